@@ -11,6 +11,72 @@
 
 #include "Service.generated.h"
 
+class FEvent;
+
+// Status of a service call started with UService::CallServiceAsync()
+enum class EServiceCallStatus : uint8
+{
+	Pending,
+	Succeeded,	// the response has been received
+	Failed,		// the request couldn't be sent, the service failed or the response couldn't be converted
+	TimedOut,	// no response has been received in time
+	Cancelled,	// FServiceCall::Cancel() has been called
+	Rejected	// too many service calls are already waiting for a response
+};
+
+/**
+ * Future of a service call started with UService::CallServiceAsync().
+ * All methods are thread safe.
+ */
+class ROSINTEGRATION_API FServiceCall
+{
+public:
+	typedef std::function<void(EServiceCallStatus, TSharedPtr<FROSBaseServiceResponse>)> FOnComplete;
+
+	FServiceCall(FOnComplete OnComplete);
+	~FServiceCall();
+
+	EServiceCallStatus GetStatus() const;
+	bool IsDone() const { return GetStatus() != EServiceCallStatus::Pending; }
+
+	// Blocks until the call is done or TimeoutSeconds elapsed (a negative value waits forever).
+	// Returns true if the call is done.
+	// Never call this from within a topic or service callback, since these run on the thread that receives the response.
+	bool Wait(float TimeoutSeconds = -1.f);
+
+	// Stops waiting for the response. Returns false if the call was already done.
+	bool Cancel();
+
+	// Only valid if the status is Succeeded
+	TSharedPtr<FROSBaseServiceResponse> GetResponse() const;
+
+	// Used by UService to finish the call. Returns false if the call was already done.
+	bool Complete(EServiceCallStatus NewStatus, TSharedPtr<FROSBaseServiceResponse> NewResponse = nullptr);
+
+	// Used by UService to release the call in rosbridge2cpp on Cancel()
+	void SetCancelFunction(std::function<void()> Function);
+
+private:
+	mutable FCriticalSection Mutex;
+	EServiceCallStatus Status = EServiceCallStatus::Pending;
+	TSharedPtr<FROSBaseServiceResponse> Response;
+	FEvent* DoneEvent = nullptr;
+	FOnComplete OnComplete;
+	std::function<void()> CancelFunction;
+};
+
+typedef TSharedPtr<FServiceCall, ESPMode::ThreadSafe> FServiceCallHandle;
+
+// Counters of the response cache of a UService, see UService::EnableResponseCache()
+struct FServiceResponseCacheStats
+{
+	uint64 Hits = 0;		// calls answered from the cache
+	uint64 Misses = 0;		// calls sent to the service
+	uint64 Collapsed = 0;	// calls that joined an identical call in flight
+	uint64 Evictions = 0;	// responses removed to stay below MaxEntries
+	int32 Entries = 0;		// cached responses
+};
+
 UCLASS()
 class ROSINTEGRATION_API UService : public UObject
 {
@@ -21,6 +87,10 @@ public:
 
 	bool Advertise(std::function<void(TSharedPtr<FROSBaseServiceRequest>, TSharedPtr<FROSBaseServiceResponse>)> ServiceHandler, bool HandleRequestsInGameThread);
 
+	// Limits how many requests of this service are handled at the same time (default: 1).
+	// Values above 1 require a thread safe ServiceHandler, unless requests are handled in the game thread.
+	void SetMaxConcurrentRequests(int32 MaxConcurrentRequests);
+
 	//// Unadvertise an advertised service
 	//// Will do nothing if no service has been advertised before in this instance
 	bool Unadvertise();
@@ -34,9 +104,33 @@ public:
 	 */
 	bool CallService(TSharedPtr<FROSBaseServiceRequest> ServiceRequest, std::function<void(TSharedPtr<FROSBaseServiceResponse>)> ServiceResponse);
 
+	/** Call a ROS-Service without blocking and get a handle to poll, wait for or cancel the call.
+	 * If no response has been received after TimeoutSeconds (<= 0 disables the timeout), the call fails with TimedOut.
+	 * OnComplete is called exactly once when the call is done, from the thread that finished it:
+	 * the rosbridge receiver thread for responses, the service call timer thread of the connection for timeouts
+	 * and responses from the response cache, or the calling thread if the call couldn't be sent.
+	 * The number of pending calls per connection is limited (see UROSIntegrationCore::SetMaxPendingServiceCalls),
+	 * calls beyond that limit fail immediately with Rejected.
+	 */
+	FServiceCallHandle CallServiceAsync(TSharedPtr<FROSBaseServiceRequest> ServiceRequest, float TimeoutSeconds = 10.f, FServiceCall::FOnComplete OnComplete = nullptr);
+
+	/** Answer repeated identical requests from a cache instead of calling the service again.
+	 * Only use this for services whose response depends on nothing but the request (e.g. map metadata, calibration).
+	 * Successful responses are kept for TTLSeconds, at most MaxEntries of them. Identical calls issued while
+	 * the first one is still waiting for its response are collapsed into that call, unless their timeout
+	 * expires before the first call's timeout does. Cached calls complete asynchronously like any other call
+	 * and can be cancelled through their handle. Requires BSON mode.
+	 */
+	void EnableResponseCache(float TTLSeconds = 60.f, int32 MaxEntries = 128);
+	void DisableResponseCache();
+	FServiceResponseCacheStats GetResponseCacheStats() const;
+
 	void MarkAsDisconnected();
 	bool Reconnect(UROSIntegrationCore* ROSIntegrationCore);
 
+	// False once UROSIntegrationCore::UpdateConnections() selected another connection for it
+	bool IsOnSelectedConnection() const;
+
 protected:
 
 	virtual FString GetDetailedInfoInternal() const override;
@@ -55,7 +149,7 @@ private:
 	// Helper to keep track of self-destruction for async functions
 	TSharedPtr<UService, ESPMode::ThreadSafe> _SelfPtr;
 
-	// PIMPL
+	// PIMPL, shared with the service worker threads that are still running a request when it is replaced
 	class Impl;
-	Impl* _Implementation = nullptr;
+	TSharedPtr<Impl, ESPMode::ThreadSafe> _Implementation;
 };
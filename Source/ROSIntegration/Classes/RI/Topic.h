@@ -33,6 +33,98 @@ enum class EMessageType : uint8
 	Twist = 19,
 };
 
+/**
+* What a full local subscriber queue does with a newly received message, see FROSSubscriptionOptions::LocalQueueLength
+*/
+UENUM(BlueprintType, Category = "ROS")
+enum class ESubscriberQueuePolicy : uint8
+{
+	// Drop the oldest queued message to make room
+	DropOldest,
+	// Drop the received message
+	DropNewest,
+	// Stop the receiver thread of the connection until the game thread has taken the queued messages. Nothing is lost,
+	// but the whole connection waits for the slowest consumer, up to FROSSubscriptionOptions::MaxReceiverBlockMs per
+	// message, then the oldest is dropped. Expect all topics of the connection to hitch for that long.
+	BlockReceiver,
+};
+
+/**
+* Delivery of messages between the topics of one UROSIntegrationCore without rosbridge, see UTopic::SetIntraProcess()
+*/
+UENUM(BlueprintType, Category = "ROS")
+enum class EIntraProcessMode : uint8
+{
+	// Every message goes through rosbridge
+	Disabled,
+	// The topic is advertised and subscribed at rosbridge as well. Subscribers receive the messages of external publishers
+	// and the ones of intra-process publishers directly. Published messages are handed directly to the subscribers in
+	// this process and always sent to rosbridge as well, whether or not anyone outside subscribes. rosbridge echoes
+	// them back to the LocalAndRemote subscribers, which drop the echo, so no subscriber gets a message twice.
+	LocalAndRemote,
+	// Messages never leave the process: the topic is neither advertised nor subscribed at rosbridge
+	LocalOnly,
+};
+
+/**
+* Options that rosbridge applies to a subscription on the server, so messages that aren't needed never cross the network,
+* and how the topic delivers the received messages locally.
+* Set them with UTopic::SetSubscriptionOptions() before subscribing.
+*/
+USTRUCT(BlueprintType)
+struct ROSINTEGRATION_API FROSSubscriptionOptions
+{
+	GENERATED_BODY()
+
+	// Minimum time in ms between two messages, rosbridge drops the messages in between. 0 sends every message.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	int32 ThrottleRate = 0;
+
+	// Messages rosbridge buffers for the subscription, 0 uses the queue size of the topic
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	int32 QueueLength = 0;
+
+	// "none" uses the SubscriptionCompression of the connection, "cbor" or "cbor-raw" (see UTopic::SetRawSubscription)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	FString Compression = TEXT("none");
+
+	// rosbridge splits messages larger than this many bytes into fragments, 0 never splits messages
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	int32 FragmentSize = 0;
+
+	// Keep only the newest received message and deliver it on the game thread once per frame, messages that are
+	// replaced before the frame starts are skipped. For control and state topics (cmd_vel, joint targets, goal poses).
+	// The callback of Subscribe() is then called on the game thread instead of the receiver thread.
+	// Same as a LocalQueueLength of 1 with DropOldest.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	bool Conflate = false;
+
+	// Received messages are queued and delivered on the game thread once per frame, at most this many at a time.
+	// 0 (and a LocalQueueBytes of 0) calls the callback on the receiver thread, Blueprint events are posted to the game thread unbounded.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	int32 LocalQueueLength = 0;
+
+	// Limit of the queued messages in received bytes, 0 doesn't limit them. A single larger message is still queued.
+	// Messages of intra-process publishers have no received size, so subscriptions with UTopic::SetIntraProcess() need a
+	// LocalQueueLength as well.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	int32 LocalQueueBytes = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	ESubscriberQueuePolicy LocalQueuePolicy = ESubscriberQueuePolicy::DropOldest;
+
+	// BlockReceiver only: how long the receiver thread waits for room in the queue before it drops the oldest message.
+	// No other topic of the connection receives anything meanwhile, so keep it below the hitch the application tolerates.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	int32 MaxReceiverBlockMs = 1000;
+
+	// Share one rosbridge subscription with the other shared subscriptions of the topic that have the same type and the
+	// same rosbridge side options (ThrottleRate, QueueLength, Compression, FragmentSize): every message is decoded once
+	// and all of them get the same message object, so the callbacks must not modify it. The local options stay per topic.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	bool Shared = false;
+};
+
 UCLASS(Blueprintable)
 class ROSINTEGRATION_API UTopic: public UObject
 {
@@ -42,6 +134,40 @@ public:
 
 	bool Subscribe(std::function<void(TSharedPtr<FROSBaseMsg>)> func);
 
+	/**
+	 * Let rosbridge send the ROS1 serialized messages instead of converting them field by field (compression "cbor-raw").
+	 * Much cheaper on both ends for large messages, but only the converters of sensor_msgs/Image, sensor_msgs/PointCloud2,
+	 * sensor_msgs/LaserScan, nav_msgs/Odometry and tf2_msgs/TFMessage can decode them, other types ignore the setting.
+	 * Needs the BSON mode and a ROS1 rosbridge. Call before Subscribe().
+	 * Same as setting the Compression of the subscription options to "cbor-raw".
+	 */
+	void SetRawSubscription(bool RawSubscription);
+
+	/**
+	 * Throttling, queue length, compression and fragmentation of the subscription on the rosbridge side and
+	 * conflating or queued delivery on this side.
+	 * Call before Subscribe(), the options are kept when the topic reconnects.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ROS|Topic")
+	void SetSubscriptionOptions(const FROSSubscriptionOptions& Options);
+
+	const FROSSubscriptionOptions& GetSubscriptionOptions() const { return _SubscriptionOptions; }
+
+	/**
+	 * Hand published messages directly to the subscribers of the same topic in this process (on the same
+	 * UROSIntegrationCore), without converting them and without the round trip through rosbridge. Both the publishing
+	 * and the subscribing topic need a mode other than Disabled. Subscribers get the TSharedPtr the publisher passed to
+	 * Publish(), so neither side may modify the message afterwards. The callback is called on the publishing thread,
+	 * or once per frame on the game thread with a local queue (see FROSSubscriptionOptions::LocalQueueLength).
+	 * rosbridge echoes the messages of a LocalAndRemote publisher back, LocalAndRemote subscribers recognize and drop
+	 * the echo of a message they already received directly (see EIntraProcessMode).
+	 * Call before Subscribe() and Advertise(), the mode is kept when the topic reconnects.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ROS|Topic")
+	void SetIntraProcess(EIntraProcessMode Mode);
+
+	EIntraProcessMode GetIntraProcess() const { return _IntraProcess; }
+
 	bool Unsubscribe();
 
 	bool Advertise();
@@ -58,6 +184,9 @@ public:
 
 	void MarkAsDisconnected();
 	bool Reconnect(UROSIntegrationCore* ROSIntegrationCore);
+
+	// False once UROSIntegrationCore::UpdateConnections() selected another connection for it
+	bool IsOnSelectedConnection() const;
 	
 	bool IsAdvertising();
 
@@ -117,6 +246,12 @@ private:
 		EMessageType BlueprintMessageType;
 	} _State;
 
+	UPROPERTY()
+	FROSSubscriptionOptions _SubscriptionOptions;
+
+	UPROPERTY()
+	EIntraProcessMode _IntraProcess = EIntraProcessMode::Disabled;
+
 
 	UFUNCTION(BlueprintCallable, Category = "ROS|Topic")
 	void Init(const FString& TopicName, EMessageType MessageType, int32 QueueSize = 1);
@@ -133,7 +268,7 @@ private:
 	// Helper to keep track of self-destruction for async functions
 	TSharedPtr<UTopic, ESPMode::ThreadSafe> _SelfPtr;
 
-	// PIMPL
+	// PIMPL, shared with the intra-process publishers that are delivering a message to it when it is replaced
 	class Impl;
-	Impl *_Implementation = nullptr;
+	TSharedPtr<Impl, ESPMode::ThreadSafe> _Implementation;
 };
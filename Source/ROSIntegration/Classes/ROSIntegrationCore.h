@@ -3,13 +3,185 @@
 #include <CoreMinimal.h>
 #include <UObject/ObjectMacros.h>
 #include <UObject/Object.h>
+#include <Stats/Stats.h>
+
+#include <functional>
 
 #include "ROSIntegrationCore.generated.h"
 
 ROSINTEGRATION_API DECLARE_LOG_CATEGORY_EXTERN(LogROS, Display, All);
 
+DECLARE_STATS_GROUP(TEXT("ROSIntegration"), STATGROUP_ROSIntegration, STATCAT_Advanced);
+
 
 class USpawnManager;
+class UTopic;
+class UService;
+class FROSBlueprintEventQueue;
+
+// Result of advertising or subscribing a topic or advertising a service, broadcast on the game thread.
+// Operation is "advertise", "subscribe" or "advertise_service".
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnROSRegistrationResult, const FString& /*Name*/, const FString& /*Operation*/, bool /*bSuccess*/);
+
+
+// Latency summary of one pipeline segment of a topic, see UROSIntegrationCore::GetLatencyStats()
+struct FROSLatencyStats
+{
+	FString Topic;
+	FString Segment;
+	uint64 Count = 0;
+	double MeanMs = 0.0;
+	double P50Ms = 0.0;
+	double P90Ms = 0.0;
+	double P99Ms = 0.0;
+	double MaxMs = 0.0;
+};
+
+
+// Runtime counters of a topic since the connection was established, see UROSIntegrationCore::GetTopicMetrics()
+USTRUCT(BlueprintType)
+struct ROSINTEGRATION_API FROSTopicMetrics
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	FString Topic;
+
+	// Messages passed to Publish(), including the dropped ones
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 Published = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 Sent = 0;
+
+	// Messages lost to a full publisher queue (see QueueSize) or a failed write
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 Dropped = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 BytesOut = 0;
+
+	// Messages currently waiting in the publisher queue
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 QueueDepth = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 Received = 0;
+
+	// Received messages that have been converted for a subscriber
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 Decoded = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 DecodeFailures = 0;
+
+	// Decoded messages a conflating subscription skipped because a newer one arrived before the next frame
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 Conflated = 0;
+
+	// Decoded messages lost to a full local subscriber queue (see FROSSubscriptionOptions::LocalQueueLength)
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 LocalDropped = 0;
+
+	// Times a full local subscriber queue with the BlockReceiver policy stopped the receiver thread
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 ReceiverBlocked = 0;
+
+	// Published messages handed to subscribers in the same process without rosbridge (see UTopic::SetIntraProcess)
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 DeliveredLocally = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 BytesIn = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	float AvgSendTimeMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	float AvgDecodeTimeMs = 0.f;
+};
+
+// Runtime counters of the rosbridge connection, including service and subscription traffic
+USTRUCT(BlueprintType)
+struct ROSINTEGRATION_API FROSConnectionMetrics
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 MessagesSent = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 BytesSent = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 SendErrors = 0;
+
+	// Writes that were given up because rosbridge didn't read within the send timeout
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 SendStalls = 0;
+
+	// Binary fields that were passed to rosbridge through shared memory instead of the socket
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 SharedMemoryPayloads = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 SharedMemoryBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 MessagesReceived = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 BytesReceived = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 PendingServiceCalls = 0;
+
+	// Blueprint topic events dropped because the game thread didn't call them fast enough,
+	// see UROSIntegrationGameInstance::BlueprintEventQueueCapacity
+	UPROPERTY(BlueprintReadOnly, Category = "ROS")
+	int64 BlueprintEventsDropped = 0;
+};
+
+
+// An additional connection to a rosbridge server, see UROSIntegrationCore::SetAdditionalConnections().
+// Each connection has its own socket, receiver and publisher thread, so a large message on one of them doesn't delay the others.
+// It carries the topics and services listed in Topics and, with bLoadBalance, a share of all the others.
+USTRUCT(BlueprintType)
+struct ROSINTEGRATION_API FROSBridgeConnectionSettings
+{
+	GENERATED_BODY()
+
+	// Only used in log messages
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	FString Name;
+
+	// Empty to use the protocol of the main connection
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	FString Protocol;
+
+	// Empty to use the host of the main connection
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	FString Host;
+
+	// 0 to use the port of the main connection
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	int32 Port = 0;
+
+	// Topics and services that always use this connection. A trailing '*' matches all names with that prefix, e.g. /camera/*
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	TArray<FString> Topics;
+
+	// Adds the server to the pool that the unassigned topics and services are spread over (by a hash of their name),
+	// together with the main connection. A pool server that can't be reached is skipped and its share goes to the others
+	// until it is reconnected, see UROSIntegrationCore::UpdateConnections(). The assigned Topics of a connection that is
+	// down use the pool in the meantime.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	bool bLoadBalance = false;
+
+	// Empty to use the subscription compression of the main connection, see UROSIntegrationCore::SetSubscriptionCompression()
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	FString SubscriptionCompression;
+};
 
 
 class TDeleterNot
@@ -66,13 +238,97 @@ public:
 
 	bool Init(FString protocol, FString ROSBridgeHost, int32 ROSBridgePort);
 
+	// Whether the main connection is up. Additional connections that fail are handled by UpdateConnections().
 	bool IsHealthy() const;
 
+	// Reconnects in the background after IsHealthy() turned false: the first call starts connecting, later calls only
+	// check for the result, so they never block on the network. Once connected, every registered topic and service is
+	// advertised and subscribed again and true is returned.
+	bool PollReconnect();
+
+	// Moves the topics and services of additional connections that went down to the remaining ones, reconnects those
+	// connections in the background and moves their topics and services back once they are up again. Call it regularly
+	// while IsHealthy(). Returns false if a topic or service couldn't be re-established.
+	bool UpdateConnections();
+
+	// Topics and services that are re-established by PollReconnect(), UTopic::Init() and UService::Init() register them
+	void RegisterTopic(UTopic* Topic);
+	void RegisterService(UService* Service);
+	TArray<UTopic*> GetTopics() const;
+	TArray<UService*> GetServices() const;
+
 	// You must call Init() before using this method to set upthe Implmentation correctly
 	void SetWorld(UWorld* World);
 
 	void InitSpawnManager();
 
+	// PollReconnect() only restores a spawn manager that was set up before
+	bool IsSpawnManagerInitialized() const;
+
+	// Number of threads that handle requests for advertised services. 0 handles them on the receiving thread,
+	// which blocks all incoming topic traffic while a service callback runs. Must be called before Init().
+	void SetServiceWorkerThreads(int32 NumThreads) { _ServiceWorkerThreads = NumThreads; }
+
+	// Opens one more connection per entry. Topics and services use the connection they are assigned to, otherwise
+	// one of the load balanced connections or the main connection. Must be called before Init().
+	void SetAdditionalConnections(const TArray<FROSBridgeConnectionSettings>& Connections) { _AdditionalConnections = Connections; }
+
+	// Time a connection attempt may take, and the range of the randomized exponential backoff between reconnect attempts.
+	// Must be called before Init().
+	void SetConnectTimeout(float Seconds) { _ConnectTimeout = Seconds; }
+	void SetReconnectBackoff(float MinSeconds, float MaxSeconds) { _MinReconnectBackoff = MinSeconds; _MaxReconnectBackoff = MaxSeconds; }
+
+	// Time a TCP write may wait for room in the socket buffer before the message is dropped, and the socket buffer
+	// sizes in bytes (0 keeps the default of the OS). Must be called before Init().
+	void SetSendTimeout(float Seconds) { _SendTimeout = Seconds; }
+	void SetSocketBufferSizes(int32 SendBufferSize, int32 ReceiveBufferSize) { _SocketSendBufferSize = SendBufferSize; _SocketReceiveBufferSize = ReceiveBufferSize; }
+
+	// Collects the advertise, subscribe and advertise_service messages of all topics and services and writes them
+	// together every ~10ms, instead of one blocking write each. Their results are reported by OnRegistrationResult.
+	// Enabled by default. Must be called before Init().
+	void SetBatchRegistrations(bool bEnabled) { _bBatchRegistrations = bEnabled; }
+
+	// Image, CompressedImage and PointCloud2 data of at least MinPayloadSize bytes is written into a shared memory ring of
+	// NumSlots slots of SlotSize bytes, and only its location is sent over the socket. Only used if the rosbridge server runs
+	// on the same host and maps the ring, otherwise the data is sent inline. Disabled by default. Must be called before Init().
+	void SetSharedMemoryPayloads(bool bEnabled, int32 NumSlots, int32 SlotSize, int32 MinPayloadSize)
+	{
+		_bSharedMemoryPayloads = bEnabled; _SharedMemorySlots = NumSlots; _SharedMemorySlotSize = SlotSize; _MinSharedMemoryPayloadSize = MinPayloadSize;
+	}
+
+	// "cbor" lets rosbridge send the messages of subscribed topics CBOR encoded instead of BSON, where numeric arrays
+	// (LaserScan ranges, JointState positions, Float32MultiArray data, ...) take 4 or 8 bytes per element instead of ~12-16.
+	// Published messages stay BSON. "none" by default. Must be called before Init().
+	void SetSubscriptionCompression(const FString& Compression) { _SubscriptionCompression = Compression; }
+
+	// Queue of the Blueprint topic events of the game instance, whose drops are part of the connection metrics
+	void SetBlueprintEventQueue(TSharedPtr<FROSBlueprintEventQueue, ESPMode::ThreadSafe> Queue) { _BlueprintEventQueue = Queue; }
+
+	// Handler for the result of a registration, which logs a failure and broadcasts OnRegistrationResult
+	std::function<void(bool)> MakeRegistrationResultHandler(const FString& Name, const FString& Operation);
+
+	FOnROSRegistrationResult OnRegistrationResult;
+
+	// Limits the number of service calls that wait for a response, see UService::CallServiceAsync().
+	// Applies to every connection, including the ones of later reconnects.
+	void SetMaxPendingServiceCalls(int32 MaxPendingServiceCalls);
+
+	// Per topic latency tracing of the publish pipeline (header.stamp -> Publish -> converter -> queue -> socket)
+	// and the receive pipeline (receive -> dispatch -> converter -> callback). Disabled by default.
+	void SetLatencyTracingEnabled(bool bEnabled);
+	bool IsLatencyTracingEnabled() const;
+	TArray<FROSLatencyStats> GetLatencyStats() const;
+	bool DumpLatencyStatsToCSV(const FString& Filename) const;
+	void ResetLatencyStats();
+
+	// Per topic and connection counters since the connection was established or ResetMetrics() was called
+	TArray<FROSTopicMetrics> GetTopicMetrics() const;
+	FROSConnectionMetrics GetConnectionMetrics() const;
+	void ResetMetrics();
+
+	// Pushes the current traffic counters and latency percentiles to the ROSIntegration stats group ('stat ROSIntegration')
+	void UpdateStats();
+
 	void BeginDestroy() override;
 
 private:
@@ -88,6 +344,35 @@ private:
 
 	bool _bson_test_mode = true;
 
+	int32 _ServiceWorkerThreads = 0;
+	int32 _MaxPendingServiceCalls = 1024;
+
+	TArray<FROSBridgeConnectionSettings> _AdditionalConnections;
+
+	bool _bBatchRegistrations = true;
+
+	float _ConnectTimeout = 2.f;
+	float _SendTimeout = 1.f;
+	int32 _SocketSendBufferSize = 0;
+	int32 _SocketReceiveBufferSize = 0;
+	bool _bSharedMemoryPayloads = false;
+	int32 _SharedMemorySlots = 8;
+	int32 _SharedMemorySlotSize = 32 * 1024 * 1024;
+	int32 _MinSharedMemoryPayloadSize = 64 * 1024;
+	FString _SubscriptionCompression = TEXT("none");
+	float _MinReconnectBackoff = 0.5f;
+	float _MaxReconnectBackoff = 30.f;
+
+	TArray<TWeakObjectPtr<UTopic>> _Topics;
+	TArray<TWeakObjectPtr<UService>> _Services;
+
+	TWeakPtr<FROSBlueprintEventQueue, ESPMode::ThreadSafe> _BlueprintEventQueue;
+
+	// for the rates in UpdateStats()
+	FROSConnectionMetrics _LastStatsConnectionMetrics;
+	int64 _LastStatsDropped = 0;
+	double _LastStatsTime = 0.0;
+
 	friend class UTopic;
 	friend class UService;
 };
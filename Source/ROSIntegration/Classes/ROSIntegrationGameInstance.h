@@ -1,8 +1,12 @@
 #pragma once
 
 #include <CoreMinimal.h>
+#include <Containers/Queue.h>
+#include <Containers/Ticker.h>
 #include <Engine/GameInstance.h>
 #include <Engine/EngineTypes.h>
+#include <HAL/ThreadSafeCounter.h>
+#include <HAL/ThreadSafeCounter64.h>
 #include <Runtime/Launch/Resources/Version.h>
 #include "ROSIntegrationCore.h"
 
@@ -11,6 +15,55 @@
 // Lets the game instance share with any bound delegates that the ROS connection status has changed
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnROSConnectionStatus, bool /*IsConnected*/);
 
+#if ENGINE_MAJOR_VERSION > 4
+typedef FTSTicker FROSCoreTicker;
+typedef FTSTicker::FDelegateHandle FROSTickerHandle;
+#else
+typedef FTicker FROSCoreTicker;
+typedef FDelegateHandle FROSTickerHandle;
+#endif
+
+/**
+ * Blueprint topic events (OnStringMessage, ...) received on the connection threads. The threads push them into a lock
+ * free queue and the game instance calls them once per frame, instead of one AsyncTask per message.
+ * The queue holds up to Capacity events, further events are dropped until the game thread catches up. Only the game
+ * thread takes events out of the queue, so it is the newest event that is dropped.
+ */
+class ROSINTEGRATION_API FROSBlueprintEventQueue
+{
+public:
+	// Returns false if the queue is full and the event was dropped
+	bool Enqueue(TFunction<void()> Event)
+	{
+		if (NumQueued.Increment() > Capacity)
+		{
+			NumQueued.Decrement();
+			NumDropped.Increment();
+			return false;
+		}
+		Events.Enqueue(MoveTemp(Event));
+		return true;
+	}
+
+	// 0 or less doesn't limit the queue
+	void SetCapacity(int32 InCapacity) { Capacity = InCapacity > 0 ? InCapacity : MAX_int32; }
+
+	// Calls the queued events on the game thread until the queue is empty or BudgetSeconds passed (0 doesn't limit it).
+	// Events queued while dispatching wait for the next frame. Returns the number of called events.
+	int32 Dispatch(double BudgetSeconds);
+
+	int32 Num() const { return NumQueued.GetValue(); }
+
+	int64 NumDroppedEvents() const { return NumDropped.GetValue(); }
+	void ResetDroppedEvents() { NumDropped.Reset(); }
+
+private:
+	TQueue<TFunction<void()>, EQueueMode::Mpsc> Events;
+	FThreadSafeCounter NumQueued; // counts the events that are being enqueued as well
+	FThreadSafeCounter64 NumDropped;
+	int32 Capacity = MAX_int32;
+};
+
 UCLASS()
 class ROSINTEGRATION_API UROSIntegrationGameInstance : public UGameInstance
 {
@@ -25,6 +78,8 @@ public:
 	UPROPERTY()
 	UROSIntegrationCore* ROSIntegrationCore = nullptr;
 
+	// "tcp", "ws" or "unix". unix connects to a rosbridge server on the same host through a Unix domain socket,
+	// the host is then the path of the socket and the port is ignored (BSON mode only, not on Windows).
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
 	FString ROSBridgeServerProtocol = "tcp";
 
@@ -55,6 +110,109 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS", Meta = (EditCondition = "bCheckHealth"))
 	float CheckHealthInterval = 1.0f;
 
+	// Seconds a connection attempt may take before it is given up
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	float ConnectTimeout = 2.0f;
+
+	// Seconds a write may wait while rosbridge doesn't read (e.g. when it is overloaded) before the message is dropped.
+	// Only the tcp protocol, counted as SendStalls in the connection metrics.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	float SendTimeout = 1.0f;
+
+	// Size of the kernel socket buffers (SO_SNDBUF/SO_RCVBUF) in bytes, 0 keeps the default of the OS.
+	// A larger send buffer lets large messages like images be written without waiting for rosbridge.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	int32 SocketSendBufferSize = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	int32 SocketReceiveBufferSize = 0;
+
+	// Image, CompressedImage and PointCloud2 data is handed to a rosbridge on the same host through shared memory instead of
+	// the socket. Needs a server that maps the ring (see README), otherwise the data is sent inline as before. Not on Windows.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	bool bSharedMemoryPayloads = false;
+
+	// Payloads waiting for rosbridge at the same time, at most 64
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS", Meta = (EditCondition = "bSharedMemoryPayloads"))
+	int32 SharedMemorySlots = 8;
+
+	// Largest payload in bytes, larger ones are sent inline. The memory is only used once a payload is written.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS", Meta = (EditCondition = "bSharedMemoryPayloads"))
+	int32 SharedMemorySlotSize = 33554432;
+
+	// Smaller payloads are sent inline, the acknowledgement isn't worth it for them
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS", Meta = (EditCondition = "bSharedMemoryPayloads"))
+	int32 MinSharedMemoryPayloadSize = 65536;
+
+	// "cbor" to receive subscribed topics CBOR encoded, which shrinks messages with numeric arrays (LaserScan, JointState,
+	// Float32MultiArray, ...) to a third or less. Needs a rosbridge server with CBOR support (rosbridge_suite 0.11 or newer).
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	FString SubscriptionCompression = TEXT("none");
+
+	// Reconnect attempts run in the background, the delay between them doubles from the min to the max backoff (randomized by +-50%)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS", Meta = (EditCondition = "bCheckHealth"))
+	float MinReconnectBackoff = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS", Meta = (EditCondition = "bCheckHealth"))
+	float MaxReconnectBackoff = 30.0f;
+
+	// Advertise and subscribe messages are written in batches instead of one blocking write each, which speeds up
+	// starting levels with many topics. Failures are logged and reported by UROSIntegrationCore::OnRegistrationResult.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	bool bBatchRegistrations = true;
+
+	// Number of threads that handle requests for services advertised by UService.
+	// With 0, requests are handled on the receiving thread and block all incoming topic traffic while a request is handled.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	int32 ServiceWorkerThreads = 2;
+
+	// Extra rosbridge connections, either dedicated to bulk topics (e.g. one per camera, so they don't delay /tf or /cmd_vel
+	// on the main connection) or, with bLoadBalance, a pool of rosbridge servers that shares the load of the main one
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	TArray<FROSBridgeConnectionSettings> AdditionalConnections;
+
+	// Service calls beyond this number of calls waiting for a response are rejected
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "ROS")
+	int32 MaxPendingServiceCalls = 1024;
+
+	// Collect per topic latency histograms of the publish and receive pipeline, see 'stat ROSIntegration' and DumpLatencyStats()
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	bool bTraceLatency = false;
+
+	// Writes the collected latency percentiles as CSV (topic,segment,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms)
+	UFUNCTION(BlueprintCallable, Category = "ROS")
+	bool DumpLatencyStats(const FString& Filename);
+
+	// Publishes the topic and connection counters as diagnostic_msgs/DiagnosticArray on /diagnostics
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	bool bPublishDiagnostics = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS", Meta = (EditCondition = "bPublishDiagnostics"))
+	float DiagnosticsInterval = 1.0f;
+
+	// Per topic counters (published, sent, dropped, received, decoded, bytes, queue depth, send and decode time)
+	UFUNCTION(BlueprintCallable, Category = "ROS")
+	TArray<FROSTopicMetrics> GetTopicMetrics() const;
+
+	UFUNCTION(BlueprintCallable, Category = "ROS")
+	FROSConnectionMetrics GetConnectionMetrics() const;
+
+	UFUNCTION(BlueprintCallable, Category = "ROS")
+	void ResetMetrics();
+
+	// Time per frame in ms for calling the Blueprint topic events that arrived since the last frame, the remaining events
+	// wait for the next frame. 0 calls all of them. Set Conflate in the subscription options of a topic to get only its newest message.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	float BlueprintEventBudgetMs = 0.f;
+
+	// Blueprint topic events beyond this number of events waiting for the game thread are dropped and counted as
+	// BlueprintEventsDropped in the connection metrics. 0 doesn't limit the queue.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ROS")
+	int32 BlueprintEventQueueCapacity = 10000;
+
+	// Queue of the Blueprint topic events, valid after Init()
+	TSharedPtr<FROSBlueprintEventQueue, ESPMode::ThreadSafe> GetBlueprintEventQueue() const { return BlueprintEventQueue; }
+
 	FOnROSConnectionStatus OnROSConnectionStatus;
 
 protected:
@@ -64,6 +222,12 @@ protected:
 
 	void MarkAllROSObjectsAsDisconnected();
 
+	void UpdateROSStats();
+
+	void PublishDiagnostics();
+
+	bool DispatchBlueprintEvents(float DeltaTime);
+
 #if ENGINE_MINOR_VERSION > 23 || ENGINE_MAJOR_VERSION >4
 	virtual void OnWorldTickStart(UWorld * World, ELevelTick TickType, float DeltaTime);
 #else 
@@ -73,13 +237,27 @@ protected:
 	FTimerHandle TimerHandle_CheckHealth;
 	bool bTimerSet = false;  // has the time been set?
 
-	bool bReconnect = false;
+	FTimerHandle TimerHandle_UpdateStats;
+
+	FTimerHandle TimerHandle_PublishDiagnostics;
+
+	TSharedPtr<FROSBlueprintEventQueue, ESPMode::ThreadSafe> BlueprintEventQueue;
+	FROSTickerHandle TickerHandle_BlueprintEvents;
 
 	FCriticalSection initMutex_;
 
 	UPROPERTY()
 	class UTopic* ClockTopic = nullptr;
 
+	UPROPERTY()
+	class UTopic* DiagnosticsTopic = nullptr;
+
+	// counters of the previous diagnostics message, to report rates and new drops
+	TMap<FString, FROSTopicMetrics> LastDiagnosticsTopicMetrics;
+	FROSConnectionMetrics LastDiagnosticsConnectionMetrics;
+	double LastDiagnosticsTime = 0.0;
+	uint32 DiagnosticsSeq = 0;
+
 	bool bAddedOnWorldTickDelegate = false;
 };
 
@@ -0,0 +1,1030 @@
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "Conversion/ConverterBenchmark.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectIterator.h"
+
+#include "Conversion/Messages/BaseMessageConverter.h"
+
+#include "actionlib_msgs/GoalID.h"
+#include "actionlib_msgs/GoalStatus.h"
+#include "actionlib_msgs/GoalStatusArray.h"
+#include "diagnostic_msgs/DiagnosticArray.h"
+#include "diagnostic_msgs/DiagnosticStatus.h"
+#include "diagnostic_msgs/KeyValue.h"
+#include "geometry_msgs/Point.h"
+#include "geometry_msgs/Pose.h"
+#include "geometry_msgs/PoseStamped.h"
+#include "geometry_msgs/PoseWithCovariance.h"
+#include "geometry_msgs/Quaternion.h"
+#include "geometry_msgs/Transform.h"
+#include "geometry_msgs/TransformStamped.h"
+#include "geometry_msgs/Twist.h"
+#include "geometry_msgs/TwistStamped.h"
+#include "geometry_msgs/TwistWithCovariance.h"
+#include "geometry_msgs/Vector3.h"
+#include "grid_map_msgs/GridMap.h"
+#include "grid_map_msgs/GridMapInfo.h"
+#include "nav_msgs/MapMetaData.h"
+#include "nav_msgs/OccupancyGrid.h"
+#include "nav_msgs/Odometry.h"
+#include "nav_msgs/Path.h"
+#include "rosgraph_msgs/Clock.h"
+#include "sensor_msgs/CameraInfo.h"
+#include "sensor_msgs/CompressedImage.h"
+#include "sensor_msgs/Image.h"
+#include "sensor_msgs/Imu.h"
+#include "sensor_msgs/JointState.h"
+#include "sensor_msgs/LaserScan.h"
+#include "sensor_msgs/NavSatFix.h"
+#include "sensor_msgs/NavSatStatus.h"
+#include "sensor_msgs/PointCloud2.h"
+#include "sensor_msgs/RegionOfInterest.h"
+#include "std_msgs/Bool.h"
+#include "std_msgs/Float32.h"
+#include "std_msgs/Float32MultiArray.h"
+#include "std_msgs/Header.h"
+#include "std_msgs/Int32.h"
+#include "std_msgs/Int64.h"
+#include "std_msgs/MultiArrayDimension.h"
+#include "std_msgs/MultiArrayLayout.h"
+#include "std_msgs/String.h"
+#include "std_msgs/UInt8.h"
+#include "std_msgs/UInt8MultiArray.h"
+#include "tf2_msgs/TFMessage.h"
+// std_msgs/Empty.h is not included since it declares a second std_msgs::String
+
+#include <cstdlib>
+
+/**
+ * Microbenchmark for all message converters.
+ *
+ *   ROSIntegration.BenchmarkConverters [Filter=<substring>] [MinTime=<seconds>] [MaxDecodeElements=<n>]
+ *                                      [Baseline=<csv>] [Tolerance=<fraction>] [-SaveBaseline]
+ *
+ * Every case builds a representative message once and measures ConvertOutgoingMessage and
+ * ConvertIncomingMessage in ns/msg, bytes/msg and libbson allocations/msg. Engine allocations aren't
+ * counted: that would take swapping GMalloc while the other threads of the engine allocate.
+ * Results are written to Saved/ROSIntegration/ConverterBenchmark.csv and compared against the
+ * baseline file of the plugin (Tools/ConverterBenchmark/ConverterBenchmarkBaseline.csv), which is
+ * written instead with -SaveBaseline. Cases that aren't measured are written as rows with the status
+ * "decode skipped", "no converter", "encode failed" or "decode failed".
+ * The benchmark blocks the calling thread; the large cases take several seconds each.
+ */
+namespace
+{
+	// libbson allocations of the current thread while a FScopedBsonAllocationCount is alive
+	thread_local bool bCountBsonAllocations = false;
+	thread_local uint64 NumBsonAllocations = 0;
+
+	void* CountingBsonMalloc(size_t NumBytes)
+	{
+		if (bCountBsonAllocations) ++NumBsonAllocations;
+		return malloc(NumBytes);
+	}
+
+	void* CountingBsonCalloc(size_t NumMembers, size_t NumBytes)
+	{
+		if (bCountBsonAllocations) ++NumBsonAllocations;
+		return calloc(NumMembers, NumBytes);
+	}
+
+	void* CountingBsonRealloc(void* Mem, size_t NumBytes)
+	{
+		if (bCountBsonAllocations) ++NumBsonAllocations;
+		return realloc(Mem, NumBytes);
+	}
+
+	void CountingBsonFree(void* Mem)
+	{
+		free(Mem);
+	}
+
+	// Counts the libbson allocations of the current thread for as long as it lives. Only touches thread local state,
+	// the allocator itself is installed once at startup, see InitConverterBenchmark().
+	class FScopedBsonAllocationCount
+	{
+	public:
+		FScopedBsonAllocationCount()
+		{
+			NumBsonAllocations = 0;
+			bCountBsonAllocations = true;
+		}
+
+		~FScopedBsonAllocationCount()
+		{
+			bCountBsonAllocations = false;
+		}
+
+		uint64 Get() const { return NumBsonAllocations; }
+	};
+
+	struct FConverterBenchmarkCase
+	{
+		FString Name;
+		FString MessageType;
+
+		// Number of elements of the largest array that is converted element by element (not as binary).
+		// Decoding looks up every element by its dotted key, so its cost grows quadratically with this.
+		int32 LargestElementArray;
+
+		// Builds the message. Payloads that are referenced by pointer (images, point clouds) are stored in Buffer.
+		TFunction<TSharedPtr<FROSBaseMsg>(TArray<uint8>& Buffer)> Create;
+	};
+
+	struct FConverterBenchmarkResult
+	{
+		FString Name;
+		FString MessageType;
+		FString Status = TEXT("ok");
+		int64 Bytes = 0;
+		double EncodeNs = 0.0;
+		int64 EncodeAllocs = 0;
+		int32 EncodeIterations = 0;
+		double DecodeNs = -1.0;
+		int64 DecodeAllocs = -1;
+		int32 DecodeIterations = 0;
+		FString Note;
+	};
+
+	struct FBenchmarkSettings
+	{
+		FString Filter;
+		double MinTime = 0.25;
+		int32 MaxIterations = 100000;
+		int32 MaxDecodeElements = 20000;
+		FString BaselineFile;
+		double Tolerance = 0.2;
+		bool bSaveBaseline = false;
+	};
+
+	ROSMessages::std_msgs::Header MakeHeader(uint32 Seq = 1)
+	{
+		return ROSMessages::std_msgs::Header(Seq, FROSTime(1600000000, 123456789), TEXT("base_link"));
+	}
+
+	ROSMessages::geometry_msgs::Pose MakePose(double Offset = 0.0)
+	{
+		ROSMessages::geometry_msgs::Pose Pose;
+		Pose.position = ROSMessages::geometry_msgs::Point(1.0 + Offset, 2.0 - Offset, 0.5);
+		Pose.orientation = ROSMessages::geometry_msgs::Quaternion(0.0, 0.0, 0.3826834, 0.9238795);
+		return Pose;
+	}
+
+	ROSMessages::geometry_msgs::Twist MakeTwist()
+	{
+		ROSMessages::geometry_msgs::Twist Twist;
+		Twist.linear = ROSMessages::geometry_msgs::Vector3(0.5, 0.0, 0.0);
+		Twist.angular = ROSMessages::geometry_msgs::Vector3(0.0, 0.0, 0.2);
+		return Twist;
+	}
+
+	TArray<double> MakeCovariance(int32 Num)
+	{
+		TArray<double> Covariance;
+		Covariance.Init(0.0, Num);
+		for (int32 i = 0; i < Num; i += 7)
+		{
+			Covariance[i] = 0.01;
+		}
+		return Covariance;
+	}
+
+	ROSMessages::geometry_msgs::TransformStamped MakeTransformStamped(int32 Index)
+	{
+		ROSMessages::geometry_msgs::TransformStamped Transform;
+		Transform.header = MakeHeader();
+		Transform.child_frame_id = FString::Printf(TEXT("link_%d"), Index);
+		Transform.transform.translation = ROSMessages::geometry_msgs::Vector3(0.1 * Index, 0.0, 0.2);
+		Transform.transform.rotation = ROSMessages::geometry_msgs::Quaternion(0.0, 0.0, 0.0, 1.0);
+		return Transform;
+	}
+
+	ROSMessages::std_msgs::MultiArrayDimension MakeDimension(const FString& Label, uint32 Size, uint32 Stride)
+	{
+		ROSMessages::std_msgs::MultiArrayDimension Dimension;
+		Dimension.label = Label;
+		Dimension.size = Size;
+		Dimension.stride = Stride;
+		return Dimension;
+	}
+
+	ROSMessages::diagnostic_msgs::DiagnosticStatus MakeDiagnosticStatus(int32 Index, int32 NumValues)
+	{
+		ROSMessages::diagnostic_msgs::DiagnosticStatus Status;
+		Status.level = ROSMessages::diagnostic_msgs::DiagnosticStatus::LEVEL_OK;
+		Status.name = FString::Printf(TEXT("ROSIntegration: /topic_%d"), Index);
+		Status.message = TEXT("OK");
+		Status.hardware_id = TEXT("benchmark");
+		for (int32 i = 0; i < NumValues; ++i)
+		{
+			Status.values.Add(ROSMessages::diagnostic_msgs::KeyValue(FString::Printf(TEXT("key_%d"), i), FString::Printf(TEXT("%d"), i * 1000)));
+		}
+		return Status;
+	}
+
+	ROSMessages::actionlib_msgs::GoalStatus MakeGoalStatus(int32 Index)
+	{
+		ROSMessages::actionlib_msgs::GoalStatus Status;
+		Status.goal_id.stamp = FROSTime(1600000000, 0);
+		Status.goal_id.id = FString::Printf(TEXT("/move_base-%d-1600000000.000000000"), Index);
+		Status.status = ROSMessages::actionlib_msgs::GoalStatus::ACTIVE;
+		Status.text = TEXT("This goal is currently being processed by the action server");
+		return Status;
+	}
+
+	TSharedPtr<FROSBaseMsg> MakePath(int32 NumPoses)
+	{
+		auto Msg = MakeShared<ROSMessages::nav_msgs::Path>();
+		Msg->header = MakeHeader();
+		Msg->poses.Reserve(NumPoses);
+		for (int32 i = 0; i < NumPoses; ++i)
+		{
+			ROSMessages::geometry_msgs::PoseStamped Pose;
+			Pose.header = MakeHeader(i);
+			Pose.pose = MakePose(i * 0.01);
+			Msg->poses.Add(Pose);
+		}
+		return Msg;
+	}
+
+	TSharedPtr<FROSBaseMsg> MakeOccupancyGrid(uint32 Width, uint32 Height)
+	{
+		auto Msg = MakeShared<ROSMessages::nav_msgs::OccupancyGrid>();
+		Msg->header = MakeHeader();
+		Msg->info = ROSMessages::nav_msgs::MapMetaData(FROSTime(1600000000, 0), 0.05f, Width, Height, MakePose());
+		Msg->data.SetNumUninitialized(Width * Height);
+		for (uint32 i = 0; i < Width * Height; ++i)
+		{
+			Msg->data[i] = (i % 17 == 0) ? 100 : ((i % 5 == 0) ? -1 : 0);
+		}
+		return Msg;
+	}
+
+	TSharedPtr<FROSBaseMsg> MakeImage(TArray<uint8>& Buffer, uint32 Width, uint32 Height)
+	{
+		Buffer.SetNumUninitialized(Width * Height * 3);
+		for (int32 i = 0; i < Buffer.Num(); ++i)
+		{
+			Buffer[i] = static_cast<uint8>(i * 31);
+		}
+
+		auto Msg = MakeShared<ROSMessages::sensor_msgs::Image>();
+		Msg->header = MakeHeader();
+		Msg->height = Height;
+		Msg->width = Width;
+		Msg->encoding = TEXT("rgb8");
+		Msg->is_bigendian = 0;
+		Msg->step = Width * 3;
+		Msg->data = Buffer.GetData();
+		return Msg;
+	}
+
+	TSharedPtr<FROSBaseMsg> MakePointCloud(TArray<uint8>& Buffer, uint32 NumPoints)
+	{
+		typedef ROSMessages::sensor_msgs::PointCloud2::PointField FPointField;
+
+		auto Msg = MakeShared<ROSMessages::sensor_msgs::PointCloud2>();
+		Msg->header = MakeHeader();
+		Msg->height = 1;
+		Msg->width = NumPoints;
+		const TCHAR* FieldNames[] = { TEXT("x"), TEXT("y"), TEXT("z"), TEXT("intensity") };
+		for (int32 i = 0; i < 4; ++i)
+		{
+			FPointField Field;
+			Field.name = FieldNames[i];
+			Field.offset = i * 4;
+			Field.datatype = FPointField::FLOAT32;
+			Field.count = 1;
+			Msg->fields.Add(Field);
+		}
+		Msg->is_bigendian = false;
+		Msg->point_step = 16;
+		Msg->row_step = NumPoints * Msg->point_step;
+		Msg->is_dense = true;
+
+		Buffer.SetNumUninitialized(Msg->row_step);
+		float* Points = reinterpret_cast<float*>(Buffer.GetData());
+		for (uint32 i = 0; i < NumPoints * 4; ++i)
+		{
+			Points[i] = static_cast<float>(i % 4096) * 0.01f;
+		}
+		Msg->data_ptr = Buffer.GetData();
+		return Msg;
+	}
+
+	TSharedPtr<FROSBaseMsg> MakeGridMap(int32 NumLayers, uint32 Size)
+	{
+		auto Msg = MakeShared<ROSMessages::grid_map_msgs::GridMap>();
+		Msg->info.header = MakeHeader();
+		Msg->info.resolution = 0.1;
+		Msg->info.length_x = Size * 0.1;
+		Msg->info.length_y = Size * 0.1;
+		Msg->info.pose = MakePose();
+		for (int32 Layer = 0; Layer < NumLayers; ++Layer)
+		{
+			Msg->layers.Add(FString::Printf(TEXT("layer_%d"), Layer));
+
+			ROSMessages::std_msgs::Float32MultiArray Data;
+			Data.layout.dim.Add(MakeDimension(TEXT("column_index"), Size, Size * Size));
+			Data.layout.dim.Add(MakeDimension(TEXT("row_index"), Size, Size));
+			Data.layout.data_offset = 0;
+			Data.data.SetNumUninitialized(Size * Size);
+			for (uint32 i = 0; i < Size * Size; ++i)
+			{
+				Data.data[i] = static_cast<float>(i % Size) * 0.05f + Layer;
+			}
+			Msg->data.Add(Data);
+		}
+		Msg->basic_layers.Add(Msg->layers[0]);
+		Msg->outer_start_index = 0;
+		Msg->inner_start_index = 0;
+		return Msg;
+	}
+
+	TArray<FConverterBenchmarkCase> MakeBenchmarkCases()
+	{
+		using namespace ROSMessages;
+
+		TArray<FConverterBenchmarkCase> Cases;
+		auto Add = [&Cases](const TCHAR* Name, const TCHAR* MessageType, int32 LargestElementArray, TFunction<TSharedPtr<FROSBaseMsg>(TArray<uint8>&)> Create)
+		{
+			Cases.Add(FConverterBenchmarkCase{ Name, MessageType, LargestElementArray, MoveTemp(Create) });
+		};
+
+		// actionlib_msgs
+		Add(TEXT("actionlib_msgs/GoalID"), TEXT("actionlib_msgs/GoalID"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<actionlib_msgs::GoalID>(MakeGoalStatus(0).goal_id));
+		});
+		Add(TEXT("actionlib_msgs/GoalStatus"), TEXT("actionlib_msgs/GoalStatus"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<actionlib_msgs::GoalStatus>(MakeGoalStatus(0)));
+		});
+		Add(TEXT("actionlib_msgs/GoalStatusArray (10)"), TEXT("actionlib_msgs/GoalStatusArray"), 10, [](TArray<uint8>&) {
+			auto Msg = MakeShared<actionlib_msgs::GoalStatusArray>();
+			Msg->header = MakeHeader();
+			for (int32 i = 0; i < 10; ++i)
+			{
+				Msg->status_list.Add(MakeGoalStatus(i));
+			}
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+
+		// diagnostic_msgs
+		Add(TEXT("diagnostic_msgs/KeyValue"), TEXT("diagnostic_msgs/KeyValue"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<diagnostic_msgs::KeyValue>(TEXT("messages_sent"), TEXT("123456")));
+		});
+		Add(TEXT("diagnostic_msgs/DiagnosticStatus (8 values)"), TEXT("diagnostic_msgs/DiagnosticStatus"), 8, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<diagnostic_msgs::DiagnosticStatus>(MakeDiagnosticStatus(0, 8)));
+		});
+		Add(TEXT("diagnostic_msgs/DiagnosticArray (10x8 values)"), TEXT("diagnostic_msgs/DiagnosticArray"), 10, [](TArray<uint8>&) {
+			auto Msg = MakeShared<diagnostic_msgs::DiagnosticArray>();
+			Msg->header = MakeHeader();
+			for (int32 i = 0; i < 10; ++i)
+			{
+				Msg->status.Add(MakeDiagnosticStatus(i, 8));
+			}
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+
+		// geometry_msgs
+		Add(TEXT("geometry_msgs/Point"), TEXT("geometry_msgs/Point"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<geometry_msgs::Point>(1.0, 2.0, 3.0));
+		});
+		Add(TEXT("geometry_msgs/Pose"), TEXT("geometry_msgs/Pose"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<geometry_msgs::Pose>(MakePose()));
+		});
+		Add(TEXT("geometry_msgs/PoseStamped"), TEXT("geometry_msgs/PoseStamped"), 0, [](TArray<uint8>&) {
+			auto Msg = MakeShared<geometry_msgs::PoseStamped>();
+			Msg->header = MakeHeader();
+			Msg->pose = MakePose();
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("geometry_msgs/PoseWithCovariance"), TEXT("geometry_msgs/PoseWithCovariance"), 36, [](TArray<uint8>&) {
+			auto Msg = MakeShared<geometry_msgs::PoseWithCovariance>();
+			Msg->pose = MakePose();
+			Msg->covariance = MakeCovariance(36);
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("geometry_msgs/Quaternion"), TEXT("geometry_msgs/Quaternion"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<geometry_msgs::Quaternion>(0.0, 0.0, 0.0, 1.0));
+		});
+		Add(TEXT("geometry_msgs/Transform"), TEXT("geometry_msgs/Transform"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<geometry_msgs::Transform>(MakeTransformStamped(0).transform));
+		});
+		Add(TEXT("geometry_msgs/TransformStamped"), TEXT("geometry_msgs/TransformStamped"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<geometry_msgs::TransformStamped>(MakeTransformStamped(0)));
+		});
+		Add(TEXT("geometry_msgs/Twist"), TEXT("geometry_msgs/Twist"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<geometry_msgs::Twist>(MakeTwist()));
+		});
+		Add(TEXT("geometry_msgs/TwistStamped"), TEXT("geometry_msgs/TwistStamped"), 0, [](TArray<uint8>&) {
+			auto Msg = MakeShared<geometry_msgs::TwistStamped>();
+			Msg->header = MakeHeader();
+			Msg->twist = MakeTwist();
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("geometry_msgs/TwistWithCovariance"), TEXT("geometry_msgs/TwistWithCovariance"), 36, [](TArray<uint8>&) {
+			auto Msg = MakeShared<geometry_msgs::TwistWithCovariance>();
+			Msg->twist = MakeTwist();
+			Msg->covariance = MakeCovariance(36);
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("geometry_msgs/Vector3"), TEXT("geometry_msgs/Vector3"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<geometry_msgs::Vector3>(1.0, 2.0, 3.0));
+		});
+
+		// grid_map_msgs
+		Add(TEXT("grid_map_msgs/GridMapInfo"), TEXT("grid_map_msgs/GridMapInfo"), 0, [](TArray<uint8>&) {
+			auto Msg = MakeShared<grid_map_msgs::GridMapInfo>();
+			Msg->header = MakeHeader();
+			Msg->resolution = 0.1;
+			Msg->length_x = 10.0;
+			Msg->length_y = 10.0;
+			Msg->pose = MakePose();
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("grid_map_msgs/GridMap (16 layers 100x100)"), TEXT("grid_map_msgs/GridMap"), 100 * 100, [](TArray<uint8>&) {
+			return MakeGridMap(16, 100);
+		});
+
+		// nav_msgs
+		Add(TEXT("nav_msgs/MapMetaData"), TEXT("nav_msgs/MapMetaData"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<nav_msgs::MapMetaData>(FROSTime(1600000000, 0), 0.05f, 2000, 2000, MakePose()));
+		});
+		Add(TEXT("nav_msgs/OccupancyGrid (100x100)"), TEXT("nav_msgs/OccupancyGrid"), 100 * 100, [](TArray<uint8>&) {
+			return MakeOccupancyGrid(100, 100);
+		});
+		Add(TEXT("nav_msgs/OccupancyGrid (2000x2000)"), TEXT("nav_msgs/OccupancyGrid"), 2000 * 2000, [](TArray<uint8>&) {
+			return MakeOccupancyGrid(2000, 2000);
+		});
+		Add(TEXT("nav_msgs/Odometry"), TEXT("nav_msgs/Odometry"), 36, [](TArray<uint8>&) {
+			auto Msg = MakeShared<nav_msgs::Odometry>();
+			Msg->header = MakeHeader();
+			Msg->child_frame_id = TEXT("base_footprint");
+			Msg->pose.pose = MakePose();
+			Msg->pose.covariance = MakeCovariance(36);
+			Msg->twist.twist = MakeTwist();
+			Msg->twist.covariance = MakeCovariance(36);
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("nav_msgs/Path (100 poses)"), TEXT("nav_msgs/Path"), 100, [](TArray<uint8>&) {
+			return MakePath(100);
+		});
+		Add(TEXT("nav_msgs/Path (10000 poses)"), TEXT("nav_msgs/Path"), 10000, [](TArray<uint8>&) {
+			return MakePath(10000);
+		});
+
+		// rosgraph_msgs
+		Add(TEXT("rosgraph_msgs/Clock"), TEXT("rosgraph_msgs/Clock"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<rosgraph_msgs::Clock>(FROSTime(1600000000, 123456789)));
+		});
+
+		// sensor_msgs
+		Add(TEXT("sensor_msgs/CameraInfo"), TEXT("sensor_msgs/CameraInfo"), 12, [](TArray<uint8>&) {
+			auto Msg = MakeShared<sensor_msgs::CameraInfo>();
+			Msg->header = MakeHeader();
+			Msg->height = 480;
+			Msg->width = 640;
+			Msg->distortion_model = TEXT("plumb_bob");
+			Msg->K = { 525.0, 0.0, 319.5, 0.0, 525.0, 239.5, 0.0, 0.0, 1.0 };
+			Msg->R = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+			Msg->P = { 525.0, 0.0, 319.5, 0.0, 0.0, 525.0, 239.5, 0.0, 0.0, 0.0, 1.0, 0.0 };
+			Msg->binning_x = 0;
+			Msg->binning_y = 0;
+			Msg->roi.x_offset = 0;
+			Msg->roi.y_offset = 0;
+			Msg->roi.height = 0;
+			Msg->roi.width = 0;
+			Msg->roi.do_rectify = false;
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("sensor_msgs/CompressedImage (100 KB)"), TEXT("sensor_msgs/CompressedImage"), 0, [](TArray<uint8>& Buffer) {
+			Buffer.SetNumUninitialized(100 * 1024);
+			for (int32 i = 0; i < Buffer.Num(); ++i)
+			{
+				Buffer[i] = static_cast<uint8>(i * 131);
+			}
+			auto Msg = MakeShared<sensor_msgs::CompressedImage>();
+			Msg->header = MakeHeader();
+			Msg->format = TEXT("jpeg");
+			Msg->data = Buffer.GetData();
+			Msg->data_size = Buffer.Num();
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("sensor_msgs/Image (640x480 rgb8)"), TEXT("sensor_msgs/Image"), 0, [](TArray<uint8>& Buffer) {
+			return MakeImage(Buffer, 640, 480);
+		});
+		Add(TEXT("sensor_msgs/Image (3840x2160 rgb8)"), TEXT("sensor_msgs/Image"), 0, [](TArray<uint8>& Buffer) {
+			return MakeImage(Buffer, 3840, 2160);
+		});
+		Add(TEXT("sensor_msgs/Imu"), TEXT("sensor_msgs/Imu"), 9, [](TArray<uint8>&) {
+			auto Msg = MakeShared<sensor_msgs::Imu>();
+			Msg->header = MakeHeader();
+			Msg->orientation = geometry_msgs::Quaternion(0.0, 0.0, 0.0, 1.0);
+			Msg->orientation_covariance = MakeCovariance(9);
+			Msg->angular_velocity = geometry_msgs::Vector3(0.01, 0.02, 0.03);
+			Msg->angular_velocity_covariance = MakeCovariance(9);
+			Msg->linear_acceleration = geometry_msgs::Vector3(0.0, 0.0, 9.81);
+			Msg->linear_acceleration_covariance = MakeCovariance(9);
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("sensor_msgs/JointState (7 joints)"), TEXT("sensor_msgs/JointState"), 7, [](TArray<uint8>&) {
+			auto Msg = MakeShared<sensor_msgs::JointState>();
+			Msg->header = MakeHeader();
+			for (int32 i = 0; i < 7; ++i)
+			{
+				Msg->name.Add(FString::Printf(TEXT("arm_joint_%d"), i + 1));
+				Msg->position.Add(0.1 * i);
+				Msg->velocity.Add(0.0);
+				Msg->effort.Add(1.5 * i);
+			}
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("sensor_msgs/LaserScan (1080 rays)"), TEXT("sensor_msgs/LaserScan"), 1080, [](TArray<uint8>&) {
+			auto Msg = MakeShared<sensor_msgs::LaserScan>();
+			Msg->header = MakeHeader();
+			Msg->angle_min = -2.356f;
+			Msg->angle_max = 2.356f;
+			Msg->angle_increment = 4.712f / 1080;
+			Msg->time_increment = 0.0f;
+			Msg->scan_time = 0.025f;
+			Msg->range_min = 0.1f;
+			Msg->range_max = 30.0f;
+			for (int32 i = 0; i < 1080; ++i)
+			{
+				Msg->ranges.Add(1.0f + (i % 100) * 0.1f);
+				Msg->intensities.Add(100.0f);
+			}
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("sensor_msgs/NavSatFix"), TEXT("sensor_msgs/NavSatFix"), 9, [](TArray<uint8>&) {
+			auto Msg = MakeShared<sensor_msgs::NavSatFix>();
+			Msg->header = MakeHeader();
+			Msg->status.status = sensor_msgs::NavSatStatus::STATUS_FIX;
+			Msg->status.service = sensor_msgs::NavSatStatus::SERVICE_GPS;
+			Msg->latitude = 53.1059;
+			Msg->longitude = 8.8521;
+			Msg->altitude = 12.0;
+			Msg->position_covariance = MakeCovariance(9);
+			Msg->position_covariance_type = sensor_msgs::NavSatFix::COVARIANCE_TYPE_DIAGONAL_KNOWN;
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("sensor_msgs/NavSatStatus"), TEXT("sensor_msgs/NavSatStatus"), 0, [](TArray<uint8>&) {
+			auto Msg = MakeShared<sensor_msgs::NavSatStatus>();
+			Msg->status = sensor_msgs::NavSatStatus::STATUS_FIX;
+			Msg->service = sensor_msgs::NavSatStatus::SERVICE_GPS;
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("sensor_msgs/PointCloud2 (65536 points)"), TEXT("sensor_msgs/PointCloud2"), 4, [](TArray<uint8>& Buffer) {
+			return MakePointCloud(Buffer, 65536);
+		});
+		Add(TEXT("sensor_msgs/PointCloud2 (1000000 points)"), TEXT("sensor_msgs/PointCloud2"), 4, [](TArray<uint8>& Buffer) {
+			return MakePointCloud(Buffer, 1000000);
+		});
+		Add(TEXT("sensor_msgs/RegionOfInterest"), TEXT("sensor_msgs/RegionOfInterest"), 0, [](TArray<uint8>&) {
+			auto Msg = MakeShared<sensor_msgs::RegionOfInterest>();
+			Msg->x_offset = 10;
+			Msg->y_offset = 20;
+			Msg->height = 100;
+			Msg->width = 200;
+			Msg->do_rectify = false;
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+
+		// std_msgs
+		Add(TEXT("std_msgs/Bool"), TEXT("std_msgs/Bool"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<std_msgs::Bool>(true));
+		});
+		Add(TEXT("std_msgs/Empty"), TEXT("std_msgs/Empty"), 0, [](TArray<uint8>&) {
+			auto Msg = MakeShared<FROSBaseMsg>();
+			Msg->_MessageType = TEXT("std_msgs/Empty");
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("std_msgs/Float32"), TEXT("std_msgs/Float32"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<std_msgs::Float32>(3.14f));
+		});
+		Add(TEXT("std_msgs/Float32MultiArray (1000)"), TEXT("std_msgs/Float32MultiArray"), 1000, [](TArray<uint8>&) {
+			auto Msg = MakeShared<std_msgs::Float32MultiArray>();
+			Msg->layout.dim.Add(MakeDimension(TEXT("data"), 1000, 1000));
+			Msg->layout.data_offset = 0;
+			for (int32 i = 0; i < 1000; ++i)
+			{
+				Msg->data.Add(i * 0.5f);
+			}
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("std_msgs/Header"), TEXT("std_msgs/Header"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<std_msgs::Header>(MakeHeader()));
+		});
+		Add(TEXT("std_msgs/Int32"), TEXT("std_msgs/Int32"), 0, [](TArray<uint8>&) {
+			auto Msg = MakeShared<std_msgs::Int32>();
+			Msg->_Data = 42;
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("std_msgs/Int64"), TEXT("std_msgs/Int64"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<std_msgs::Int64>(1234567890123ll));
+		});
+		Add(TEXT("std_msgs/MultiArrayDimension"), TEXT("std_msgs/MultiArrayDimension"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<std_msgs::MultiArrayDimension>(MakeDimension(TEXT("height"), 480, 640 * 480)));
+		});
+		Add(TEXT("std_msgs/MultiArrayLayout"), TEXT("std_msgs/MultiArrayLayout"), 2, [](TArray<uint8>&) {
+			auto Msg = MakeShared<std_msgs::MultiArrayLayout>();
+			Msg->dim.Add(MakeDimension(TEXT("height"), 480, 640 * 480));
+			Msg->dim.Add(MakeDimension(TEXT("width"), 640, 640));
+			Msg->data_offset = 0;
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+		Add(TEXT("std_msgs/String (64 chars)"), TEXT("std_msgs/String"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<std_msgs::String>(FString::ChrN(64, TEXT('x'))));
+		});
+		Add(TEXT("std_msgs/UInt8"), TEXT("std_msgs/UInt8"), 0, [](TArray<uint8>&) {
+			return TSharedPtr<FROSBaseMsg>(MakeShared<std_msgs::UInt8>(7));
+		});
+		Add(TEXT("std_msgs/UInt8MultiArray (64 KB)"), TEXT("std_msgs/UInt8MultiArray"), 1, [](TArray<uint8>& Buffer) {
+			Buffer.SetNumZeroed(64 * 1024);
+			auto Msg = MakeShared<std_msgs::UInt8MultiArray>();
+			Msg->layout.dim.Add(MakeDimension(TEXT("data"), Buffer.Num(), Buffer.Num()));
+			Msg->layout.data_offset = 0;
+			Msg->data = Buffer.GetData();
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+
+		// tf2_msgs
+		Add(TEXT("tf2_msgs/TFMessage (20 transforms)"), TEXT("tf2_msgs/TFMessage"), 20, [](TArray<uint8>&) {
+			auto Msg = MakeShared<tf2_msgs::TFMessage>();
+			for (int32 i = 0; i < 20; ++i)
+			{
+				Msg->transforms.Add(MakeTransformStamped(i));
+			}
+			return TSharedPtr<FROSBaseMsg>(Msg);
+		});
+
+		return Cases;
+	}
+
+	TMap<FString, UBaseMessageConverter*> FindConverters()
+	{
+		TMap<FString, UBaseMessageConverter*> Converters;
+		for (TObjectIterator<UClass> It; It; ++It)
+		{
+			if (It->IsChildOf(UBaseMessageConverter::StaticClass()) && *It != UBaseMessageConverter::StaticClass())
+			{
+				UBaseMessageConverter* Converter = It->GetDefaultObject<UBaseMessageConverter>();
+				Converters.Add(Converter->_MessageType, Converter);
+			}
+		}
+		return Converters;
+	}
+
+	double CyclesToNs(uint64 Cycles)
+	{
+		return Cycles * FPlatformTime::GetSecondsPerCycle64() * 1e9;
+	}
+
+	// Runs Step once with allocation counting, then repeats it until MinTime has passed.
+	// Returns false if the first run fails.
+	bool Measure(const FBenchmarkSettings& Settings, TFunctionRef<bool()> Step, double& OutNs, int64& OutAllocs, int32& OutIterations)
+	{
+		uint64 Start = FPlatformTime::Cycles64();
+		{
+			FScopedBsonAllocationCount AllocationCount;
+			if (!Step())
+			{
+				return false;
+			}
+			OutAllocs = static_cast<int64>(AllocationCount.Get());
+		}
+		const double FirstNs = CyclesToNs(FPlatformTime::Cycles64() - Start);
+
+		// a single run of the large cases is already longer than MinTime
+		if (FirstNs >= Settings.MinTime * 1e9)
+		{
+			OutNs = FirstNs;
+			OutIterations = 1;
+			return true;
+		}
+
+		int32 Iterations = 0;
+		Start = FPlatformTime::Cycles64();
+		uint64 Elapsed = 0;
+		do
+		{
+			Step();
+			++Iterations;
+			Elapsed = FPlatformTime::Cycles64() - Start;
+		} while (Iterations < Settings.MaxIterations && CyclesToNs(Elapsed) < Settings.MinTime * 1e9);
+
+		OutNs = CyclesToNs(Elapsed) / Iterations;
+		OutIterations = Iterations;
+		return true;
+	}
+
+	FConverterBenchmarkResult RunCase(const FBenchmarkSettings& Settings, const FConverterBenchmarkCase& Case, UBaseMessageConverter* Converter)
+	{
+		FConverterBenchmarkResult Result;
+		Result.Name = Case.Name;
+		Result.MessageType = Case.MessageType;
+
+		TArray<uint8> Buffer;
+		TSharedPtr<FROSBaseMsg> Msg = Case.Create(Buffer);
+
+		bool bEncoded = Measure(Settings, [Converter, &Msg]()
+		{
+			bson_t* Encoded = nullptr;
+			const bool bSuccess = Converter->ConvertOutgoingMessage(Msg, &Encoded);
+			if (Encoded)
+			{
+				bson_destroy(Encoded);
+			}
+			return bSuccess;
+		}, Result.EncodeNs, Result.EncodeAllocs, Result.EncodeIterations);
+
+		if (!bEncoded)
+		{
+			Result.Status = TEXT("encode failed");
+			return Result;
+		}
+
+		// Wrap the encoded message into a publish envelope, like the bridge hands it to UTopic
+		bson_t* Encoded = nullptr;
+		Converter->ConvertOutgoingMessage(Msg, &Encoded);
+		bson_t* FullMsg = bson_new();
+		BSON_APPEND_UTF8(FullMsg, "op", "publish");
+		BSON_APPEND_UTF8(FullMsg, "topic", "/benchmark");
+		if (Encoded)
+		{
+			Result.Bytes = Encoded->len;
+			BSON_APPEND_DOCUMENT(FullMsg, "msg", Encoded);
+			bson_destroy(Encoded);
+		}
+		else
+		{
+			bson_t Empty;
+			bson_init(&Empty);
+			BSON_APPEND_DOCUMENT(FullMsg, "msg", &Empty);
+			bson_destroy(&Empty);
+		}
+
+		if (Case.LargestElementArray > Settings.MaxDecodeElements)
+		{
+			Result.Status = TEXT("decode skipped");
+			Result.Note = FString::Printf(TEXT("%d element array exceeds MaxDecodeElements=%d"), Case.LargestElementArray, Settings.MaxDecodeElements);
+		}
+		else
+		{
+			ROSBridgePublishMsg Publish(true);
+			Publish.topic_ = "/benchmark";
+			Publish.full_msg_bson_ = FullMsg;
+
+			const bool bDecoded = Measure(Settings, [Converter, &Publish]()
+			{
+				TSharedPtr<FROSBaseMsg> Decoded;
+				return Converter->ConvertIncomingMessage(&Publish, Decoded);
+			}, Result.DecodeNs, Result.DecodeAllocs, Result.DecodeIterations);
+
+			// FullMsg is owned by this function
+			Publish.full_msg_bson_ = nullptr;
+
+			if (!bDecoded)
+			{
+				Result.DecodeNs = -1.0;
+				Result.DecodeAllocs = -1;
+				Result.Status = TEXT("decode failed");
+			}
+		}
+
+		bson_destroy(FullMsg);
+		return Result;
+	}
+
+	FString ToCSVLine(const FConverterBenchmarkResult& Result)
+	{
+		return FString::Printf(TEXT("%s,%s,%s,%lld,%.1f,%lld,%d,%.1f,%lld,%d,%s"),
+			*Result.Name, *Result.MessageType, *Result.Status, Result.Bytes,
+			Result.EncodeNs, Result.EncodeAllocs, Result.EncodeIterations,
+			Result.DecodeNs, Result.DecodeAllocs, Result.DecodeIterations,
+			*Result.Note.Replace(TEXT(","), TEXT(";")));
+	}
+
+	const TCHAR* CSVHeader = TEXT("name,message_type,status,bytes,encode_ns,encode_bson_allocs,encode_iterations,decode_ns,decode_bson_allocs,decode_iterations,note");
+
+	void WriteResults(const FString& FileName, const TArray<FConverterBenchmarkResult>& Results)
+	{
+		TArray<FString> Lines;
+		Lines.Add(CSVHeader);
+		for (const FConverterBenchmarkResult& Result : Results)
+		{
+			Lines.Add(ToCSVLine(Result));
+		}
+
+		if (FFileHelper::SaveStringArrayToFile(Lines, *FileName))
+		{
+			UE_LOG(LogROS, Display, TEXT("Converter benchmark results written to %s"), *FileName);
+		}
+		else
+		{
+			UE_LOG(LogROS, Error, TEXT("Could not write converter benchmark results to %s"), *FileName);
+		}
+	}
+
+	TMap<FString, FConverterBenchmarkResult> ReadBaseline(const FString& FileName)
+	{
+		TMap<FString, FConverterBenchmarkResult> Baseline;
+
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *FileName))
+		{
+			return Baseline;
+		}
+
+		for (int32 i = 1; i < Lines.Num(); ++i)
+		{
+			TArray<FString> Columns;
+			Lines[i].ParseIntoArray(Columns, TEXT(","), false);
+			if (Columns.Num() < 10)
+			{
+				continue;
+			}
+
+			FConverterBenchmarkResult Result;
+			Result.Name = Columns[0];
+			Result.MessageType = Columns[1];
+			Result.Status = Columns[2];
+			Result.Bytes = FCString::Atoi64(*Columns[3]);
+			Result.EncodeNs = FCString::Atod(*Columns[4]);
+			Result.EncodeAllocs = FCString::Atoi64(*Columns[5]);
+			Result.DecodeNs = FCString::Atod(*Columns[7]);
+			Result.DecodeAllocs = FCString::Atoi64(*Columns[8]);
+			Baseline.Add(Result.Name, Result);
+		}
+		return Baseline;
+	}
+
+	// Returns the number of regressions against the baseline
+	int32 CompareToBaseline(const FBenchmarkSettings& Settings, const TArray<FConverterBenchmarkResult>& Results, const TMap<FString, FConverterBenchmarkResult>& Baseline)
+	{
+		int32 Regressions = 0;
+		auto CompareTime = [&](const FConverterBenchmarkResult& Result, const TCHAR* Direction, double Ns, double BaselineNs)
+		{
+			if (Ns >= 0.0 && BaselineNs > 0.0 && Ns > BaselineNs * (1.0 + Settings.Tolerance))
+			{
+				UE_LOG(LogROS, Warning, TEXT("Regression: %s %s %.0f ns/msg, baseline %.0f ns/msg (+%.0f%%)"),
+					*Result.Name, Direction, Ns, BaselineNs, (Ns / BaselineNs - 1.0) * 100.0);
+				++Regressions;
+			}
+		};
+		auto CompareAllocs = [&](const FConverterBenchmarkResult& Result, const TCHAR* Direction, int64 Allocs, int64 BaselineAllocs)
+		{
+			// allocation counts are deterministic, every additional allocation is reported
+			if (Allocs >= 0 && BaselineAllocs >= 0 && Allocs > BaselineAllocs)
+			{
+				UE_LOG(LogROS, Warning, TEXT("Regression: %s %s %lld allocs/msg, baseline %lld allocs/msg"),
+					*Result.Name, Direction, Allocs, BaselineAllocs);
+				++Regressions;
+			}
+		};
+
+		for (const FConverterBenchmarkResult& Result : Results)
+		{
+			const FConverterBenchmarkResult* Base = Baseline.Find(Result.Name);
+			if (!Base)
+			{
+				continue;
+			}
+			if (Result.Status != Base->Status)
+			{
+				UE_LOG(LogROS, Warning, TEXT("%s: %s, baseline %s"), *Result.Name, *Result.Status, *Base->Status);
+			}
+
+			CompareTime(Result, TEXT("encode"), Result.EncodeNs, Base->EncodeNs);
+			CompareTime(Result, TEXT("decode"), Result.DecodeNs, Base->DecodeNs);
+			CompareAllocs(Result, TEXT("encode"), Result.EncodeAllocs, Base->EncodeAllocs);
+			CompareAllocs(Result, TEXT("decode"), Result.DecodeAllocs, Base->DecodeAllocs);
+
+			if (Result.Bytes != Base->Bytes)
+			{
+				UE_LOG(LogROS, Warning, TEXT("%s: encoded size changed from %lld to %lld bytes"), *Result.Name, Base->Bytes, Result.Bytes);
+			}
+		}
+		return Regressions;
+	}
+
+	void RunConverterBenchmark(const TArray<FString>& Args)
+	{
+		const FString ArgString = FString::Join(Args, TEXT(" "));
+		const FString ResultDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("ROSIntegration"));
+
+		FBenchmarkSettings Settings;
+		TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("ROSIntegration"));
+		Settings.BaselineFile = Plugin.IsValid()
+			? FPaths::Combine(Plugin->GetBaseDir(), TEXT("Tools"), TEXT("ConverterBenchmark"), TEXT("ConverterBenchmarkBaseline.csv"))
+			: FPaths::Combine(ResultDir, TEXT("ConverterBenchmarkBaseline.csv"));
+		FParse::Value(*ArgString, TEXT("Filter="), Settings.Filter);
+		FParse::Value(*ArgString, TEXT("MinTime="), Settings.MinTime);
+		FParse::Value(*ArgString, TEXT("MaxDecodeElements="), Settings.MaxDecodeElements);
+		FParse::Value(*ArgString, TEXT("Baseline="), Settings.BaselineFile);
+		FParse::Value(*ArgString, TEXT("Tolerance="), Settings.Tolerance);
+		Settings.bSaveBaseline = FParse::Param(*ArgString, TEXT("SaveBaseline"));
+
+		const TMap<FString, UBaseMessageConverter*> Converters = FindConverters();
+		const TArray<FConverterBenchmarkCase> Cases = MakeBenchmarkCases();
+
+		TSet<FString> CoveredTypes;
+		for (const FConverterBenchmarkCase& Case : Cases)
+		{
+			CoveredTypes.Add(Case.MessageType);
+		}
+		for (const auto& Converter : Converters)
+		{
+			if (!CoveredTypes.Contains(Converter.Key))
+			{
+				UE_LOG(LogROS, Warning, TEXT("No converter benchmark case for %s"), *Converter.Key);
+			}
+		}
+
+		UE_LOG(LogROS, Display, TEXT("%-48s %10s %12s %8s %12s %8s"), TEXT("Converter benchmark"), TEXT("bytes"), TEXT("encode ns"), TEXT("bson"), TEXT("decode ns"), TEXT("bson"));
+
+		TArray<FConverterBenchmarkResult> Results;
+		for (const FConverterBenchmarkCase& Case : Cases)
+		{
+			if (!Settings.Filter.IsEmpty() && !Case.Name.Contains(Settings.Filter))
+			{
+				continue;
+			}
+
+			UBaseMessageConverter* const* Converter = Converters.Find(Case.MessageType);
+			FConverterBenchmarkResult Result;
+			if (Converter)
+			{
+				Result = RunCase(Settings, Case, *Converter);
+			}
+			else
+			{
+				UE_LOG(LogROS, Warning, TEXT("No converter registered for %s"), *Case.MessageType);
+				Result.Name = Case.Name;
+				Result.MessageType = Case.MessageType;
+				Result.Status = TEXT("no converter");
+				Result.EncodeNs = -1.0;
+				Result.EncodeAllocs = -1;
+			}
+
+			if (Result.Status == TEXT("ok"))
+			{
+				UE_LOG(LogROS, Display, TEXT("%-48s %10lld %12.0f %8lld %12.0f %8lld"),
+					*Result.Name, Result.Bytes, Result.EncodeNs, Result.EncodeAllocs, Result.DecodeNs, Result.DecodeAllocs);
+			}
+			else if (Result.Status == TEXT("decode skipped"))
+			{
+				UE_LOG(LogROS, Display, TEXT("%-48s %10lld %12.0f %8lld %21s (%s)"),
+					*Result.Name, Result.Bytes, Result.EncodeNs, Result.EncodeAllocs, *Result.Status, *Result.Note);
+			}
+			else
+			{
+				UE_LOG(LogROS, Display, TEXT("%-48s %s"), *Result.Name, *Result.Status);
+			}
+			Results.Add(Result);
+		}
+
+		WriteResults(FPaths::Combine(ResultDir, TEXT("ConverterBenchmark.csv")), Results);
+
+		if (Settings.bSaveBaseline)
+		{
+			WriteResults(Settings.BaselineFile, Results);
+			return;
+		}
+
+		const TMap<FString, FConverterBenchmarkResult> Baseline = ReadBaseline(Settings.BaselineFile);
+		if (Baseline.Num() == 0)
+		{
+			UE_LOG(LogROS, Display, TEXT("No converter benchmark baseline at %s, run with -SaveBaseline to create one"), *Settings.BaselineFile);
+			return;
+		}
+
+		const int32 Regressions = CompareToBaseline(Settings, Results, Baseline);
+		UE_LOG(LogROS, Display, TEXT("Converter benchmark: %d regression(s) against %s"), Regressions, *Settings.BaselineFile);
+	}
+}
+
+void InitConverterBenchmark()
+{
+	// Installed once, before any connection uses libbson, and never swapped back. It only counts on the thread that
+	// runs the benchmark.
+	static const bson_mem_vtable_t CountingVtable = { CountingBsonMalloc, CountingBsonCalloc, CountingBsonRealloc, CountingBsonFree, { nullptr } };
+	bson_mem_set_vtable(&CountingVtable);
+}
+
+static FAutoConsoleCommand GROSBenchmarkConvertersCommand(
+	TEXT("ROSIntegration.BenchmarkConverters"),
+	TEXT("Measures encode/decode time, size and allocations of all message converters. ")
+	TEXT("Args: Filter=<substring> MinTime=<seconds> MaxDecodeElements=<n> Baseline=<csv> Tolerance=<fraction> -SaveBaseline"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunConverterBenchmark));
+
+#endif // !UE_BUILD_SHIPPING
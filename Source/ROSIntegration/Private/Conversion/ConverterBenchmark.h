@@ -0,0 +1,9 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+// Installs the libbson allocator that counts the allocations of ROSIntegration.BenchmarkConverters.
+// Must be called before anything else uses libbson.
+void InitConverterBenchmark();
+#endif
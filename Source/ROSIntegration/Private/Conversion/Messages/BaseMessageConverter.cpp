@@ -14,3 +14,8 @@ bool UBaseMessageConverter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseM
 {
 	return false;
 }
+
+bool UBaseMessageConverter::ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	return false;
+}
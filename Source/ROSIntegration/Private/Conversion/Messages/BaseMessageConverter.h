@@ -8,6 +8,8 @@
 
 #include "ROSIntegrationCore.h"
 #include "rosbridge2cpp/messages/rosbridge_publish_msg.h"
+#include "rosbridge2cpp/shared_memory_ring.h"
+#include "rosbridge2cpp/ros1_reader.h"
 #include <cstring>
 #include <functional>
 #include <bson.h>
@@ -27,11 +29,19 @@ public:
 	UPROPERTY()
 	FString _MessageType;
 
+	// True if the converter implements ConvertIncomingRawMessage(), which topics of this type need to subscribe with compression "cbor-raw"
+	UPROPERTY()
+	bool _SupportsRawMessages = false;
+
 	// For ConvertMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg) {
 
 	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
 	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
 
+	// Decodes a message in the ROS1 serialization format, as rosbridge sends it for subscriptions with compression "cbor-raw".
+	// Like with BSON messages, pointer fields (Image::data, ...) point into Data, which is only valid during the topic callback.
+	virtual bool ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg);
+
 	static double GetDoubleFromBSON(FString Key, bson_t* msg, bool &KeyFound, bool LogOnErrors=true)
 	{
 		assert(msg != nullptr);
@@ -187,6 +197,13 @@ public:
 		_bson_append_uint32_tarray(b, key, (TArray<uint32>)tarray);
 	}
 
+	// Helper function to append a large binary field (image data, point clouds, ...) to a bson_t.
+	// If the topic publishes through a shared memory ring, the data is copied into the ring instead, see UTopic::Publish().
+	static void _bson_append_binary_payload(bson_t *b, const char *key, const uint8 *data, uint32 length)
+	{
+		rosbridge2cpp::AppendBinaryPayload(b, key, data, length);
+	}
+
 	// Helper function to append a TArray<int32> to a bson_t
 	static void _bson_append_int32_tarray(bson_t *b, const char *key, const TArray<int32>& tarray)
 	{
@@ -213,6 +230,38 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_ros_time(rosbridge2cpp::ROS1Reader &r, FROSTime *time)
+	{
+		time->_Sec = r.Read<uint32>();
+		time->_NSec = r.Read<uint32>();
+	}
+
+	static FString _ros1_read_fstring(rosbridge2cpp::ROS1Reader &r)
+	{
+		uint32 Length = 0;
+		const char* Data = r.ReadString(Length);
+		if (!Data) return FString();
+		FUTF8ToTCHAR Converted(Data, Length);
+		return FString(Converted.Length(), Converted.Get());
+	}
+
+	// Variable length float32[] / float64[] arrays are copied as a whole
+	template<class T>
+	static void _ros1_read_tarray(rosbridge2cpp::ROS1Reader &r, TArray<T>& tarray)
+	{
+		uint32 Count = 0;
+		const uint8* Data = r.ReadArray(Count, sizeof(T));
+		tarray.SetNumUninitialized(Data ? Count : 0);
+		if (Data) FMemory::Memcpy(tarray.GetData(), Data, Count * sizeof(T));
+	}
+
+	// Fixed length arrays like the float64[36] covariance have no length prefix
+	static void _ros1_read_fixed_double_tarray(rosbridge2cpp::ROS1Reader &r, TArray<double>& tarray, uint32 Count)
+	{
+		tarray.SetNumUninitialized(Count);
+		r.ReadFixedArray(tarray.GetData(), Count);
+	}
+
 	static void _bson_append_child_ros_time(bson_t *b, const char* key, const FROSTime* time)
 	{
 		bson_t child;
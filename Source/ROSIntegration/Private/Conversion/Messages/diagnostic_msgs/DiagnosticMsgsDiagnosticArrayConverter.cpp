@@ -0,0 +1,22 @@
+#include "Conversion/Messages/diagnostic_msgs/DiagnosticMsgsDiagnosticArrayConverter.h"
+
+
+UDiagnosticMsgsDiagnosticArrayConverter::UDiagnosticMsgsDiagnosticArrayConverter()
+{
+	_MessageType = "diagnostic_msgs/DiagnosticArray";
+}
+
+bool UDiagnosticMsgsDiagnosticArrayConverter::ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	auto msg = new ROSMessages::diagnostic_msgs::DiagnosticArray();
+	BaseMsg = TSharedPtr<FROSBaseMsg>(msg);
+	return _bson_extract_child_diagnostic_array(message->full_msg_bson_, "msg", msg);
+}
+
+bool UDiagnosticMsgsDiagnosticArrayConverter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
+{
+	auto CastMSG = StaticCastSharedPtr<ROSMessages::diagnostic_msgs::DiagnosticArray>(BaseMsg);
+	*message = bson_new();
+	_bson_append_diagnostic_array(*message, CastMSG.Get());
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Conversion/Messages/BaseMessageConverter.h"
+#include "Conversion/Messages/std_msgs/StdMsgsHeaderConverter.h"
+#include "Conversion/Messages/diagnostic_msgs/DiagnosticMsgsDiagnosticStatusConverter.h"
+#include "diagnostic_msgs/DiagnosticArray.h"
+#include "DiagnosticMsgsDiagnosticArrayConverter.generated.h"
+
+
+UCLASS()
+class ROSINTEGRATION_API UDiagnosticMsgsDiagnosticArrayConverter : public UBaseMessageConverter
+{
+	GENERATED_BODY()
+
+public:
+	UDiagnosticMsgsDiagnosticArrayConverter();
+	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
+	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
+
+	static bool _bson_extract_child_diagnostic_array(bson_t *b, FString key, ROSMessages::diagnostic_msgs::DiagnosticArray *msg, bool LogOnErrors = true)
+	{
+		bool KeyFound = false;
+
+		if (!UStdMsgsHeaderConverter::_bson_extract_child_header(b, key + ".header", &msg->header)) return false;
+		msg->status = GetTArrayFromBSON<ROSMessages::diagnostic_msgs::DiagnosticStatus>(key + ".status", b, KeyFound, [LogOnErrors](FString subKey, bson_t* subMsg, bool& subKeyFound)
+		{
+			ROSMessages::diagnostic_msgs::DiagnosticStatus ret;
+			subKeyFound = UDiagnosticMsgsDiagnosticStatusConverter::_bson_extract_child_diagnostic_status(subMsg, subKey, &ret, LogOnErrors);
+			return ret;
+		}, LogOnErrors);
+		if (!KeyFound) return false;
+
+		return true;
+	}
+
+	static void _bson_append_child_diagnostic_array(bson_t *b, const char *key, const ROSMessages::diagnostic_msgs::DiagnosticArray *msg)
+	{
+		bson_t child;
+		BSON_APPEND_DOCUMENT_BEGIN(b, key, &child);
+		_bson_append_diagnostic_array(&child, msg);
+		bson_append_document_end(b, &child);
+	}
+
+	static void _bson_append_diagnostic_array(bson_t *b, const ROSMessages::diagnostic_msgs::DiagnosticArray *msg)
+	{
+		UStdMsgsHeaderConverter::_bson_append_child_header(b, "header", &msg->header);
+		_bson_append_tarray<ROSMessages::diagnostic_msgs::DiagnosticStatus>(b, "status", msg->status, [](bson_t *subb, const char *subKey, ROSMessages::diagnostic_msgs::DiagnosticStatus ds)
+		{
+			UDiagnosticMsgsDiagnosticStatusConverter::_bson_append_child_diagnostic_status(subb, subKey, &ds);
+		});
+	}
+};
@@ -0,0 +1,22 @@
+#include "Conversion/Messages/diagnostic_msgs/DiagnosticMsgsDiagnosticStatusConverter.h"
+
+
+UDiagnosticMsgsDiagnosticStatusConverter::UDiagnosticMsgsDiagnosticStatusConverter()
+{
+	_MessageType = "diagnostic_msgs/DiagnosticStatus";
+}
+
+bool UDiagnosticMsgsDiagnosticStatusConverter::ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	auto msg = new ROSMessages::diagnostic_msgs::DiagnosticStatus();
+	BaseMsg = TSharedPtr<FROSBaseMsg>(msg);
+	return _bson_extract_child_diagnostic_status(message->full_msg_bson_, "msg", msg);
+}
+
+bool UDiagnosticMsgsDiagnosticStatusConverter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
+{
+	auto CastMSG = StaticCastSharedPtr<ROSMessages::diagnostic_msgs::DiagnosticStatus>(BaseMsg);
+	*message = bson_new();
+	_bson_append_diagnostic_status(*message, CastMSG.Get());
+	return true;
+}
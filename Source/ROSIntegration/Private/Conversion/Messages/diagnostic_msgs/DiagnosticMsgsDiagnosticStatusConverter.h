@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Conversion/Messages/BaseMessageConverter.h"
+#include "Conversion/Messages/diagnostic_msgs/DiagnosticMsgsKeyValueConverter.h"
+#include "diagnostic_msgs/DiagnosticStatus.h"
+#include "DiagnosticMsgsDiagnosticStatusConverter.generated.h"
+
+
+UCLASS()
+class ROSINTEGRATION_API UDiagnosticMsgsDiagnosticStatusConverter : public UBaseMessageConverter
+{
+	GENERATED_BODY()
+
+public:
+	UDiagnosticMsgsDiagnosticStatusConverter();
+	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
+	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
+
+	static bool _bson_extract_child_diagnostic_status(bson_t *b, FString key, ROSMessages::diagnostic_msgs::DiagnosticStatus *msg, bool LogOnErrors = true)
+	{
+		bool KeyFound = false;
+		msg->level = static_cast<ROSMessages::diagnostic_msgs::DiagnosticStatus::Level>(GetInt32FromBSON(key + ".level", b, KeyFound, LogOnErrors)); if (!KeyFound) return false;
+		msg->name = GetFStringFromBSON(key + ".name", b, KeyFound, LogOnErrors); if (!KeyFound) return false;
+		msg->message = GetFStringFromBSON(key + ".message", b, KeyFound, LogOnErrors); if (!KeyFound) return false;
+		msg->hardware_id = GetFStringFromBSON(key + ".hardware_id", b, KeyFound, LogOnErrors); if (!KeyFound) return false;
+		msg->values = GetTArrayFromBSON<ROSMessages::diagnostic_msgs::KeyValue>(key + ".values", b, KeyFound, [LogOnErrors](FString subKey, bson_t* subMsg, bool& subKeyFound)
+		{
+			ROSMessages::diagnostic_msgs::KeyValue ret;
+			subKeyFound = UDiagnosticMsgsKeyValueConverter::_bson_extract_child_key_value(subMsg, subKey, &ret, LogOnErrors);
+			return ret;
+		}, LogOnErrors);
+		if (!KeyFound) return false;
+
+		return true;
+	}
+
+	static void _bson_append_child_diagnostic_status(bson_t *b, const char *key, const ROSMessages::diagnostic_msgs::DiagnosticStatus *msg)
+	{
+		bson_t child;
+		BSON_APPEND_DOCUMENT_BEGIN(b, key, &child);
+		_bson_append_diagnostic_status(&child, msg);
+		bson_append_document_end(b, &child);
+	}
+
+	static void _bson_append_diagnostic_status(bson_t *b, const ROSMessages::diagnostic_msgs::DiagnosticStatus *msg)
+	{
+		BSON_APPEND_INT32(b, "level", msg->level);
+		BSON_APPEND_UTF8(b, "name", TCHAR_TO_UTF8(*msg->name));
+		BSON_APPEND_UTF8(b, "message", TCHAR_TO_UTF8(*msg->message));
+		BSON_APPEND_UTF8(b, "hardware_id", TCHAR_TO_UTF8(*msg->hardware_id));
+		_bson_append_tarray<ROSMessages::diagnostic_msgs::KeyValue>(b, "values", msg->values, [](bson_t *subb, const char *subKey, ROSMessages::diagnostic_msgs::KeyValue kv)
+		{
+			UDiagnosticMsgsKeyValueConverter::_bson_append_child_key_value(subb, subKey, &kv);
+		});
+	}
+};
@@ -0,0 +1,22 @@
+#include "Conversion/Messages/diagnostic_msgs/DiagnosticMsgsKeyValueConverter.h"
+
+
+UDiagnosticMsgsKeyValueConverter::UDiagnosticMsgsKeyValueConverter()
+{
+	_MessageType = "diagnostic_msgs/KeyValue";
+}
+
+bool UDiagnosticMsgsKeyValueConverter::ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	auto msg = new ROSMessages::diagnostic_msgs::KeyValue();
+	BaseMsg = TSharedPtr<FROSBaseMsg>(msg);
+	return _bson_extract_child_key_value(message->full_msg_bson_, "msg", msg);
+}
+
+bool UDiagnosticMsgsKeyValueConverter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
+{
+	auto CastMSG = StaticCastSharedPtr<ROSMessages::diagnostic_msgs::KeyValue>(BaseMsg);
+	*message = bson_new();
+	_bson_append_key_value(*message, CastMSG.Get());
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Conversion/Messages/BaseMessageConverter.h"
+#include "diagnostic_msgs/KeyValue.h"
+#include "DiagnosticMsgsKeyValueConverter.generated.h"
+
+
+UCLASS()
+class ROSINTEGRATION_API UDiagnosticMsgsKeyValueConverter : public UBaseMessageConverter
+{
+	GENERATED_BODY()
+
+public:
+	UDiagnosticMsgsKeyValueConverter();
+	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
+	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
+
+	static bool _bson_extract_child_key_value(bson_t *b, FString key, ROSMessages::diagnostic_msgs::KeyValue *msg, bool LogOnErrors = true)
+	{
+		bool KeyFound = false;
+		msg->key = GetFStringFromBSON(key + ".key", b, KeyFound, LogOnErrors); if (!KeyFound) return false;
+		msg->value = GetFStringFromBSON(key + ".value", b, KeyFound, LogOnErrors); if (!KeyFound) return false;
+
+		return true;
+	}
+
+	static void _bson_append_child_key_value(bson_t *b, const char *key, const ROSMessages::diagnostic_msgs::KeyValue *msg)
+	{
+		bson_t child;
+		BSON_APPEND_DOCUMENT_BEGIN(b, key, &child);
+		_bson_append_key_value(&child, msg);
+		bson_append_document_end(b, &child);
+	}
+
+	static void _bson_append_key_value(bson_t *b, const ROSMessages::diagnostic_msgs::KeyValue *msg)
+	{
+		BSON_APPEND_UTF8(b, "key", TCHAR_TO_UTF8(*msg->key));
+		BSON_APPEND_UTF8(b, "value", TCHAR_TO_UTF8(*msg->value));
+	}
+};
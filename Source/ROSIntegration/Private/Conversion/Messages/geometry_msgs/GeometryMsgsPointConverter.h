@@ -27,6 +27,13 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_point(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::Point *msg)
+	{
+		msg->x = r.Read<double>();
+		msg->y = r.Read<double>();
+		msg->z = r.Read<double>();
+	}
+
 
 	static void _bson_append_child_point(bson_t *b, const char *key, const ROSMessages::geometry_msgs::Point *msg)
 	{
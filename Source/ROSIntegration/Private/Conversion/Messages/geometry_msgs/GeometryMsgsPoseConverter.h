@@ -26,6 +26,12 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_pose(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::Pose *msg)
+	{
+		UGeometryMsgsPointConverter::_ros1_read_point(r, &msg->position);
+		UGeometryMsgsQuaternionConverter::_ros1_read_quaternion(r, &msg->orientation);
+	}
+
 	static void _bson_append_child_pose(bson_t *b, const char *key, const ROSMessages::geometry_msgs::Pose *msg)
 	{
 		bson_t child;
@@ -31,6 +31,12 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_pose_with_covariance(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::PoseWithCovariance *msg)
+	{
+		UGeometryMsgsPoseConverter::_ros1_read_pose(r, &msg->pose);
+		_ros1_read_fixed_double_tarray(r, msg->covariance, 36);
+	}
+
 	static void _bson_append_child_pose_with_covariance(bson_t *b, const char *key, const ROSMessages::geometry_msgs::PoseWithCovariance *msg)
 	{
 		bson_t child;
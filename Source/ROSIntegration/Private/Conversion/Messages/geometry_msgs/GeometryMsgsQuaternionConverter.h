@@ -27,6 +27,14 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_quaternion(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::Quaternion *msg)
+	{
+		msg->x = r.Read<double>();
+		msg->y = r.Read<double>();
+		msg->z = r.Read<double>();
+		msg->w = r.Read<double>();
+	}
+
 	static void _bson_append_child_quaternion(bson_t *b, const char *key, const ROSMessages::geometry_msgs::Quaternion *msg)
 	{
 		bson_t child;
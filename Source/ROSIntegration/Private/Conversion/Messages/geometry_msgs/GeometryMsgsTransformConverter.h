@@ -24,6 +24,12 @@ public:
         if (!UGeometryMsgsQuaternionConverter::_bson_extract_child_quaternion(b, key + ".rotation", &msg->rotation)) return false;
         return true;
     }
+
+    static void _ros1_read_transform(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::Transform *msg)
+    {
+        UGeometryMsgsVector3Converter::_ros1_read_vector3(r, &msg->translation);
+        UGeometryMsgsQuaternionConverter::_ros1_read_quaternion(r, &msg->rotation);
+    }
     
     static void _bson_append_child_transform(bson_t *b, const char *key, const ROSMessages::geometry_msgs::Transform *msg)
 	{
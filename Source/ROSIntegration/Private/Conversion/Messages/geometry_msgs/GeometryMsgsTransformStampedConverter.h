@@ -27,6 +27,13 @@ public:
         return true;
     }
 
+    static void _ros1_read_transform_stamped(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::TransformStamped *msg)
+    {
+        UStdMsgsHeaderConverter::_ros1_read_header(r, &msg->header);
+        msg->child_frame_id = _ros1_read_fstring(r);
+        UGeometryMsgsTransformConverter::_ros1_read_transform(r, &msg->transform);
+    }
+
     static void _bson_append_child_transform_stamped(bson_t *b, const char *key, const ROSMessages::geometry_msgs::TransformStamped *msg)
 	{
 		bson_t child;
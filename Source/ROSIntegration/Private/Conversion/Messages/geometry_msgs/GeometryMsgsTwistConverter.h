@@ -25,6 +25,12 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_twist(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::Twist *msg)
+	{
+		UGeometryMsgsVector3Converter::_ros1_read_vector3(r, &msg->linear);
+		UGeometryMsgsVector3Converter::_ros1_read_vector3(r, &msg->angular);
+	}
+
 	static void _bson_append_child_twist(bson_t *b, const char *key, const ROSMessages::geometry_msgs::Twist *msg)
 	{
 		bson_t child;
@@ -31,6 +31,12 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_twist_with_covariance(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::TwistWithCovariance *msg)
+	{
+		UGeometryMsgsTwistConverter::_ros1_read_twist(r, &msg->twist);
+		_ros1_read_fixed_double_tarray(r, msg->covariance, 36);
+	}
+
 	static void _bson_append_child_twist_with_covariance(bson_t *b, const char *key, const ROSMessages::geometry_msgs::TwistWithCovariance *msg)
 	{
 		bson_t child;
@@ -25,6 +25,13 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_vector3(rosbridge2cpp::ROS1Reader &r, ROSMessages::geometry_msgs::Vector3 *msg)
+	{
+		msg->x = r.Read<double>();
+		msg->y = r.Read<double>();
+		msg->z = r.Read<double>();
+	}
+
 	static void _bson_append_child_vector3(bson_t *b, const char *key, const ROSMessages::geometry_msgs::Vector3 *msg)
 	{
 		bson_t child;
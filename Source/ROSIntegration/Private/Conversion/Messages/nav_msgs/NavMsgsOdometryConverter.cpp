@@ -4,6 +4,7 @@
 UNavMsgsOdometryConverter::UNavMsgsOdometryConverter()
 {
 	_MessageType = "nav_msgs/Odometry";
+	_SupportsRawMessages = true;
 }
 
 bool UNavMsgsOdometryConverter::ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
@@ -13,6 +14,14 @@ bool UNavMsgsOdometryConverter::ConvertIncomingMessage(const ROSBridgePublishMsg
 	return _bson_extract_child_odometry(message->full_msg_bson_, "msg", msg);
 }
 
+bool UNavMsgsOdometryConverter::ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	auto msg = new ROSMessages::nav_msgs::Odometry();
+	BaseMsg = TSharedPtr<FROSBaseMsg>(msg);
+	rosbridge2cpp::ROS1Reader Reader(Data, Length);
+	return _ros1_read_odometry(Reader, msg);
+}
+
 bool UNavMsgsOdometryConverter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
 {
 	auto CastMsg = StaticCastSharedPtr<ROSMessages::nav_msgs::Odometry>(BaseMsg);
@@ -18,6 +18,7 @@ public:
 	UNavMsgsOdometryConverter();
 	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
 	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
+	virtual bool ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg);
 
 	static bool _bson_extract_child_odometry(bson_t *b, FString key, ROSMessages::nav_msgs::Odometry * msg, bool LogOnErrors = true)
 	{
@@ -31,6 +32,16 @@ public:
 		return true;
 	}
 
+	static bool _ros1_read_odometry(rosbridge2cpp::ROS1Reader &r, ROSMessages::nav_msgs::Odometry *msg)
+	{
+		UStdMsgsHeaderConverter::_ros1_read_header(r, &msg->header);
+		msg->child_frame_id = _ros1_read_fstring(r);
+		UGeometryMsgsPoseWithCovarianceConverter::_ros1_read_pose_with_covariance(r, &msg->pose);
+		UGeometryMsgsTwistWithCovarianceConverter::_ros1_read_twist_with_covariance(r, &msg->twist);
+
+		return r.Ok();
+	}
+
 	static void _bson_append_child_odometry(bson_t *b, const char *key, const ROSMessages::nav_msgs::Odometry *msg)
 	{
 		bson_t child;
@@ -40,6 +40,6 @@ public:
 	{
 		UStdMsgsHeaderConverter::_bson_append_child_header(b, "header", &msg->header);
 		BSON_APPEND_UTF8(b, "format", TCHAR_TO_UTF8(*msg->format));
-		BSON_APPEND_BINARY(b, "data", BSON_SUBTYPE_BINARY, msg->data, msg->data_size);
+		_bson_append_binary_payload(b, "data", msg->data, msg->data_size);
 	}
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 USensorMsgsImageConverter::USensorMsgsImageConverter()
 {
 	_MessageType = "sensor_msgs/Image";
+	_SupportsRawMessages = true;
 }
 
 bool USensorMsgsImageConverter::ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
@@ -13,6 +14,14 @@ bool USensorMsgsImageConverter::ConvertIncomingMessage(const ROSBridgePublishMsg
 	return _bson_extract_child_image(message->full_msg_bson_, "msg", msg);
 }
 
+bool USensorMsgsImageConverter::ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	auto msg = new ROSMessages::sensor_msgs::Image;
+	BaseMsg = TSharedPtr<FROSBaseMsg>(msg);
+	rosbridge2cpp::ROS1Reader Reader(Data, Length);
+	return _ros1_read_image(Reader, msg);
+}
+
 bool USensorMsgsImageConverter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
 {
 	auto CastMsg = StaticCastSharedPtr<ROSMessages::sensor_msgs::Image>(BaseMsg);
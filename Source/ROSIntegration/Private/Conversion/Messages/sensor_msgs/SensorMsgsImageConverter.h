@@ -16,6 +16,7 @@ public:
 	USensorMsgsImageConverter();
 	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
 	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
+	virtual bool ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg);
 
 	static bool _bson_extract_child_image(bson_t *b, FString key, ROSMessages::sensor_msgs::Image *msg)
 	{
@@ -32,6 +33,20 @@ public:
 		return KeyFound;
 	}
 
+	static bool _ros1_read_image(rosbridge2cpp::ROS1Reader &r, ROSMessages::sensor_msgs::Image *msg)
+	{
+		UStdMsgsHeaderConverter::_ros1_read_header(r, &msg->header);
+		msg->height = r.Read<uint32>();
+		msg->width = r.Read<uint32>();
+		msg->encoding = _ros1_read_fstring(r);
+		msg->is_bigendian = r.Read<uint8>();
+		msg->step = r.Read<uint32>();
+		uint32 DataLength = 0;
+		msg->data = r.ReadArray(DataLength, 1); // not copied, points into the received message
+
+		return r.Ok() && DataLength >= static_cast<uint64>(msg->height) * msg->step;
+	}
+
 	static void _bson_append_child_image(bson_t *b, const char *key, const ROSMessages::sensor_msgs::Image *msg)
 	{
 		bson_t child;
@@ -48,6 +63,6 @@ public:
 		BSON_APPEND_UTF8(b, "encoding", TCHAR_TO_UTF8(*msg->encoding));
 		BSON_APPEND_INT32(b, "is_bigendian", msg->is_bigendian);
 		BSON_APPEND_INT32(b, "step", msg->step);
-		BSON_APPEND_BINARY(b, "data", BSON_SUBTYPE_BINARY, msg->data, msg->height * msg->step);
+		_bson_append_binary_payload(b, "data", msg->data, msg->height * msg->step);
 	}
 };
\ No newline at end of file
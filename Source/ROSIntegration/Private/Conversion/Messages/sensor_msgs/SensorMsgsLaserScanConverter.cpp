@@ -4,6 +4,7 @@
 USensorMsgsLaserScanConverter::USensorMsgsLaserScanConverter()
 {
 	_MessageType = "sensor_msgs/LaserScan";
+	_SupportsRawMessages = true;
 }
 
 bool USensorMsgsLaserScanConverter::ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
@@ -13,6 +14,14 @@ bool USensorMsgsLaserScanConverter::ConvertIncomingMessage(const ROSBridgePublis
 	return _bson_extract_child_laser_scan(message->full_msg_bson_, "msg", msg);
 }
 
+bool USensorMsgsLaserScanConverter::ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	auto msg = new ROSMessages::sensor_msgs::LaserScan;
+	BaseMsg = TSharedPtr<FROSBaseMsg>(msg);
+	rosbridge2cpp::ROS1Reader Reader(Data, Length);
+	return _ros1_read_laser_scan(Reader, msg);
+}
+
 bool USensorMsgsLaserScanConverter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
 {
 	auto CastMsg = StaticCastSharedPtr<ROSMessages::sensor_msgs::LaserScan>(BaseMsg);
@@ -16,6 +16,7 @@ public:
 	USensorMsgsLaserScanConverter();
 	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
 	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
+	virtual bool ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg);
 
 	static bool _bson_extract_child_laser_scan(bson_t *b, FString key, ROSMessages::sensor_msgs::LaserScan *msg, bool LogOnErrors = true)
 	{
@@ -36,6 +37,22 @@ public:
 		return true;
 	}
 
+	static bool _ros1_read_laser_scan(rosbridge2cpp::ROS1Reader &r, ROSMessages::sensor_msgs::LaserScan *msg)
+	{
+		UStdMsgsHeaderConverter::_ros1_read_header(r, &msg->header);
+		msg->angle_min = r.Read<float>();
+		msg->angle_max = r.Read<float>();
+		msg->angle_increment = r.Read<float>();
+		msg->time_increment = r.Read<float>();
+		msg->scan_time = r.Read<float>();
+		msg->range_min = r.Read<float>();
+		msg->range_max = r.Read<float>();
+		_ros1_read_tarray(r, msg->ranges);
+		_ros1_read_tarray(r, msg->intensities);
+
+		return r.Ok();
+	}
+
 	static void _bson_append_child_laser_scan(bson_t *b, const char *key, const ROSMessages::sensor_msgs::LaserScan *msg)
 	{
 		bson_t child;
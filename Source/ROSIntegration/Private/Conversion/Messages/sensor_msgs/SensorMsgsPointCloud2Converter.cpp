@@ -4,6 +4,7 @@
 USensorMsgsPointCloud2Converter::USensorMsgsPointCloud2Converter()
 {
 	_MessageType = "sensor_msgs/PointCloud2";
+	_SupportsRawMessages = true;
 }
 
 bool USensorMsgsPointCloud2Converter::ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
@@ -13,6 +14,14 @@ bool USensorMsgsPointCloud2Converter::ConvertIncomingMessage(const ROSBridgePubl
 	return _bson_extract_child_point_cloud2(message->full_msg_bson_, "msg", msg);
 }
 
+bool USensorMsgsPointCloud2Converter::ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	auto msg = new ROSMessages::sensor_msgs::PointCloud2;
+	BaseMsg = TSharedPtr<FROSBaseMsg>(msg);
+	rosbridge2cpp::ROS1Reader Reader(Data, Length);
+	return _ros1_read_point_cloud2(Reader, msg);
+}
+
 bool USensorMsgsPointCloud2Converter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
 {
 	auto CastMsg = StaticCastSharedPtr<ROSMessages::sensor_msgs::PointCloud2>(BaseMsg);
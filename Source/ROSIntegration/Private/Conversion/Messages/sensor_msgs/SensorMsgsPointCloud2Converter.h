@@ -16,6 +16,7 @@ public:
 	USensorMsgsPointCloud2Converter();
 	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
 	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
+	virtual bool ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg);
 
 	static bool _bson_extract_child_point_cloud2(bson_t *b, FString key, ROSMessages::sensor_msgs::PointCloud2 *msg)
 	{
@@ -44,6 +45,35 @@ public:
 		return true;
 	}
 
+	static bool _ros1_read_point_cloud2(rosbridge2cpp::ROS1Reader &r, ROSMessages::sensor_msgs::PointCloud2 *msg)
+	{
+		UStdMsgsHeaderConverter::_ros1_read_header(r, &msg->header);
+		msg->height = r.Read<uint32>();
+		msg->width = r.Read<uint32>();
+
+		uint32 NumFields = 0;
+		r.ReadArray(NumFields, 0);
+		const uint32 MinFieldSize = 13; // empty name, offset, datatype and count
+		if (!r.Ok() || NumFields > r.Remaining() / MinFieldSize) return false;
+		msg->fields.SetNum(NumFields);
+		for (ROSMessages::sensor_msgs::PointCloud2::PointField& Field : msg->fields)
+		{
+			Field.name = _ros1_read_fstring(r);
+			Field.offset = r.Read<uint32>();
+			Field.datatype = static_cast<ROSMessages::sensor_msgs::PointCloud2::PointField::EType>(r.Read<uint8>());
+			Field.count = r.Read<uint32>();
+		}
+
+		msg->is_bigendian = r.ReadBool();
+		msg->point_step = r.Read<uint32>();
+		msg->row_step = r.Read<uint32>();
+		uint32 DataLength = 0;
+		msg->data_ptr = r.ReadArray(DataLength, 1); // not copied, points into the received message
+		msg->is_dense = r.ReadBool();
+
+		return r.Ok() && DataLength >= static_cast<uint64>(msg->height) * msg->row_step;
+	}
+
 	static void _bson_append_child_point_cloud2(bson_t *b, const char *key, const ROSMessages::sensor_msgs::PointCloud2 *msg)
 	{
 		bson_t child;
@@ -74,7 +104,7 @@ public:
 		BSON_APPEND_BOOL(b, "is_bigendian", msg->is_bigendian);
 		BSON_APPEND_INT32(b, "point_step", msg->point_step);
 		BSON_APPEND_INT32(b, "row_step", msg->row_step);
-		BSON_APPEND_BINARY(b, "data", BSON_SUBTYPE_BINARY, msg->data_ptr, msg->height * msg->row_step);
+		_bson_append_binary_payload(b, "data", msg->data_ptr, msg->height * msg->row_step);
 		BSON_APPEND_BOOL(b, "is_dense", msg->is_dense);
 	}
 };
\ No newline at end of file
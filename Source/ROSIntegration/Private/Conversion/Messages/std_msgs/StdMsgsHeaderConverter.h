@@ -31,6 +31,13 @@ public:
 		return true;
 	}
 
+	static void _ros1_read_header(rosbridge2cpp::ROS1Reader &r, ROSMessages::std_msgs::Header *msg)
+	{
+		msg->seq = r.Read<uint32>();
+		_ros1_read_ros_time(r, &msg->time);
+		msg->frame_id = _ros1_read_fstring(r);
+	}
+
 	static void _bson_append_child_header(bson_t* b, const char* key, const ROSMessages::std_msgs::Header* msg)
 	{
 		bson_t child;
@@ -4,6 +4,7 @@
 UTf2MsgsTFMessageConverter::UTf2MsgsTFMessageConverter()
 {
 	_MessageType = "tf2_msgs/TFMessage";
+	_SupportsRawMessages = true;
 }
 
 bool UTf2MsgsTFMessageConverter::ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg) 
@@ -13,6 +14,14 @@ bool UTf2MsgsTFMessageConverter::ConvertIncomingMessage(const ROSBridgePublishMs
 	return _bson_extract_child_tf2_msg(message->full_msg_bson_, "msg", msg);
 }
 
+bool UTf2MsgsTFMessageConverter::ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg)
+{
+	auto msg = new ROSMessages::tf2_msgs::TFMessage;
+	BaseMsg = TSharedPtr<FROSBaseMsg>(msg);
+	rosbridge2cpp::ROS1Reader Reader(Data, Length);
+	return _ros1_read_tf2_msg(Reader, msg);
+}
+
 
 bool UTf2MsgsTFMessageConverter::ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message) 
 {
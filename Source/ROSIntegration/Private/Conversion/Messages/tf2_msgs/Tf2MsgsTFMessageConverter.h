@@ -17,6 +17,7 @@ public:
 
 	virtual bool ConvertIncomingMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg);
 	virtual bool ConvertOutgoingMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message);
+	virtual bool ConvertIncomingRawMessage(const uint8* Data, uint32 Length, TSharedPtr<FROSBaseMsg> &BaseMsg);
 
     static ROSMessages::geometry_msgs::TransformStamped GetTransformStampedFromBSON(FString key, bson_t* b, bool &keyFound, bool LogOnErrors = true)
     {
@@ -43,6 +44,20 @@ public:
         return keyFound;
     }
 
+    static bool _ros1_read_tf2_msg(rosbridge2cpp::ROS1Reader &r, ROSMessages::tf2_msgs::TFMessage *msg)
+    {
+        uint32 NumTransforms = 0;
+        r.ReadArray(NumTransforms, 0);
+        const uint32 MinTransformSize = 76; // header with empty frame_id, empty child_frame_id and transform
+        if (!r.Ok() || NumTransforms > r.Remaining() / MinTransformSize) return false;
+        msg->transforms.SetNum(NumTransforms);
+        for (ROSMessages::geometry_msgs::TransformStamped& Transform : msg->transforms)
+        {
+            UGeometryMsgsTransformStampedConverter::_ros1_read_transform_stamped(r, &Transform);
+        }
+        return r.Ok();
+    }
+
     static void _bson_append_child_tf2_msg(bson_t *b, const char *key, const ROSMessages::tf2_msgs::TFMessage *msg)
 	{
 		bson_t child;
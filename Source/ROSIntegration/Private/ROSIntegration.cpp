@@ -1,16 +1,47 @@
 #include "ROSIntegration.h"
+#include "ROSIntegrationCore.h"
+#include "Conversion/ConverterBenchmark.h"
+#include "rosbridge2cpp/ros_log.h"
+#include "rosbridge2cpp/ros_profiling.h"
+
+#if ROS_WITH_TRACE
+UE_TRACE_CHANNEL_DEFINE(ROSChannel)
+#endif
 
 #define LOCTEXT_NAMESPACE "FROSIntegrationModule"
 
 void FROSIntegrationModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+
+	// Route the rosbridge2cpp log through LogROS. The sink runs on the flush thread of the logger, not on the game thread
+	rosbridge2cpp::AsyncLogger& Logger = rosbridge2cpp::AsyncLogger::Get();
+	Logger.SetSink([](rosbridge2cpp::LogSeverity Severity, const char* Message)
+	{
+		switch (Severity)
+		{
+		case rosbridge2cpp::LogSeverity::SEVERITY_VERBOSE: UE_LOG(LogROS, Verbose, TEXT("%s"), UTF8_TO_TCHAR(Message)); break;
+		case rosbridge2cpp::LogSeverity::SEVERITY_INFO: UE_LOG(LogROS, Display, TEXT("%s"), UTF8_TO_TCHAR(Message)); break;
+		case rosbridge2cpp::LogSeverity::SEVERITY_WARNING: UE_LOG(LogROS, Warning, TEXT("%s"), UTF8_TO_TCHAR(Message)); break;
+		default: UE_LOG(LogROS, Error, TEXT("%s"), UTF8_TO_TCHAR(Message)); break;
+		}
+	});
+	Logger.SetMinSeverity(LogROS.GetVerbosity() >= ELogVerbosity::Verbose ? rosbridge2cpp::LogSeverity::SEVERITY_VERBOSE : rosbridge2cpp::LogSeverity::SEVERITY_INFO);
+	Logger.Start();
+
+#if !UE_BUILD_SHIPPING
+	InitConverterBenchmark();
+#endif
 }
 
 void FROSIntegrationModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+
+	// Flush pending messages while LogROS is still around, later messages go to stderr
+	rosbridge2cpp::AsyncLogger::Get().Stop();
+	rosbridge2cpp::AsyncLogger::Get().SetSink(nullptr);
 }
 
 #undef LOCTEXT_NAMESPACE
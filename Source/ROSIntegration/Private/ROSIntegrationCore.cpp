@@ -1,18 +1,60 @@
 #include "ROSIntegrationCore.h"
 #include "ROSIntegrationGameInstance.h"
+#include "RI/Topic.h"
+#include "RI/Service.h"
 #include "rosbridge2cpp/TCPConnection.h"
+#include "rosbridge2cpp/UnixSocketConnection.h"
 #include "rosbridge2cpp/WebsocketConnection.h"
 #include "rosbridge2cpp/ros_bridge.h"
+#include "rosbridge2cpp/ros_profiling.h"
 #include "rosbridge2cpp/ros_topic.h"
 
 #include "SpawnManager.h"
 #include "SpawnObjectMessage.h"
 
 
+#include <Async/Async.h>
+#include <Misc/Crc.h>
+#include <Misc/FileHelper.h>
+#include <HAL/PlatformTime.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
 #include <sstream>
+#include <thread>
 
 DEFINE_LOG_CATEGORY(LogROS);
 
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: header.stamp to Publish (ms)"), STAT_ROSLatencyStampToPublish, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: outgoing converter (ms)"), STAT_ROSLatencyConvertOutgoing, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: enqueue (ms)"), STAT_ROSLatencyEnqueue, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: publisher queue (ms)"), STAT_ROSLatencyQueueWait, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: socket write (ms)"), STAT_ROSLatencySocketWrite, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: Publish to sent (ms)"), STAT_ROSLatencyPublishToSent, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: header.stamp to receive (ms)"), STAT_ROSLatencyStampToReceive, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: receive to dispatch (ms)"), STAT_ROSLatencyReceiveToDispatch, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: incoming converter (ms)"), STAT_ROSLatencyConvertIncoming, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: callback (ms)"), STAT_ROSLatencyCallback, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Latency p99: receive to delivered (ms)"), STAT_ROSLatencyReceiveToDelivered, STATGROUP_ROSIntegration);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Messages published"), STAT_ROSMessagesPublished, STATGROUP_ROSIntegration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Messages dropped"), STAT_ROSMessagesDropped, STATGROUP_ROSIntegration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Messages decoded"), STAT_ROSMessagesDecoded, STATGROUP_ROSIntegration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Send errors"), STAT_ROSSendErrors, STATGROUP_ROSIntegration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Send stalls"), STAT_ROSSendStalls, STATGROUP_ROSIntegration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared memory payloads"), STAT_ROSSharedMemoryPayloads, STATGROUP_ROSIntegration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Max publisher queue depth"), STAT_ROSMaxQueueDepth, STATGROUP_ROSIntegration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending service calls"), STAT_ROSPendingServiceCalls, STATGROUP_ROSIntegration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blueprint events dropped"), STAT_ROSBlueprintEventsDropped, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Sent (msgs/s)"), STAT_ROSSentRate, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Sent (KB/s)"), STAT_ROSSentKBRate, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Received (msgs/s)"), STAT_ROSReceivedRate, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Received (KB/s)"), STAT_ROSReceivedKBRate, STATGROUP_ROSIntegration);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Dropped (msgs/s)"), STAT_ROSDroppedRate, STATGROUP_ROSIntegration);
+
 #define UNREAL_ROS_CHECK_KEY_FOUND \
 	if (!key_found) {\
 		UE_LOG(LogROS, Warning, TEXT("%s is not present in data"), *FString(UTF8_TO_TCHAR(LookupKey.c_str())));\
@@ -20,17 +62,494 @@ DEFINE_LOG_CATEGORY(LogROS);
 	}
 
 
-// PIMPL
-class UImpl::Impl
+// Settings of all connections, the connection manager thread works on a copy
+struct FBridgeConnectionConfig
 {
-	// hidden implementation details
+	FString Protocol;
+	FString Host;
+	int32 Port = 0;
+	bool bBsonMode = true;
+	int32 ServiceWorkerThreads = 0;
+	int32 MaxPendingServiceCalls = 1024;
+	float ConnectTimeout = 2.f;
+	float SendTimeout = 1.f;
+	int32 SocketSendBufferSize = 0;
+	int32 SocketReceiveBufferSize = 0;
+	bool bBatchRegistrations = true;
+	bool bSharedMemoryPayloads = false;
+	int32 SharedMemorySlots = 8;
+	int32 SharedMemorySlotSize = 32 * 1024 * 1024;
+	int32 MinSharedMemoryPayloadSize = 64 * 1024;
+	FString SubscriptionCompression = TEXT("none");
+	TArray<FROSBridgeConnectionSettings> AdditionalConnections;
+};
+
+
+// One connection to a rosbridge server with its own socket, receiver and publisher thread
+struct FBridgeConnection
+{
+	FString Name;
+	FString Protocol;
+	FString Host;
+	int32 Port = 0;
+	FString Endpoint; // protocol://host:port
+	TArray<FString> Topics; // see FROSBridgeConnectionSettings::Topics
+	bool bLoadBalance = false;
+	FString SubscriptionCompression = TEXT("none");
+	bool bAvailable = false; // carries its topics and services, see FBridgeConnectionSet::UpdateAvailability()
 	TCPConnection* _TCPConnection = nullptr;
 	WebsocketConnection* _WebsocketConnection = nullptr;
+	UnixSocketConnection* _UnixConnection = nullptr;
 	rosbridge2cpp::ROSBridge* _Ros = nullptr;
+
+	~FBridgeConnection()
+	{
+		if (_Ros) delete _Ros;
+		if (_WebsocketConnection) delete _WebsocketConnection;
+		if (_TCPConnection) delete _TCPConnection;
+		if (_UnixConnection) delete _UnixConnection;
+	}
+
+	// A connection with the same settings that isn't connected yet
+	std::unique_ptr<FBridgeConnection> MakeReplacement() const
+	{
+		std::unique_ptr<FBridgeConnection> Connection(new FBridgeConnection());
+		Connection->Name = Name;
+		Connection->Protocol = Protocol;
+		Connection->Host = Host;
+		Connection->Port = Port;
+		Connection->Topics = Topics;
+		Connection->bLoadBalance = bLoadBalance;
+		Connection->SubscriptionCompression = SubscriptionCompression;
+		return Connection;
+	}
+
+	bool Init(const FBridgeConnectionConfig& Config)
+	{
+		if (Protocol == "ws") {
+			_WebsocketConnection = new WebsocketConnection();
+			_Ros = new rosbridge2cpp::ROSBridge(*_WebsocketConnection);
+		} else if (Protocol == "tcp") {
+			_TCPConnection = new TCPConnection();
+			_TCPConnection->SetConnectTimeout(std::chrono::milliseconds(static_cast<int64>(Config.ConnectTimeout * 1000.f)));
+			_TCPConnection->SetSendTimeout(std::chrono::milliseconds(static_cast<int64>(Config.SendTimeout * 1000.f)));
+			_TCPConnection->SetSocketBufferSizes(Config.SocketSendBufferSize, Config.SocketReceiveBufferSize);
+			_Ros = new rosbridge2cpp::ROSBridge(*_TCPConnection);
+		} else if (Protocol == "unix") {
+			// the host is the path of the socket
+			_UnixConnection = new UnixSocketConnection();
+			_UnixConnection->SetSendTimeout(std::chrono::milliseconds(static_cast<int64>(Config.SendTimeout * 1000.f)));
+			_UnixConnection->SetSocketBufferSizes(Config.SocketSendBufferSize, Config.SocketReceiveBufferSize);
+			_Ros = new rosbridge2cpp::ROSBridge(*_UnixConnection);
+		} else {
+			UE_LOG(LogROS, Error, TEXT("Protocol %s of connection %s not supported"), *Protocol, *Name);
+			return false;
+		}
+
+		if (Config.bBsonMode) {
+			_Ros->enable_bson_mode();
+		}
+		_Ros->SetServiceWorkerThreads(FMath::Max(Config.ServiceWorkerThreads, 0));
+		_Ros->SetMaxPendingServiceCalls(FMath::Max(Config.MaxPendingServiceCalls, 1));
+		_Ros->SetBatchControlMessages(Config.bBatchRegistrations);
+		if (Config.bSharedMemoryPayloads) {
+			_Ros->SetSharedMemoryPayloads(FMath::Clamp(Config.SharedMemorySlots, 1, static_cast<int32>(rosbridge2cpp::SharedMemoryRing::kMaxSlots)),
+				FMath::Max(Config.SharedMemorySlotSize, 1), FMath::Max(Config.MinSharedMemoryPayloadSize, 0));
+		}
+		if (SubscriptionCompression == TEXT("cbor")) {
+			_Ros->SetSubscriptionCompression("cbor");
+		} else if (SubscriptionCompression != TEXT("none")) {
+			UE_LOG(LogROS, Warning, TEXT("Subscription compression %s of connection %s not supported, subscribing without compression"), *SubscriptionCompression, *Name);
+		}
+
+		Endpoint = Protocol == "unix" ? FString::Printf(TEXT("unix://%s"), *Host) : FString::Printf(TEXT("%s://%s:%d"), *Protocol, *Host, Port);
+		return _Ros->Init(TCHAR_TO_UTF8(*Host), Port);
+	}
+
+	bool IsHealthy() const
+	{
+		return ((_TCPConnection != nullptr && _TCPConnection->IsHealthy()) || (_WebsocketConnection != nullptr && _WebsocketConnection->IsHealthy()) ||
+			(_UnixConnection != nullptr && _UnixConnection->IsHealthy())) && _Ros != nullptr && _Ros->IsHealthy();
+	}
+
+	bool IsAssigned(const FString& TopicOrService) const
+	{
+		for (const FString& Pattern : Topics)
+		{
+			if (Pattern.EndsWith(TEXT("*")) ? TopicOrService.StartsWith(Pattern.LeftChop(1)) : TopicOrService == Pattern) return true;
+		}
+		return false;
+	}
+};
+
+
+// The main connection and the additional ones, see FROSBridgeConnectionSettings
+struct FBridgeConnectionSet
+{
+	FBridgeConnection Main;
+	std::vector<std::unique_ptr<FBridgeConnection>> Additional;
+
+	// The main connection and the available additional ones with bLoadBalance
+	std::vector<FBridgeConnection*> ServerPool;
+
+	// Only fails if the main connection fails. An additional connection that fails is kept and reconnected on its own,
+	// see UImpl::Impl::UpdateConnections(), its topics and services use the other connections in the meantime.
+	bool Init(const FBridgeConnectionConfig& Config)
+	{
+		Main.Name = TEXT("main");
+		Main.Protocol = Config.Protocol;
+		Main.Host = Config.Host;
+		Main.Port = Config.Port;
+		Main.SubscriptionCompression = Config.SubscriptionCompression;
+		if (!Main.Init(Config)) {
+			return false;
+		}
+		Main.bAvailable = true;
+
+		for (const FROSBridgeConnectionSettings& Settings : Config.AdditionalConnections)
+		{
+			std::unique_ptr<FBridgeConnection> Connection(new FBridgeConnection());
+			Connection->Name = Settings.Name.IsEmpty() ? FString::Printf(TEXT("%d"), static_cast<int32>(Additional.size()) + 1) : Settings.Name;
+			Connection->Topics = Settings.Topics;
+			Connection->bLoadBalance = Settings.bLoadBalance;
+			Connection->SubscriptionCompression = Settings.SubscriptionCompression.IsEmpty() ? Config.SubscriptionCompression : Settings.SubscriptionCompression;
+
+			Connection->Protocol = Settings.Protocol.IsEmpty() ? Config.Protocol : Settings.Protocol;
+			Connection->Host = Settings.Host.IsEmpty() ? Config.Host : Settings.Host;
+			Connection->Port = Settings.Port > 0 ? Settings.Port : Config.Port;
+
+			if (Connection->Init(Config)) {
+				UE_LOG(LogROS, Log, TEXT("Opened rosbridge connection %s to %s:%d"), *Connection->Name, *Connection->Host, Connection->Port);
+			} else {
+				UE_LOG(LogROS, Warning, TEXT("Failed to open rosbridge connection %s to %s:%d, its topics and services use the other connections until it is reconnected"),
+					*Connection->Name, *Connection->Host, Connection->Port);
+			}
+			Additional.push_back(std::move(Connection));
+		}
+		UpdateAvailability();
+		return true;
+	}
+
+	// Only the main connection is required, see UpdateAvailability() for the additional ones
+	bool IsHealthy() const
+	{
+		return Main.IsHealthy();
+	}
+
+	// Takes the additional connections that went down out of service and the ones that are up again back in. Only called
+	// on the game thread, so the selection of SelectBridge() doesn't change while the topics and services move. Returns
+	// true if it changed.
+	bool UpdateAvailability()
+	{
+		bool bChanged = false;
+		ServerPool.clear();
+		ServerPool.push_back(&Main);
+		for (const std::unique_ptr<FBridgeConnection>& Connection : Additional)
+		{
+			const bool bAvailable = Connection->IsHealthy();
+			if (bAvailable != Connection->bAvailable) {
+				if (bAvailable) {
+					UE_LOG(LogROS, Display, TEXT("rosbridge connection %s to %s is up, moving its topics and services back"), *Connection->Name, *Connection->Endpoint);
+				} else {
+					UE_LOG(LogROS, Warning, TEXT("rosbridge connection %s to %s is down, moving its topics and services to the other connections"), *Connection->Name, *Connection->Endpoint);
+				}
+				Connection->bAvailable = bAvailable;
+				bChanged = true;
+			}
+			if (bAvailable && Connection->bLoadBalance) ServerPool.push_back(Connection.get());
+		}
+		return bChanged;
+	}
+
+	bool IsAvailable(const rosbridge2cpp::ROSBridge* Bridge) const
+	{
+		if (Bridge == Main._Ros) return true;
+		for (const std::unique_ptr<FBridgeConnection>& Connection : Additional)
+		{
+			if (Connection->_Ros == Bridge) return Connection->bAvailable;
+		}
+		return false;
+	}
+
+	rosbridge2cpp::ROSBridge& SelectBridge(const FString& TopicOrService)
+	{
+		// an assigned connection that is down hands its topics to the pool
+		for (const std::unique_ptr<FBridgeConnection>& Connection : Additional)
+		{
+			if (Connection->bAvailable && Connection->IsAssigned(TopicOrService)) return *Connection->_Ros;
+		}
+
+		// Rendezvous hashing, so only the topics of a server that drops out of the pool move to another one
+		FBridgeConnection* Selected = &Main;
+		uint32 SelectedWeight = 0;
+		for (FBridgeConnection* Connection : ServerPool)
+		{
+			const uint32 Weight = FCrc::StrCrc32(*TopicOrService, FCrc::StrCrc32(*Connection->Endpoint));
+			if (Weight >= SelectedWeight)
+			{
+				Selected = Connection;
+				SelectedWeight = Weight;
+			}
+		}
+		return *Selected->_Ros;
+	}
+};
+
+
+// Establishes connections on its own thread with jittered exponential backoff between the attempts, and tears down
+// broken ones there, so neither a rosbridge outage nor the recovery from it blocks the game thread
+class FBridgeConnectionManager
+{
+public:
+	~FBridgeConnectionManager()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(_Mutex);
+			_bStop = true;
+		}
+		_Wakeup.notify_all();
+		if (_Thread.joinable()) _Thread.join();
+	}
+
+	void SetBackoff(float MinSeconds, float MaxSeconds)
+	{
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		_MinBackoff = FMath::Max(MinSeconds, 0.01f);
+		_MaxBackoff = FMath::Max(MaxSeconds, _MinBackoff);
+	}
+
+	// Starts connecting in the background unless it's already in progress. Returns the new connections once an attempt succeeded.
+	std::unique_ptr<FBridgeConnectionSet> PollReconnect(const FBridgeConnectionConfig& Config)
+	{
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		if (_Connected) {
+			return std::move(_Connected);
+		}
+		if (!_bReconnect) {
+			_bReconnect = true;
+			_Config = Config;
+			// the connections of the replaced set are gone by the time this one is connected
+			for (FMemberReconnect& Member : _Members)
+			{
+				if (Member.Replacement) _RetiredMembers.push_back(std::move(Member.Replacement));
+			}
+			_Members.clear();
+			StartThread();
+			_Wakeup.notify_all();
+		}
+		return nullptr;
+	}
+
+	// The same for a single additional connection of the current set that failed, identified by its address. The attempts
+	// have their own backoff, and don't touch the other connections.
+	std::unique_ptr<FBridgeConnection> PollReconnectMember(const FBridgeConnection& Connection, const FBridgeConnectionConfig& Config)
+	{
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		for (auto It = _Members.begin(); It != _Members.end(); ++It)
+		{
+			if (It->Key != &Connection) continue;
+			std::unique_ptr<FBridgeConnection> Replacement = std::move(It->Replacement);
+			if (Replacement) _Members.erase(It);
+			return Replacement;
+		}
+		if (_bReconnect) {
+			return nullptr; // the whole set is replaced anyway
+		}
+
+		FMemberReconnect Member;
+		Member.Id = ++_LastMemberId;
+		Member.Key = &Connection;
+		Member.Settings = Connection.MakeReplacement();
+		Member.NextAttempt = std::chrono::steady_clock::now();
+		_Members.push_back(std::move(Member));
+		_Config = Config;
+		StartThread();
+		_Wakeup.notify_all();
+		return nullptr;
+	}
+
+	// Destroys the connections on the manager thread, joining their threads can take a second
+	void Retire(std::unique_ptr<FBridgeConnectionSet> Connections)
+	{
+		if (!Connections) return;
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		_Retired.push_back(std::move(Connections));
+		StartThread();
+		_Wakeup.notify_all();
+	}
+
+	void Retire(std::unique_ptr<FBridgeConnection> Connection)
+	{
+		if (!Connection) return;
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		_RetiredMembers.push_back(std::move(Connection));
+		StartThread();
+		_Wakeup.notify_all();
+	}
+
+private:
+	struct FMemberReconnect
+	{
+		uint64 Id = 0; // tells a finished attempt whether its request is still the same
+		const FBridgeConnection* Key = nullptr;
+		std::unique_ptr<FBridgeConnection> Settings; // not connected, copied for every attempt
+		std::unique_ptr<FBridgeConnection> Replacement;
+		int32 NumFailedAttempts = 0;
+		std::chrono::steady_clock::time_point NextAttempt;
+	};
+
+	float GetBackoff(int32 NumFailedAttempts, std::mt19937& Random) const
+	{
+		std::uniform_real_distribution<float> Jitter(0.5f, 1.5f);
+		return FMath::Min(_MinBackoff * FMath::Pow(2.f, static_cast<float>(FMath::Min(NumFailedAttempts, 16))), _MaxBackoff) * Jitter(Random);
+	}
+
+	void StartThread()
+	{
+		if (!_Thread.joinable()) {
+			_Thread = std::thread(&FBridgeConnectionManager::Run, this);
+		}
+	}
+
+	void Run()
+	{
+		ROS_PROFILER_THREAD_NAME("ROSConnectionManager");
+
+		std::mt19937 Random(std::random_device{}());
+		int32 NumFailedAttempts = 0;
+
+		std::unique_lock<std::mutex> Lock(_Mutex);
+		while (!_bStop) {
+			if (!_Retired.empty() || !_RetiredMembers.empty()) {
+				std::vector<std::unique_ptr<FBridgeConnectionSet>> Retired = std::move(_Retired);
+				std::vector<std::unique_ptr<FBridgeConnection>> RetiredMembers = std::move(_RetiredMembers);
+				_Retired.clear();
+				_RetiredMembers.clear();
+				Lock.unlock();
+				Retired.clear();
+				RetiredMembers.clear();
+				Lock.lock();
+				continue;
+			}
+
+			if (!_bReconnect) {
+				ReconnectMembers(Lock, Random);
+				continue;
+			}
+
+			const FBridgeConnectionConfig Config = _Config;
+			Lock.unlock();
+			std::unique_ptr<FBridgeConnectionSet> Connections(new FBridgeConnectionSet());
+			const bool bConnected = Connections->Init(Config);
+			if (!bConnected) {
+				Connections.reset();
+			}
+			Lock.lock();
+
+			if (bConnected) {
+				_Connected = std::move(Connections);
+				_bReconnect = false;
+				NumFailedAttempts = 0;
+				continue;
+			}
+
+			const float Backoff = GetBackoff(NumFailedAttempts, Random);
+			++NumFailedAttempts;
+			UE_LOG(LogROS, Display, TEXT("Connecting to rosbridge %s:%d failed (attempt %d), retrying in %.1f s"), *Config.Host, Config.Port, NumFailedAttempts, Backoff);
+			_Wakeup.wait_for(Lock, std::chrono::duration<float>(Backoff), [this]() { return _bStop || !_Retired.empty() || !_RetiredMembers.empty(); });
+		}
+	}
+
+	// Makes one attempt for the additional connection that is due first, or waits until one is due or something changes
+	void ReconnectMembers(std::unique_lock<std::mutex>& Lock, std::mt19937& Random)
+	{
+		FMemberReconnect* Due = nullptr;
+		for (FMemberReconnect& Member : _Members)
+		{
+			if (!Member.Replacement && (!Due || Member.NextAttempt < Due->NextAttempt)) Due = &Member;
+		}
+		if (!Due) {
+			_Wakeup.wait(Lock);
+			return;
+		}
+		if (Due->NextAttempt > std::chrono::steady_clock::now()) {
+			_Wakeup.wait_until(Lock, Due->NextAttempt);
+			return;
+		}
+
+		const uint64 Id = Due->Id;
+		const FBridgeConnectionConfig Config = _Config;
+		std::unique_ptr<FBridgeConnection> Connection = Due->Settings->MakeReplacement();
+		Lock.unlock();
+		const bool bConnected = Connection->Init(Config);
+		Lock.lock();
+
+		// _Members may have changed in the meantime
+		auto It = std::find_if(_Members.begin(), _Members.end(), [Id](const FMemberReconnect& Member) { return Member.Id == Id; });
+		if (It == _Members.end()) {
+			_RetiredMembers.push_back(std::move(Connection));
+			return;
+		}
+		if (bConnected) {
+			It->Replacement = std::move(Connection);
+			return;
+		}
+
+		const float Backoff = GetBackoff(It->NumFailedAttempts, Random);
+		++It->NumFailedAttempts;
+		It->NextAttempt = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(Backoff));
+		UE_LOG(LogROS, Display, TEXT("Connecting rosbridge connection %s to %s:%d failed (attempt %d), retrying in %.1f s"),
+			*Connection->Name, *Connection->Host, Connection->Port, It->NumFailedAttempts, Backoff);
+		_RetiredMembers.push_back(std::move(Connection));
+	}
+
+	std::mutex _Mutex;
+	std::condition_variable _Wakeup;
+	std::thread _Thread;
+	bool _bStop = false;
+	bool _bReconnect = false;
+	float _MinBackoff = 0.5f;
+	float _MaxBackoff = 30.f;
+	FBridgeConnectionConfig _Config;
+	std::unique_ptr<FBridgeConnectionSet> _Connected;
+	std::vector<std::unique_ptr<FBridgeConnectionSet>> _Retired;
+	std::vector<FMemberReconnect> _Members;
+	std::vector<std::unique_ptr<FBridgeConnection>> _RetiredMembers;
+	uint64 _LastMemberId = 0;
+};
+
+
+// PIMPL
+class UImpl::Impl
+{
+	// hidden implementation details
+	// declared first, so the listeners below are destroyed while their bridge still exists
+	FBridgeConnectionManager _ConnectionManager;
+	FBridgeConnectionConfig _Config;
+	std::unique_ptr<FBridgeConnectionSet> _Connections;
+	std::unique_ptr<FBridgeConnectionSet> _PreviousConnections; // until the topics and services moved to the new connections
+	std::vector<std::unique_ptr<FBridgeConnection>> _PreviousMembers; // the same for single additional connections
+
 public:
 	bool _bson_test_mode;
 
-	rosbridge2cpp::ROSBridge& GetBridge() { return *_Ros; }
+	// The main connection carries the spawn manager and everything that isn't assigned to or balanced onto another connection
+	rosbridge2cpp::ROSBridge& GetBridge() { return *_Connections->Main._Ros; }
+
+	rosbridge2cpp::ROSBridge& GetBridgeForTopic(const FString& Topic) { return _Connections->SelectBridge(Topic); }
+
+	rosbridge2cpp::ROSBridge& GetBridgeForService(const FString& ServiceName) { return _Connections->SelectBridge(ServiceName); }
+
+	template<typename FunctionType>
+	void ForEachBridge(FunctionType Function)
+	{
+		if (!_Connections) return;
+		if (_Connections->Main._Ros) Function(*_Connections->Main._Ros);
+		for (const std::unique_ptr<FBridgeConnection>& Connection : _Connections->Additional)
+		{
+			if (Connection->_Ros) Function(*Connection->_Ros);
+		}
+	}
 
 	UWorld* _World = nullptr;
 
@@ -260,14 +779,16 @@ public:
 		UE_LOG(LogROS, Display, TEXT("UROSIntegrationCore ~Impl() "));
 		//_World = nullptr;
 		_SpawnManager = nullptr;
-		if(_Ros) delete _Ros;
-		if(_WebsocketConnection) delete _WebsocketConnection;
-		if (_TCPConnection) delete _TCPConnection;
+	}
+
+	bool HasBridge() const
+	{
+		return _Connections && _Connections->Main._Ros != nullptr;
 	}
 
 	bool IsHealthy() const
 	{
-		return ((_TCPConnection != nullptr && _TCPConnection->IsHealthy()) || (_WebsocketConnection != nullptr && _WebsocketConnection->IsHealthy())) && _Ros != nullptr && _Ros->IsHealthy();
+		return _Connections && _Connections->IsHealthy();
 	}
 
 	void SetWorld(UWorld* World)
@@ -275,39 +796,99 @@ public:
 		_World = World;
 	}
 
+	bool IsSpawnManagerInitialized() const
+	{
+		return _SpawnMessageListener != nullptr;
+	}
+
+	// Applies to the current connections and the ones of later reconnects
+	void SetMaxPendingServiceCalls(int32 MaxPendingServiceCalls)
+	{
+		_Config.MaxPendingServiceCalls = MaxPendingServiceCalls;
+		ForEachBridge([MaxPendingServiceCalls](rosbridge2cpp::ROSBridge& Bridge) { Bridge.SetMaxPendingServiceCalls(FMath::Max(MaxPendingServiceCalls, 1)); });
+	}
+
 	void SetImplSpawnManager(USpawnManager* SpawnManager)
 	{
 		_SpawnManager = SpawnManager;
 	}
 
-	bool Init(FString protocol, FString ROSBridgeHost, int32 ROSBridgePort, bool bson_test_mode)
+	bool Init(const FBridgeConnectionConfig& Config, float MinReconnectBackoff, float MaxReconnectBackoff)
 	{
-		_bson_test_mode = bson_test_mode;
+		_bson_test_mode = Config.bBsonMode;
+		_Config = Config;
+		_ConnectionManager.SetBackoff(MinReconnectBackoff, MaxReconnectBackoff);
 
-		if (protocol == "ws") {
-			_WebsocketConnection = new WebsocketConnection();
-			_Ros = new rosbridge2cpp::ROSBridge(*_WebsocketConnection);
-		} else if (protocol == "tcp") {
-			_TCPConnection = new TCPConnection();
-			_Ros = new rosbridge2cpp::ROSBridge(*_TCPConnection);
-		} else {
-			UE_LOG(LogROS, Error, TEXT("Protocol not supported"));
+		_Connections.reset(new FBridgeConnectionSet());
+		bool ConnectionSuccessful = _Connections->Init(Config);
+		if (!ConnectionSuccessful) {
+			return false;
 		}
 
-		if (bson_test_mode) {
-			_Ros->enable_bson_mode();
-		}
+		UE_LOG(LogROS, Log, TEXT("rosbridge2cpp init successful"));
 
-		bool ConnectionSuccessful = _Ros->Init(TCHAR_TO_UTF8(*ROSBridgeHost), ROSBridgePort);
-		if (!ConnectionSuccessful) {
+		return true;
+	}
+
+	// Switches to the connections of the background reconnect once they are established. The previous
+	// connections stay around until FinishReconnect(), so the old topics and services can be released safely.
+	bool PollReconnect()
+	{
+		std::unique_ptr<FBridgeConnectionSet> Connections = _ConnectionManager.PollReconnect(_Config);
+		if (!Connections) {
 			return false;
 		}
 
-		UE_LOG(LogROS, Log, TEXT("rosbridge2cpp init successful"));
+		const bool bSpawnManager = _SpawnMessageListener != nullptr;
+		_SpawnMessageListener.reset();
+		_SpawnArrayMessageListener.reset();
 
+		_ConnectionManager.Retire(std::move(_PreviousConnections));
+		_PreviousConnections = std::move(_Connections);
+		_Connections = std::move(Connections);
+
+		if (bSpawnManager) {
+			InitSpawnManager();
+		}
 		return true;
 	}
 
+	void FinishReconnect()
+	{
+		_ConnectionManager.Retire(std::move(_PreviousConnections));
+	}
+
+	// Replaces the additional connections that failed once their background reconnect succeeded, and takes them out of
+	// or back into service. Returns true if topics and services have to move, see UROSIntegrationCore::UpdateConnections().
+	bool UpdateConnections()
+	{
+		if (!_Connections) return false;
+		for (std::unique_ptr<FBridgeConnection>& Connection : _Connections->Additional)
+		{
+			if (Connection->IsHealthy()) continue;
+			std::unique_ptr<FBridgeConnection> Replacement = _ConnectionManager.PollReconnectMember(*Connection, _Config);
+			if (!Replacement) continue;
+			_PreviousMembers.push_back(std::move(Connection));
+			Connection = std::move(Replacement);
+		}
+		return _Connections->UpdateAvailability();
+	}
+
+	void FinishUpdateConnections()
+	{
+		for (std::unique_ptr<FBridgeConnection>& Connection : _PreviousMembers)
+		{
+			_ConnectionManager.Retire(std::move(Connection));
+		}
+		_PreviousMembers.clear();
+	}
+
+	// Whether the topics and services that move away from this connection can still unsubscribe and unadvertise there
+	bool IsAvailable(const rosbridge2cpp::ROSBridge* Bridge) const
+	{
+		return _Connections && _Connections->IsAvailable(Bridge);
+	}
+
 
 	void InitSpawnManager()
 	{
@@ -329,6 +910,44 @@ public:
 
 
 
+static FROSLatencyStats ToROSLatencyStats(const rosbridge2cpp::LatencySummary& Summary)
+{
+	FROSLatencyStats Stats;
+	Stats.Topic = UTF8_TO_TCHAR(Summary.topic_.c_str());
+	Stats.Segment = UTF8_TO_TCHAR(rosbridge2cpp::LatencySegmentName(Summary.segment_));
+	Stats.Count = Summary.count_;
+	Stats.MeanMs = Summary.mean_ms_;
+	Stats.P50Ms = Summary.p50_ms_;
+	Stats.P90Ms = Summary.p90_ms_;
+	Stats.P99Ms = Summary.p99_ms_;
+	Stats.MaxMs = Summary.max_ms_;
+	return Stats;
+}
+
+
+static FROSTopicMetrics ToROSTopicMetrics(const rosbridge2cpp::TopicMetricsSnapshot& Snapshot)
+{
+	FROSTopicMetrics Metrics;
+	Metrics.Topic = UTF8_TO_TCHAR(Snapshot.topic_.c_str());
+	Metrics.Published = Snapshot.published_;
+	Metrics.Sent = Snapshot.sent_;
+	Metrics.Dropped = Snapshot.dropped_;
+	Metrics.BytesOut = Snapshot.bytes_out_;
+	Metrics.QueueDepth = Snapshot.queue_depth_;
+	Metrics.Received = Snapshot.received_;
+	Metrics.Decoded = Snapshot.decoded_;
+	Metrics.DecodeFailures = Snapshot.decode_failures_;
+	Metrics.Conflated = Snapshot.conflated_;
+	Metrics.LocalDropped = Snapshot.local_dropped_;
+	Metrics.ReceiverBlocked = Snapshot.receiver_blocked_;
+	Metrics.DeliveredLocally = Snapshot.delivered_locally_;
+	Metrics.BytesIn = Snapshot.bytes_in_;
+	Metrics.AvgSendTimeMs = Snapshot.sent_ ? static_cast<float>(Snapshot.send_time_ns_ / 1e6 / Snapshot.sent_) : 0.f;
+	Metrics.AvgDecodeTimeMs = Snapshot.decoded_ ? static_cast<float>(Snapshot.decode_time_ns_ / 1e6 / Snapshot.decoded_) : 0.f;
+	return Metrics;
+}
+
+
 // - - -  - - - 
 
 
@@ -396,7 +1015,26 @@ bool UROSIntegrationCore::Init(FString protocol, FString ROSBridgeHost, int32 RO
 		_Implementation->Init();
 		_Implementation->SetImplSpawnManager(_SpawnManager);
 	}
-	return _Implementation->Get()->Init(protocol, ROSBridgeHost, ROSBridgePort, _bson_test_mode);
+
+	FBridgeConnectionConfig Config;
+	Config.Protocol = protocol;
+	Config.Host = ROSBridgeHost;
+	Config.Port = ROSBridgePort;
+	Config.bBsonMode = _bson_test_mode;
+	Config.ServiceWorkerThreads = _ServiceWorkerThreads;
+	Config.MaxPendingServiceCalls = _MaxPendingServiceCalls;
+	Config.ConnectTimeout = _ConnectTimeout;
+	Config.SendTimeout = _SendTimeout;
+	Config.SocketSendBufferSize = _SocketSendBufferSize;
+	Config.SocketReceiveBufferSize = _SocketReceiveBufferSize;
+	Config.bBatchRegistrations = _bBatchRegistrations;
+	Config.bSharedMemoryPayloads = _bSharedMemoryPayloads;
+	Config.SharedMemorySlots = _SharedMemorySlots;
+	Config.SharedMemorySlotSize = _SharedMemorySlotSize;
+	Config.MinSharedMemoryPayloadSize = _MinSharedMemoryPayloadSize;
+	Config.SubscriptionCompression = _SubscriptionCompression;
+	Config.AdditionalConnections = _AdditionalConnections;
+	return _Implementation->Get()->Init(Config, _MinReconnectBackoff, _MaxReconnectBackoff);
 }
 
 
@@ -405,6 +1043,116 @@ bool UROSIntegrationCore::IsHealthy() const
 	return _Implementation->Get()->IsHealthy();
 }
 
+bool UROSIntegrationCore::PollReconnect()
+{
+	if (!_Implementation || !_Implementation->Get()->PollReconnect()) return false;
+
+	// replay the state of every live topic and service on the new connections
+	bool bSuccess = true;
+	for (UTopic* Topic : GetTopics())
+	{
+		if (!Topic->Reconnect(this))
+		{
+			bSuccess = false;
+			UE_LOG(LogROS, Error, TEXT("Unable to re-establish topic %s."), *Topic->GetDetailedInfo());
+		}
+	}
+	for (UService* Service : GetServices())
+	{
+		if (!Service->Reconnect(this))
+		{
+			bSuccess = false;
+			UE_LOG(LogROS, Error, TEXT("Unable to re-establish service %s."), *Service->GetDetailedInfo());
+		}
+	}
+
+	_Implementation->Get()->FinishReconnect();
+	return bSuccess;
+}
+
+bool UROSIntegrationCore::UpdateConnections()
+{
+	if (!_Implementation) return true;
+
+	// only the topics and services whose connection changed move
+	bool bSuccess = true;
+	if (_Implementation->Get()->UpdateConnections())
+	{
+		for (UTopic* Topic : GetTopics())
+		{
+			if (!Topic->IsOnSelectedConnection() && !Topic->Reconnect(this))
+			{
+				bSuccess = false;
+				UE_LOG(LogROS, Error, TEXT("Unable to move topic %s to another connection."), *Topic->GetDetailedInfo());
+			}
+		}
+		for (UService* Service : GetServices())
+		{
+			if (!Service->IsOnSelectedConnection() && !Service->Reconnect(this))
+			{
+				bSuccess = false;
+				UE_LOG(LogROS, Error, TEXT("Unable to move service %s to another connection."), *Service->GetDetailedInfo());
+			}
+		}
+	}
+
+	_Implementation->Get()->FinishUpdateConnections();
+	return bSuccess;
+}
+
+std::function<void(bool)> UROSIntegrationCore::MakeRegistrationResultHandler(const FString& Name, const FString& Operation)
+{
+	// batched registrations report from the publisher thread of the connection, possibly after this object is gone
+	TWeakObjectPtr<UROSIntegrationCore> WeakSelf(this);
+	return [WeakSelf, Name, Operation](bool bSuccess)
+	{
+		if (!bSuccess)
+		{
+			// the write only fails on a broken connection, the health check reconnects and registers everything again
+			UE_LOG(LogROS, Warning, TEXT("Failed to %s %s"), *Operation, *Name);
+		}
+		AsyncTask(ENamedThreads::GameThread, [WeakSelf, Name, Operation, bSuccess]()
+		{
+			if (UROSIntegrationCore* Self = WeakSelf.Get())
+			{
+				Self->OnRegistrationResult.Broadcast(Name, Operation, bSuccess);
+			}
+		});
+	};
+}
+
+void UROSIntegrationCore::RegisterTopic(UTopic* Topic)
+{
+	_Topics.RemoveAll([](const TWeakObjectPtr<UTopic>& Registered) { return !Registered.IsValid(); });
+	_Topics.AddUnique(Topic);
+}
+
+void UROSIntegrationCore::RegisterService(UService* Service)
+{
+	_Services.RemoveAll([](const TWeakObjectPtr<UService>& Registered) { return !Registered.IsValid(); });
+	_Services.AddUnique(Service);
+}
+
+TArray<UTopic*> UROSIntegrationCore::GetTopics() const
+{
+	TArray<UTopic*> Topics;
+	for (const TWeakObjectPtr<UTopic>& Topic : _Topics)
+	{
+		if (Topic.IsValid()) Topics.Add(Topic.Get());
+	}
+	return Topics;
+}
+
+TArray<UService*> UROSIntegrationCore::GetServices() const
+{
+	TArray<UService*> Services;
+	for (const TWeakObjectPtr<UService>& Service : _Services)
+	{
+		if (Service.IsValid()) Services.Add(Service.Get());
+	}
+	return Services;
+}
+
 void UROSIntegrationCore::SetWorld(UWorld* World)
 {
 	assert(_Implementation);
@@ -417,6 +1165,193 @@ void UROSIntegrationCore::InitSpawnManager()
 	_Implementation->Get()->InitSpawnManager();
 }
 
+bool UROSIntegrationCore::IsSpawnManagerInitialized() const
+{
+	return _Implementation && _Implementation->Get()->IsSpawnManagerInitialized();
+}
+
+
+void UROSIntegrationCore::SetMaxPendingServiceCalls(int32 MaxPendingServiceCalls)
+{
+	_MaxPendingServiceCalls = MaxPendingServiceCalls;
+	if (!_Implementation) return;
+	_Implementation->Get()->SetMaxPendingServiceCalls(MaxPendingServiceCalls);
+}
+
+void UROSIntegrationCore::SetLatencyTracingEnabled(bool bEnabled)
+{
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return;
+	_Implementation->Get()->ForEachBridge([bEnabled](rosbridge2cpp::ROSBridge& Bridge) { Bridge.GetLatencyTracer().SetEnabled(bEnabled); });
+}
+
+bool UROSIntegrationCore::IsLatencyTracingEnabled() const
+{
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return false;
+	return _Implementation->Get()->GetBridge().GetLatencyTracer().IsEnabled();
+}
+
+TArray<FROSLatencyStats> UROSIntegrationCore::GetLatencyStats() const
+{
+	TArray<FROSLatencyStats> Result;
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return Result;
+
+	_Implementation->Get()->ForEachBridge([&Result](rosbridge2cpp::ROSBridge& Bridge)
+	{
+		for (const rosbridge2cpp::LatencySummary& Summary : Bridge.GetLatencyTracer().GetSummaries())
+		{
+			Result.Add(ToROSLatencyStats(Summary));
+		}
+	});
+	return Result;
+}
+
+bool UROSIntegrationCore::DumpLatencyStatsToCSV(const FString& Filename) const
+{
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return false;
+
+	// the rows of all connections below a single header, written the same way
+	std::ostringstream CSV;
+	rosbridge2cpp::LatencyTracer::WriteCSVHeader(CSV);
+	_Implementation->Get()->ForEachBridge([&CSV](rosbridge2cpp::ROSBridge& Bridge)
+	{
+		Bridge.GetLatencyTracer().WriteCSVRows(CSV);
+	});
+	return FFileHelper::SaveStringToFile(UTF8_TO_TCHAR(CSV.str().c_str()), *Filename);
+}
+
+void UROSIntegrationCore::ResetLatencyStats()
+{
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return;
+	_Implementation->Get()->ForEachBridge([](rosbridge2cpp::ROSBridge& Bridge) { Bridge.GetLatencyTracer().Reset(); });
+}
+
+TArray<FROSTopicMetrics> UROSIntegrationCore::GetTopicMetrics() const
+{
+	TArray<FROSTopicMetrics> Result;
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return Result;
+
+	_Implementation->Get()->ForEachBridge([&Result](rosbridge2cpp::ROSBridge& Bridge)
+	{
+		for (const rosbridge2cpp::TopicMetricsSnapshot& Snapshot : Bridge.GetMetrics().GetTopicSnapshots())
+		{
+			Result.Add(ToROSTopicMetrics(Snapshot));
+		}
+	});
+	return Result;
+}
+
+FROSConnectionMetrics UROSIntegrationCore::GetConnectionMetrics() const
+{
+	FROSConnectionMetrics Metrics;
+	TSharedPtr<FROSBlueprintEventQueue, ESPMode::ThreadSafe> BlueprintEventQueue = _BlueprintEventQueue.Pin();
+	if (BlueprintEventQueue.IsValid()) Metrics.BlueprintEventsDropped = BlueprintEventQueue->NumDroppedEvents();
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return Metrics;
+
+	// summed over all connections
+	_Implementation->Get()->ForEachBridge([&Metrics](rosbridge2cpp::ROSBridge& Bridge)
+	{
+		const rosbridge2cpp::ConnectionMetricsSnapshot Snapshot = Bridge.GetMetrics().GetConnectionSnapshot();
+		Metrics.MessagesSent += Snapshot.messages_sent_;
+		Metrics.BytesSent += Snapshot.bytes_sent_;
+		Metrics.SendErrors += Snapshot.send_errors_;
+		Metrics.SendStalls += Snapshot.send_stalls_;
+		Metrics.SharedMemoryPayloads += Snapshot.shared_memory_payloads_;
+		Metrics.SharedMemoryBytes += Snapshot.shared_memory_bytes_;
+		Metrics.MessagesReceived += Snapshot.messages_received_;
+		Metrics.BytesReceived += Snapshot.bytes_received_;
+		Metrics.PendingServiceCalls += Bridge.NumPendingServiceCalls();
+	});
+	return Metrics;
+}
+
+void UROSIntegrationCore::ResetMetrics()
+{
+	TSharedPtr<FROSBlueprintEventQueue, ESPMode::ThreadSafe> BlueprintEventQueue = _BlueprintEventQueue.Pin();
+	if (BlueprintEventQueue.IsValid()) BlueprintEventQueue->ResetDroppedEvents();
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return;
+	_Implementation->Get()->ForEachBridge([](rosbridge2cpp::ROSBridge& Bridge) { Bridge.GetMetrics().Reset(); });
+	_LastStatsConnectionMetrics = FROSConnectionMetrics();
+	_LastStatsDropped = 0;
+}
+
+void UROSIntegrationCore::UpdateStats()
+{
+#if STATS
+	if (!_Implementation || !_Implementation->Get()->HasBridge()) return;
+
+	int64 Published = 0;
+	int64 Dropped = 0;
+	int64 Decoded = 0;
+	int64 MaxQueueDepth = 0;
+	for (const FROSTopicMetrics& TopicMetrics : GetTopicMetrics())
+	{
+		Published += TopicMetrics.Published;
+		Dropped += TopicMetrics.Dropped;
+		Decoded += TopicMetrics.Decoded;
+		MaxQueueDepth = FMath::Max(MaxQueueDepth, TopicMetrics.QueueDepth);
+	}
+	const FROSConnectionMetrics ConnectionMetrics = GetConnectionMetrics();
+
+	SET_DWORD_STAT(STAT_ROSMessagesPublished, Published);
+	SET_DWORD_STAT(STAT_ROSMessagesDropped, Dropped);
+	SET_DWORD_STAT(STAT_ROSMessagesDecoded, Decoded);
+	SET_DWORD_STAT(STAT_ROSSendErrors, ConnectionMetrics.SendErrors);
+	SET_DWORD_STAT(STAT_ROSSendStalls, ConnectionMetrics.SendStalls);
+	SET_DWORD_STAT(STAT_ROSSharedMemoryPayloads, ConnectionMetrics.SharedMemoryPayloads);
+	SET_DWORD_STAT(STAT_ROSMaxQueueDepth, MaxQueueDepth);
+	SET_DWORD_STAT(STAT_ROSPendingServiceCalls, ConnectionMetrics.PendingServiceCalls);
+	SET_DWORD_STAT(STAT_ROSBlueprintEventsDropped, ConnectionMetrics.BlueprintEventsDropped);
+
+	const double Now = FPlatformTime::Seconds();
+	const double Seconds = Now - _LastStatsTime;
+	if (_LastStatsTime > 0.0 && Seconds > 0.0)
+	{
+		SET_FLOAT_STAT(STAT_ROSSentRate, (ConnectionMetrics.MessagesSent - _LastStatsConnectionMetrics.MessagesSent) / Seconds);
+		SET_FLOAT_STAT(STAT_ROSSentKBRate, (ConnectionMetrics.BytesSent - _LastStatsConnectionMetrics.BytesSent) / 1024.0 / Seconds);
+		SET_FLOAT_STAT(STAT_ROSReceivedRate, (ConnectionMetrics.MessagesReceived - _LastStatsConnectionMetrics.MessagesReceived) / Seconds);
+		SET_FLOAT_STAT(STAT_ROSReceivedKBRate, (ConnectionMetrics.BytesReceived - _LastStatsConnectionMetrics.BytesReceived) / 1024.0 / Seconds);
+		SET_FLOAT_STAT(STAT_ROSDroppedRate, (Dropped - _LastStatsDropped) / Seconds);
+	}
+	_LastStatsConnectionMetrics = ConnectionMetrics;
+	_LastStatsDropped = Dropped;
+	_LastStatsTime = Now;
+
+	if (!IsLatencyTracingEnabled()) return;
+
+	static const int32 NumSegments = static_cast<int32>(rosbridge2cpp::LatencySegment::NUM_SEGMENTS);
+
+	// same order as rosbridge2cpp::LatencySegment
+	static const FName LatencyStatNames[NumSegments] = {
+		GET_STATFNAME(STAT_ROSLatencyStampToPublish),
+		GET_STATFNAME(STAT_ROSLatencyConvertOutgoing),
+		GET_STATFNAME(STAT_ROSLatencyEnqueue),
+		GET_STATFNAME(STAT_ROSLatencyQueueWait),
+		GET_STATFNAME(STAT_ROSLatencySocketWrite),
+		GET_STATFNAME(STAT_ROSLatencyPublishToSent),
+		GET_STATFNAME(STAT_ROSLatencyStampToReceive),
+		GET_STATFNAME(STAT_ROSLatencyReceiveToDispatch),
+		GET_STATFNAME(STAT_ROSLatencyConvertIncoming),
+		GET_STATFNAME(STAT_ROSLatencyCallback),
+		GET_STATFNAME(STAT_ROSLatencyReceiveToDelivered),
+	};
+	// report the worst topic per segment
+	double WorstP99Ms[NumSegments] = { 0.0 };
+	_Implementation->Get()->ForEachBridge([&WorstP99Ms](rosbridge2cpp::ROSBridge& Bridge)
+	{
+		for (const rosbridge2cpp::LatencySummary& Summary : Bridge.GetLatencyTracer().GetSummaries())
+		{
+			double& Worst = WorstP99Ms[static_cast<int>(Summary.segment_)];
+			Worst = FMath::Max(Worst, Summary.p99_ms_);
+		}
+	});
+
+	for (int32 i = 0; i < NumSegments; ++i)
+	{
+		FThreadStats::AddMessage(LatencyStatNames[i], EStatOperation::Set, WorstP99Ms[i]);
+	}
+#endif
+}
+
 
 void UROSIntegrationCore::BeginDestroy()
 {
@@ -3,9 +3,12 @@
 #include "RI/Service.h"
 #include "ROSTime.h"
 #include "rosgraph_msgs/Clock.h"
+#include "diagnostic_msgs/DiagnosticArray.h"
 #include "Misc/App.h"
 #include "ROSBridgeParamOverride.h"
 #include "Kismet/GameplayStatics.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
 
 
 #include <chrono>
@@ -57,14 +60,43 @@ void UROSIntegrationGameInstance::Init()
 			}
 		}
 
+		if (!BlueprintEventQueue.IsValid())
+		{
+			BlueprintEventQueue = MakeShared<FROSBlueprintEventQueue, ESPMode::ThreadSafe>();
+		}
+		BlueprintEventQueue->SetCapacity(BlueprintEventQueueCapacity);
+		if (!TickerHandle_BlueprintEvents.IsValid())
+		{
+			TickerHandle_BlueprintEvents = FROSCoreTicker::GetCoreTicker().AddTicker(
+				FTickerDelegate::CreateUObject(this, &UROSIntegrationGameInstance::DispatchBlueprintEvents));
+		}
+
 		ROSIntegrationCore = NewObject<UROSIntegrationCore>(UROSIntegrationCore::StaticClass()); // ORIGINAL 
+		LastDiagnosticsTopicMetrics.Empty(); // the counters start over with the new connection
+		LastDiagnosticsConnectionMetrics = FROSConnectionMetrics();
+		LastDiagnosticsTime = 0.0;
+		ROSIntegrationCore->SetServiceWorkerThreads(ServiceWorkerThreads);
+		ROSIntegrationCore->SetMaxPendingServiceCalls(MaxPendingServiceCalls);
+		ROSIntegrationCore->SetAdditionalConnections(AdditionalConnections);
+		ROSIntegrationCore->SetConnectTimeout(ConnectTimeout);
+		ROSIntegrationCore->SetReconnectBackoff(MinReconnectBackoff, MaxReconnectBackoff);
+		ROSIntegrationCore->SetBatchRegistrations(bBatchRegistrations);
+		ROSIntegrationCore->SetSendTimeout(SendTimeout);
+		ROSIntegrationCore->SetSocketBufferSizes(SocketSendBufferSize, SocketReceiveBufferSize);
+		ROSIntegrationCore->SetSharedMemoryPayloads(bSharedMemoryPayloads, SharedMemorySlots, SharedMemorySlotSize, MinSharedMemoryPayloadSize);
+		ROSIntegrationCore->SetSubscriptionCompression(SubscriptionCompression);
+		ROSIntegrationCore->SetBlueprintEventQueue(BlueprintEventQueue);
 		bIsConnected = ROSIntegrationCore->Init(ROSBridgeServerProtocol, ROSBridgeServerHost, ROSBridgeServerPort);
+		ROSIntegrationCore->SetLatencyTracingEnabled(bTraceLatency);
 
 		if (!bTimerSet)
 		{
 			bTimerSet = true; 
 			GetTimerManager().SetTimer(TimerHandle_CheckHealth, this, &UROSIntegrationGameInstance::CheckROSBridgeHealth,
 				CheckHealthInterval, true, std::max(5.0f, CheckHealthInterval));
+			GetTimerManager().SetTimer(TimerHandle_UpdateStats, this, &UROSIntegrationGameInstance::UpdateROSStats, 1.0f, true);
+			GetTimerManager().SetTimer(TimerHandle_PublishDiagnostics, this, &UROSIntegrationGameInstance::PublishDiagnostics,
+				FMath::Max(DiagnosticsInterval, 0.1f), true);
 		}
 
 		if (bIsConnected)
@@ -80,7 +112,7 @@ void UROSIntegrationGameInstance::Init()
 				UE_LOG(LogROS, Display, TEXT("World not available in UROSIntegrationGameInstance::Init()!"));
 			}
 		}
-		else if (!bReconnect)
+		else
 		{
 			UE_LOG(LogROS, Error, TEXT("Failed to connect to server %s:%u. Please make sure that your rosbridge is running."), *ROSBridgeServerHost, ROSBridgeServerPort);
 		}
@@ -91,9 +123,10 @@ void UROSIntegrationGameInstance::Init()
 			FApp::SetUseFixedTimeStep(bUseFixedUpdateInterval);
 
 			// tell ROSIntegration to use simulated time
+			// set the clock before enabling it, so no thread ever reads an uninitialized simulated time
 			FROSTime now = FROSTime::Now();
-			FROSTime::SetUseSimTime(true);
 			FROSTime::SetSimTime(now);
+			FROSTime::SetUseSimTime(true);
 
 			if (!bAddedOnWorldTickDelegate)
 			{
@@ -116,6 +149,9 @@ void UROSIntegrationGameInstance::CheckROSBridgeHealth()
 
 	if (bIsConnected && ROSIntegrationCore->IsHealthy())
 	{
+		// additional connections fail and recover on their own, without interrupting the others
+		ROSIntegrationCore->UpdateConnections();
+
 		if (OnROSConnectionStatus.IsBound())
 		{
 			OnROSConnectionStatus.Broadcast(true); // Notify bound functions that we are connected to rosbridge
@@ -132,54 +168,224 @@ void UROSIntegrationGameInstance::CheckROSBridgeHealth()
 		}
 	}
 
-	// reconnect again
-	bIsConnected = false;
-	bReconnect = true;
-	Init();
-	bReconnect = false;
-
 	// tell everyone (Topics, Services, etc.) they lost connection and should stop any interaction with ROS for now.
+	bIsConnected = false;
 	MarkAllROSObjectsAsDisconnected();
 
-	if (!bIsConnected)
+	// Connecting and tearing down the broken connection happen on a background thread with backoff between the attempts,
+	// this only picks up the result and re-establishes all topics and services (subscribe and advertise) once connected
+	if (!ROSIntegrationCore || !ROSIntegrationCore->PollReconnect())
 	{
-		return; // Let timer call this method again to retry connection attempt
+		return; // Let timer call this method again to check on the connection attempt
 	}
+	bIsConnected = true;
 
-	// tell everyone (Topics, Services, etc.) they can try to reconnect (subscribe and advertise)
+	// Init() sets up the spawn manager only if its own connection attempt succeeded
+	UWorld* CurrentWorld = GetWorld();
+	if (CurrentWorld && !ROSIntegrationCore->IsSpawnManagerInitialized())
+	{
+		ROSIntegrationCore->SetWorld(CurrentWorld);
+		ROSIntegrationCore->InitSpawnManager();
+	}
+
+	UE_LOG(LogROS, Display, TEXT("Successfully reconnected to rosbridge %s:%u."), *ROSBridgeServerHost, ROSBridgeServerPort);
+}
+
+int32 FROSBlueprintEventQueue::Dispatch(double BudgetSeconds)
+{
+	const double Start = FPlatformTime::Seconds();
+	const int32 Pending = NumQueued.GetValue();
+	int32 Dispatched = 0;
+	TFunction<void()> Event;
+	while (Dispatched < Pending && Events.Dequeue(Event))
+	{
+		NumQueued.Decrement();
+		Event();
+		++Dispatched;
+		if (BudgetSeconds > 0.0 && FPlatformTime::Seconds() - Start >= BudgetSeconds) break;
+	}
+	return Dispatched;
+}
+
+bool UROSIntegrationGameInstance::DispatchBlueprintEvents(float DeltaTime)
+{
+	if (BlueprintEventQueue.IsValid())
 	{
-		for (TObjectIterator<UTopic> It; It; ++It)
+		BlueprintEventQueue->Dispatch(BlueprintEventBudgetMs / 1000.0);
+	}
+	return true;
+}
+
+void UROSIntegrationGameInstance::UpdateROSStats()
+{
+	if (!ROSIntegrationCore) return;
+
+	// pick up changes of bTraceLatency made at runtime
+	if (ROSIntegrationCore->IsLatencyTracingEnabled() != bTraceLatency)
+	{
+		ROSIntegrationCore->SetLatencyTracingEnabled(bTraceLatency);
+	}
+	ROSIntegrationCore->UpdateStats();
+}
+
+bool UROSIntegrationGameInstance::DumpLatencyStats(const FString& Filename)
+{
+	if (!ROSIntegrationCore) return false;
+
+	bool bSuccess = ROSIntegrationCore->DumpLatencyStatsToCSV(Filename);
+	if (!bSuccess)
+	{
+		UE_LOG(LogROS, Error, TEXT("Failed to write latency stats to %s."), *Filename);
+	}
+	return bSuccess;
+}
+
+TArray<FROSTopicMetrics> UROSIntegrationGameInstance::GetTopicMetrics() const
+{
+	if (!ROSIntegrationCore) return TArray<FROSTopicMetrics>();
+	return ROSIntegrationCore->GetTopicMetrics();
+}
+
+FROSConnectionMetrics UROSIntegrationGameInstance::GetConnectionMetrics() const
+{
+	if (!ROSIntegrationCore) return FROSConnectionMetrics();
+	return ROSIntegrationCore->GetConnectionMetrics();
+}
+
+void UROSIntegrationGameInstance::ResetMetrics()
+{
+	if (!ROSIntegrationCore) return;
+	ROSIntegrationCore->ResetMetrics();
+	LastDiagnosticsTopicMetrics.Empty();
+	LastDiagnosticsConnectionMetrics = FROSConnectionMetrics();
+}
+
+static ROSMessages::diagnostic_msgs::KeyValue DiagnosticValue(const FString& Key, int64 Value)
+{
+	return ROSMessages::diagnostic_msgs::KeyValue(Key, FString::Printf(TEXT("%lld"), Value));
+}
+
+static ROSMessages::diagnostic_msgs::KeyValue DiagnosticValue(const FString& Key, double Value)
+{
+	return ROSMessages::diagnostic_msgs::KeyValue(Key, FString::Printf(TEXT("%.3f"), Value));
+}
+
+void UROSIntegrationGameInstance::PublishDiagnostics()
+{
+	if (!bPublishDiagnostics || !bIsConnected || !ROSIntegrationCore) return;
+
+	if (!DiagnosticsTopic)
+	{
+		DiagnosticsTopic = NewObject<UTopic>(UTopic::StaticClass());
+		DiagnosticsTopic->Init(ROSIntegrationCore, TEXT("/diagnostics"), TEXT("diagnostic_msgs/DiagnosticArray"), 1);
+		DiagnosticsTopic->Advertise();
+	}
+
+	typedef ROSMessages::diagnostic_msgs::DiagnosticStatus FStatus;
+
+	const double Now = FPlatformTime::Seconds();
+	const double Seconds = LastDiagnosticsTime > 0.0 ? FMath::Max(Now - LastDiagnosticsTime, 0.001) : 0.0;
+	const FString HardwareId = FPlatformProcess::ComputerName();
+
+	TSharedPtr<ROSMessages::diagnostic_msgs::DiagnosticArray> Diagnostics(new ROSMessages::diagnostic_msgs::DiagnosticArray());
+	Diagnostics->header = ROSMessages::std_msgs::Header(DiagnosticsSeq++, FROSTime::Now(), TEXT(""));
+
+	const FROSConnectionMetrics Connection = ROSIntegrationCore->GetConnectionMetrics();
+	{
+		FStatus& Status = Diagnostics->status[Diagnostics->status.AddDefaulted()];
+		Status.name = TEXT("ROSIntegration: rosbridge connection");
+		Status.hardware_id = HardwareId;
+		const bool bHealthy = ROSIntegrationCore->IsHealthy();
+		Status.level = bHealthy ? FStatus::LEVEL_OK : FStatus::LEVEL_ERROR;
+		Status.message = bHealthy ? TEXT("Connected") : TEXT("Connection unhealthy");
+		if (bHealthy && Connection.SendErrors > LastDiagnosticsConnectionMetrics.SendErrors)
 		{
-			UTopic* Topic = *It;
+			Status.level = FStatus::LEVEL_WARN;
+			Status.message = FString::Printf(TEXT("%lld send errors"), Connection.SendErrors - LastDiagnosticsConnectionMetrics.SendErrors);
+		}
+		if (bHealthy && Connection.SendStalls > LastDiagnosticsConnectionMetrics.SendStalls)
+		{
+			Status.level = FStatus::LEVEL_WARN;
+			Status.message = FString::Printf(TEXT("rosbridge doesn't keep up, %lld writes timed out"), Connection.SendStalls - LastDiagnosticsConnectionMetrics.SendStalls);
+		}
 
-			bool success = Topic->Reconnect(ROSIntegrationCore);
-			if (!success)
-			{
-				bIsConnected = false;
-				UE_LOG(LogROS, Error, TEXT("Unable to re-establish topic %s."), *Topic->GetDetailedInfo());
-			}
+		Status.values.Add(ROSMessages::diagnostic_msgs::KeyValue(TEXT("server"), FString::Printf(TEXT("%s://%s:%d"), *ROSBridgeServerProtocol, *ROSBridgeServerHost, ROSBridgeServerPort)));
+		Status.values.Add(DiagnosticValue(TEXT("messages_sent"), Connection.MessagesSent));
+		Status.values.Add(DiagnosticValue(TEXT("bytes_sent"), Connection.BytesSent));
+		Status.values.Add(DiagnosticValue(TEXT("send_errors"), Connection.SendErrors));
+		Status.values.Add(DiagnosticValue(TEXT("send_stalls"), Connection.SendStalls));
+		Status.values.Add(DiagnosticValue(TEXT("shared_memory_payloads"), Connection.SharedMemoryPayloads));
+		Status.values.Add(DiagnosticValue(TEXT("messages_received"), Connection.MessagesReceived));
+		Status.values.Add(DiagnosticValue(TEXT("bytes_received"), Connection.BytesReceived));
+		Status.values.Add(DiagnosticValue(TEXT("pending_service_calls"), Connection.PendingServiceCalls));
+		if (Seconds > 0.0)
+		{
+			Status.values.Add(DiagnosticValue(TEXT("sent_kb_per_s"), (Connection.BytesSent - LastDiagnosticsConnectionMetrics.BytesSent) / 1024.0 / Seconds));
+			Status.values.Add(DiagnosticValue(TEXT("received_kb_per_s"), (Connection.BytesReceived - LastDiagnosticsConnectionMetrics.BytesReceived) / 1024.0 / Seconds));
+		}
+	}
+
+	TMap<FString, FROSTopicMetrics> TopicMetrics;
+	for (const FROSTopicMetrics& Metrics : ROSIntegrationCore->GetTopicMetrics())
+	{
+		const FROSTopicMetrics* Last = LastDiagnosticsTopicMetrics.Find(Metrics.Topic);
+		const FROSTopicMetrics Previous = Last ? *Last : FROSTopicMetrics();
+		const int64 NewDrops = (Metrics.Dropped - Previous.Dropped) + (Metrics.LocalDropped - Previous.LocalDropped);
+		const int64 NewDecodeFailures = Metrics.DecodeFailures - Previous.DecodeFailures;
+
+		FStatus& Status = Diagnostics->status[Diagnostics->status.AddDefaulted()];
+		Status.name = FString::Printf(TEXT("ROSIntegration: %s"), *Metrics.Topic);
+		Status.hardware_id = HardwareId;
+		if (NewDrops > 0 || NewDecodeFailures > 0)
+		{
+			Status.level = FStatus::LEVEL_WARN;
+			Status.message = FString::Printf(TEXT("%lld messages dropped, %lld decode failures"), NewDrops, NewDecodeFailures);
 		}
-		for (TObjectIterator<UService> It; It; ++It)
+		else
 		{
-			UService* Service = *It;
+			Status.level = FStatus::LEVEL_OK;
+			Status.message = TEXT("OK");
+		}
 
-			bool success = Service->Reconnect(ROSIntegrationCore);
-			if (!success)
-			{
-				bIsConnected = false;
-				UE_LOG(LogROS, Error, TEXT("Unable to re-establish service %s."), *Service->GetDetailedInfo());
-			}
+		Status.values.Add(DiagnosticValue(TEXT("published"), Metrics.Published));
+		Status.values.Add(DiagnosticValue(TEXT("sent"), Metrics.Sent));
+		Status.values.Add(DiagnosticValue(TEXT("dropped"), Metrics.Dropped));
+		Status.values.Add(DiagnosticValue(TEXT("queue_depth"), Metrics.QueueDepth));
+		Status.values.Add(DiagnosticValue(TEXT("bytes_out"), Metrics.BytesOut));
+		Status.values.Add(DiagnosticValue(TEXT("avg_send_ms"), static_cast<double>(Metrics.AvgSendTimeMs)));
+		Status.values.Add(DiagnosticValue(TEXT("received"), Metrics.Received));
+		Status.values.Add(DiagnosticValue(TEXT("decoded"), Metrics.Decoded));
+		Status.values.Add(DiagnosticValue(TEXT("decode_failures"), Metrics.DecodeFailures));
+		Status.values.Add(DiagnosticValue(TEXT("conflated"), Metrics.Conflated));
+		Status.values.Add(DiagnosticValue(TEXT("local_dropped"), Metrics.LocalDropped));
+		Status.values.Add(DiagnosticValue(TEXT("receiver_blocked"), Metrics.ReceiverBlocked));
+		Status.values.Add(DiagnosticValue(TEXT("delivered_locally"), Metrics.DeliveredLocally));
+		Status.values.Add(DiagnosticValue(TEXT("bytes_in"), Metrics.BytesIn));
+		Status.values.Add(DiagnosticValue(TEXT("avg_decode_ms"), static_cast<double>(Metrics.AvgDecodeTimeMs)));
+		if (Seconds > 0.0)
+		{
+			Status.values.Add(DiagnosticValue(TEXT("sent_per_s"), (Metrics.Sent - Previous.Sent) / Seconds));
+			Status.values.Add(DiagnosticValue(TEXT("sent_kb_per_s"), (Metrics.BytesOut - Previous.BytesOut) / 1024.0 / Seconds));
+			Status.values.Add(DiagnosticValue(TEXT("received_per_s"), (Metrics.Received - Previous.Received) / Seconds));
+			Status.values.Add(DiagnosticValue(TEXT("received_kb_per_s"), (Metrics.BytesIn - Previous.BytesIn) / 1024.0 / Seconds));
 		}
+
+		TopicMetrics.Add(Metrics.Topic, Metrics);
 	}
 
-	UE_LOG(LogROS, Display, TEXT("Successfully reconnected to rosbridge %s:%u."), *ROSBridgeServerHost, ROSBridgeServerPort);
+	LastDiagnosticsTopicMetrics = MoveTemp(TopicMetrics);
+	LastDiagnosticsConnectionMetrics = Connection;
+	LastDiagnosticsTime = Now;
+
+	DiagnosticsTopic->Publish(Diagnostics);
 }
 
 void UROSIntegrationGameInstance::ShutdownAllROSObjects()
 {
-	for (TObjectIterator<UTopic> It; It; ++It)
+	if (!ROSIntegrationCore) return;
+
+	for (UTopic* Topic : ROSIntegrationCore->GetTopics())
 	{
-		UTopic* Topic = *It;
 		if (bIsConnected)
 		{
 			Topic->Unadvertise(); // Must come before unsubscribe becasue unsubscribe can potentially set _ROSTopic to null
@@ -187,9 +393,8 @@ void UROSIntegrationGameInstance::ShutdownAllROSObjects()
 		}
 		Topic->MarkAsDisconnected();
 	}
-	for (TObjectIterator<UService> It; It; ++It)
+	for (UService* Service : ROSIntegrationCore->GetServices())
 	{
-		UService* Service = *It;
 		if (bIsConnected)
 		{
 			Service->Unadvertise();
@@ -200,16 +405,14 @@ void UROSIntegrationGameInstance::ShutdownAllROSObjects()
 
 void UROSIntegrationGameInstance::MarkAllROSObjectsAsDisconnected()
 {
-	for (TObjectIterator<UTopic> It; It; ++It)
-	{
-		UTopic* Topic = *It;
+	if (!ROSIntegrationCore) return;
 
+	for (UTopic* Topic : ROSIntegrationCore->GetTopics())
+	{
 		Topic->MarkAsDisconnected();  
 	}
-	for (TObjectIterator<UService> It; It; ++It)
+	for (UService* Service : ROSIntegrationCore->GetServices())
 	{
-		UService* Service = *It;
-
 		Service->MarkAsDisconnected();   
 	}
 }
@@ -220,13 +423,24 @@ void UROSIntegrationGameInstance::Shutdown()
 	UE_LOG(LogROS, Display, TEXT("ROS Game Instance - shutdown start"));
 	if (bConnectToROS)
 	{
-		if(bTimerSet) GetTimerManager().ClearTimer(TimerHandle_CheckHealth);
+		if (bTimerSet)
+		{
+			GetTimerManager().ClearTimer(TimerHandle_CheckHealth);
+			GetTimerManager().ClearTimer(TimerHandle_UpdateStats);
+			GetTimerManager().ClearTimer(TimerHandle_PublishDiagnostics);
+		}
 
 		if (bSimulateTime)
 		{
 			FWorldDelegates::OnWorldTickStart.RemoveAll(this);
 		}
 
+		if (TickerHandle_BlueprintEvents.IsValid())
+		{
+			FROSCoreTicker::GetCoreTicker().RemoveTicker(TickerHandle_BlueprintEvents);
+			TickerHandle_BlueprintEvents.Reset();
+		}
+
 		ShutdownAllROSObjects(); // Stop all ROS objects from advertising, publishing, and subscribing
 		MarkAllROSObjectsAsDisconnected(); // moved here from UROSIntegrationGameInstance::BeginDestroy()
 
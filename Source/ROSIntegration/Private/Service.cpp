@@ -1,7 +1,11 @@
 #include "RI/Service.h"
 
+#include <HAL/Event.h>
+#include <Misc/ScopeLock.h>
+
 #include "rosbridge2cpp/ros_bridge.h"
 #include "rosbridge2cpp/ros_service.h"
+#include "rosbridge2cpp/ros_profiling.h"
 #include "Conversion/Services/BaseRequestConverter.h"
 #include "Conversion/Services/BaseResponseConverter.h"
 
@@ -10,7 +14,7 @@ static TMap<FString, UBaseResponseConverter*> ResponseConverterMap;
 
 
 // PIMPL
-class UService::Impl {
+class UService::Impl : public TSharedFromThis<UService::Impl, ESPMode::ThreadSafe> {
 	// hidden implementation details
 public:
 	Impl()
@@ -23,7 +27,7 @@ public:
 
 	~Impl() {
 
-		if (_ServiceRequestCallback && _Ric) {
+		if (_ROSService && _Ric) {
 			Unadvertise();
 		}
 
@@ -31,7 +35,10 @@ public:
 	}
 
 	bool _HandleRequestsInGameThread;
+	int32 _MaxConcurrentRequests = 1;
+	std::shared_ptr<rosbridge2cpp::ServiceResponseCache> _ResponseCache;
 	UROSIntegrationCore* _Ric = nullptr;
+	rosbridge2cpp::ROSBridge* _Bridge = nullptr; // the connection the service is called and advertised on
 	FString _ServiceName;
 	FString _ServiceType;
 	rosbridge2cpp::ROSService* _ROSService = nullptr;
@@ -45,7 +52,9 @@ public:
 		_ServiceName = ServiceName;
 		_ServiceType = ServiceType;
 
-		_ROSService = new rosbridge2cpp::ROSService(Ric->_Implementation->Get()->GetBridge(), TCHAR_TO_UTF8(*ServiceName), TCHAR_TO_UTF8(*ServiceType));
+		_Bridge = &Ric->_Implementation->Get()->GetBridgeForService(ServiceName);
+		_ROSService = new rosbridge2cpp::ROSService(*_Bridge, TCHAR_TO_UTF8(*ServiceName), TCHAR_TO_UTF8(*ServiceType));
+		_ROSService->SetResponseCache(_ResponseCache);
 
 		// Construct static ConverterMaps
 		if (RequestConverterMap.Num() == 0)
@@ -87,6 +96,7 @@ public:
 	}
 
 	void CallServiceCallback(const ROSBridgeServiceResponseMsg &message, std::function<void(TSharedPtr<FROSBaseServiceResponse>)> ServiceResponse) {
+		ROS_PROFILER_SCOPE("ROS::ServiceResponseCallback");
 		TSharedRef<TSharedPtr<FROSBaseServiceResponse>> Response =
 			TSharedRef<TSharedPtr<FROSBaseServiceResponse>>(new TSharedPtr<FROSBaseServiceResponse>());
 
@@ -98,6 +108,9 @@ public:
 	}
 
 	void ServiceRequestCallback(ROSBridgeCallServiceMsg &req, TWeakPtr<UService, ESPMode::ThreadSafe> SelfPtr) {
+		ROS_PROFILER_SCOPE("ROS::ServiceRequestCallback");
+		if (!SelfPtr.IsValid()) return;
+
 		TSharedPtr<FROSBaseServiceRequest> ServiceRequest = _RequestConverter->AllocateConcreteRequest();
 
 		// Convert the incoming service request to the UnrealRI format
@@ -134,22 +147,22 @@ public:
 				return;
 			}
 
-			_Ric->_Implementation->Get()->GetBridge().SendMessage(response);
+			_Bridge->SendMessage(response);
 		};
 
 		if (_HandleRequestsInGameThread) {
-			AsyncTask(ENamedThreads::GameThread, [this, SelfPtr, CreateAndSendResponse]()
+			TWeakPtr<Impl, ESPMode::ThreadSafe> WeakThis = AsShared();
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, SelfPtr, CreateAndSendResponse]()
 			{
-				if (!SelfPtr.IsValid()) return;
+				// Reconnect clears _Ric of the replaced implementation before its connection is retired
+				TSharedPtr<Impl, ESPMode::ThreadSafe> Implementation = WeakThis.Pin();
+				if (!Implementation.IsValid() || !Implementation->_Ric || !SelfPtr.IsValid()) return;
 				CreateAndSendResponse();
 			});
 		}
 		else
 		{
-			if (SelfPtr.IsValid())
-			{
-				CreateAndSendResponse();
-			}
+			CreateAndSendResponse();
 		}
 	}
 
@@ -159,22 +172,105 @@ public:
 		TWeakPtr<UService, ESPMode::ThreadSafe> SelfPtr) {
 		_ServiceRequestCallback = ServiceHandler;
 		_HandleRequestsInGameThread = HandleRequestsInGameThread;
-		auto service_request_handler = [this, SelfPtr](ROSBridgeCallServiceMsg &message) {
-			this->ServiceRequestCallback(message, SelfPtr);
+		// Requests run on the service worker threads, keep this implementation alive until they are done
+		TWeakPtr<Impl, ESPMode::ThreadSafe> WeakThis = AsShared();
+		auto service_request_handler = [WeakThis, SelfPtr](ROSBridgeCallServiceMsg &message) {
+			TSharedPtr<Impl, ESPMode::ThreadSafe> Implementation = WeakThis.Pin();
+			if (Implementation.IsValid()) Implementation->ServiceRequestCallback(message, SelfPtr);
 		};
-		return _ROSService->Advertise(service_request_handler);
+		return _ROSService->Advertise(service_request_handler, _Ric ? _Ric->MakeRegistrationResultHandler(_ServiceName, TEXT("advertise_service")) : nullptr);
 	}
 
 	bool Unadvertise() {
-		_ServiceRequestCallback = nullptr;
+		// the handler stays, requests that are already queued on the worker threads are still answered
 		return _ROSService->Unadvertise();
 	}
 
+	void CallServiceAsync(
+		TSharedPtr<FROSBaseServiceRequest> ServiceRequest,
+		float TimeoutSeconds,
+		FServiceCallHandle Call) {
+
+		ROS_PROFILER_SCOPE("ROS::ServiceCall");
+		bson_t* service_params;
+
+		if (!_RequestConverter->ConvertOutgoingRequest(ServiceRequest, &service_params)) {
+			UE_LOG(LogROS, Error, TEXT("Failed to Convert Service call to BSON"));
+			Call->Complete(EServiceCallStatus::Failed);
+			return;
+		}
+
+		// The call might outlive this Impl (see Reconnect), so only capture the converter
+		UBaseResponseConverter* ResponseConverter = _ResponseConverter;
+		auto service_response_handler = [ResponseConverter, Call](const ROSBridgeServiceResponseMsg &message)
+		{
+			ROS_PROFILER_SCOPE("ROS::ServiceResponseCallback");
+			if (!message.result_) {
+				Call->Complete(EServiceCallStatus::Failed);
+				return;
+			}
+
+			TSharedRef<TSharedPtr<FROSBaseServiceResponse>> Response =
+				TSharedRef<TSharedPtr<FROSBaseServiceResponse>>(new TSharedPtr<FROSBaseServiceResponse>());
+			if (!ResponseConverter->ConvertIncomingResponse(message, Response)) {
+				UE_LOG(LogROS, Error, TEXT("Failed to Convert ROSBridgeCallServiceMsg to UnrealRI Service Format"));
+				Call->Complete(EServiceCallStatus::Failed);
+				return;
+			}
+			Call->Complete(EServiceCallStatus::Succeeded, *Response);
+		};
+
+		FString ServiceName = _ServiceName;
+		auto service_error_handler = [Call, ServiceName](rosbridge2cpp::ServiceCallError error)
+		{
+			switch (error) {
+			case rosbridge2cpp::ServiceCallError::TIMEOUT:
+				UE_LOG(LogROS, Warning, TEXT("Call of service %s timed out"), *ServiceName);
+				Call->Complete(EServiceCallStatus::TimedOut);
+				break;
+			case rosbridge2cpp::ServiceCallError::REJECTED:
+				UE_LOG(LogROS, Warning, TEXT("Call of service %s rejected, too many calls are waiting for a response"), *ServiceName);
+				Call->Complete(EServiceCallStatus::Rejected);
+				break;
+			default:
+				Call->Complete(EServiceCallStatus::Failed);
+				break;
+			}
+		};
+
+		std::string service_call_id;
+		const std::chrono::milliseconds timeout(TimeoutSeconds > 0.f ? static_cast<int64>(TimeoutSeconds * 1000.f) : 0);
+		if (!_ROSService->CallService(service_params, service_response_handler, timeout, service_error_handler, service_call_id)) {
+			return; // the error handler has completed the call
+		}
+
+		// The call can be cancelled on any thread, but the connection of the implementation is only retired on the
+		// game thread (see UService::Reconnect), so that's where the pending call is released
+		TWeakPtr<Impl, ESPMode::ThreadSafe> WeakThis = AsShared();
+		Call->SetCancelFunction([WeakThis, service_call_id]()
+		{
+			auto CancelServiceCall = [WeakThis, service_call_id]()
+			{
+				TSharedPtr<Impl, ESPMode::ThreadSafe> Implementation = WeakThis.Pin();
+				if (Implementation.IsValid() && Implementation->_Ric && Implementation->_ROSService) {
+					Implementation->_ROSService->CancelServiceCall(service_call_id);
+				}
+			};
+			if (IsInGameThread()) {
+				CancelServiceCall();
+			}
+			else {
+				AsyncTask(ENamedThreads::GameThread, CancelServiceCall);
+			}
+		});
+	}
+
 	bool CallService(
 		TSharedPtr<FROSBaseServiceRequest> ServiceRequest,
 		std::function<void(TSharedPtr<FROSBaseServiceResponse>)> ServiceResponse,
 		TWeakPtr<UService, ESPMode::ThreadSafe> SelfPtr) {
 
+		ROS_PROFILER_SCOPE("ROS::ServiceCall");
 		bson_t* service_params;
 
 		if (!_RequestConverter->ConvertOutgoingRequest(ServiceRequest, &service_params)) {
@@ -182,10 +278,12 @@ public:
 			return false;
 		}
 
-		auto service_response_handler = [this, ServiceResponse, SelfPtr](const ROSBridgeServiceResponseMsg &message)
+		TWeakPtr<Impl, ESPMode::ThreadSafe> WeakThis = AsShared();
+		auto service_response_handler = [WeakThis, ServiceResponse, SelfPtr](const ROSBridgeServiceResponseMsg &message)
 		{
-			if (!SelfPtr.IsValid()) return;
-			this->CallServiceCallback(message, ServiceResponse);
+			TSharedPtr<Impl, ESPMode::ThreadSafe> Implementation = WeakThis.Pin();
+			if (!Implementation.IsValid() || !SelfPtr.IsValid()) return;
+			Implementation->CallServiceCallback(message, ServiceResponse);
 		};
 		return _ROSService->CallService(service_params, service_response_handler);
 	}
@@ -196,11 +294,52 @@ bool UService::CallService(TSharedPtr<FROSBaseServiceRequest> ServiceRequest, st
 	return _State.Connected && _Implementation->CallService(ServiceRequest, ServiceResponse, _SelfPtr);
 }
 
+FServiceCallHandle UService::CallServiceAsync(TSharedPtr<FROSBaseServiceRequest> ServiceRequest, float TimeoutSeconds, FServiceCall::FOnComplete OnComplete) {
+	FServiceCallHandle Call = MakeShared<FServiceCall, ESPMode::ThreadSafe>(OnComplete);
+	if (!_State.Connected) {
+		Call->Complete(EServiceCallStatus::Failed);
+		return Call;
+	}
+	_Implementation->CallServiceAsync(ServiceRequest, TimeoutSeconds, Call);
+	return Call;
+}
+
 bool UService::Advertise(std::function<void(TSharedPtr<FROSBaseServiceRequest>, TSharedPtr<FROSBaseServiceResponse>)> ServiceHandler, bool HandleRequestsInGameThread) {
 	_State.Advertised = true;
 	return _State.Connected && _Implementation->Advertise(ServiceHandler, HandleRequestsInGameThread, _SelfPtr);
 }
 
+void UService::EnableResponseCache(float TTLSeconds, int32 MaxEntries) {
+	const std::chrono::milliseconds TTL(static_cast<int64>(FMath::Max(TTLSeconds, 0.f) * 1000.f));
+	_Implementation->_ResponseCache = std::make_shared<rosbridge2cpp::ServiceResponseCache>(TTL, FMath::Max(MaxEntries, 1));
+	if (_Implementation->_ROSService) _Implementation->_ROSService->SetResponseCache(_Implementation->_ResponseCache);
+}
+
+void UService::DisableResponseCache() {
+	_Implementation->_ResponseCache = nullptr;
+	if (_Implementation->_ROSService) _Implementation->_ROSService->SetResponseCache(nullptr);
+}
+
+FServiceResponseCacheStats UService::GetResponseCacheStats() const {
+	FServiceResponseCacheStats Stats;
+	if (!_Implementation || !_Implementation->_ResponseCache) return Stats;
+
+	const rosbridge2cpp::ServiceResponseCache::Stats CacheStats = _Implementation->_ResponseCache->GetStats();
+	Stats.Hits = CacheStats.hits_;
+	Stats.Misses = CacheStats.misses_;
+	Stats.Collapsed = CacheStats.collapsed_;
+	Stats.Evictions = CacheStats.evictions_;
+	Stats.Entries = static_cast<int32>(CacheStats.entries_);
+	return Stats;
+}
+
+void UService::SetMaxConcurrentRequests(int32 MaxConcurrentRequests) {
+	_Implementation->_MaxConcurrentRequests = FMath::Max(MaxConcurrentRequests, 1);
+	if (_State.Connected && _Implementation->_Ric) {
+		_Implementation->_Bridge->SetMaxConcurrentServiceRequests(TCHAR_TO_UTF8(*_Implementation->_ServiceName), _Implementation->_MaxConcurrentRequests);
+	}
+}
+
 bool UService::Unadvertise() {
 	_State.Advertised = false;
 	return _Implementation->Unadvertise();
@@ -210,7 +349,7 @@ bool UService::Unadvertise() {
 UService::UService(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 	, _SelfPtr(this, TDeleterNot())
-	, _Implementation(new UService::Impl())
+	, _Implementation(MakeShared<UService::Impl, ESPMode::ThreadSafe>())
 {
 	_State.Connected = true;
 	_State.Advertised = false;
@@ -224,8 +363,8 @@ void UService::BeginDestroy() {
 		_Implementation->_Ric = nullptr;
 	}
 
-	if (_Implementation) delete _Implementation;
-	_Implementation = nullptr;
+	// a service worker thread might still hold on to it until its request is done
+	_Implementation.Reset();
 
 	Super::BeginDestroy();
 
@@ -234,6 +373,7 @@ void UService::BeginDestroy() {
 
 void UService::Init(UROSIntegrationCore *Ric, FString ServiceName, FString ServiceType) {
 	_ROSIntegrationCore = Ric;
+	if (Ric) Ric->RegisterService(this);
 	_Implementation->Init(Ric, ServiceName, ServiceType);
 }
 
@@ -247,12 +387,17 @@ bool UService::Reconnect(UROSIntegrationCore* ROSIntegrationCore)
 	bool success = true;
 	_ROSIntegrationCore = ROSIntegrationCore;
 
-	Impl* oldImplementation = _Implementation;
-	_Implementation = new UService::Impl();
+	TSharedPtr<Impl, ESPMode::ThreadSafe> oldImplementation = _Implementation;
+	_Implementation = MakeShared<UService::Impl, ESPMode::ThreadSafe>();
+	_Implementation->_ResponseCache = oldImplementation->_ResponseCache; // responses stay valid across connections
 
 	_State.Connected = true;
 
 	_Implementation->Init(ROSIntegrationCore, oldImplementation->_ServiceName, oldImplementation->_ServiceType);
+	if (oldImplementation->_MaxConcurrentRequests != 1)
+	{
+		SetMaxConcurrentRequests(oldImplementation->_MaxConcurrentRequests);
+	}
 	if (_State.Advertised)
 	{
 		success = success && Advertise(oldImplementation->_ServiceRequestCallback, oldImplementation->_HandleRequestsInGameThread);
@@ -262,13 +407,98 @@ bool UService::Reconnect(UROSIntegrationCore* ROSIntegrationCore)
 
 	if (oldImplementation)
 	{
-		oldImplementation->_Ric = nullptr; // prevent any interaction with ROS during destruction
-		delete oldImplementation;
+		// a service that only moves to another connection unadvertises on the old one, unless that one is broken
+		if (!ROSIntegrationCore->_Implementation->Get()->IsAvailable(oldImplementation->_Bridge))
+		{
+			oldImplementation->_Ric = nullptr; // prevent any interaction with ROS during destruction
+		}
+		oldImplementation.Reset();
 	}
 	return success;
 }
 
+bool UService::IsOnSelectedConnection() const
+{
+	if (!_ROSIntegrationCore || !_Implementation->_Bridge) return true; // not initialized
+	return _Implementation->_Bridge == &_ROSIntegrationCore->_Implementation->Get()->GetBridgeForService(_Implementation->_ServiceName);
+}
+
 FString UService::GetDetailedInfoInternal() const
 {
 	return _Implementation->_ServiceName;
 }
+
+
+FServiceCall::FServiceCall(FOnComplete InOnComplete)
+	: DoneEvent(FPlatformProcess::GetSynchEventFromPool(true))
+	, OnComplete(InOnComplete)
+{
+}
+
+FServiceCall::~FServiceCall()
+{
+	FPlatformProcess::ReturnSynchEventToPool(DoneEvent);
+}
+
+EServiceCallStatus FServiceCall::GetStatus() const
+{
+	FScopeLock Lock(&Mutex);
+	return Status;
+}
+
+bool FServiceCall::Wait(float TimeoutSeconds)
+{
+	if (TimeoutSeconds < 0.f)
+	{
+		DoneEvent->Wait();
+	}
+	else
+	{
+		DoneEvent->Wait(FTimespan::FromSeconds(TimeoutSeconds));
+	}
+	return IsDone();
+}
+
+bool FServiceCall::Cancel()
+{
+	std::function<void()> Function;
+	{
+		FScopeLock Lock(&Mutex);
+		if (Status != EServiceCallStatus::Pending) return false;
+		Function = CancelFunction;
+	}
+
+	if (!Complete(EServiceCallStatus::Cancelled)) return false;
+	if (Function) Function();
+	return true;
+}
+
+TSharedPtr<FROSBaseServiceResponse> FServiceCall::GetResponse() const
+{
+	FScopeLock Lock(&Mutex);
+	return Response;
+}
+
+bool FServiceCall::Complete(EServiceCallStatus NewStatus, TSharedPtr<FROSBaseServiceResponse> NewResponse)
+{
+	FOnComplete Callback;
+	{
+		FScopeLock Lock(&Mutex);
+		if (Status != EServiceCallStatus::Pending) return false;
+		Status = NewStatus;
+		Response = NewResponse;
+		Callback = MoveTemp(OnComplete);
+		OnComplete = nullptr;
+		CancelFunction = nullptr;
+	}
+
+	DoneEvent->Trigger();
+	if (Callback) Callback(NewStatus, NewResponse);
+	return true;
+}
+
+void FServiceCall::SetCancelFunction(std::function<void()> Function)
+{
+	FScopeLock Lock(&Mutex);
+	if (Status == EServiceCallStatus::Pending) CancelFunction = Function;
+}
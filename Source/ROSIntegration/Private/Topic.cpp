@@ -1,7 +1,12 @@
 #include "RI/Topic.h"
 #include <bson.h>
+#include <atomic>
+#include <Async/Async.h>
+#include <Hash/CityHash.h>
+#include "ROSIntegrationGameInstance.h"
 #include "rosbridge2cpp/ros_bridge.h"
 #include "rosbridge2cpp/ros_topic.h"
+#include "rosbridge2cpp/ros_profiling.h"
 #include "Conversion/Messages/BaseMessageConverter.h"
 #include "Conversion/Messages/std_msgs/StdMsgsStringConverter.h"
 #include "Conversion/Messages/std_msgs/StdMsgsBoolConverter.h"
@@ -17,23 +22,41 @@ static TMap<EMessageType, FString> SupportedMessageTypes;
 
 
 // PIMPL
-class UTopic::Impl {
+class UTopic::Impl : public TSharedFromThis<UTopic::Impl, ESPMode::ThreadSafe> {
 	// hidden implementation details
 public:
 	Impl()
 	: _Ric(nullptr)
 	, _ROSTopic(nullptr)
 	, _Converter(nullptr)
+	, _QueueSpaceEvent(FPlatformProcess::GetSynchEventFromPool(false))
 	{
 	}
 
 	~Impl() {
+		Shutdown();
+		FPlatformProcess::ReturnSynchEventToPool(_QueueSpaceEvent);
+	}
+
+	// Called by the UTopic before it releases the implementation, so this doesn't happen on the thread of an
+	// intra-process publisher that still holds a reference to it
+	void Shutdown() {
 
 		if (_Callback && _Ric) {
 			Unsubscribe();
 		}
+		else if (_CallbackHandle.IsValid() && _Bridge) {
+			// The connection is being replaced, so nothing is sent over it, but its receiver thread must not call
+			// this anymore. Waits for a message that is being handed to it.
+			_Bridge->UnregisterTopicCallback(TCHAR_TO_UTF8(*_Topic), _CallbackHandle);
+			_CallbackHandle = rosbridge2cpp::ROSCallbackHandle<rosbridge2cpp::FunVrROSPublishMsg>();
+		}
+		StopLocalQueue();
+		UnregisterIntraProcessSubscriber();
+		DetachFromSharedSubscription();
 
 		if(_ROSTopic) delete _ROSTopic;
+		_ROSTopic = nullptr;
 	}
 
 	UROSIntegrationCore* _Ric = nullptr;
@@ -41,22 +64,109 @@ public:
 	FString _MessageType;
 	int32 _QueueSize;
 	rosbridge2cpp::ROSTopic* _ROSTopic = nullptr;
+	rosbridge2cpp::ROSBridge* _Bridge = nullptr;
 	UBaseMessageConverter* _Converter;
+	rosbridge2cpp::LatencyTracer* _LatencyTracer = nullptr;
+	rosbridge2cpp::TopicLatency* _TopicLatency = nullptr;
 	rosbridge2cpp::ROSCallbackHandle<rosbridge2cpp::FunVrROSPublishMsg> _CallbackHandle;
+	bool _RawMessages = false; // subscribed with compression "cbor-raw"
+
+	// Bounded local queue of a conflating or queued subscription (see FROSSubscriptionOptions): the receiver thread
+	// adds the decoded messages, the core ticker delivers them once per frame on the game thread
+	struct QueuedMessage
+	{
+		TSharedPtr<FROSBaseMsg> Msg;
+		size_t Size;
+	};
+	bool _LocalQueue = false;
+	bool _Conflate = false;
+	int32 _LocalQueueLength = 0;
+	size_t _LocalQueueBytes = 0;
+	ESubscriberQueuePolicy _LocalQueuePolicy = ESubscriberQueuePolicy::DropOldest;
+	FCriticalSection _LocalQueueLock;
+	TArray<QueuedMessage> _QueuedMessages;
+	int32 _QueueHead = 0; // index of the oldest message in _QueuedMessages, dropping it only advances the index
+	TArray<QueuedMessage> _DeliveredMessages; // game thread only, swapped with _QueuedMessages to keep both allocations
+	size_t _QueuedBytes = 0;
+	FEvent* _QueueSpaceEvent;
+	std::atomic<bool> _LocalQueueStopped{true};
+	FROSTickerHandle _TickerHandle;
+
+	// BlockReceiver: the message that found the queue full, and how long the receiver thread waits for room for it
+	// before it drops the oldest message after all, see WaitForQueueSpace()
+	TArray<QueuedMessage> _ParkedMessages;
+	uint32 _MaxReceiverBlockMs = 1000;
+
+	// Subscribers of a topic name of a UROSIntegrationCore, see UTopic::SetIntraProcess()
+	typedef TWeakPtr<Impl, ESPMode::ThreadSafe> IntraProcessSubscriber;
+	struct IntraProcessTopic
+	{
+		TArray<IntraProcessSubscriber> Subscribers; // guarded by IntraProcessLock
+	};
+	typedef TSharedPtr<IntraProcessTopic, ESPMode::ThreadSafe> IntraProcessTopicPtr;
+	static FCriticalSection IntraProcessLock;
+	static TMap<TPair<UROSIntegrationCore*, FString>, IntraProcessTopicPtr> IntraProcessTopics;
+
+	EIntraProcessMode _IntraProcess = EIntraProcessMode::Disabled;
+	IntraProcessTopicPtr _IntraProcessTopic;
+	bool _IntraProcessSubscriber = false;
+	rosbridge2cpp::TopicMetrics* _TopicMetrics = nullptr;
+
+	// LocalAndRemote subscriber: fingerprints of the messages LocalAndRemote publishers handed to it directly. rosbridge
+	// echoes these back, the echo is dropped on arrival, see IsEcho(). Echoes rosbridge never sends expire.
+	struct PendingEcho
+	{
+		uint64 Fingerprint;
+		double Expires;
+	};
+	static constexpr int32 MaxPendingEchoes = 64;
+	static constexpr double EchoTimeoutSeconds = 5.0;
+	FCriticalSection _PendingEchoesLock;
+	TArray<PendingEcho> _PendingEchoes;
+
+	// A subscription with FROSSubscriptionOptions::Shared attaches to a hub: an Impl that isn't owned by any UTopic,
+	// holds the rosbridge subscription of a topic, type and rosbridge side options, and hands each message it decodes
+	// to all attached subscribers. Once the last subscriber detached, the hub is shut down and released on the game thread.
+	typedef TSharedPtr<Impl, ESPMode::ThreadSafe> ImplPtr;
+	typedef TPair<uint64, FString> SharedSubscriptionKey; // ROSBridge::GetConnectionId(), topic, type and options
+	static FCriticalSection SharedSubscriptionLock; // guards SharedSubscriptions, never taken by the receiver thread
+	static TMap<SharedSubscriptionKey, ImplPtr> SharedSubscriptions;
+
+	bool _IsSharedHub = false;
+	SharedSubscriptionKey _SharedKey;
+	FCriticalSection _SharedSubscribersLock; // only guards the list, the subscribers are called without it
+	TArray<TWeakPtr<Impl, ESPMode::ThreadSafe>> _SharedSubscribers; // of a hub
+	ImplPtr _SharedHub; // of an attached subscriber
 
 	std::function<void(TSharedPtr<FROSBaseMsg>)> _Callback;
+	FCriticalSection _CallbackLock; // guards changes of _Callback against intra-process publishers, see DeliverLocally()
 
 	bool ConvertMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
 	{
+		ROS_PROFILER_SCOPE("ROS::ConverterEncode");
 		return _Converter->ConvertOutgoingMessage(BaseMsg, message);
 	}
 
 	bool ConvertMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
 	{
+		ROS_PROFILER_SCOPE("ROS::ConverterDecode");
 		return _Converter->ConvertIncomingMessage(message, BaseMsg);
 	}
 
-	bool Subscribe(std::function<void(TSharedPtr<FROSBaseMsg>)> func)
+	bool ConvertRawMessage(const ROSBridgePublishMsg* message, TSharedPtr<FROSBaseMsg> &BaseMsg)
+	{
+		ROS_PROFILER_SCOPE("ROS::ConverterDecode");
+		bool KeyFound = false;
+		uint32_t Length = 0;
+		const uint8_t* Data = rosbridge2cpp::Helper::get_binary_by_key("msg.bytes", *message->full_msg_bson_, Length, KeyFound);
+		if (!KeyFound) {
+			UE_LOG(LogROS, Error, TEXT("Raw message on topic %s has no msg.bytes field"), *_Topic);
+			return false;
+		}
+		return _Converter->ConvertIncomingRawMessage(Data, Length, BaseMsg);
+	}
+
+	bool Subscribe(std::function<void(TSharedPtr<FROSBaseMsg>)> func, const FROSSubscriptionOptions& Options)
 	{
 		if (!_ROSTopic) {
 			UE_LOG(LogROS, Error, TEXT("Rostopic hasn't been initialized before Subscribe() call"));
@@ -67,8 +177,67 @@ public:
 			Unsubscribe();
 		}
 
-		_CallbackHandle = _ROSTopic->Subscribe(std::bind(&UTopic::Impl::MessageCallback, this, std::placeholders::_1));
-		_Callback = func;
+		_ROSTopic->SetThrottleRate(FMath::Max(Options.ThrottleRate, 0));
+		_ROSTopic->SetQueueLength(Options.QueueLength > 0 ? Options.QueueLength : -1);
+		_ROSTopic->SetFragmentSize(Options.FragmentSize > 0 ? Options.FragmentSize : -1);
+
+		// always set, a resubscription must not keep the compression of the previous subscription
+		std::string Compression = "none";
+		if (Options.Compression == TEXT("cbor")) {
+			Compression = "cbor";
+		}
+		else if (Options.Compression == TEXT("cbor-raw")) {
+			if (!_Converter->_SupportsRawMessages) {
+				UE_LOG(LogROS, Warning, TEXT("No raw decoder for %s, subscribing to %s without cbor-raw"), *_MessageType, *_Topic);
+			}
+			else if (!_Bridge->bson_only_mode()) {
+				UE_LOG(LogROS, Warning, TEXT("Raw subscriptions need the BSON mode, subscribing to %s without cbor-raw"), *_Topic);
+			}
+			else {
+				Compression = "cbor-raw";
+			}
+		}
+		else if (Options.Compression != TEXT("none") && !Options.Compression.IsEmpty()) {
+			UE_LOG(LogROS, Warning, TEXT("Unsupported compression %s, subscribing to %s without compression"), *Options.Compression, *_Topic);
+		}
+		_ROSTopic->SetCompression(Compression);
+		_RawMessages = Compression == "cbor-raw";
+
+		if (_IntraProcess != EIntraProcessMode::Disabled && !Options.Conflate && Options.LocalQueueBytes > 0 && Options.LocalQueueLength <= 0) {
+			// the messages of intra-process publishers are never serialized, so there's no size to count against the limit
+			UE_LOG(LogROS, Error, TEXT("Intra-process subscription of %s needs a LocalQueueLength, LocalQueueBytes alone doesn't bound it"), *_Topic);
+			return false;
+		}
+
+		_Conflate = Options.Conflate;
+		_LocalQueueLength = _Conflate ? 1 : FMath::Max(Options.LocalQueueLength, 0);
+		_LocalQueueBytes = _Conflate ? 0 : FMath::Max(Options.LocalQueueBytes, 0);
+		_LocalQueuePolicy = _Conflate ? ESubscriberQueuePolicy::DropOldest : Options.LocalQueuePolicy;
+		_MaxReceiverBlockMs = static_cast<uint32>(FMath::Max(Options.MaxReceiverBlockMs, 0));
+		_LocalQueue = _LocalQueueLength > 0 || _LocalQueueBytes > 0;
+		if (_LocalQueue) {
+			_LocalQueueStopped = false;
+			_TickerHandle = FROSCoreTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &UTopic::Impl::DeliverQueuedMessages));
+		}
+
+		{
+			FScopeLock Lock(&_CallbackLock);
+			_Callback = func;
+		}
+		if (_IntraProcess != EIntraProcessMode::Disabled && _IntraProcessTopic.IsValid()) {
+			FScopeLock Lock(&IntraProcessLock);
+			_IntraProcessTopic->Subscribers.Add(AsShared());
+			_IntraProcessSubscriber = true;
+		}
+		if (_IntraProcess == EIntraProcessMode::LocalOnly) {
+			return true;
+		}
+		if (Options.Shared) {
+			return AttachToSharedSubscription(Options);
+		}
+
+		_CallbackHandle = _ROSTopic->Subscribe(std::bind(&UTopic::Impl::MessageCallback, this, std::placeholders::_1),
+			_Ric ? _Ric->MakeRegistrationResultHandler(_Topic, TEXT("subscribe")) : nullptr);
 		return _CallbackHandle.IsValid();
 	}
 
@@ -79,9 +248,22 @@ public:
 			return false;
 		}
 
+		// releases a receiver thread that waits for room in the queue
+		StopLocalQueue();
+		UnregisterIntraProcessSubscriber();
+		if (_IntraProcess == EIntraProcessMode::LocalOnly || _SharedHub.IsValid()) {
+			DetachFromSharedSubscription();
+			FScopeLock Lock(&_CallbackLock);
+			_Callback = nullptr;
+			return true;
+		}
+
 		bool result = _ROSTopic->Unsubscribe(_CallbackHandle);
 		if (result) {
-			_Callback = nullptr;
+			{
+				FScopeLock Lock(&_CallbackLock);
+				_Callback = nullptr;
+			}
 			_CallbackHandle = rosbridge2cpp::ROSCallbackHandle<rosbridge2cpp::FunVrROSPublishMsg>();
 			if(_ROSTopic) delete _ROSTopic;
 			_ROSTopic = nullptr;
@@ -89,26 +271,291 @@ public:
 		return result;
 	}
 
+	bool AttachToSharedSubscription(const FROSSubscriptionOptions& Options)
+	{
+		// only the rosbridge side of the options is shared, the local delivery is up to each subscriber
+		FROSSubscriptionOptions HubOptions;
+		HubOptions.ThrottleRate = Options.ThrottleRate;
+		HubOptions.QueueLength = Options.QueueLength;
+		HubOptions.Compression = Options.Compression;
+		HubOptions.FragmentSize = Options.FragmentSize;
+		const SharedSubscriptionKey Key(_Bridge->GetConnectionId(), FString::Printf(TEXT("%s|%s|%d|%d|%s|%d"), *_Topic, *_MessageType,
+			HubOptions.ThrottleRate, HubOptions.QueueLength, *HubOptions.Compression, HubOptions.FragmentSize));
+
+		FScopeLock Lock(&SharedSubscriptionLock);
+		ImplPtr Hub = SharedSubscriptions.FindRef(Key);
+		if (!Hub.IsValid()) {
+			Hub = MakeShared<Impl, ESPMode::ThreadSafe>();
+			Hub->Init(_Ric, _Topic, _MessageType, _QueueSize);
+			Hub->_IsSharedHub = true;
+			Hub->_SharedKey = Key;
+			// the callback only marks the hub as subscribed, Deliver() hands the messages to the attached subscribers
+			if (!Hub->Subscribe([](TSharedPtr<FROSBaseMsg>) {}, HubOptions)) {
+				Hub->Shutdown();
+				return false;
+			}
+			SharedSubscriptions.Add(Key, Hub);
+		}
+
+		FScopeLock HubLock(&Hub->_SharedSubscribersLock);
+		Hub->_SharedSubscribers.Add(AsShared());
+		_SharedHub = Hub;
+		return true;
+	}
+
+	void DetachFromSharedSubscription()
+	{
+		if (!_SharedHub.IsValid()) return;
+
+		ImplPtr Hub = MoveTemp(_SharedHub);
+		bool bUnused = false;
+		{
+			FScopeLock Lock(&SharedSubscriptionLock);
+			{
+				FScopeLock HubLock(&Hub->_SharedSubscribersLock);
+				// can't pin itself anymore while it is being destroyed
+				Hub->_SharedSubscribers.RemoveAll([this](const TWeakPtr<Impl, ESPMode::ThreadSafe>& Subscriber)
+				{
+					return !Subscriber.IsValid() || Subscriber.HasSameObject(this);
+				});
+				bUnused = Hub->_SharedSubscribers.Num() == 0;
+			}
+			if (bUnused) SharedSubscriptions.Remove(Hub->_SharedKey);
+		}
+		if (!bUnused) return;
+
+		if (!_Ric) Hub->_Ric = nullptr; // the connection is being replaced, don't unsubscribe over it
+		ReleaseSharedHub(MoveTemp(Hub));
+	}
+
+	// Ending the rosbridge subscription waits for the receiver thread to leave the callbacks of the connection. A
+	// subscriber that unsubscribes in its callback is on that thread, so the hub is shut down on the game thread.
+	// It stays pinned until then, and Deliver() pins it as well, so it is never destroyed during a delivery.
+	static void ReleaseSharedHub(ImplPtr Hub)
+	{
+		if (IsInGameThread()) {
+			Hub->Shutdown();
+			return;
+		}
+		AsyncTask(ENamedThreads::GameThread, [Hub]()
+		{
+			// the connection may have been replaced in the meantime
+			if (Hub->_Ric && !Hub->_Ric->_Implementation->Get()->IsAvailable(Hub->_Bridge)) {
+				Hub->_Ric = nullptr;
+				Hub->_Bridge = nullptr;
+			}
+			Hub->Shutdown();
+		});
+	}
+
 	bool Advertise()
 	{
+		if (_IntraProcess == EIntraProcessMode::LocalOnly) return true;
+
 		if (!_ROSTopic) UE_LOG(LogROS, Warning, TEXT("Trying to advertise on an un-initialized topic."))
-		return _ROSTopic && _ROSTopic->Advertise();
+		return _ROSTopic && _ROSTopic->Advertise(_Ric ? _Ric->MakeRegistrationResultHandler(_Topic, TEXT("advertise")) : nullptr);
 	}
 
 
 	bool Unadvertise()
 	{
+		if (_IntraProcess == EIntraProcessMode::LocalOnly) return true;
+
 		if (!_ROSTopic) UE_LOG(LogROS, Warning, TEXT("Trying to unadvertise on an un-initialized topic."))
 		return _ROSTopic && _ROSTopic->Unadvertise();
 	}
 
+	void SetIntraProcess(EIntraProcessMode Mode)
+	{
+		_IntraProcess = Mode;
+		if (Mode == EIntraProcessMode::Disabled || !_Bridge) return; // _Bridge is set by a successful Init()
+
+		if (!_IntraProcessTopic.IsValid()) {
+			FScopeLock Lock(&IntraProcessLock);
+			IntraProcessTopicPtr& Entry = IntraProcessTopics.FindOrAdd(TPair<UROSIntegrationCore*, FString>(_Ric, _Topic));
+			if (!Entry.IsValid()) Entry = MakeShared<IntraProcessTopic, ESPMode::ThreadSafe>();
+			_IntraProcessTopic = Entry;
+		}
+		if (!_TopicMetrics) _TopicMetrics = _Bridge->GetMetrics().GetTopicMetrics(TCHAR_TO_UTF8(*_Topic));
+	}
+
+	void UnregisterIntraProcessSubscriber()
+	{
+		if (!_IntraProcessSubscriber) return;
+		FScopeLock Lock(&IntraProcessLock);
+		// can't pin itself anymore while it is being destroyed
+		_IntraProcessTopic->Subscribers.RemoveAll([this](const IntraProcessSubscriber& Subscriber)
+		{
+			return !Subscriber.IsValid() || Subscriber.HasSameObject(this);
+		});
+		_IntraProcessSubscriber = false;
+	}
+
+	// Hands the message to the intra-process subscribers of the topic, without converting it
+	void PublishLocally(TSharedPtr<FROSBaseMsg> msg)
+	{
+		ROS_PROFILER_SCOPE("ROS::TopicPublishLocally");
+		// The lock only guards the registry. The callbacks run without it, a subscriber that unsubscribes or is
+		// destroyed meanwhile stays alive until its delivery is done.
+		TArray<IntraProcessSubscriber, TInlineAllocator<4>> Subscribers;
+		{
+			FScopeLock Lock(&IntraProcessLock);
+			Subscribers.Append(_IntraProcessTopic->Subscribers);
+		}
+		int32 Delivered = 0;
+		uint64 Fingerprint = 0;
+		bool bFingerprinted = false, bHasFingerprint = false;
+		for (const IntraProcessSubscriber& WeakSubscriber : Subscribers) {
+			TSharedPtr<Impl, ESPMode::ThreadSafe> Subscriber = WeakSubscriber.Pin();
+			if (!Subscriber.IsValid()) continue;
+			if (Subscriber->_MessageType != _MessageType) {
+				UE_LOG(LogROS, Verbose, TEXT("Not delivering %s on %s to a subscriber of %s"), *_MessageType, *_Topic, *Subscriber->_MessageType);
+				continue;
+			}
+			if (_IntraProcess == EIntraProcessMode::LocalAndRemote && Subscriber->_IntraProcess == EIntraProcessMode::LocalAndRemote) {
+				// subscribed at rosbridge as well, it drops the copy we send there when it comes back
+				if (!bFingerprinted) {
+					bFingerprinted = true;
+					bHasFingerprint = GetFingerprint(msg, Fingerprint);
+				}
+				// a message that can't be converted isn't sent to rosbridge either
+				if (bHasFingerprint) Subscriber->ExpectEcho(Fingerprint);
+			}
+			if (Subscriber->DeliverLocally(msg, _TopicMetrics)) ++Delivered;
+		}
+		if (_TopicMetrics && Delivered > 0) _TopicMetrics->delivered_locally_.Add(Delivered);
+	}
+
+	// Fingerprint of a message as the converter of the topic serializes it, the same for a published message and its
+	// echo from rosbridge. Must not be called while a ScopedPayloadRing is active.
+	bool GetFingerprint(TSharedPtr<FROSBaseMsg> BaseMsg, uint64& Fingerprint)
+	{
+		bson_t* Bson = nullptr;
+		if (!ConvertMessage(BaseMsg, &Bson)) return false;
+		Fingerprint = CityHash64(reinterpret_cast<const char*>(bson_get_data(Bson)), Bson->len);
+		bson_destroy(Bson);
+		return true;
+	}
+
+	void ExpectEcho(uint64 Fingerprint)
+	{
+		FScopeLock Lock(&_PendingEchoesLock);
+		if (_PendingEchoes.Num() >= MaxPendingEchoes) _PendingEchoes.RemoveAt(0, 1, false);
+		_PendingEchoes.Add({ Fingerprint, FPlatformTime::Seconds() + EchoTimeoutSeconds });
+	}
+
+	// Whether a received message is the echo of one a LocalAndRemote publisher of this process delivered directly.
+	// Only messages received while echoes are pending are converted again to compare them.
+	bool IsEcho(TSharedPtr<FROSBaseMsg> BaseMsg)
+	{
+		{
+			FScopeLock Lock(&_PendingEchoesLock);
+			if (_PendingEchoes.Num() == 0) return false;
+		}
+		uint64 Fingerprint;
+		if (!GetFingerprint(BaseMsg, Fingerprint)) return false;
+
+		const double Now = FPlatformTime::Seconds();
+		FScopeLock Lock(&_PendingEchoesLock);
+		_PendingEchoes.RemoveAll([Now](const PendingEcho& Echo) { return Echo.Expires < Now; });
+		const int32 Index = _PendingEchoes.IndexOfByPredicate([Fingerprint](const PendingEcho& Echo) { return Echo.Fingerprint == Fingerprint; });
+		if (Index == INDEX_NONE) return false;
+		_PendingEchoes.RemoveAt(Index, 1, false);
+		return true;
+	}
+
+	// Delivery of an intra-process publisher, which may run concurrently with Unsubscribe() on another thread
+	bool DeliverLocally(TSharedPtr<FROSBaseMsg> BaseMsg, rosbridge2cpp::TopicMetrics* TopicMetrics)
+	{
+		std::function<void(TSharedPtr<FROSBaseMsg>)> Callback;
+		{
+			FScopeLock Lock(&_CallbackLock);
+			if (!_Callback) return false;
+			if (!_LocalQueue) Callback = _Callback;
+		}
+		if (!Callback) {
+			// The publisher may be the game thread that empties a local queue, so it never waits for room. The message
+			// has no serialized size, only LocalQueueLength bounds the queue (see Subscribe()).
+			EnqueueMessage(BaseMsg, 0, TopicMetrics, false);
+			return true;
+		}
+		ROS_PROFILER_SCOPE("ROS::TopicUserCallback");
+		Callback(BaseMsg);
+		return true;
+	}
+
+	// Hands a decoded message to the callback, the local queue, or the subscribers of a shared subscription hub.
+	// Called on the receiver thread, and on the publishing thread for the messages of intra-process publishers.
+	void Deliver(TSharedPtr<FROSBaseMsg> BaseMsg, size_t Size, rosbridge2cpp::TopicMetrics* TopicMetrics, bool CanBlock)
+	{
+		if (_IsSharedHub) {
+			// The subscribers are called without the lock, a callback may unsubscribe and detach itself meanwhile.
+			// Neither the hub nor a subscriber is destroyed before its delivery is done.
+			const ImplPtr Hub = AsShared();
+			TArray<TWeakPtr<Impl, ESPMode::ThreadSafe>, TInlineAllocator<8>> Subscribers;
+			{
+				FScopeLock Lock(&_SharedSubscribersLock);
+				Subscribers.Append(_SharedSubscribers);
+			}
+			for (const TWeakPtr<Impl, ESPMode::ThreadSafe>& WeakSubscriber : Subscribers) {
+				ImplPtr Subscriber = WeakSubscriber.Pin();
+				if (Subscriber.IsValid()) Subscriber->Deliver(BaseMsg, Size, TopicMetrics, CanBlock);
+			}
+			return;
+		}
+
+		if (_IntraProcess == EIntraProcessMode::LocalAndRemote && IsEcho(BaseMsg)) {
+			return; // already delivered directly by the publisher
+		}
+
+		std::function<void(TSharedPtr<FROSBaseMsg>)> Callback;
+		{
+			// a subscriber of a hub may unsubscribe on the game thread during the delivery
+			FScopeLock Lock(&_CallbackLock);
+			if (!_Callback) return;
+			if (!_LocalQueue) Callback = _Callback;
+		}
+		if (!Callback) {
+			EnqueueMessage(BaseMsg, Size, TopicMetrics, CanBlock);
+			return;
+		}
+		ROS_PROFILER_SCOPE("ROS::TopicUserCallback");
+		Callback(BaseMsg);
+	}
+
 
 	bool Publish(TSharedPtr<FROSBaseMsg> msg)
 	{
+		ROS_PROFILER_SCOPE("ROS::TopicPublish");
+		if (_IntraProcess != EIntraProcessMode::Disabled && _IntraProcessTopic.IsValid()) {
+			PublishLocally(msg);
+			if (_IntraProcess == EIntraProcessMode::LocalOnly) return true;
+		}
+
 		bson_t *bson_message = nullptr;
 
+		rosbridge2cpp::MessageTrace Trace;
+		if (_LatencyTracer && _LatencyTracer->IsEnabled()) {
+			if (!_TopicLatency) _TopicLatency = _LatencyTracer->GetTopicLatency(TCHAR_TO_UTF8(*_Topic));
+			Trace.topic_latency_ = _TopicLatency;
+			Trace.publish_ns_ = rosbridge2cpp::LatencyTracer::Now();
+		}
+
+		// large binary fields are written into the shared memory ring of the connection while converting, if it has one
+		rosbridge2cpp::ScopedPayloadRing PayloadRing(_Bridge ? _Bridge->GetPayloadRing() : nullptr, _Bridge ? _Bridge->GetMinSharedMemoryPayloadSize() : 0);
 		if (ConvertMessage(msg, &bson_message)) {
-			return _ROSTopic->Publish(bson_message); // bson memory will be freed in the rosbridge core code after the message is published
+			if (Trace.topic_latency_) {
+				Trace.converted_ns_ = rosbridge2cpp::LatencyTracer::Now();
+				const int64 ConvertNs = Trace.converted_ns_ - Trace.publish_ns_;
+				Trace.topic_latency_->Record(rosbridge2cpp::LatencySegment::CONVERT_OUTGOING, ConvertNs);
+
+				int64_t StampAgeNs;
+				if (rosbridge2cpp::LatencyTracer::GetStampAge(*bson_message, "header.stamp", StampAgeNs)) {
+					// the stamp age is taken after conversion, but we want the age at the time Publish() was called
+					Trace.topic_latency_->Record(rosbridge2cpp::LatencySegment::STAMP_TO_PUBLISH, StampAgeNs - ConvertNs);
+				}
+			}
+			return _ROSTopic->Publish(bson_message, Trace, PayloadRing.TakeSlots()); // bson memory will be freed in the rosbridge core code after the message is published
 		}
 		else {
 			UE_LOG(LogROS, Error, TEXT("Failed to ConvertMessage in UTopic::Publish()"));
@@ -152,27 +599,197 @@ public:
 		}
 		_Converter = *Converter;
 
-		_ROSTopic = new rosbridge2cpp::ROSTopic(Ric->_Implementation->Get()->GetBridge(), TCHAR_TO_UTF8(*Topic), TCHAR_TO_UTF8(*MessageType), QueueSize);
+		rosbridge2cpp::ROSBridge& Bridge = Ric->_Implementation->Get()->GetBridgeForTopic(Topic);
+		_Bridge = &Bridge;
+		_LatencyTracer = &Bridge.GetLatencyTracer();
+		_TopicLatency = nullptr;
+		_ROSTopic = new rosbridge2cpp::ROSTopic(Bridge, TCHAR_TO_UTF8(*Topic), TCHAR_TO_UTF8(*MessageType), QueueSize);
+	}
+
+	int32 NumQueuedMessages() const
+	{
+		return _QueuedMessages.Num() - _QueueHead;
+	}
+
+	bool IsLocalQueueFull(size_t Size) const
+	{
+		if (NumQueuedMessages() == 0) return false;
+		return (_LocalQueueLength > 0 && NumQueuedMessages() >= _LocalQueueLength)
+			|| (_LocalQueueBytes > 0 && _QueuedBytes + Size > _LocalQueueBytes);
+	}
+
+	void DropOldestQueuedMessage(TArray<TSharedPtr<FROSBaseMsg>, TInlineAllocator<4>>& Dropped)
+	{
+		QueuedMessage& Oldest = _QueuedMessages[_QueueHead++];
+		_QueuedBytes -= Oldest.Size;
+		Dropped.Add(MoveTemp(Oldest.Msg));
+
+		// the dropped entries are only removed once they are half of the array, so a drop costs O(1) on average
+		if (_QueueHead * 2 >= _QueuedMessages.Num()) {
+			_QueuedMessages.RemoveAt(0, _QueueHead, false);
+			_QueueHead = 0;
+		}
+	}
+
+	// Called on the receiver thread for every decoded message of a conflating or queued subscription,
+	// and on the publishing thread for the messages of intra-process publishers
+	void EnqueueMessage(TSharedPtr<FROSBaseMsg> BaseMsg, size_t Size, rosbridge2cpp::TopicMetrics* TopicMetrics, bool CanBlock)
+	{
+		// dropped messages are freed outside of the lock
+		TArray<TSharedPtr<FROSBaseMsg>, TInlineAllocator<4>> Dropped;
+		bool Parked = false;
+
+		_LocalQueueLock.Lock();
+		while (!_LocalQueueStopped && IsLocalQueueFull(Size)) {
+			if (_LocalQueuePolicy == ESubscriberQueuePolicy::BlockReceiver && CanBlock && _Bridge) {
+				// Waiting here would hold the topic lock of the bridge and stall every topic of the connection,
+				// so the receiver thread waits for room once it handed the message to all subscribers
+				_ParkedMessages.Add({ MoveTemp(BaseMsg), Size });
+				Parked = true;
+				break;
+			}
+			else if (_LocalQueuePolicy == ESubscriberQueuePolicy::DropNewest) {
+				Dropped.Add(MoveTemp(BaseMsg));
+				break;
+			}
+
+			// DropOldest, or BlockReceiver of an intra-process publisher, which never waits
+			DropOldestQueuedMessage(Dropped);
+		}
+		if (BaseMsg.IsValid() && !_LocalQueueStopped) {
+			_QueuedMessages.Add({ MoveTemp(BaseMsg), Size });
+			_QueuedBytes += Size;
+		}
+		_LocalQueueLock.Unlock();
+
+		if (Parked) {
+			if (TopicMetrics) TopicMetrics->receiver_blocked_.Add();
+			TWeakPtr<Impl, ESPMode::ThreadSafe> WeakThis = AsShared();
+			_Bridge->BlockReceiverAfterDispatch([WeakThis, TopicMetrics]()
+			{
+				TSharedPtr<Impl, ESPMode::ThreadSafe> This = WeakThis.Pin();
+				if (This.IsValid()) This->WaitForQueueSpace(TopicMetrics);
+			});
+		}
+		if (Dropped.Num() > 0 && TopicMetrics) {
+			(_Conflate ? TopicMetrics->conflated_ : TopicMetrics->local_dropped_).Add(Dropped.Num());
+		}
+	}
+
+	// BlockReceiver: called on the receiver thread after the dispatch of a message that found the queue full. Not
+	// reading the socket meanwhile pushes back on rosbridge, no lock of the bridge is held.
+	void WaitForQueueSpace(rosbridge2cpp::TopicMetrics* TopicMetrics)
+	{
+		TArray<TSharedPtr<FROSBaseMsg>, TInlineAllocator<4>> Dropped;
+		const double BlockStart = FPlatformTime::Seconds();
+
+		_LocalQueueLock.Lock();
+		while (!_LocalQueueStopped && _ParkedMessages.Num() > 0) {
+			if (IsLocalQueueFull(_ParkedMessages[0].Size)) {
+				if ((FPlatformTime::Seconds() - BlockStart) * 1000.0 < _MaxReceiverBlockMs) {
+					_LocalQueueLock.Unlock();
+					_QueueSpaceEvent->Wait(10);
+					_LocalQueueLock.Lock();
+					continue;
+				}
+				DropOldestQueuedMessage(Dropped); // waited too long
+				continue;
+			}
+			_QueuedBytes += _ParkedMessages[0].Size;
+			_QueuedMessages.Add(MoveTemp(_ParkedMessages[0]));
+			_ParkedMessages.RemoveAt(0);
+		}
+		_ParkedMessages.Reset(); // unsubscribed meanwhile
+		_LocalQueueLock.Unlock();
+
+		if (Dropped.Num() > 0 && TopicMetrics) {
+			TopicMetrics->local_dropped_.Add(Dropped.Num());
+		}
+	}
+
+	// Core ticker of a conflating or queued subscription, runs once per frame on the game thread
+	bool DeliverQueuedMessages(float DeltaTime)
+	{
+		int32 DeliveredHead = 0;
+		{
+			FScopeLock Lock(&_LocalQueueLock);
+			if (NumQueuedMessages() == 0) return true;
+			Swap(_QueuedMessages, _DeliveredMessages);
+			DeliveredHead = _QueueHead;
+			_QueueHead = 0;
+			_QueuedBytes = 0;
+		}
+		_QueueSpaceEvent->Trigger();
+
+		ROS_PROFILER_SCOPE("ROS::TopicUserCallback");
+		for (int32 Index = DeliveredHead; Index < _DeliveredMessages.Num(); ++Index) {
+			if (!_Callback) break; // unsubscribed by an earlier callback
+			_Callback(_DeliveredMessages[Index].Msg);
+		}
+		_DeliveredMessages.Reset();
+		return true;
+	}
+
+	void StopLocalQueue()
+	{
+		_LocalQueueStopped = true;
+		_QueueSpaceEvent->Trigger();
+		if (_TickerHandle.IsValid()) {
+			FROSCoreTicker::GetCoreTicker().RemoveTicker(_TickerHandle);
+			_TickerHandle.Reset();
+		}
+		FScopeLock Lock(&_LocalQueueLock);
+		_QueuedMessages.Empty();
+		_ParkedMessages.Empty();
+		_QueueHead = 0;
+		_QueuedBytes = 0;
 	}
 
 	void MessageCallback(const ROSBridgePublishMsg &message)
 	{
+		ROS_PROFILER_SCOPE("ROS::TopicMessageCallback");
+		// set by the bridge for received messages while tracing is enabled
+		rosbridge2cpp::TopicLatency* TopicLatency = message.trace_.topic_latency_;
+		rosbridge2cpp::TopicMetrics* TopicMetrics = message.metrics_;
+		const int64 DispatchedNs = rosbridge2cpp::LatencyTracer::Now();
+
 		TSharedPtr<FROSBaseMsg> BaseMsg;
-		if (ConvertMessage(&message, BaseMsg)) {
-			_Callback(BaseMsg);
+		if (_RawMessages ? ConvertRawMessage(&message, BaseMsg) : ConvertMessage(&message, BaseMsg)) {
+			const int64 ConvertedNs = rosbridge2cpp::LatencyTracer::Now();
+			if (TopicMetrics) {
+				TopicMetrics->decoded_.Add();
+				TopicMetrics->decode_time_ns_.Add(ConvertedNs - DispatchedNs);
+			}
+			Deliver(BaseMsg, message.size_, TopicMetrics, true);
+
+			if (TopicLatency) {
+				// Blueprint and queued subscriptions only hand the message over to the game thread here
+				const int64 DeliveredNs = rosbridge2cpp::LatencyTracer::Now();
+				const int64 ReceivedNs = message.trace_.received_ns_;
+				TopicLatency->Record(rosbridge2cpp::LatencySegment::RECEIVE_TO_DISPATCH, DispatchedNs - ReceivedNs);
+				TopicLatency->Record(rosbridge2cpp::LatencySegment::CONVERT_INCOMING, ConvertedNs - DispatchedNs);
+				TopicLatency->Record(rosbridge2cpp::LatencySegment::CALLBACK, DeliveredNs - ConvertedNs);
+				TopicLatency->Record(rosbridge2cpp::LatencySegment::RECEIVE_TO_DELIVERED, DeliveredNs - ReceivedNs);
+			}
 		}
 		else {
+			if (TopicMetrics) TopicMetrics->decode_failures_.Add();
 			UE_LOG(LogROS, Error, TEXT("Couldn't convert incoming Message; Skipping callback"));
 		}
 	}
 };
 
+FCriticalSection UTopic::Impl::IntraProcessLock;
+TMap<TPair<UROSIntegrationCore*, FString>, UTopic::Impl::IntraProcessTopicPtr> UTopic::Impl::IntraProcessTopics;
+FCriticalSection UTopic::Impl::SharedSubscriptionLock;
+TMap<UTopic::Impl::SharedSubscriptionKey, UTopic::Impl::ImplPtr> UTopic::Impl::SharedSubscriptions;
+
 // Interface Implementation
 
 UTopic::UTopic(const FObjectInitializer& ObjectInitializer)
 : Super(ObjectInitializer)
 , _SelfPtr(this, TDeleterNot())
-, _Implementation(new UTopic::Impl())
+, _Implementation(MakeShared<UTopic::Impl, ESPMode::ThreadSafe>())
 {
 	_State.Connected = true;
 	_State.Advertised = false;
@@ -215,8 +832,8 @@ void UTopic::BeginDestroy() {
 	}
 	_State.Connected = false;
 
-	if(_Implementation) delete _Implementation;
-	_Implementation = nullptr;
+	if (_Implementation) _Implementation->Shutdown();
+	_Implementation.Reset();
 
 	Super::BeginDestroy();
 
@@ -226,7 +843,23 @@ void UTopic::BeginDestroy() {
 bool UTopic::Subscribe(std::function<void(TSharedPtr<FROSBaseMsg>)> func)
 {
 	_State.Subscribed = true;
-	return _State.Connected && _Implementation->Subscribe(func);
+	return _State.Connected && _Implementation->Subscribe(func, _SubscriptionOptions);
+}
+
+void UTopic::SetRawSubscription(bool RawSubscription)
+{
+	_SubscriptionOptions.Compression = RawSubscription ? TEXT("cbor-raw") : TEXT("none");
+}
+
+void UTopic::SetSubscriptionOptions(const FROSSubscriptionOptions& Options)
+{
+	_SubscriptionOptions = Options;
+}
+
+void UTopic::SetIntraProcess(EIntraProcessMode Mode)
+{
+	_IntraProcess = Mode;
+	if (_Implementation) _Implementation->SetIntraProcess(Mode);
 }
 
 bool UTopic::Unsubscribe()
@@ -255,7 +888,9 @@ bool UTopic::Publish(TSharedPtr<FROSBaseMsg> msg)
 void UTopic::Init(UROSIntegrationCore *Ric, FString Topic, FString MessageType, int32 QueueSize)
 {
 	_ROSIntegrationCore = Ric;
+	if (Ric) Ric->RegisterTopic(this);
 	_Implementation->Init(Ric, Topic, MessageType, QueueSize);
+	_Implementation->SetIntraProcess(_IntraProcess);
 }
 
 void UTopic::MarkAsDisconnected()
@@ -268,9 +903,10 @@ bool UTopic::Reconnect(UROSIntegrationCore* ROSIntegrationCore)
 	bool success = true;
 	_ROSIntegrationCore = ROSIntegrationCore;
 
-	Impl* oldImplementation = _Implementation;
-	_Implementation = new UTopic::Impl();
+	TSharedPtr<Impl, ESPMode::ThreadSafe> oldImplementation = _Implementation;
+	_Implementation = MakeShared<UTopic::Impl, ESPMode::ThreadSafe>();
 	_Implementation->Init(ROSIntegrationCore, oldImplementation->_Topic, oldImplementation->_MessageType, oldImplementation->_QueueSize);
+	_Implementation->SetIntraProcess(_IntraProcess);
 
 	_State.Connected = true;
 	if (_State.Subscribed)
@@ -285,12 +921,23 @@ bool UTopic::Reconnect(UROSIntegrationCore* ROSIntegrationCore)
 
 	if (oldImplementation)
 	{
-		oldImplementation->_Ric = nullptr; // prevent old topic from unsubscribing using the broken connection
-		delete oldImplementation;
+		// a topic that only moves to another connection unsubscribes from the old one, unless that one is broken
+		if (!ROSIntegrationCore->_Implementation->Get()->IsAvailable(oldImplementation->_Bridge))
+		{
+			oldImplementation->_Ric = nullptr; // prevent old topic from unsubscribing using the broken connection
+		}
+		oldImplementation->Shutdown();
+		oldImplementation.Reset();
 	}
 	return success;
 }
 
+bool UTopic::IsOnSelectedConnection() const
+{
+	if (!_ROSIntegrationCore || !_Implementation->_Bridge) return true; // not initialized
+	return _Implementation->_Bridge == &_ROSIntegrationCore->_Implementation->Get()->GetBridgeForTopic(_Implementation->_Topic);
+}
+
 bool UTopic::IsAdvertising() 
 {
 	return _State.Advertised;
@@ -328,7 +975,40 @@ bool UTopic::Subscribe()
 	if (_State.Connected)
 	{
 		EMessageType MessageType = _State.BlueprintMessageType;
-		std::function<void(TSharedPtr<FROSBaseMsg>)> Callback = [this, MessageType](TSharedPtr<FROSBaseMsg> msg) -> void
+		TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
+
+		// events from the connection threads are called by the game instance once per frame
+		TSharedPtr<FROSBlueprintEventQueue, ESPMode::ThreadSafe> EventQueue;
+		UROSIntegrationGameInstance* ROSInstance = Cast<UROSIntegrationGameInstance>(GWorld->GetGameInstance());
+		if (ROSInstance)
+		{
+			EventQueue = ROSInstance->GetBlueprintEventQueue();
+		}
+
+		auto RunOnGameThread = [SelfPtr, EventQueue](TFunction<void()> Event)
+		{
+			// conflating, queued and intra-process subscriptions may already deliver on the game thread
+			if (IsInGameThread())
+			{
+				Event();
+				return;
+			}
+			auto CheckedEvent = [Event, SelfPtr]()
+			{
+				if (!SelfPtr.IsValid()) return;
+				Event();
+			};
+			if (EventQueue.IsValid())
+			{
+				EventQueue->Enqueue(MoveTemp(CheckedEvent));
+			}
+			else
+			{
+				AsyncTask(ENamedThreads::GameThread, MoveTemp(CheckedEvent));
+			}
+		};
+
+		std::function<void(TSharedPtr<FROSBaseMsg>)> Callback = [this, MessageType, RunOnGameThread](TSharedPtr<FROSBaseMsg> msg) -> void
 		{
 			switch (MessageType)
 			{
@@ -338,10 +1018,8 @@ bool UTopic::Subscribe()
 				if (ConcreteStringMessage.IsValid())
 				{
 					const FString Data = ConcreteStringMessage->_Data;
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, Data, SelfPtr]()
+					RunOnGameThread([this, Data]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnStringMessage(Data);
 					});
 				}
@@ -353,10 +1031,8 @@ bool UTopic::Subscribe()
 				if (ConcreteFloatMessage.IsValid())
 				{
 					const float Data = ConcreteFloatMessage->_Data;
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, Data, SelfPtr]()
+					RunOnGameThread([this, Data]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnFloat32Message(Data);
 					});
 				}
@@ -368,10 +1044,8 @@ bool UTopic::Subscribe()
 				if (ConcreteBoolMessage.IsValid())
 				{
 					const bool Data = ConcreteBoolMessage->_Data;
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, Data, SelfPtr]()
+					RunOnGameThread([this, Data]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnBoolMessage(Data);
 					});
 				}
@@ -383,10 +1057,8 @@ bool UTopic::Subscribe()
 				if (ConcreteInt32Message.IsValid())
 				{
 					const int32 Data = ConcreteInt32Message->_Data;
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, Data, SelfPtr]()
+					RunOnGameThread([this, Data]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnInt32Message(Data);
 					});
 				}
@@ -398,10 +1070,8 @@ bool UTopic::Subscribe()
 				if (ConcreteInt64Message.IsValid())
 				{
 					const int64 Data = ConcreteInt64Message->_Data;
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, Data, SelfPtr]()
+					RunOnGameThread([this, Data]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnInt64Message(Data);
 					});
 				}
@@ -416,10 +1086,8 @@ bool UTopic::Subscribe()
 					const float y = ConcreteVectorMessage->y;
 					const float z = ConcreteVectorMessage->z;
 					FVector Data(x,y,z);
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, Data, SelfPtr]()
+					RunOnGameThread([this, Data]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnVector3Message(Data);
 					});
 				}
@@ -434,10 +1102,8 @@ bool UTopic::Subscribe()
 					const float y = ConcreteVectorMessage->y;
 					const float z = ConcreteVectorMessage->z;
 					FVector Data(x, y, z);
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, Data, SelfPtr]()
+					RunOnGameThread([this, Data]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnPointMessage(Data);
 					});
 				}
@@ -452,10 +1118,8 @@ bool UTopic::Subscribe()
 					const auto q = ConcreteVectorMessage->orientation;
 					const FVector  position(p.x, p.y, p.z);
 					const FVector4 orientation(q.x,q.y,q.z,q.w);
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, position, orientation, SelfPtr]()
+					RunOnGameThread([this, position, orientation]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnPoseMessage(position, orientation);
 					});
 				}
@@ -468,10 +1132,8 @@ bool UTopic::Subscribe()
 				{
 					const auto q = ConcreteVectorMessage;
 					const FVector4 orientation(q->x, q->y, q->z, q->w);
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, orientation, SelfPtr]()
+					RunOnGameThread([this, orientation]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnQuaternionMessage(orientation);
 					});
 				}
@@ -486,10 +1148,8 @@ bool UTopic::Subscribe()
 					const auto q = ConcreteVectorMessage->angular;
 					const FVector  linear(p.x, p.y, p.z);
 					const FVector angular(q.x, q.y, q.z);
-					TWeakPtr<UTopic, ESPMode::ThreadSafe> SelfPtr(_SelfPtr);
-					AsyncTask(ENamedThreads::GameThread, [this, linear, angular, SelfPtr]()
+					RunOnGameThread([this, linear, angular]()
 					{
-						if (!SelfPtr.IsValid()) return;
 						OnTwistMessage(linear, angular);
 					});
 				}
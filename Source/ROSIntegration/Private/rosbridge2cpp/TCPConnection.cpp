@@ -1,6 +1,8 @@
 #include "TCPConnection.h"
 
 #include "ROSIntegrationCore.h"
+#include "cbor_codec.h"
+#include "ros_profiling.h"
 
 #include <iomanip>
 
@@ -25,23 +27,42 @@ bool TCPConnection::Init(std::string ip_addr, int port)
 
 	if (!ipValid)
 	{
-		FTCHARToUTF8 UTF8Converter(*address);
-		std::cout << "Given IP address is invalid: " << UTF8Converter.Get() << std::endl;
+		UE_LOG(LogROS, Error, TEXT("Given IP address is invalid: %s"), *address);
 		return false;
 	}
 
 	_sock = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateSocket(NAME_Stream, TEXT("Rosbridge TCP client"), false);
 
-	/*const int32 ReceiveBufferSize = 4000000;
-	int32 ReceiveBufferSizeSet = 4000000;
-	if (!_sock->SetReceiveBufferSize(4000000, ReceiveBufferSizeSet) ||
-		ReceiveBufferSizeSet < ReceiveBufferSize)
+	if (send_buffer_size_ > 0)
 	{
-		std::cout << "Unable to set requested receiver buffer size" << std::endl;
-	}*/
-
-	if (!_sock->Connect(*addr))
+		int32 actual_size = 0;
+		if (!_sock->SetSendBufferSize(send_buffer_size_, actual_size) || actual_size < send_buffer_size_)
+		{
+			UE_LOG(LogROS, Warning, TEXT("Requested a socket send buffer of %d bytes, got %d"), send_buffer_size_, actual_size);
+		}
+	}
+	if (receive_buffer_size_ > 0)
+	{
+		int32 actual_size = 0;
+		if (!_sock->SetReceiveBufferSize(receive_buffer_size_, actual_size) || actual_size < receive_buffer_size_)
+		{
+			UE_LOG(LogROS, Warning, TEXT("Requested a socket receive buffer of %d bytes, got %d"), receive_buffer_size_, actual_size);
+		}
+	}
+	// Small control messages and service calls shouldn't wait for Nagle's algorithm
+	_sock->SetNoDelay(true);
+
+	// The socket stays non-blocking: connecting doesn't wait for the OS timeout (which can be minutes) when rosbridge
+	// isn't reachable, and writes wait for the socket with a timeout instead of blocking (see SendMessage)
+	_sock->SetNonBlocking(true);
+	_sock->Connect(*addr);
+	const bool bConnected = _sock->Wait(ESocketWaitConditions::WaitForWrite, FTimespan::FromMilliseconds(connect_timeout_.count())) &&
+		_sock->GetConnectionState() == ESocketConnectionState::SCS_Connected;
+	if (!bConnected)
+	{
+		UE_LOG(LogROS, Warning, TEXT("Unable to connect to %s:%d within %lld ms"), *address, remote_port, static_cast<long long>(connect_timeout_.count()));
 		return false;
+	}
 
 	// Setting up the receiver thread
 	UE_LOG(LogROS, Display, TEXT("Setting up receiver thread ..."));
@@ -53,6 +74,11 @@ bool TCPConnection::Init(std::string ip_addr, int port)
 	return true;
 }
 
+static bool IsWouldBlock()
+{
+	return ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode() == SE_EWOULDBLOCK;
+}
+
 bool TCPConnection::SendMessage(std::string data)
 {
 	if (!_sock)
@@ -61,49 +87,67 @@ bool TCPConnection::SendMessage(std::string data)
 		return false;
 	}
 
-	// std::string msg = "{\"args\":{\"a\":1,\"b\":2},\"id\":\"call_service:/add_two_ints:23\",\"op\":\"call_service\",\"service\":\"/add_two_ints\"}";
-	const uint8 *byte_msg = reinterpret_cast<const uint8*>(data.c_str());
-	int32 bytes_sent = 0;
-	// TODO check proper casting
-
-	// TODO check errors on send
-	_sock->Send(byte_msg, data.length(), bytes_sent);
 	UE_LOG(LogROS, VeryVerbose, TEXT("Send data: %s"), *FString(UTF8_TO_TCHAR(data.c_str())));
-
-	return true;
+	return SendMessage(reinterpret_cast<const uint8_t*>(data.c_str()), static_cast<unsigned int>(data.length()));
 }
 
 bool TCPConnection::SendMessage(const uint8_t *data, unsigned int length)
 {
+	ROS_PROFILER_SCOPE("ROS::SocketWrite");
 	if (!_sock)
 	{
 		UE_LOG(LogROS, Error, TEXT("TCPConnection::SendMessage() - Trying to send binary message when socket is nullptr."));
 		return false;
 	}
 	
+	if (stream_broken_)
+	{
+		return false;
+	}
+
 	// Simple checksum
 	//uint16_t checksum = Fletcher16(data, length);
 
-	int32 bytes_sent = 0;
 	unsigned int total_bytes_to_send = length;
-	int32 num_tries = 0;
-	while (total_bytes_to_send > 0 && num_tries < 3)
+	while (total_bytes_to_send > 0)
 	{
-		bool SendResult = _sock->Send(data, total_bytes_to_send, bytes_sent);
-
-		if (SendResult)
+		int32 bytes_sent = 0;
+		if (_sock->Send(data, total_bytes_to_send, bytes_sent) && bytes_sent > 0)
 		{
 			data += bytes_sent;
+			total_bytes_to_send -= bytes_sent;
+			continue;
 		}
-		else
+
+		if (!IsWouldBlock())
 		{
-			++num_tries;
+			UE_LOG(LogROS, Error, TEXT("TCPConnection::SendMessage() - Failed to write to the socket."));
+			ReportError(rosbridge2cpp::TransportError::R2C_SOCKET_ERROR);
+			return false;
 		}
 
-		total_bytes_to_send -= bytes_sent;
+		// The socket buffer is full, wait until rosbridge reads some of it
+		ROS_PROFILER_SCOPE("ROS::SocketWriteStall");
+		if (!_sock->Wait(ESocketWaitConditions::WaitForWrite, FTimespan::FromMilliseconds(send_timeout_.count())))
+		{
+			if (total_bytes_to_send < length)
+			{
+				// rosbridge can't make sense of the rest of the stream anymore, let the health check reconnect
+				stream_broken_ = true;
+				UE_LOG(LogROS, Error, TEXT("TCPConnection::SendMessage() - rosbridge didn't read for %lld ms in the middle of a message, closing the connection."),
+					static_cast<long long>(send_timeout_.count()));
+			}
+			else
+			{
+				UE_LOG(LogROS, Warning, TEXT("TCPConnection::SendMessage() - rosbridge didn't read for %lld ms, dropping a message of %u bytes."),
+					static_cast<long long>(send_timeout_.count()), length);
+			}
+			ReportError(rosbridge2cpp::TransportError::R2C_SEND_STALLED);
+			return false;
+		}
 	}
 
-	return total_bytes_to_send == 0;
+	return true;
 }
 
 uint16_t TCPConnection::Fletcher16( const uint8_t *data, int count )
@@ -123,12 +167,14 @@ uint16_t TCPConnection::Fletcher16( const uint8_t *data, int count )
 
 int TCPConnection::ReceiverThreadFunction()
 {
+	ROS_PROFILER_THREAD_NAME("ROSBridgeReceiver");
+
+	// BSON mode reads everything that is available at once and splits it into messages afterwards. The length of a
+	// CBOR message is only known once all of it arrived, cbor_scanner continues where the previous read stopped.
 	TArray<uint8> binary_buffer;
-	uint32_t buffer_size = 10 * 1024 * 1024;
-	binary_buffer.Reserve(buffer_size);
-	bool bson_state_read_length = true; // indicate that the receiver shall only get 4 bytes to start with
-	int32_t bson_msg_length = 0;
-	int32_t bson_msg_length_read = 0;
+	binary_buffer.SetNumUninitialized(1024 * 1024);
+	int32 num_buffered = 0;
+	rosbridge2cpp::CBORCodec::ItemScanner cbor_scanner;
 	int return_value = 0;
 
 	while (run_receiver_thread) {
@@ -153,61 +199,106 @@ int TCPConnection::ReceiverThreadFunction()
 		}
 
 		if (bson_only_mode_) {
-			if (bson_state_read_length) {
-				binary_buffer.SetNumUninitialized(4, false);
-				int32 bytes_read = 0;
-				if (_sock->Recv(binary_buffer.GetData() + bson_msg_length_read, 4 - bson_msg_length_read, bytes_read) && bytes_read > 0) {
-					bson_msg_length_read += bytes_read;
-					if (bson_msg_length_read == 4) { // receive until we have all 4 bytes for the size variable
-#if PLATFORM_LITTLE_ENDIAN
-						bson_msg_length = (
-							binary_buffer.GetData()[3] << 24 |
-							binary_buffer.GetData()[2] << 16 |
-							binary_buffer.GetData()[1] << 8 |
-							binary_buffer.GetData()[0]
-						);
-#else
-						bson_msg_length = *((uint32_t*)&binary_buffer[0]);
-#endif
-						// Indicate the message retrieval mode
-						bson_state_read_length = false;
-						binary_buffer.SetNumUninitialized(bson_msg_length, false);  // bson_msg_length includes the 4 bytes for the size variable
-					} else if (bson_msg_length_read > 4) {
-						UE_LOG(LogROS, Error, 
-							TEXT("bson_msg_length_read is greater than 4 during bson_state_read_length==true. It's: %d"),
-							bson_msg_length_read);
-					}
-				} else {
-					UE_LOG(LogROS, Error, TEXT("Failed to recv(); Closing receiver thread."));
-					run_receiver_thread = false;
+			int32 bytes_read = 0;
+			if (!_sock->Recv(binary_buffer.GetData() + num_buffered, binary_buffer.Num() - num_buffered, bytes_read) || bytes_read <= 0) {
+				if (IsWouldBlock()) {
+					continue; // woken up without data
 				}
-			} else {
-				// Message retrieval mode
-				int32 bytes_read = 0;
-				if (_sock->Recv(binary_buffer.GetData() + bson_msg_length_read, bson_msg_length - bson_msg_length_read, bytes_read) && bytes_read > 0) {
-
-					bson_msg_length_read += bytes_read;
-					if (bson_msg_length_read == bson_msg_length) {
-						// Full received message!
-						bson_state_read_length = true;
-						bson_msg_length_read = 0; // reset to wait for next 4 bytes size variable of next message
-						bson_t b;
-						if (!bson_init_static(&b, binary_buffer.GetData(), bson_msg_length)) {
-							UE_LOG(LogROS, Error, TEXT("Error on BSON parse - Ignoring message"));
-							continue;
-						}
-						if (incoming_message_callback_bson_) {
-							incoming_message_callback_bson_(b);
-						}
-					} else {
-						UE_LOG(LogROS, VeryVerbose, TEXT("Binary buffer num is: %d"), binary_buffer.Num());
+				UE_LOG(LogROS, Error, TEXT("Failed to recv(); Closing receiver thread."));
+				run_receiver_thread = false;
+				continue;
+			}
+			num_buffered += bytes_read;
+
+			int32 offset = 0;
+			uint32_t required_length = 0; // of an incomplete message at the end of the buffer
+			bool valid_stream = true;
+			while (num_buffered - offset >= 4) {
+				const uint8_t* message = binary_buffer.GetData() + offset;
+				const size_t available = num_buffered - offset;
+				if (rosbridge2cpp::CBORCodec::IsMessage(message, available)) {
+					// CBOR subscriptions, see ROSBridge::SetSubscriptionCompression
+					size_t message_length = 0;
+					const rosbridge2cpp::CBORCodec::ItemStatus status = cbor_scanner.Scan(message, available, message_length);
+					if (status == rosbridge2cpp::CBORCodec::ItemStatus::INVALID || message_length > kMaxMessageLength) {
+						valid_stream = false;
+						break;
+					}
+					if (status == rosbridge2cpp::CBORCodec::ItemStatus::INCOMPLETE) {
+						required_length = static_cast<uint32_t>(message_length);
+						break;
+					}
+					cbor_scanner.Reset();
+
+					ROS_PROFILER_SCOPE("ROS::Receive");
+					bson_t b;
+					bool parsed;
+					bson_init(&b);
+					{
+						ROS_PROFILER_SCOPE("ROS::FrameParse");
+						parsed = rosbridge2cpp::CBORCodec::ToBSON(message, message_length, &b);
+					}
+					if (!parsed) {
+						UE_LOG(LogROS, Error, TEXT("Error on CBOR parse - Ignoring message"));
 					}
-				} else {
-					UE_LOG(LogROS, Error, TEXT("Failed to recv()"));
+					else if (incoming_message_callback_bson_) {
+						bson_t view;
+						bson_init_static(&view, bson_get_data(&b), b.len);
+						incoming_message_callback_bson_(view);
+					}
+					bson_destroy(&b);
+					offset += static_cast<int32>(message_length);
+					continue;
+				}
+
+				// the length includes the 4 bytes of the length itself
+				const uint32_t message_length = static_cast<uint32_t>(message[0]) | (static_cast<uint32_t>(message[1]) << 8) |
+					(static_cast<uint32_t>(message[2]) << 16) | (static_cast<uint32_t>(message[3]) << 24);
+				if (message_length < 5 || message_length > kMaxMessageLength) {
+					valid_stream = false;
+					break;
+				}
+				if (available < message_length) {
+					required_length = message_length;
+					break;
+				}
+
+				ROS_PROFILER_SCOPE("ROS::Receive");
+				bson_t b;
+				bool parsed;
+				{
+					ROS_PROFILER_SCOPE("ROS::FrameParse");
+					parsed = bson_init_static(&b, message, message_length);
 				}
+				if (!parsed) {
+					UE_LOG(LogROS, Error, TEXT("Error on BSON parse - Ignoring message"));
+				}
+				else if (incoming_message_callback_bson_) {
+					incoming_message_callback_bson_(b);
+				}
+				offset += static_cast<int32>(message_length);
+			}
+
+			if (!valid_stream) {
+				UE_LOG(LogROS, Error, TEXT("Received an invalid or too long message (more than %u bytes); Closing receiver thread."), kMaxMessageLength);
+				ReportError(rosbridge2cpp::TransportError::R2C_SOCKET_ERROR);
+				run_receiver_thread = false;
+				continue;
+			}
+
+			// keep the beginning of an incomplete message and make room for the rest of it
+			if (offset > 0) {
+				FMemory::Memmove(binary_buffer.GetData(), binary_buffer.GetData() + offset, num_buffered - offset);
+				num_buffered -= offset;
+			}
+			if (required_length > static_cast<uint32_t>(binary_buffer.Num())) {
+				// the length of a CBOR message is only known once it has been read completely, so grow in bigger steps
+				const int64 new_size = FMath::Max<int64>(required_length, int64(binary_buffer.Num()) * 2);
+				binary_buffer.SetNumUninitialized(static_cast<int32>(FMath::Min<int64>(new_size, kMaxMessageLength)), false);
 			}
 		}
 		else {
+			ROS_PROFILER_SCOPE("ROS::Receive");
 			FString result;
 			uint32 count = 0;
 			while (_sock->HasPendingData(count) && count > 0) {
@@ -239,7 +330,10 @@ int TCPConnection::ReceiverThreadFunction()
 			// TODO catch parse error properly
 			// auto j = json::parse(received_data);
 			json j;
-			j.Parse(TCHAR_TO_UTF8(*result));
+			{
+				ROS_PROFILER_SCOPE("ROS::FrameParse");
+				j.Parse(TCHAR_TO_UTF8(*result));
+			}
 
 			if (_incoming_message_callback)
 				_incoming_message_callback(j);
@@ -288,7 +382,16 @@ void TCPConnection::SetTransportMode(rosbridge2cpp::ITransportLayer::TransportMo
 	}
 }
 
+void TCPConnection::StopReceiving()
+{
+	run_receiver_thread = false;
+	if (receiverThreadSetUp) {
+		receiverThread.join(); // Wait for the receiver thread to finish, it checks the flag at least once per second
+		receiverThreadSetUp = false;
+	}
+}
+
 bool TCPConnection::IsHealthy() const
 {
-	return run_receiver_thread;
+	return run_receiver_thread && !stream_broken_;
 }
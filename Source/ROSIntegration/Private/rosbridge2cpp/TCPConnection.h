@@ -4,6 +4,8 @@
 //#include <stdio.h>
 //#include <string>
 //#include <chrono>
+#include <atomic>
+#include <chrono>
 #include <thread>
 
 #include <functional> // std::function
@@ -33,10 +35,7 @@ public:
 	TCPConnection() {
 	}
 	~TCPConnection() {
-		run_receiver_thread = false;
-		if (receiverThreadSetUp) {
-			receiverThread.join(); // Wait for the receiver thread to finish
-		}
+		StopReceiving();
 		if (_sock != nullptr) {
 			_sock->Close();
 			ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(_sock);
@@ -44,8 +43,16 @@ public:
 	}
 
 	bool Init(std::string ip_addr, int port);
+	// Init() gives up if the connection isn't established within this time
+	void SetConnectTimeout(std::chrono::milliseconds timeout) { connect_timeout_ = timeout; }
+	// A write that can't put any data into the socket buffer within this time is given up (R2C_SEND_STALLED),
+	// instead of blocking the sending thread while rosbridge doesn't keep up
+	void SetSendTimeout(std::chrono::milliseconds timeout) { send_timeout_ = timeout; }
+	// SO_SNDBUF and SO_RCVBUF in bytes, 0 keeps the default of the OS. Must be called before Init().
+	void SetSocketBufferSizes(int32 send_buffer_size, int32 receive_buffer_size) { send_buffer_size_ = send_buffer_size; receive_buffer_size_ = receive_buffer_size; }
 	bool SendMessage(std::string data);
 	bool SendMessage(const uint8_t *data, unsigned int length);
+	bool SupportsCoalescedWrites() const override { return true; }
 	uint16_t Fletcher16(const uint8_t *data, int count);
 	int ReceiverThreadFunction();
 	void RegisterIncomingMessageCallback(std::function<void(json&)> fun);
@@ -53,6 +60,7 @@ public:
 	void RegisterErrorCallback(std::function<void(rosbridge2cpp::TransportError)> fun);
 	void ReportError(rosbridge2cpp::TransportError err);
 	void SetTransportMode(rosbridge2cpp::ITransportLayer::TransportMode);
+	void StopReceiving();
 
 	bool IsHealthy() const;
 
@@ -61,6 +69,11 @@ private:
 	int _port;
 
 	FSocket *_sock = nullptr;
+	std::chrono::milliseconds connect_timeout_ = std::chrono::milliseconds(2000);
+	std::chrono::milliseconds send_timeout_ = std::chrono::milliseconds(1000);
+	int32 send_buffer_size_ = 0;
+	int32 receive_buffer_size_ = 0;
+	std::atomic<bool> stream_broken_{ false }; // a stalled write left part of a message in the stream
 	// int sock = socket(AF_INET , SOCK_STREAM , 0);
 	// struct sockaddr_in connect_to;
 	std::thread receiverThread;
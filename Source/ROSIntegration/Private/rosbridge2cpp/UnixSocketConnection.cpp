@@ -0,0 +1,331 @@
+#include "UnixSocketConnection.h"
+
+#include "cbor_codec.h"
+#include "ros_log.h"
+#include "ros_profiling.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#if defined(MSG_NOSIGNAL)
+static const int SendFlags = MSG_NOSIGNAL;
+#else
+static const int SendFlags = 0; // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+// Smallest valid BSON document: length prefix and terminating zero
+static const uint32_t MinBSONLength = 5;
+
+static uint32_t ReadLittleEndian32(const uint8_t* data)
+{
+	return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+		static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+UnixSocketConnection::~UnixSocketConnection()
+{
+	run_receiver_thread_ = false;
+#if !defined(_WIN32)
+	if (fd_ >= 0) {
+		shutdown(fd_, SHUT_RDWR); // wakes up the receiver thread
+	}
+	if (receiver_thread_.joinable()) {
+		receiver_thread_.join();
+	}
+	if (fd_ >= 0) {
+		close(fd_);
+	}
+#endif
+}
+
+void UnixSocketConnection::StopReceiving()
+{
+	run_receiver_thread_ = false;
+#if !defined(_WIN32)
+	if (fd_ >= 0) {
+		shutdown(fd_, SHUT_RD); // wakes up the receiver thread
+	}
+	if (receiver_thread_.joinable()) {
+		receiver_thread_.join();
+	}
+#endif
+}
+
+bool UnixSocketConnection::Init(std::string socket_path, int /*port*/)
+{
+#if defined(_WIN32)
+	ROS_LOG_ERROR("[UnixSocketConnection] Unix domain sockets aren't supported on this platform");
+	return false;
+#else
+	if (!bson_only_mode_) {
+		ROS_LOG_ERROR("[UnixSocketConnection] Only the BSON mode is supported");
+		return false;
+	}
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+		ROS_LOG_ERROR("[UnixSocketConnection] Invalid socket path '%s'", socket_path.c_str());
+		return false;
+	}
+	memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+	fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd_ < 0) {
+		ROS_LOG_ERROR("[UnixSocketConnection] Couldn't create socket: %s", strerror(errno));
+		return false;
+	}
+
+#if defined(SO_NOSIGPIPE)
+	int no_sigpipe = 1;
+	setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+	if (send_buffer_size_ > 0 && setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &send_buffer_size_, sizeof(send_buffer_size_)) != 0) {
+		ROS_LOG_WARNING("[UnixSocketConnection] Couldn't set a socket send buffer of %d bytes", send_buffer_size_);
+	}
+	if (receive_buffer_size_ > 0 && setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &receive_buffer_size_, sizeof(receive_buffer_size_)) != 0) {
+		ROS_LOG_WARNING("[UnixSocketConnection] Couldn't set a socket receive buffer of %d bytes", receive_buffer_size_);
+	}
+
+	// Connecting to a local socket either succeeds or fails right away, no timeout needed
+	if (connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		ROS_LOG_WARNING("[UnixSocketConnection] Unable to connect to %s: %s", socket_path.c_str(), strerror(errno));
+		close(fd_);
+		fd_ = -1;
+		return false;
+	}
+
+	// Writes wait for the socket with a timeout instead of blocking, see SendMessage
+	fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+
+	socket_path_ = socket_path;
+	run_receiver_thread_ = true;
+	receiver_thread_ = std::thread(&UnixSocketConnection::ReceiverThreadFunction, this);
+	return true;
+#endif
+}
+
+bool UnixSocketConnection::SendMessage(std::string data)
+{
+	return SendMessage(reinterpret_cast<const uint8_t*>(data.c_str()), static_cast<unsigned int>(data.length()));
+}
+
+bool UnixSocketConnection::SendMessage(const uint8_t *data, unsigned int length)
+{
+#if defined(_WIN32)
+	return false;
+#else
+	ROS_PROFILER_SCOPE("ROS::SocketWrite");
+	if (fd_ < 0 || stream_broken_) {
+		return false;
+	}
+
+	unsigned int total_bytes_to_send = length;
+	while (total_bytes_to_send > 0) {
+		const ssize_t bytes_sent = send(fd_, data, total_bytes_to_send, SendFlags);
+		if (bytes_sent > 0) {
+			data += bytes_sent;
+			total_bytes_to_send -= static_cast<unsigned int>(bytes_sent);
+			continue;
+		}
+		if (bytes_sent < 0 && errno == EINTR) {
+			continue;
+		}
+		if (bytes_sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			ROS_LOG_ERROR("[UnixSocketConnection] Failed to write to the socket: %s", strerror(errno));
+			stream_broken_ = true;
+			ReportError(rosbridge2cpp::TransportError::R2C_SOCKET_ERROR);
+			return false;
+		}
+
+		// The socket buffer is full, wait until rosbridge reads some of it
+		ROS_PROFILER_SCOPE("ROS::SocketWriteStall");
+		pollfd poll_fd;
+		poll_fd.fd = fd_;
+		poll_fd.events = POLLOUT;
+		poll_fd.revents = 0;
+		const int ready = poll(&poll_fd, 1, static_cast<int>(send_timeout_.count()));
+		if (ready < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ready <= 0) {
+			if (total_bytes_to_send < length) {
+				// rosbridge can't make sense of the rest of the stream anymore, let the health check reconnect
+				stream_broken_ = true;
+				ROS_LOG_ERROR("[UnixSocketConnection] rosbridge didn't read for %lld ms in the middle of a message, closing the connection",
+					static_cast<long long>(send_timeout_.count()));
+			}
+			else {
+				ROS_LOG_WARNING("[UnixSocketConnection] rosbridge didn't read for %lld ms, dropping a message of %u bytes",
+					static_cast<long long>(send_timeout_.count()), length);
+			}
+			ReportError(rosbridge2cpp::TransportError::R2C_SEND_STALLED);
+			return false;
+		}
+	}
+	return true;
+#endif
+}
+
+void UnixSocketConnection::ReceiverThreadFunction()
+{
+#if !defined(_WIN32)
+	ROS_PROFILER_THREAD_NAME("ROSBridgeReceiver");
+
+	// Reads everything that is available at once and splits it into messages afterwards,
+	// so a burst of small messages costs a single read
+	std::vector<uint8_t> buffer(1024 * 1024);
+	size_t num_buffered = 0;
+	rosbridge2cpp::CBORCodec::ItemScanner cbor_scanner; // continues an incomplete CBOR message where the last read stopped
+
+	while (run_receiver_thread_) {
+		pollfd poll_fd;
+		poll_fd.fd = fd_;
+		poll_fd.events = POLLIN;
+		poll_fd.revents = 0;
+		const int ready = poll(&poll_fd, 1, 1000);
+		if (ready == 0 || (ready < 0 && errno == EINTR)) {
+			continue; // check if we should stop
+		}
+
+		const ssize_t bytes_read = ready > 0 ? recv(fd_, buffer.data() + num_buffered, buffer.size() - num_buffered, 0) : -1;
+		if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			continue;
+		}
+		if (bytes_read <= 0) {
+			if (run_receiver_thread_) {
+				ROS_LOG_ERROR("[UnixSocketConnection] Connection to %s closed", socket_path_.c_str());
+				ReportError(bytes_read == 0 ? rosbridge2cpp::TransportError::R2C_CONNECTION_CLOSED : rosbridge2cpp::TransportError::R2C_SOCKET_ERROR);
+			}
+			break;
+		}
+		num_buffered += static_cast<size_t>(bytes_read);
+
+		size_t offset = 0;
+		size_t required_length = 0; // of an incomplete message at the end of the buffer
+		bool valid_stream = true;
+		while (num_buffered - offset >= 4) {
+			if (rosbridge2cpp::CBORCodec::IsMessage(buffer.data() + offset, num_buffered - offset)) {
+				// CBOR subscriptions, see ROSBridge::SetSubscriptionCompression
+				size_t message_length = 0;
+				const rosbridge2cpp::CBORCodec::ItemStatus status = cbor_scanner.Scan(buffer.data() + offset, num_buffered - offset, message_length);
+				if (status == rosbridge2cpp::CBORCodec::ItemStatus::INVALID || message_length > kMaxMessageLength) {
+					valid_stream = false;
+					break;
+				}
+				if (status == rosbridge2cpp::CBORCodec::ItemStatus::INCOMPLETE) {
+					required_length = message_length;
+					break;
+				}
+				cbor_scanner.Reset();
+
+				ROS_PROFILER_SCOPE("ROS::Receive");
+				bson_t b;
+				bool parsed;
+				bson_init(&b);
+				{
+					ROS_PROFILER_SCOPE("ROS::FrameParse");
+					parsed = rosbridge2cpp::CBORCodec::ToBSON(buffer.data() + offset, message_length, &b);
+				}
+				if (!parsed) {
+					ROS_LOG_ERROR("[UnixSocketConnection] Error on CBOR parse - Ignoring message");
+				}
+				else if (incoming_message_callback_bson_) {
+					bson_t view;
+					bson_init_static(&view, bson_get_data(&b), b.len);
+					incoming_message_callback_bson_(view);
+				}
+				bson_destroy(&b);
+				offset += message_length;
+				continue;
+			}
+
+			const uint32_t message_length = ReadLittleEndian32(buffer.data() + offset); // includes the 4 bytes of the length
+			if (message_length < MinBSONLength || message_length > kMaxMessageLength) {
+				valid_stream = false;
+				break;
+			}
+			if (num_buffered - offset < message_length) {
+				required_length = message_length;
+				break;
+			}
+
+			ROS_PROFILER_SCOPE("ROS::Receive");
+			bson_t b;
+			bool parsed;
+			{
+				ROS_PROFILER_SCOPE("ROS::FrameParse");
+				parsed = bson_init_static(&b, buffer.data() + offset, message_length);
+			}
+			if (!parsed) {
+				ROS_LOG_ERROR("[UnixSocketConnection] Error on BSON parse - Ignoring message");
+			}
+			else if (incoming_message_callback_bson_) {
+				incoming_message_callback_bson_(b);
+			}
+			offset += message_length;
+		}
+
+		if (!valid_stream) {
+			ROS_LOG_ERROR("[UnixSocketConnection] Received an invalid or too long message (more than %u bytes), closing the connection", kMaxMessageLength);
+			stream_broken_ = true;
+			ReportError(rosbridge2cpp::TransportError::R2C_SOCKET_ERROR);
+			break;
+		}
+
+		// keep the beginning of an incomplete message and make room for the rest of it
+		if (offset > 0) {
+			memmove(buffer.data(), buffer.data() + offset, num_buffered - offset);
+			num_buffered -= offset;
+		}
+		if (required_length > buffer.size()) {
+			// the length of a CBOR message is only known once it has been read completely, so grow in bigger steps
+			const size_t max_length = kMaxMessageLength;
+			buffer.resize(std::min(std::max(required_length, buffer.size() * 2), max_length));
+		}
+	}
+	run_receiver_thread_ = false;
+#endif
+}
+
+void UnixSocketConnection::RegisterIncomingMessageCallback(std::function<void(json&)> fun)
+{
+	incoming_message_callback_ = fun;
+}
+
+void UnixSocketConnection::RegisterIncomingMessageCallback(std::function<void(bson_t&)> fun)
+{
+	incoming_message_callback_bson_ = fun;
+}
+
+void UnixSocketConnection::RegisterErrorCallback(std::function<void(rosbridge2cpp::TransportError)> fun)
+{
+	error_callback_ = fun;
+}
+
+void UnixSocketConnection::ReportError(rosbridge2cpp::TransportError err)
+{
+	if (error_callback_)
+		error_callback_(err);
+}
+
+void UnixSocketConnection::SetTransportMode(rosbridge2cpp::ITransportLayer::TransportMode mode)
+{
+	bson_only_mode_ = mode == rosbridge2cpp::ITransportLayer::BSON;
+}
+
+bool UnixSocketConnection::IsHealthy() const
+{
+	return fd_ >= 0 && run_receiver_thread_ && !stream_broken_;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional> // std::function
+#include <string>
+#include <thread>
+
+#include "itransport_layer.h"
+#include "types.h"
+
+#include "rapidjson/document.h"
+using json = rapidjson::Document;
+
+/**
+ * Transport over a Unix domain stream socket, for a rosbridge server on the same host.
+ *
+ * Compared to TCPConnection over the loopback device, no checksums, segmentation or acknowledgements
+ * are involved, which saves a lot of CPU time for large messages like images. The framing is the same
+ * as the one of TCPConnection in BSON mode, so only the BSON mode is supported. Like there, CBOR messages of
+ * subscriptions with compression "cbor" are recognized in the stream and converted to BSON.
+ *
+ * Init() takes the path of the socket instead of an IP address, the port is ignored.
+ * Doesn't depend on the engine. Not available on Windows.
+ */
+class UnixSocketConnection : public rosbridge2cpp::ITransportLayer {
+public:
+	UnixSocketConnection() {}
+	~UnixSocketConnection();
+
+	bool Init(std::string socket_path, int port) override;
+	// A write that can't put any data into the socket buffer within this time is given up (R2C_SEND_STALLED),
+	// like in TCPConnection
+	void SetSendTimeout(std::chrono::milliseconds timeout) { send_timeout_ = timeout; }
+	// SO_SNDBUF and SO_RCVBUF in bytes, 0 keeps the default of the OS. Must be called before Init().
+	void SetSocketBufferSizes(int send_buffer_size, int receive_buffer_size) { send_buffer_size_ = send_buffer_size; receive_buffer_size_ = receive_buffer_size; }
+	bool SendMessage(std::string data) override;
+	bool SendMessage(const uint8_t *data, unsigned int length) override;
+	bool SupportsCoalescedWrites() const override { return true; }
+	void RegisterIncomingMessageCallback(std::function<void(json&)> fun) override;
+	void RegisterIncomingMessageCallback(std::function<void(bson_t&)> fun) override;
+	void RegisterErrorCallback(std::function<void(rosbridge2cpp::TransportError)> fun) override;
+	void ReportError(rosbridge2cpp::TransportError err) override;
+	void SetTransportMode(rosbridge2cpp::ITransportLayer::TransportMode mode) override;
+	void StopReceiving() override;
+
+	bool IsHealthy() const;
+
+private:
+	void ReceiverThreadFunction();
+
+	std::string socket_path_;
+	int fd_ = -1;
+	std::chrono::milliseconds send_timeout_ = std::chrono::milliseconds(1000);
+	int send_buffer_size_ = 0;
+	int receive_buffer_size_ = 0;
+	bool bson_only_mode_ = false;
+
+	std::thread receiver_thread_;
+	std::atomic<bool> run_receiver_thread_{ false };
+	std::atomic<bool> stream_broken_{ false }; // a stalled write left part of a message in the stream
+
+	std::function<void(json&)> incoming_message_callback_;
+	std::function<void(bson_t&)> incoming_message_callback_bson_;
+	std::function<void(rosbridge2cpp::TransportError)> error_callback_;
+};
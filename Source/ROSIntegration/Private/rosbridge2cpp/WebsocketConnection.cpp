@@ -1,6 +1,8 @@
 #include "WebsocketConnection.h"
 #include <iostream>
 #include "ROSIntegrationCore.h"
+#include "cbor_codec.h"
+#include "ros_profiling.h"
 #include "WebSocketsModule.h"  //moduel used to create websocket object in init 
 #include <iomanip>
 
@@ -8,6 +10,7 @@
 #if ENGINE_MINOR_VERSION < 23
 #include <IPAddress.h>
 #endif
+#include <Misc/ScopeLock.h>
 #include <Serialization/ArrayReader.h>
 #include <SocketSubsystem.h>
 
@@ -80,6 +83,7 @@ void WebsocketConnection::OnClosed(int32 StatusCode, const FString& Reason, bool
 
 bool WebsocketConnection::SendMessage(std::string data)
 {
+	ROS_PROFILER_SCOPE("ROS::SocketWrite");
 	//Data is already UTF-8, no conversion to UE4 string is necessary
 	WebSocket->Send(data.c_str(), data.size(), false);
 	return true;
@@ -87,18 +91,52 @@ bool WebsocketConnection::SendMessage(std::string data)
 
 bool WebsocketConnection::SendMessage(const uint8_t* data, unsigned int length)
 {
+	ROS_PROFILER_SCOPE("ROS::SocketWrite");
 	WebSocket->Send(data, length, true);
 	return true;
 }
 
+void WebsocketConnection::StopReceiving()
+{
+	FScopeLock Lock(&receive_lock_);
+	receiving_ = false;
+}
+
 void WebsocketConnection::OnRawMessage(const void* data, size_t size, size_t bytes_remaining)
 {
+	ROS_PROFILER_SCOPE("ROS::Receive");
+	FScopeLock Lock(&receive_lock_);
+	if (!receiving_) return;
 	if (bytes_remaining > 0) {
 		UE_LOG(LogROS, Warning, TEXT("Websocket message fragments not supported - Ignoring message"));
 		return;
 	}
+	if (rosbridge2cpp::CBORCodec::IsMessage(reinterpret_cast<const uint8_t*>(data), size)) {
+		// CBOR subscriptions, see ROSBridge::SetSubscriptionCompression
+		bson_t b;
+		bool parsed;
+		bson_init(&b);
+		{
+			ROS_PROFILER_SCOPE("ROS::FrameParse");
+			parsed = rosbridge2cpp::CBORCodec::ToBSON(reinterpret_cast<const uint8_t*>(data), size, &b);
+		}
+		if (!parsed) {
+			UE_LOG(LogROS, Error, TEXT("Error on CBOR parse - Ignoring message"));
+		} else if (incoming_message_callback_bson_) {
+			bson_t view;
+			bson_init_static(&view, bson_get_data(&b), b.len);
+			incoming_message_callback_bson_(view);
+		}
+		bson_destroy(&b);
+		return;
+	}
 	bson_t b;
-	if (!bson_init_static(&b, reinterpret_cast<const uint8_t*>(data), size)) {
+	bool parsed;
+	{
+		ROS_PROFILER_SCOPE("ROS::FrameParse");
+		parsed = bson_init_static(&b, reinterpret_cast<const uint8_t*>(data), size);
+	}
+	if (!parsed) {
 		UE_LOG(LogROS, Error, TEXT("Error on BSON parse - Ignoring message"));
 	} else if (incoming_message_callback_bson_) {
 		incoming_message_callback_bson_(b);
@@ -106,9 +144,15 @@ void WebsocketConnection::OnRawMessage(const void* data, size_t size, size_t byt
 }
 
 void WebsocketConnection::OnMessage(const FString& msg) {
+	ROS_PROFILER_SCOPE("ROS::Receive");
+	FScopeLock Lock(&receive_lock_);
+	if (!receiving_) return;
 	json j;
 	try {
-		j.Parse(TCHAR_TO_ANSI(*msg)); //convert to UTF-8 and then reinterpret_cast the pointer to char *
+		{
+			ROS_PROFILER_SCOPE("ROS::FrameParse");
+			j.Parse(TCHAR_TO_ANSI(*msg)); //convert to UTF-8 and then reinterpret_cast the pointer to char *
+		}
 
 		if (_incoming_message_callback)
 			_incoming_message_callback(j);
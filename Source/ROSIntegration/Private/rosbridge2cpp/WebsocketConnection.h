@@ -33,6 +33,7 @@ public:
 	void RegisterErrorCallback(std::function<void(rosbridge2cpp::TransportError)> fun);
 	void ReportError(rosbridge2cpp::TransportError err);
 	void SetTransportMode(rosbridge2cpp::ITransportLayer::TransportMode);
+	void StopReceiving();
 
 	bool IsHealthy() const;
 
@@ -46,6 +47,9 @@ private:
 	TSharedPtr<IWebSocket> WebSocket;
 
 	bool bson_only_mode_ = false;
+	// the messages arrive on the game thread, the bridge might stop receiving on another one
+	FCriticalSection receive_lock_;
+	bool receiving_ = true;
 	std::function<void(json&)> _incoming_message_callback;
 	std::function<void(bson_t&)> incoming_message_callback_bson_;
 	std::function<void(rosbridge2cpp::TransportError)> _error_callback;
@@ -0,0 +1,757 @@
+#include "cbor_codec.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace rosbridge2cpp {
+
+	// Major types, RFC 8949 3.1
+	static const uint8_t MajorUnsigned = 0;
+	static const uint8_t MajorNegative = 1;
+	static const uint8_t MajorBytes = 2;
+	static const uint8_t MajorText = 3;
+	static const uint8_t MajorArray = 4;
+	static const uint8_t MajorMap = 5;
+	static const uint8_t MajorTag = 6;
+	static const uint8_t MajorSimple = 7;
+
+	static const uint8_t IndefiniteLength = 31;
+	static const uint8_t Break = 0xFF;
+	static const uint8_t SimpleFalse = 0xF4;
+	static const uint8_t SimpleTrue = 0xF5;
+	static const uint8_t SimpleNull = 0xF6;
+	static const uint8_t Float32 = 0xFA;
+	static const uint8_t Float64 = 0xFB;
+
+	// RFC 8746 typed arrays are the tags 0b010fsell: float, signed, little endian, log2 of the element size
+	static const uint64_t FirstTypedArrayTag = 64;
+	static const uint64_t LastTypedArrayTag = 87;
+	static const uint64_t Uint8TypedArrayTag = 64;
+	static const uint64_t Uint8ClampedTypedArrayTag = 68;
+	static const uint64_t Sint32LittleEndianTag = 78;
+	static const uint64_t Sint64LittleEndianTag = 79;
+	static const uint64_t Float32LittleEndianTag = 85;
+	static const uint64_t Float64LittleEndianTag = 86;
+
+	static const int MaxDepth = 64; // nesting of arrays, maps and tags
+	static const uint64_t MaxLength = INT32_MAX; // of strings and containers, BSON can't hold more anyway
+
+	struct CBORCursor {
+		CBORCursor(const uint8_t *data, size_t available) : data_(data), available_(available) {}
+
+		CBORCodec::ItemStatus Incomplete(size_t needed)
+		{
+			needed_ = needed;
+			return CBORCodec::ItemStatus::INCOMPLETE;
+		}
+
+		const uint8_t *data_;
+		size_t available_;
+		size_t pos_ = 0;
+		size_t needed_ = 0; // lower bound of the item length after INCOMPLETE
+	};
+
+	struct CBORHeader {
+		uint8_t major_ = 0;
+		uint8_t info_ = 0; // additional information, the low 5 bits of the initial byte
+		uint64_t value_ = 0; // integer value, length, number of entries, tag or bits of a float
+		bool indefinite_ = false;
+	};
+
+	static uint64_t LoadUnsigned(const uint8_t *data, size_t size, bool little_endian)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < size; ++i) {
+			value = (value << 8) | data[little_endian ? size - 1 - i : i];
+		}
+		return value;
+	}
+
+	static CBORCodec::ItemStatus ReadHeader(CBORCursor &cursor, CBORHeader &header)
+	{
+		if (cursor.pos_ >= cursor.available_) {
+			return cursor.Incomplete(cursor.pos_ + 1);
+		}
+		const uint8_t initial = cursor.data_[cursor.pos_];
+		header.major_ = initial >> 5;
+		header.info_ = initial & 0x1F;
+		header.value_ = header.info_;
+		header.indefinite_ = false;
+
+		size_t argument_size = 0;
+		if (header.info_ >= 24 && header.info_ <= 27) {
+			argument_size = size_t(1) << (header.info_ - 24);
+		}
+		else if (header.info_ == IndefiniteLength) {
+			// Only strings, arrays and maps can have an indefinite length. A break is consumed by the container.
+			if (header.major_ < MajorBytes || header.major_ > MajorMap) {
+				return CBORCodec::ItemStatus::INVALID;
+			}
+			header.indefinite_ = true;
+		}
+		else if (header.info_ > 27) {
+			return CBORCodec::ItemStatus::INVALID;
+		}
+
+		if (cursor.available_ - cursor.pos_ - 1 < argument_size) {
+			return cursor.Incomplete(cursor.pos_ + 1 + argument_size);
+		}
+		if (argument_size > 0) {
+			header.value_ = LoadUnsigned(cursor.data_ + cursor.pos_ + 1, argument_size, false);
+		}
+		cursor.pos_ += 1 + argument_size;
+		return CBORCodec::ItemStatus::COMPLETE;
+	}
+
+	static CBORCodec::ItemStatus SkipBytes(CBORCursor &cursor, uint64_t length)
+	{
+		if (length > MaxLength) {
+			return CBORCodec::ItemStatus::INVALID;
+		}
+		if (cursor.available_ - cursor.pos_ < length) {
+			return cursor.Incomplete(cursor.pos_ + static_cast<size_t>(length));
+		}
+		cursor.pos_ += static_cast<size_t>(length);
+		return CBORCodec::ItemStatus::COMPLETE;
+	}
+
+	// Checks if a container has another entry, consumes the break at the end of an indefinite length container
+	static bool HasNextEntry(CBORCursor &cursor, const CBORHeader &container, uint64_t index)
+	{
+		if (!container.indefinite_) {
+			return index < container.value_;
+		}
+		if (cursor.pos_ < cursor.available_ && cursor.data_[cursor.pos_] == Break) {
+			++cursor.pos_;
+			return false;
+		}
+		return true; // without more data, reading the next entry reports what is missing
+	}
+
+	bool CBORCodec::IsMessage(const uint8_t *data, size_t length)
+	{
+		if (length < kDetectLength) {
+			return false;
+		}
+		const bool is_map = (data[0] >= 0xA1 && data[0] <= 0xB7) || data[0] == 0xBF; // 1 to 23 entries or indefinite
+		const bool is_key = data[1] >= 0x62 && data[1] <= 0x77; // text string of 2 to 23 bytes
+		return is_map && is_key && data[3] >= 0x20; // the second character of the key
+	}
+
+	CBORCodec::ItemStatus CBORCodec::GetItemLength(const uint8_t *data, size_t available, size_t &length)
+	{
+		ItemScanner scanner;
+		return scanner.Scan(data, available, length);
+	}
+
+	void CBORCodec::ItemScanner::Reset()
+	{
+		open_.clear();
+		pos_ = 0;
+		complete_ = false;
+	}
+
+	void CBORCodec::ItemScanner::ItemDone()
+	{
+		// a finished container is an item of the one around it
+		while (!open_.empty()) {
+			Container &container = open_.back();
+			if (container.indefinite_) {
+				++container.count_;
+				return;
+			}
+			if (--container.remaining_ > 0) {
+				return;
+			}
+			open_.pop_back();
+		}
+		complete_ = true;
+	}
+
+	CBORCodec::ItemStatus CBORCodec::ItemScanner::Scan(const uint8_t *data, size_t available, size_t &length)
+	{
+		CBORCursor cursor(data, available);
+		cursor.pos_ = pos_;
+
+		while (!complete_) {
+			// The position only advances past complete headers and strings, an incomplete one is read again
+			// with more data
+			if (cursor.pos_ >= available) {
+				length = cursor.pos_ + 1;
+				return ItemStatus::INCOMPLETE;
+			}
+
+			Container *parent = open_.empty() ? nullptr : &open_.back();
+			if (parent && parent->indefinite_ && data[cursor.pos_] == Break) {
+				if (parent->major_ == MajorMap && parent->count_ % 2 != 0) {
+					return ItemStatus::INVALID; // a key without a value
+				}
+				++cursor.pos_;
+				pos_ = cursor.pos_;
+				open_.pop_back();
+				ItemDone();
+				continue;
+			}
+			if (open_.size() > static_cast<size_t>(MaxDepth)) {
+				return ItemStatus::INVALID;
+			}
+
+			CBORHeader header;
+			ItemStatus status = ReadHeader(cursor, header);
+			if (status == ItemStatus::INCOMPLETE) {
+				length = cursor.needed_;
+				return status;
+			}
+			if (status == ItemStatus::INVALID) {
+				return status;
+			}
+
+			// the chunks of an indefinite length string are definite length strings of the same type
+			const bool in_string = parent && parent->indefinite_ && (parent->major_ == MajorBytes || parent->major_ == MajorText);
+			if (in_string && (header.major_ != parent->major_ || header.indefinite_)) {
+				return ItemStatus::INVALID;
+			}
+
+			switch (header.major_) {
+			case MajorBytes:
+			case MajorText:
+				if (header.indefinite_) {
+					open_.push_back(Container{ header.major_, true, 0, 0 });
+					break;
+				}
+				status = SkipBytes(cursor, header.value_);
+				if (status == ItemStatus::INCOMPLETE) {
+					length = cursor.needed_;
+					return status;
+				}
+				if (status == ItemStatus::INVALID) {
+					return status;
+				}
+				ItemDone();
+				break;
+
+			case MajorArray:
+			case MajorMap:
+				if (header.value_ > MaxLength) {
+					return ItemStatus::INVALID;
+				}
+				if (header.indefinite_) {
+					open_.push_back(Container{ header.major_, true, 0, 0 });
+				}
+				else if (header.value_ > 0) {
+					open_.push_back(Container{ header.major_, false, header.major_ == MajorMap ? header.value_ * 2 : header.value_, 0 });
+				}
+				else {
+					ItemDone();
+				}
+				break;
+
+			case MajorTag:
+				open_.push_back(Container{ header.major_, false, 1, 0 });
+				break;
+
+			default:
+				ItemDone(); // integers and simple values consist of their header
+				break;
+			}
+			pos_ = cursor.pos_;
+		}
+
+		length = pos_;
+		return ItemStatus::COMPLETE;
+	}
+
+	// Decoding
+
+	static double HalfToDouble(uint16_t half)
+	{
+		// RFC 8949, appendix D
+		const int exponent = (half >> 10) & 0x1F;
+		const int mantissa = half & 0x3FF;
+		double value;
+		if (exponent == 0) {
+			value = std::ldexp(mantissa, -24);
+		}
+		else if (exponent != 31) {
+			value = std::ldexp(mantissa + 1024, exponent - 25);
+		}
+		else {
+			value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+		}
+		return (half & 0x8000) ? -value : value;
+	}
+
+	static double BitsToDouble(uint64_t bits, size_t size)
+	{
+		if (size == 2) {
+			return HalfToDouble(static_cast<uint16_t>(bits));
+		}
+		if (size == 4) {
+			const uint32_t bits32 = static_cast<uint32_t>(bits);
+			float value;
+			memcpy(&value, &bits32, sizeof(value));
+			return value;
+		}
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Like the BSON encoder of rosbridge: int32 if the value fits, int64 otherwise
+	static bool AppendInteger(bson_t *b, const char *key, int key_length, int64_t value)
+	{
+		if (value >= INT32_MIN && value <= INT32_MAX) {
+			return bson_append_int32(b, key, key_length, static_cast<int32_t>(value));
+		}
+		return bson_append_int64(b, key, key_length, value);
+	}
+
+	// Points data at the content of a string. Chunks of an indefinite length string are joined in storage.
+	static bool ReadString(CBORCursor &cursor, const CBORHeader &header, std::string &storage, const uint8_t *&data, size_t &length)
+	{
+		if (!header.indefinite_) {
+			const size_t start = cursor.pos_;
+			if (SkipBytes(cursor, header.value_) != CBORCodec::ItemStatus::COMPLETE) {
+				return false;
+			}
+			data = cursor.data_ + start;
+			length = cursor.pos_ - start;
+			return true;
+		}
+
+		storage.clear();
+		for (uint64_t index = 0; HasNextEntry(cursor, header, index); ++index) {
+			CBORHeader chunk;
+			if (ReadHeader(cursor, chunk) != CBORCodec::ItemStatus::COMPLETE || chunk.major_ != header.major_ || chunk.indefinite_) {
+				return false;
+			}
+			const size_t start = cursor.pos_;
+			if (SkipBytes(cursor, chunk.value_) != CBORCodec::ItemStatus::COMPLETE || storage.size() + chunk.value_ > MaxLength) {
+				return false;
+			}
+			storage.append(reinterpret_cast<const char*>(cursor.data_ + start), cursor.pos_ - start);
+		}
+		data = reinterpret_cast<const uint8_t*>(storage.data());
+		length = storage.size();
+		return true;
+	}
+
+	// Writes the key of an array element, the decimal index with its terminator
+	static size_t WriteIndexKey(uint8_t *out, uint32_t index)
+	{
+		char digits[10];
+		size_t num_digits = 0;
+		do {
+			digits[num_digits++] = static_cast<char>('0' + index % 10);
+			index /= 10;
+		} while (index > 0);
+		for (size_t i = 0; i < num_digits; ++i) {
+			out[i] = static_cast<uint8_t>(digits[num_digits - 1 - i]);
+		}
+		out[num_digits] = 0;
+		return num_digits + 1;
+	}
+
+	static bool AppendTypedArray(bson_t *b, const char *key, int key_length, uint64_t tag, const uint8_t *data, size_t length)
+	{
+		if (tag == Uint8TypedArrayTag || tag == Uint8ClampedTypedArrayTag) {
+			return bson_append_binary(b, key, key_length, BSON_SUBTYPE_BINARY, data, static_cast<uint32_t>(length));
+		}
+
+		const unsigned format = static_cast<unsigned>(tag - FirstTypedArrayTag);
+		const bool is_float = (format & 0x10) != 0;
+		const bool is_signed = (format & 0x08) != 0;
+		const bool little_endian = (format & 0x04) != 0;
+		const unsigned size_exponent = format & 0x03;
+		if (is_float && size_exponent == 3) {
+			return false; // float128
+		}
+		const size_t element_size = is_float ? size_t(2) << size_exponent : size_t(1) << size_exponent;
+		if (length % element_size != 0) {
+			return false;
+		}
+
+		// The array document is written directly instead of element by element through libbson,
+		// which would be the bulk of the decoding time for a large array.
+		// Per element: type, key of up to 10 digits and its terminator, value of up to 8 bytes.
+		const size_t count = length / element_size;
+		if (count > (MaxLength - 5) / 20) {
+			return false;
+		}
+		std::vector<uint8_t> array(4 + count * 20 + 1);
+		uint8_t *out = array.data() + 4;
+		for (size_t index = 0; index < count; ++index) {
+			const uint64_t bits = LoadUnsigned(data + index * element_size, element_size, little_endian);
+			uint64_t value_bits;
+			size_t value_size = 8;
+			if (is_float) {
+				*out++ = BSON_TYPE_DOUBLE;
+				const double value = BitsToDouble(bits, element_size);
+				memcpy(&value_bits, &value, sizeof(value_bits));
+			}
+			else {
+				// uint64 values beyond INT64_MAX wrap around, BSON has no unsigned 64 bit type
+				const unsigned shift = static_cast<unsigned>(64 - element_size * 8);
+				const int64_t value = is_signed ? static_cast<int64_t>(bits << shift) >> shift : static_cast<int64_t>(bits);
+				const bool fits_int32 = value >= INT32_MIN && value <= INT32_MAX;
+				*out++ = fits_int32 ? BSON_TYPE_INT32 : BSON_TYPE_INT64;
+				value_bits = static_cast<uint64_t>(value);
+				value_size = fits_int32 ? 4 : 8;
+			}
+			out += WriteIndexKey(out, static_cast<uint32_t>(index));
+			for (size_t i = 0; i < value_size; ++i) {
+				*out++ = static_cast<uint8_t>(value_bits >> (i * 8));
+			}
+		}
+		*out++ = 0;
+
+		const size_t array_length = static_cast<size_t>(out - array.data());
+		for (size_t i = 0; i < 4; ++i) {
+			array[i] = static_cast<uint8_t>(array_length >> (i * 8));
+		}
+		bson_t array_document;
+		return bson_init_static(&array_document, array.data(), array_length) && bson_append_array(b, key, key_length, &array_document);
+	}
+
+	static bool AppendItem(CBORCursor &cursor, bson_t *b, const char *key, int key_length, int depth);
+
+	static bool AppendEntries(CBORCursor &cursor, const CBORHeader &container, bson_t *document, int depth)
+	{
+		std::string key_storage;
+		char index_buffer[16];
+		for (uint64_t index = 0; HasNextEntry(cursor, container, index); ++index) {
+			const char *key;
+			size_t key_length;
+			if (container.major_ == MajorArray) {
+				key_length = bson_uint32_to_string(static_cast<uint32_t>(index), &key, index_buffer, sizeof(index_buffer));
+			}
+			else {
+				CBORHeader key_header;
+				if (ReadHeader(cursor, key_header) != CBORCodec::ItemStatus::COMPLETE) {
+					return false;
+				}
+				if (key_header.major_ == MajorText) {
+					const uint8_t *key_data;
+					if (!ReadString(cursor, key_header, key_storage, key_data, key_length)) {
+						return false;
+					}
+					key = reinterpret_cast<const char*>(key_data);
+				}
+				else if (key_header.major_ == MajorUnsigned) {
+					key_storage = std::to_string(key_header.value_);
+					key = key_storage.c_str();
+					key_length = key_storage.size();
+				}
+				else {
+					return false;
+				}
+			}
+			if (!AppendItem(cursor, document, key, static_cast<int>(key_length), depth)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool AppendItem(CBORCursor &cursor, bson_t *b, const char *key, int key_length, int depth)
+	{
+		if (depth > MaxDepth) {
+			return false;
+		}
+
+		CBORHeader header;
+		if (ReadHeader(cursor, header) != CBORCodec::ItemStatus::COMPLETE) {
+			return false;
+		}
+
+		switch (header.major_) {
+		case MajorUnsigned:
+			return AppendInteger(b, key, key_length, static_cast<int64_t>(header.value_));
+
+		case MajorNegative:
+			return AppendInteger(b, key, key_length, header.value_ > static_cast<uint64_t>(INT64_MAX) ? INT64_MIN : -1 - static_cast<int64_t>(header.value_));
+
+		case MajorBytes:
+		case MajorText: {
+			std::string storage;
+			const uint8_t *data;
+			size_t length;
+			if (!ReadString(cursor, header, storage, data, length)) {
+				return false;
+			}
+			if (header.major_ == MajorBytes) {
+				return bson_append_binary(b, key, key_length, BSON_SUBTYPE_BINARY, data, static_cast<uint32_t>(length));
+			}
+			return bson_append_utf8(b, key, key_length, reinterpret_cast<const char*>(data), static_cast<int>(length));
+		}
+
+		case MajorArray:
+		case MajorMap: {
+			bson_t child;
+			const bool is_map = header.major_ == MajorMap;
+			if (!(is_map ? bson_append_document_begin(b, key, key_length, &child) : bson_append_array_begin(b, key, key_length, &child))) {
+				return false;
+			}
+			const bool success = AppendEntries(cursor, header, &child, depth + 1);
+			const bool ended = is_map ? bson_append_document_end(b, &child) : bson_append_array_end(b, &child);
+			return success && ended;
+		}
+
+		case MajorTag:
+			if (header.value_ >= FirstTypedArrayTag && header.value_ <= LastTypedArrayTag) {
+				CBORHeader content;
+				std::string storage;
+				const uint8_t *data;
+				size_t length;
+				if (ReadHeader(cursor, content) != CBORCodec::ItemStatus::COMPLETE || content.major_ != MajorBytes ||
+					!ReadString(cursor, content, storage, data, length)) {
+					return false;
+				}
+				return AppendTypedArray(b, key, key_length, header.value_, data, length);
+			}
+			return AppendItem(cursor, b, key, key_length, depth + 1); // other tags carry nothing the converters need
+
+		case MajorSimple:
+			switch (header.info_) {
+			case 20:
+				return bson_append_bool(b, key, key_length, false);
+			case 21:
+				return bson_append_bool(b, key, key_length, true);
+			case 25:
+				return bson_append_double(b, key, key_length, BitsToDouble(header.value_, 2));
+			case 26:
+				return bson_append_double(b, key, key_length, BitsToDouble(header.value_, 4));
+			case 27:
+				return bson_append_double(b, key, key_length, BitsToDouble(header.value_, 8));
+			default:
+				return bson_append_null(b, key, key_length); // null, undefined and unassigned simple values
+			}
+
+		default:
+			return false;
+		}
+	}
+
+	bool CBORCodec::ToBSON(const uint8_t *data, size_t length, bson_t *b)
+	{
+		CBORCursor cursor(data, length);
+		CBORHeader header;
+		if (ReadHeader(cursor, header) != ItemStatus::COMPLETE || header.major_ != MajorMap) {
+			return false;
+		}
+		return AppendEntries(cursor, header, b, 1) && cursor.pos_ == length;
+	}
+
+	// Encoding
+
+	static void WriteHeader(std::vector<uint8_t> &cbor, uint8_t major, uint64_t value)
+	{
+		const uint8_t initial = static_cast<uint8_t>(major << 5);
+		size_t argument_size;
+		if (value < 24) {
+			cbor.push_back(initial | static_cast<uint8_t>(value));
+			return;
+		}
+		else if (value <= 0xFF) {
+			cbor.push_back(initial | 24);
+			argument_size = 1;
+		}
+		else if (value <= 0xFFFF) {
+			cbor.push_back(initial | 25);
+			argument_size = 2;
+		}
+		else if (value <= 0xFFFFFFFF) {
+			cbor.push_back(initial | 26);
+			argument_size = 4;
+		}
+		else {
+			cbor.push_back(initial | 27);
+			argument_size = 8;
+		}
+		for (size_t i = argument_size; i > 0; --i) {
+			cbor.push_back(static_cast<uint8_t>(value >> ((i - 1) * 8)));
+		}
+	}
+
+	static void WriteInteger(std::vector<uint8_t> &cbor, int64_t value)
+	{
+		if (value >= 0) {
+			WriteHeader(cbor, MajorUnsigned, static_cast<uint64_t>(value));
+		}
+		else {
+			WriteHeader(cbor, MajorNegative, static_cast<uint64_t>(-1 - value));
+		}
+	}
+
+	static bool FitsFloat(double value)
+	{
+		if (std::isnan(value) || std::isinf(value)) {
+			return true;
+		}
+		return std::fabs(value) <= std::numeric_limits<float>::max() && static_cast<double>(static_cast<float>(value)) == value;
+	}
+
+	static uint64_t DoubleToBits(double value, bool as_float)
+	{
+		if (as_float) {
+			const float float_value = static_cast<float>(value);
+			uint32_t bits;
+			memcpy(&bits, &float_value, sizeof(bits));
+			return bits;
+		}
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	// Writes an array of numbers as typed array, returns false if the elements don't share a type that has one
+	static bool WriteTypedArray(std::vector<uint8_t> &cbor, const bson_t *array)
+	{
+		bson_iter_t iter;
+		if (!bson_iter_init(&iter, array)) {
+			return false;
+		}
+
+		uint64_t count = 0;
+		bool all_doubles = true;
+		bool all_integers = true;
+		bool fits_float = true;
+		bool fits_int32 = true;
+		while (bson_iter_next(&iter)) {
+			switch (bson_iter_type(&iter)) {
+			case BSON_TYPE_DOUBLE:
+				all_integers = false;
+				fits_float = fits_float && FitsFloat(bson_iter_double(&iter));
+				break;
+			case BSON_TYPE_INT32:
+				all_doubles = false;
+				break;
+			case BSON_TYPE_INT64:
+				all_doubles = false;
+				fits_int32 = false;
+				break;
+			default:
+				return false;
+			}
+			if (!all_doubles && !all_integers) {
+				return false;
+			}
+			++count;
+		}
+		if (count == 0) {
+			return false;
+		}
+
+		const size_t element_size = (all_doubles ? fits_float : fits_int32) ? 4 : 8;
+		const uint64_t tag = all_doubles ? (fits_float ? Float32LittleEndianTag : Float64LittleEndianTag) :
+			(fits_int32 ? Sint32LittleEndianTag : Sint64LittleEndianTag);
+		WriteHeader(cbor, MajorTag, tag);
+		WriteHeader(cbor, MajorBytes, count * element_size);
+
+		bson_iter_init(&iter, array);
+		while (bson_iter_next(&iter)) {
+			const uint64_t bits = all_doubles ? DoubleToBits(bson_iter_double(&iter), fits_float) : static_cast<uint64_t>(bson_iter_as_int64(&iter));
+			for (size_t i = 0; i < element_size; ++i) {
+				cbor.push_back(static_cast<uint8_t>(bits >> (i * 8)));
+			}
+		}
+		return true;
+	}
+
+	static void WriteDocument(std::vector<uint8_t> &cbor, const bson_t *document, bool is_array);
+
+	static void WriteValue(std::vector<uint8_t> &cbor, const bson_iter_t *iter)
+	{
+		switch (bson_iter_type(iter)) {
+		case BSON_TYPE_DOUBLE: {
+			const double value = bson_iter_double(iter);
+			const bool as_float = FitsFloat(value);
+			const uint64_t bits = DoubleToBits(value, as_float);
+			cbor.push_back(as_float ? Float32 : Float64);
+			for (size_t i = as_float ? 4 : 8; i > 0; --i) {
+				cbor.push_back(static_cast<uint8_t>(bits >> ((i - 1) * 8)));
+			}
+			break;
+		}
+		case BSON_TYPE_UTF8: {
+			uint32_t length;
+			const char *text = bson_iter_utf8(iter, &length);
+			WriteHeader(cbor, MajorText, length);
+			cbor.insert(cbor.end(), text, text + length);
+			break;
+		}
+		case BSON_TYPE_DOCUMENT:
+		case BSON_TYPE_ARRAY: {
+			const bool is_array = bson_iter_type(iter) == BSON_TYPE_ARRAY;
+			uint32_t length;
+			const uint8_t *data;
+			if (is_array) {
+				bson_iter_array(iter, &length, &data);
+			}
+			else {
+				bson_iter_document(iter, &length, &data);
+			}
+			bson_t child;
+			if (bson_init_static(&child, data, length)) {
+				WriteDocument(cbor, &child, is_array);
+			}
+			else {
+				cbor.push_back(SimpleNull);
+			}
+			break;
+		}
+		case BSON_TYPE_BINARY: {
+			bson_subtype_t subtype;
+			uint32_t length;
+			const uint8_t *data;
+			bson_iter_binary(iter, &subtype, &length, &data);
+			WriteHeader(cbor, MajorBytes, length);
+			cbor.insert(cbor.end(), data, data + length);
+			break;
+		}
+		case BSON_TYPE_BOOL:
+			cbor.push_back(bson_iter_bool(iter) ? SimpleTrue : SimpleFalse);
+			break;
+		case BSON_TYPE_INT32:
+			WriteInteger(cbor, bson_iter_int32(iter));
+			break;
+		case BSON_TYPE_INT64:
+			WriteInteger(cbor, bson_iter_int64(iter));
+			break;
+		default:
+			cbor.push_back(SimpleNull); // rosbridge doesn't send other types
+			break;
+		}
+	}
+
+	static void WriteDocument(std::vector<uint8_t> &cbor, const bson_t *document, bool is_array)
+	{
+		if (is_array && WriteTypedArray(cbor, document)) {
+			return;
+		}
+		WriteHeader(cbor, is_array ? MajorArray : MajorMap, bson_count_keys(document));
+
+		bson_iter_t iter;
+		if (!bson_iter_init(&iter, document)) {
+			return;
+		}
+		while (bson_iter_next(&iter)) {
+			if (!is_array) {
+				const char *key = bson_iter_key(&iter);
+				const size_t key_length = strlen(key);
+				WriteHeader(cbor, MajorText, key_length);
+				cbor.insert(cbor.end(), key, key + key_length);
+			}
+			WriteValue(cbor, &iter);
+		}
+	}
+
+	void CBORCodec::FromBSON(const bson_t *b, std::vector<uint8_t> &cbor)
+	{
+		cbor.clear();
+		cbor.reserve(b->len); // CBOR is hardly ever larger than BSON
+		WriteDocument(cbor, b, false);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <bson.h>
+
+namespace rosbridge2cpp {
+
+	/**
+	 * CBOR (RFC 8949) encoding of rosbridge messages, as sent by rosbridge for subscriptions with compression "cbor".
+	 *
+	 * Numeric arrays are RFC 8746 typed arrays there: the elements are packed back to back into a tagged byte string
+	 * (e.g. float32[] of a LaserScan is tag 85 with 4 bytes per element), so they are much smaller than the BSON
+	 * arrays with their type byte and "0", "1", ... key per element. uint8[] fields are plain byte strings.
+	 *
+	 * Incoming CBOR messages are converted to BSON, so everything behind the transport (ROSBridge, the message
+	 * converters) handles them like any other BSON message:
+	 *   - uint8 typed arrays (tag 64 and 68) and byte strings become BSON binary fields
+	 *   - the other typed arrays become BSON arrays of int32/int64 or double elements
+	 *   - integers become int32 if they fit, int64 otherwise, like the BSON encoder of rosbridge does
+	 *   - float16/32/64 become double, other tags are skipped and their content is used as is
+	 *
+	 * Doesn't depend on the engine.
+	 */
+	class CBORCodec {
+	public:
+		enum class ItemStatus { COMPLETE, INCOMPLETE, INVALID };
+
+		// Number of bytes IsMessage() needs to tell a CBOR message from a length prefixed BSON document
+		static const size_t kDetectLength = 4;
+
+		// True if data starts with a CBOR map whose first key is a text string of at least two characters,
+		// e.g. "op". Read as the length prefix of a BSON document, these bytes would announce more than 512 MB,
+		// so both encodings can share a stream.
+		static bool IsMessage(const uint8_t *data, size_t length);
+
+		// Determines the length of the CBOR item at the start of data.
+		//  - COMPLETE:   length is the size of the item in bytes
+		//  - INCOMPLETE: more data is needed, the item is at least length bytes long. Reading exactly up to
+		//                that length never reads into the next message.
+		//  - INVALID:    the data isn't well formed CBOR (or nested too deep)
+		static ItemStatus GetItemLength(const uint8_t *data, size_t available, size_t &length);
+
+		// GetItemLength() for an item that arrives in pieces. Scan() continues where the previous call stopped, so
+		// every byte is looked at once no matter how many reads the item takes. data has to start with the item in
+		// every call and hold at least as much of it as in the previous one. Reset() before the next item.
+		class ItemScanner {
+		public:
+			ItemStatus Scan(const uint8_t *data, size_t available, size_t &length);
+			void Reset();
+
+		private:
+			struct Container {
+				uint8_t major_;
+				bool indefinite_;
+				uint64_t remaining_; // items of a definite length container (keys and values of a map) or a tag
+				uint64_t count_; // items read of an indefinite length container
+			};
+
+			void ItemDone();
+
+			std::vector<Container> open_; // containers whose end hasn't been read yet, innermost last
+			size_t pos_ = 0; // of the next header
+			bool complete_ = false;
+		};
+
+		// Decodes a complete CBOR map into the initialized, empty document b.
+		// The incoming message callbacks may call bson_destroy() on the document they get (they expect the static
+		// documents of BSON messages), so hand them a bson_init_static() view of b instead of b itself.
+		static bool ToBSON(const uint8_t *data, size_t length, bson_t *b);
+
+		// Encodes a BSON document like rosbridge would: arrays of doubles become float32 typed arrays if every
+		// element survives the round trip through float (the fields came from float32[] then), float64 typed arrays
+		// otherwise. Arrays of int32 (int64) become sint32 (sint64) typed arrays, binary fields byte strings.
+		static void FromBSON(const bson_t *b, std::vector<uint8_t> &cbor);
+	};
+}
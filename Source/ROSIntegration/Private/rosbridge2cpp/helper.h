@@ -5,6 +5,8 @@
 #include "rapidjson/stringbuffer.h"
 #include <bson.h>
 
+#include "ros_log.h"
+
 using json = rapidjson::Document;
 namespace rosbridge2cpp {
 	class Helper {
@@ -93,7 +95,7 @@ namespace rosbridge2cpp {
 			if (bson_iter_init(&iter, &b) &&
 				bson_iter_find_descendant(&iter, dot_notation, &val)) {
 				if (!BSON_ITER_HOLDS_DOUBLE(&val)) {
-					std::cout << "Key found, but not double typed" << std::endl;
+					ROS_LOG_VERBOSE("[Helper] Key %s found, but not double typed", dot_notation);
 				}
 				else {
 					//std::cout << "Key " << dot_notation << " found. success is = " << success << std::endl;
@@ -103,7 +105,7 @@ namespace rosbridge2cpp {
 					return bson_iter_double(&val);
 				}
 			}
-			std::cout << "Couldn't find descendant" << std::endl;
+			ROS_LOG_VERBOSE("[Helper] Couldn't find descendant %s", dot_notation);
 			success = false;
 			return -1.0;
 		}
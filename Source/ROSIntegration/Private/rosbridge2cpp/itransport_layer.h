@@ -15,6 +15,9 @@ namespace rosbridge2cpp {
 	public:
 		enum TransportMode { JSON, BSON };
 		virtual ~ITransportLayer() = default;
+
+		// Longest incoming BSON or CBOR message. A longer one is taken for a broken stream instead of waiting for it.
+		static const uint32_t kMaxMessageLength = 1024u * 1024u * 1024u;
 		
 		// Initialize the TransportLayer by connecting to the given IP and port
 		// The implementing class should have an active connection to IP:port
@@ -28,12 +31,21 @@ namespace rosbridge2cpp {
 		// Send a string over the underlying transport mechanism to the rosbridge server
 		virtual bool SendMessage(const uint8_t *data, unsigned int length) = 0;
 
+		// True if several BSON messages may be written with a single SendMessage call. That's the case for byte
+		// streams like TCP, where the server splits the data into messages by their length, but not for transports
+		// that deliver every write as one message (e.g. a websocket frame).
+		virtual bool SupportsCoalescedWrites() const { return false; }
+
 		// Register a std::function that will be called whenever a new data packet has been received by this TransportLayer.
 		virtual void RegisterIncomingMessageCallback(std::function<void(json&)>) = 0;
 
 		// Register a std::function that will be called whenever a new data packet has been received by this TransportLayer.
 		virtual void RegisterIncomingMessageCallback(std::function<void(bson_t&)>) = 0;
 
+		// Stop calling the incoming message callbacks. None of them is running anymore when this returns,
+		// sending is still possible. The ROSBridge calls it before it tears itself down.
+		virtual void StopReceiving() {}
+
 		// Register a std::function that will be called when errors occur.
 		virtual void RegisterErrorCallback(std::function<void(TransportError)>) = 0;
 
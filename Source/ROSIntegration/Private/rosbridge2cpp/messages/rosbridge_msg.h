@@ -84,14 +84,14 @@ public:
 	bool FromJSON(const rapidjson::Document &data)
 	{
 		if (!data.HasMember("op")) {
-			std::cerr << "[ROSBridgeMsg] Received message without 'op' field" << std::endl;
+			ROS_LOG_ERROR("[ROSBridgeMsg] Received message without 'op' field");
 			return false;
 		}
 
 		std::string op_code = data["op"].GetString();
 		auto mapping_iterator = op_code_mapping.find(op_code);
 		if (mapping_iterator == op_code_mapping.end()) {
-			std::cerr << "[ROSBridgeMsg] Received message with invalid 'op' field: " << op_code << std::endl;
+			ROS_LOG_ERROR("[ROSBridgeMsg] Received message with invalid 'op' field: %s", op_code.c_str());
 			return false;
 		}
 
@@ -108,7 +108,7 @@ public:
 	bool FromBSON(bson_t &bson)
 	{
 		if (!bson_has_field(&bson, "op")) {
-			std::cerr << "[ROSBridgeMsg] Received message without 'op' field" << std::endl;
+			ROS_LOG_ERROR("[ROSBridgeMsg] Received message without 'op' field");
 			return false;
 		}
 
@@ -119,7 +119,7 @@ public:
 
 		auto mapping_iterator = op_code_mapping.find(op_code);
 		if (mapping_iterator == op_code_mapping.end()) {
-			std::cerr << "[ROSBridgeMsg] Received message with invalid 'op' field: " << op_code << std::endl;
+			ROS_LOG_ERROR("[ROSBridgeMsg] Received message with invalid 'op' field: %s", op_code.c_str());
 			return false;
 		}
 
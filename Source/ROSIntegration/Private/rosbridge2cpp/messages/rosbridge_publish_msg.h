@@ -3,6 +3,8 @@
 #include <iostream>
 
 #include "messages/rosbridge_msg.h"
+#include "ros_latency_tracer.h"
+#include "ros_metrics.h"
 
 class ROSBridgePublishMsg : public ROSBridgeMsg {
 public:
@@ -33,14 +35,14 @@ public:
 			return false;
 
 		if (!data.HasMember("topic")) {
-			std::cerr << "[ROSBridgePublishMsg] Received 'publish' message without 'topic' field." << std::endl; // TODO: use generic logging
+			ROS_LOG_ERROR("[ROSBridgePublishMsg] Received 'publish' message without 'topic' field.");
 			return false;
 		}
 
 		topic_ = data["topic"].GetString();
 
 		if (!data.HasMember("msg")) {
-			std::cerr << "[ROSBridgePublishMsg] Received 'publish' message without 'msg' field." << std::endl;
+			ROS_LOG_ERROR("[ROSBridgePublishMsg] Received 'publish' message without 'msg' field.");
 			return false;
 		}
 
@@ -55,7 +57,7 @@ public:
 			return false;
 
 		if (!bson_has_field(&bson, "topic")) {
-			std::cerr << "[ROSBridgePublishMsg] Received 'publish' message without 'topic' field." << std::endl;
+			ROS_LOG_ERROR("[ROSBridgePublishMsg] Received 'publish' message without 'topic' field.");
 			return false;
 		}
 
@@ -65,7 +67,7 @@ public:
 		key_found = false;
 
 		if (!bson_has_field(&bson, "msg")) {
-			std::cerr << "[ROSBridgePublishMsg] Received 'publish' message without 'msg' field." << std::endl;
+			ROS_LOG_ERROR("[ROSBridgePublishMsg] Received 'publish' message without 'msg' field.");
 			return false;
 		}
 
@@ -102,7 +104,7 @@ public:
 
 		BSON_APPEND_BOOL(&bson, "latch", latch_);
 		if (msg_bson_ != nullptr && !BSON_APPEND_DOCUMENT(&bson, "msg", msg_bson_)) {
-			std::cerr << "Error while appending 'msg' bson to messge BSON" << std::endl;
+			ROS_LOG_ERROR("Error while appending 'msg' bson to message BSON");
 		}
 	}
 
@@ -129,6 +131,19 @@ public:
 	// might get modified.
 	bson_t *full_msg_bson_ = nullptr;
 
+	// Pipeline timestamps for latency tracing. Not part of the wire representation.
+	rosbridge2cpp::MessageTrace trace_;
+
+	// Counters of the topic, set by the ROSBridge for received messages. Not part of the wire representation.
+	rosbridge2cpp::TopicMetrics* metrics_ = nullptr;
+
+	// Size of the received message in bytes, set by the ROSBridge. Not part of the wire representation.
+	size_t size_ = 0;
+
+	// Slots of the ROSBridge's SharedMemoryRing that hold payloads of msg_bson_, freed if the message is dropped
+	// before it is sent. Not part of the wire representation.
+	uint64_t payload_slots_ = 0;
+
 private:
 	/* data */
 };
@@ -34,14 +34,14 @@ public:
 			return false;
 
 		if (!data.HasMember("service")) {
-			std::cerr << "[ROSBridgeServiceResponseMsg] Received 'service_response' message without 'service' field." << std::endl; // TODO: use generic logging
+			ROS_LOG_ERROR("[ROSBridgeServiceResponseMsg] Received 'service_response' message without 'service' field.");
 			return false;
 		}
 
 		service_ = data["service"].GetString();
 
 		if (!data.HasMember("result")) {
-			std::cerr << "[ROSBridgeServiceResponseMsg] Received 'service_response' message without 'result' field." << std::endl;
+			ROS_LOG_ERROR("[ROSBridgeServiceResponseMsg] Received 'service_response' message without 'result' field.");
 			return false;
 		}
 
@@ -62,7 +62,7 @@ public:
 			return false;
 
 		if (!bson_has_field(&bson, "service")) {
-			std::cerr << "[ROSBridgeServiceResponseMsg] Received 'service_response' message without 'service' field." << std::endl;
+			ROS_LOG_ERROR("[ROSBridgeServiceResponseMsg] Received 'service_response' message without 'service' field.");
 			return false;
 		}
 
@@ -72,7 +72,7 @@ public:
 		key_found = false;
 
 		if (!bson_has_field(&bson, "result")) {
-			std::cerr << "[ROSBridgeServiceResponseMsg] Received 'service_response' message without 'result' field." << std::endl;
+			ROS_LOG_ERROR("[ROSBridgeServiceResponseMsg] Received 'service_response' message without 'result' field.");
 			return false;
 		}
 
@@ -112,7 +112,7 @@ public:
 
 		BSON_APPEND_BOOL(&bson, "result", result_);
 		if (values_bson_ != nullptr && !BSON_APPEND_DOCUMENT(&bson, "values", values_bson_)) {
-			std::cerr << "Error while appending 'values' bson to messge BSON" << std::endl;
+			ROS_LOG_ERROR("Error while appending 'values' bson to message BSON");
 		}
 	}
 
@@ -33,6 +33,7 @@ public:
 		add_if_value_changed(d, alloc, "queue_length", queue_length_);
 		add_if_value_changed(d, alloc, "throttle_rate", throttle_rate_);
 		add_if_value_changed(d, alloc, "compression", compression_);
+		add_if_value_changed(d, alloc, "fragment_size", fragment_size_);
 
 		return d;
 	}
@@ -47,6 +48,7 @@ public:
 		add_if_value_changed(bson, "queue_length", queue_length_);
 		add_if_value_changed(bson, "throttle_rate", throttle_rate_);
 		add_if_value_changed(bson, "compression", compression_);
+		add_if_value_changed(bson, "fragment_size", fragment_size_);
 	}
 
 	std::string topic_;
@@ -54,6 +56,7 @@ public:
 	int queue_length_ = -1;
 	int throttle_rate_ = -1;
 	std::string compression_;
+	int fragment_size_ = -1;
 private:
 	/* data */
 };
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace rosbridge2cpp {
+
+	/**
+	 * Cursor over a message in the ROS1 serialization format, as sent by rosbridge for subscriptions with
+	 * compression "cbor-raw" (the "bytes" field of the message):
+	 *   - fixed size fields are packed little endian without padding, bool is a single byte
+	 *   - strings and variable length arrays are prefixed with their number of elements as uint32
+	 *   - fixed length arrays (e.g. float64[36] covariance) have no prefix
+	 *
+	 * Reading past the end doesn't throw, it sets the cursor into the failed state and returns zeroes, so a
+	 * decoder can read a whole message and check Ok() once at the end.
+	 * Arrays are copied with memcpy, which assumes a little endian host like every platform the plugin supports.
+	 *
+	 * Doesn't depend on the engine.
+	 */
+	class ROS1Reader {
+	public:
+		ROS1Reader(const uint8_t *data, size_t length) : data_(data), end_(data + length) {}
+
+		bool Ok() const { return !failed_; }
+		size_t Remaining() const { return failed_ ? 0 : static_cast<size_t>(end_ - data_); }
+
+		template <typename T>
+		T Read()
+		{
+			T value;
+			if (!Take(sizeof(T))) {
+				std::memset(&value, 0, sizeof(T));
+				return value;
+			}
+			std::memcpy(&value, data_ - sizeof(T), sizeof(T));
+			return value;
+		}
+
+		bool ReadBool() { return Read<uint8_t>() != 0; }
+
+		// Copies count elements of a fixed length array into out
+		template <typename T>
+		void ReadFixedArray(T *out, uint32_t count)
+		{
+			const size_t size = sizeof(T) * count;
+			if (!Take(size)) {
+				std::memset(out, 0, size);
+				return;
+			}
+			std::memcpy(out, data_ - size, size);
+		}
+
+		// Reads the length prefix of a variable length array of elements of element_size bytes and returns a
+		// pointer to the (possibly unaligned) elements inside the message, or nullptr if they don't fit into it.
+		// element_size 0 skips the check, for arrays of variable size elements like strings or sub-messages.
+		const uint8_t* ReadArray(uint32_t &count, size_t element_size)
+		{
+			count = Read<uint32_t>();
+			if (failed_) return nullptr;
+
+			if (element_size > 0 && count > Remaining() / element_size) {
+				failed_ = true;
+				count = 0;
+				return nullptr;
+			}
+			const uint8_t *elements = data_;
+			data_ += count * element_size;
+			return elements;
+		}
+
+		// A string is an array of chars, not terminated by \0
+		const char* ReadString(uint32_t &length)
+		{
+			return reinterpret_cast<const char*>(ReadArray(length, 1));
+		}
+
+	private:
+		bool Take(size_t size)
+		{
+			if (failed_ || size > static_cast<size_t>(end_ - data_)) {
+				failed_ = true;
+				return false;
+			}
+			data_ += size;
+			return true;
+		}
+
+		const uint8_t *data_;
+		const uint8_t *end_;
+		bool failed_ = false;
+	};
+}
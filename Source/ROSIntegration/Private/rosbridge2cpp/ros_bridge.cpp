@@ -1,15 +1,36 @@
 
 #include "ros_bridge.h"
+#include "ros_log.h"
+#include "ros_profiling.h"
 #include "ros_topic.h"
 #include <bson.h>
 
+#include <algorithm>
+#include <iterator>
+
 namespace rosbridge2cpp {
 
 	static const std::chrono::seconds SendThreadFreezeTimeout = std::chrono::seconds(5);
+	static const size_t MaxServiceRequestBacklog = 256; // per advertised service
 	unsigned long ROSCallbackHandle_id_counter = 1;
+	std::atomic<uint64_t> ROSBridge::connection_id_counter_{ 0 };
 
 	ROSBridge::~ROSBridge()
 	{
+		// no new service requests can arrive once the receiver stopped, so none of them is left to the pool
+		transport_layer_.StopReceiving();
+		service_worker_pool_.Stop();
+
+		{
+			std::lock_guard<std::mutex> lock(service_call_timer_mutex_);
+			run_service_call_timer_thread_ = false;
+		}
+		service_call_timer_cv_.notify_one();
+		if (service_call_timer_thread_.joinable())
+		{
+			service_call_timer_thread_.join();
+		}
+
 		run_publisher_queue_thread_ = false;
 		if (publisher_queue_thread_.joinable())
 		{
@@ -24,41 +45,72 @@ namespace rosbridge2cpp {
 			}
 		}
 
+		// nobody is going to write the batched control messages anymore
+		for (auto& batched : control_batch_)
+		{
+			if (batched.on_result_)
+			{
+				batched.on_result_(false);
+			}
+		}
+
 		for (auto& queue : publisher_queues_)
 		{
 			while (queue.size())
 			{
-				bson_t* bson = queue.front();
+				bson_t* bson = queue.front().bson_;
 				queue.pop();
 				bson_destroy(bson);
 			}
 		}
+
+		// nobody is going to answer the pending service calls anymore
+		for (auto& pending_service_call : registered_service_callbacks_.TakeAll())
+		{
+			if (pending_service_call.second.error_callback_)
+			{
+				pending_service_call.second.error_callback_(ServiceCallError::CONNECTION_CLOSED);
+			}
+		}
 	}
 
 	bool ROSBridge::SendMessage(std::string data) {
+		if (control_batch_size_.load(std::memory_order_relaxed)) {
+			FlushControlMessages();
+		}
+
+		ROS_PROFILER_SCOPE("ROS::SocketSend");
 		spinlock::scoped_lock_wait_for_short_task lock(transport_layer_access_mutex_);
-		return transport_layer_.SendMessage(data);
+		const bool success = transport_layer_.SendMessage(data);
+		CountSentMessage(success, data.size());
+		return success;
 	}
 
 	bool ROSBridge::SendMessage(json &data)
 	{
 		if (bson_only_mode()) {
+			if (control_batch_size_.load(std::memory_order_relaxed)) {
+				FlushControlMessages();
+			}
+
 			// going from JSON to BSON
 			std::string str_repr = Helper::get_string_from_rapidjson(data);
-			std::cout << "[ROSBridge] serializing from JSON to BSON for: " << str_repr << std::endl;
+			ROS_LOG_VERBOSE("[ROSBridge] serializing from JSON to BSON for: %s", str_repr.c_str());
 			// return transport_layer_.SendMessage(data,length);
 
 			bson_t bson;
 			bson_error_t error;
 			if (!bson_init_from_json(&bson, str_repr.c_str(), -1, &error)) {
-				printf("bson_init_from_json() failed: %s\n", error.message);
+				ROS_LOG_ERROR("[ROSBridge] bson_init_from_json() failed: %s", error.message);
 				bson_destroy(&bson);
 				return false;
 			}
 			const uint8_t *bson_data = bson_get_data(&bson);
 			uint32_t bson_size = bson.len;
+			ROS_PROFILER_SCOPE("ROS::SocketSend");
 			spinlock::scoped_lock_wait_for_short_task lock(transport_layer_access_mutex_);
 			bool retval = transport_layer_.SendMessage(bson_data, bson_size);
+			CountSentMessage(retval, bson_size);
 			bson_destroy(&bson);
 			return retval;
 		}
@@ -71,26 +123,32 @@ namespace rosbridge2cpp {
 	bool ROSBridge::SendMessage(ROSBridgeMsg &msg)
 	{
 		if (bson_only_mode()) {
+			if (control_batch_size_.load(std::memory_order_relaxed)) {
+				FlushControlMessages();
+			}
+
 			bson_t* message = bson_new();
 			msg.ToBSON(*message);
 			//size_t offset;
 
 			const uint8_t *bson_data = bson_get_data(message);
 			uint32_t bson_size = message->len;
+			ROS_PROFILER_SCOPE("ROS::SocketSend");
 			spinlock::scoped_lock_wait_for_short_task lock(transport_layer_access_mutex_);
 			bool retval = transport_layer_.SendMessage(bson_data, bson_size);
+			CountSentMessage(retval, bson_size);
 			bson_destroy(message);
 			return retval;
 
 			// // going from JSON to BSON
 			// std::string str_repr = Helper::get_string_from_rapidjson(data);
-			// std::cout << "[ROSBridge] serializing from JSON to BSON for: " << str_repr << std::endl;
+			// ROS_LOG_VERBOSE("[ROSBridge] serializing from JSON to BSON for: %s", str_repr.c_str());
 			// // return transport_layer_.SendMessage(data,length);
 			//
 			// bson_t bson;
 			// bson_error_t error;
 			// if (!bson_init_from_json(&bson, str_repr.c_str(), -1, &error)) {
-			//   printf("bson_init_from_json() failed: %s\n", error.message);
+			//   ROS_LOG_ERROR("[ROSBridge] bson_init_from_json() failed: %s", error.message);
 			//   bson_destroy(&bson);
 			//   return false;
 			// }
@@ -111,35 +169,182 @@ namespace rosbridge2cpp {
 		return SendMessage(str_repr);
 	}
 
+	bool ROSBridge::SendControlMessage(ROSBridgeMsg &msg, FunVBool on_result)
+	{
+		// Without the publisher queue thread nobody would flush the batch
+		if (!batch_control_messages_ || !run_publisher_queue_thread_) {
+			const bool success = SendMessage(msg);
+			if (on_result) {
+				on_result(success);
+			}
+			return success;
+		}
+
+		ROS_PROFILER_SCOPE("ROS::BatchControlMessage");
+		BatchedControlMessage batched;
+		if (bson_only_mode()) {
+			bson_t* message = bson_new();
+			msg.ToBSON(*message);
+			batched.data_.assign(reinterpret_cast<const char*>(bson_get_data(message)), message->len);
+			bson_destroy(message);
+		}
+		else {
+			json alloc;
+			json message = msg.ToJSON(alloc.GetAllocator());
+			batched.data_ = Helper::get_string_from_rapidjson(message);
+		}
+		batched.on_result_ = std::move(on_result);
+
+		spinlock::scoped_lock_wait_for_short_task lock(control_batch_mutex_);
+		control_batch_.push_back(std::move(batched));
+		control_batch_size_.store(control_batch_.size(), std::memory_order_relaxed);
+		return true;
+	}
+
+	size_t ROSBridge::FlushControlMessages()
+	{
+		if (!control_batch_size_.load(std::memory_order_relaxed)) {
+			return 0;
+		}
+
+		std::vector<BatchedControlMessage> batch;
+		std::vector<bool> results;
+		size_t num_failed = 0;
+		{
+			ROS_PROFILER_SCOPE("ROS::FlushControlMessages");
+			// Hold the transport while taking the batch, so a concurrent send can't overtake the batch we're writing
+			spinlock::scoped_lock_wait_for_long_task lock(transport_layer_access_mutex_);
+			{
+				spinlock::scoped_lock_wait_for_short_task batch_lock(control_batch_mutex_);
+				batch.swap(control_batch_);
+				control_batch_size_.store(0, std::memory_order_relaxed);
+			}
+			if (batch.empty()) {
+				return 0;
+			}
+
+			if (bson_only_mode() && transport_layer_.SupportsCoalescedWrites()) {
+				size_t num_bytes = 0;
+				for (const auto& batched : batch) {
+					num_bytes += batched.data_.size();
+				}
+				std::string data;
+				data.reserve(num_bytes);
+				for (const auto& batched : batch) {
+					data.append(batched.data_);
+				}
+
+				const bool success = transport_layer_.SendMessage(reinterpret_cast<const uint8_t*>(data.data()), static_cast<unsigned int>(data.size()));
+				for (const auto& batched : batch) {
+					CountSentMessage(success, batched.data_.size());
+				}
+				results.assign(batch.size(), success);
+				num_failed = success ? 0 : batch.size();
+			}
+			else {
+				results.reserve(batch.size());
+				for (const auto& batched : batch) {
+					const bool success = bson_only_mode() ?
+						transport_layer_.SendMessage(reinterpret_cast<const uint8_t*>(batched.data_.data()), static_cast<unsigned int>(batched.data_.size())) :
+						transport_layer_.SendMessage(batched.data_);
+					CountSentMessage(success, batched.data_.size());
+					results.push_back(success);
+					if (!success) ++num_failed;
+				}
+			}
+		}
+
+		if (num_failed > 0) {
+			ROS_LOG_WARNING("[ROSBridge] Failed to write %zu of %zu batched control messages", num_failed, batch.size());
+		}
+
+		// outside of the lock, the callbacks may send messages themselves
+		for (size_t i = 0; i < batch.size(); ++i) {
+			if (batch[i].on_result_) {
+				batch[i].on_result_(results[i]);
+			}
+		}
+		return batch.size();
+	}
+
+	void ROSBridge::CountSentMessage(bool success, size_t num_bytes, TopicMetrics* topic_metrics, int64_t send_time_ns)
+	{
+		ConnectionMetrics& connection_metrics = metrics_.GetConnectionMetrics();
+		if (!success) {
+			connection_metrics.send_errors_.Add();
+			if (topic_metrics) topic_metrics->dropped_.Add();
+			return;
+		}
+
+		connection_metrics.messages_sent_.Add();
+		connection_metrics.bytes_sent_.Add(num_bytes);
+		if (topic_metrics) {
+			topic_metrics->sent_.Add();
+			topic_metrics->bytes_out_.Add(num_bytes);
+			topic_metrics->send_time_ns_.Add(static_cast<uint64_t>(send_time_ns));
+		}
+	}
+
 	bool ROSBridge::QueueMessage(const std::string& topic_name, int queue_size, ROSBridgePublishMsg& msg)
 	{
+		ROS_PROFILER_SCOPE("ROS::Enqueue");
 		assert(bson_only_mode_); // queueing is not supported for json data
 
 		if (!run_publisher_queue_thread_)
 		{
+			TopicMetrics* topic_metrics = metrics_.GetTopicMetrics(topic_name);
+			topic_metrics->published_.Add();
+			topic_metrics->dropped_.Add();
+			ReleasePayloadSlots(msg.payload_slots_);
 			return false;
 		}
 
 		bson_t* message = bson_new();
 		msg.ToBSON(*message);
+		ROS_PROFILER_MESSAGE("out", topic_name.c_str(), message->len);
+
+		MessageTrace trace = msg.trace_;
+		if (latency_tracer_.IsEnabled())
+		{
+			if (!trace.topic_latency_)
+			{
+				trace.topic_latency_ = latency_tracer_.GetTopicLatency(topic_name);
+			}
+			trace.queued_ns_ = LatencyTracer::Now();
+			if (trace.converted_ns_)
+			{
+				trace.topic_latency_->Record(LatencySegment::ENQUEUE, trace.queued_ns_ - trace.converted_ns_);
+			}
+		}
+		else
+		{
+			trace.topic_latency_ = nullptr;
+		}
 
 		{
 			spinlock::scoped_lock_wait_for_short_task lock(change_publisher_queues_mutex_);
 			if (publisher_topics_.find(topic_name) == publisher_topics_.end())
 			{
 				publisher_topics_[topic_name] = publisher_queues_.size();
-				publisher_queues_.push_back(std::queue<bson_t*>());
+				publisher_queues_.push_back(std::queue<QueuedMessage>());
+				publisher_queue_metrics_.push_back(metrics_.GetTopicMetrics(topic_name));
 			}
 
-			auto& queue = publisher_queues_[publisher_topics_[topic_name]];
+			const int queue_index = publisher_topics_[topic_name];
+			auto& queue = publisher_queues_[queue_index];
+			TopicMetrics* topic_metrics = publisher_queue_metrics_[queue_index];
+			topic_metrics->published_.Add();
 			if (queue_size > 0 && queue.size() >= queue_size) // make space if necessary
 			{
-				bson_t* bson = queue.front();
+				bson_t* bson = queue.front().bson_;
+				ReleasePayloadSlots(queue.front().payload_slots_);
 				queue.pop();
 				bson_destroy(bson);
+				topic_metrics->dropped_.Add();
 			}
 
-			queue.push(message);
+			queue.push(QueuedMessage{ message, trace, topic_metrics, msg.payload_slots_ });
+			topic_metrics->queue_depth_.Set(queue.size());
 		}
 
 		return true;
@@ -147,30 +352,50 @@ namespace rosbridge2cpp {
 
 	void ROSBridge::HandleIncomingPublishMessage(ROSBridgePublishMsg &data)
 	{
+		DispatchToTopicCallbacks(data);
+
+		// back-pressure of full local queues, applied without the topic lock
+		if (!receiver_waits_.empty()) {
+			ROS_PROFILER_SCOPE("ROS::ReceiverBlocked");
+			std::vector<std::function<void()>> waits;
+			waits.swap(receiver_waits_);
+			for (const std::function<void()>& wait : waits) {
+				wait();
+			}
+		}
+	}
+
+	void ROSBridge::DispatchToTopicCallbacks(ROSBridgePublishMsg &data)
+	{
+		ROS_PROFILER_SCOPE("ROS::DispatchPublish");
 		spinlock::scoped_lock_wait_for_short_task lock(change_topics_mutex_);
 
 		// Incoming topic message - dispatch to correct callback
 		std::string &incoming_topic_name = data.topic_;
-		if (registered_topic_callbacks_.find(incoming_topic_name) == registered_topic_callbacks_.end()) {
-			std::cerr << "[ROSBridge] Received message for topic " << incoming_topic_name << " where no callback has been registered before" << std::endl;
+		auto subscription = registered_topic_callbacks_.find(incoming_topic_name);
+		if (subscription == registered_topic_callbacks_.end()) {
+			ROS_LOG_WARNING("[ROSBridge] Received message for topic %s where no callback has been registered before", incoming_topic_name.c_str());
 			return;
 		}
+		data.metrics_ = subscription->second.metrics_;
+		data.metrics_->received_.Add();
+		data.metrics_->bytes_in_.Add(data.size_);
 
 		if (bson_only_mode()) {
 			if (!data.full_msg_bson_) {
-				std::cerr << "[ROSBridge] Received message for topic " << incoming_topic_name << ", but full message field is missing. Aborting" << std::endl;
+				ROS_LOG_ERROR("[ROSBridge] Received message for topic %s, but full message field is missing. Aborting", incoming_topic_name.c_str());
 				return;
 			}
 		}
 		else {
 			if (data.msg_json_.IsNull()) {
-				std::cerr << "[ROSBridge] Received message for topic " << incoming_topic_name << ", but 'msg' field is missing. Aborting" << std::endl;
+				ROS_LOG_ERROR("[ROSBridge] Received message for topic %s, but 'msg' field is missing. Aborting", incoming_topic_name.c_str());
 				return;
 			}
 		}
 
 		// Iterate over all registered callbacks for the given topic
-		for (auto& topic_callback : registered_topic_callbacks_.find(incoming_topic_name)->second) {
+		for (auto& topic_callback : subscription->second.callbacks_) {
 			topic_callback.GetFunction()(data);
 		}
 		return;
@@ -178,55 +403,115 @@ namespace rosbridge2cpp {
 
 	void ROSBridge::HandleIncomingServiceResponseMessage(ROSBridgeServiceResponseMsg &data)
 	{
+		ROS_PROFILER_SCOPE("ROS::DispatchServiceResponse");
 		std::string &incoming_service_id = data.id_;
 
-		auto service_response_callback_it = registered_service_callbacks_.find(incoming_service_id);
-
-		if (service_response_callback_it == registered_service_callbacks_.end()) {
-			std::cerr << "[ROSBridge] Received response for service id " << incoming_service_id << "where no callback has been registered before" << std::endl;
-			return;
-		}
-
-		// Execute the callback for the given service id
-		service_response_callback_it->second(data);
-
-		// Delete the callback.
 		// Every call_service will create a new id
-		registered_service_callbacks_.erase(service_response_callback_it);
-
+		if (!CompleteServiceCall(incoming_service_id, data)) {
+			ROS_LOG_WARNING("[ROSBridge] Received response for service id %s where no callback has been registered before or the call has timed out", incoming_service_id.c_str());
+		}
 	}
 
 	void ROSBridge::HandleIncomingServiceRequestMessage(ROSBridgeCallServiceMsg &data)
 	{
+		ROS_PROFILER_SCOPE("ROS::DispatchServiceRequest");
 		std::string &incoming_service = data.service_;
 
 		if (bson_only_mode()) {
-			auto service_request_callback_it = registered_service_request_callbacks_bson_.find(incoming_service);
-
-			if (service_request_callback_it == registered_service_request_callbacks_bson_.end()) {
-				std::cerr << "[ROSBridge] Received service request for service :" << incoming_service << " where no callback has been registered before" << std::endl;
+			std::shared_ptr<ServiceRequestDispatcher> dispatcher;
+			if (!registered_service_request_callbacks_bson_.Get(incoming_service, dispatcher)) {
+				ROS_LOG_WARNING("[ROSBridge] Received service request for service %s where no callback has been registered before", incoming_service.c_str());
 				return;
 			}
-			service_request_callback_it->second(data);
+			dispatcher->callback_(data);
 		}
 		else
 		{
-			auto service_request_callback_it = registered_service_request_callbacks_.find(incoming_service);
-
-			if (service_request_callback_it == registered_service_request_callbacks_.end()) {
-				std::cerr << "[ROSBridge] Received service request for service :" << incoming_service << " where no bson callback has been registered before" << std::endl;
+			FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator service_request_callback;
+			if (!registered_service_request_callbacks_.Get(incoming_service, service_request_callback)) {
+				ROS_LOG_WARNING("[ROSBridge] Received service request for service %s where no bson callback has been registered before", incoming_service.c_str());
 				return;
 			}
 			rapidjson::Document response_allocator;
 
 			// Execute the callback for the given service id
-			service_request_callback_it->second(data, response_allocator.GetAllocator());
+			service_request_callback(data, response_allocator.GetAllocator());
+		}
+	}
+
+	void ROSBridge::DispatchServiceRequest(std::shared_ptr<ROSBridgeCallServiceMsg> request)
+	{
+		std::shared_ptr<ServiceRequestDispatcher> dispatcher;
+		std::shared_ptr<ROSBridgeCallServiceMsg> rejected_request;
+		if (!registered_service_request_callbacks_bson_.Get(request->service_, dispatcher)) {
+			ROS_LOG_WARNING("[ROSBridge] Received service request for service %s where no callback has been registered before", request->service_.c_str());
+			return;
+		}
+
+		{
+			spinlock::scoped_lock_wait_for_short_task lock(dispatcher->mutex_);
+			if (dispatcher->in_flight_ < dispatcher->max_concurrent_requests_) {
+				dispatcher->in_flight_++;
+			}
+			else if (dispatcher->backlog_.size() < MaxServiceRequestBacklog) {
+				dispatcher->backlog_.push(request);
+				return;
+			}
+			else {
+				request.swap(rejected_request);
+			}
+		}
+
+		if (rejected_request) {
+			ROS_LOG_WARNING("[ROSBridge] Too many requests for service %s. Rejecting request.", rejected_request->service_.c_str());
+			RejectServiceRequest(*rejected_request);
+			return;
+		}
+
+		service_worker_pool_.Submit([this, dispatcher, request]() { RunServiceRequest(dispatcher, request); });
+	}
+
+	void ROSBridge::RunServiceRequest(std::shared_ptr<ServiceRequestDispatcher> dispatcher, std::shared_ptr<ROSBridgeCallServiceMsg> request)
+	{
+		dispatcher->callback_(*request);
+
+		std::shared_ptr<ROSBridgeCallServiceMsg> next_request;
+		{
+			spinlock::scoped_lock_wait_for_short_task lock(dispatcher->mutex_);
+			if (dispatcher->backlog_.empty()) {
+				dispatcher->in_flight_--;
+				return;
+			}
+			next_request = dispatcher->backlog_.front();
+			dispatcher->backlog_.pop();
 		}
+
+		// resubmit instead of looping here, so a busy service can't starve the others
+		service_worker_pool_.Submit([this, dispatcher, next_request]() { RunServiceRequest(dispatcher, next_request); });
+	}
+
+	void ROSBridge::RejectServiceRequest(const ROSBridgeCallServiceMsg &request)
+	{
+		ROSBridgeServiceResponseMsg response(true);
+		response.service_ = request.service_;
+		response.id_ = request.id_;
+		response.result_ = false;
+		SendMessage(response);
 	}
 
 	// void ROSBridge::HandleIncomingMessage(ROSBridgeMsg &msg) {}
 
 	void ROSBridge::IncomingMessageCallback(bson_t &bson)
+	{
+		ROS_PROFILER_SCOPE("ROS::IncomingMessage");
+		ConnectionMetrics& connection_metrics = metrics_.GetConnectionMetrics();
+		connection_metrics.messages_received_.Add();
+		connection_metrics.bytes_received_.Add(bson.len);
+
+		DispatchIncomingMessage(bson);
+	}
+
+	void ROSBridge::DispatchIncomingMessage(bson_t &bson)
 	{
 		//ROSBridgeMsg msg;
 		//msg.FromBSON(bson);
@@ -236,15 +521,26 @@ namespace rosbridge2cpp {
 		//
 		// Incoming Topic messages
 		bool key_found = false;
+		const int64_t received_ns = latency_tracer_.IsEnabled() ? LatencyTracer::Now() : 0;
 
 		if (Helper::get_utf8_by_key("op", bson, key_found) == "publish") {
 			ROSBridgePublishMsg m;
 			if (m.FromBSON(bson)) {
+				ROS_PROFILER_MESSAGE("in", m.topic_.c_str(), bson.len);
+				m.size_ = bson.len; // counted in the metrics of the topic by HandleIncomingPublishMessage
+				if (received_ns) {
+					m.trace_.received_ns_ = received_ns;
+					m.trace_.topic_latency_ = latency_tracer_.GetTopicLatency(m.topic_);
+					int64_t stamp_age_ns = 0;
+					if (LatencyTracer::GetStampAge(bson, "msg.header.stamp", stamp_age_ns)) {
+						m.trace_.topic_latency_->Record(LatencySegment::STAMP_TO_RECEIVE, stamp_age_ns);
+					}
+				}
 				HandleIncomingPublishMessage(m);
 				return;
 			}
 
-			std::cerr << "Failed to parse publish message into class. Skipping message." << std::endl;
+			ROS_LOG_ERROR("[ROSBridge] Failed to parse publish message into class. Skipping message.");
 		}
 
 		// Service responses for service we called earlier
@@ -254,32 +550,93 @@ namespace rosbridge2cpp {
 				HandleIncomingServiceResponseMessage(m);
 				return;
 			}
-			std::cerr << "Failed to parse service_response message into class. Skipping message." << std::endl;
+			ROS_LOG_ERROR("[ROSBridge] Failed to parse service_response message into class. Skipping message.");
 		}
 
 		// Service Requests to a service that we advertised in ROSService
 		if (Helper::get_utf8_by_key("op", bson, key_found) == "call_service") {
-			ROSBridgeCallServiceMsg m;
-			m.FromBSON(bson);
-			HandleIncomingServiceRequestMessage(m);
+			if (service_worker_pool_.NumThreads() == 0) {
+				ROSBridgeCallServiceMsg m;
+				m.FromBSON(bson);
+				HandleIncomingServiceRequestMessage(m);
+				return;
+			}
+
+			// The receive buffer will be reused for the next message,
+			// so the request needs its own copy to be handled on the worker pool
+			bson_t *request_bson = bson_copy(&bson);
+			std::shared_ptr<ROSBridgeCallServiceMsg> m = std::make_shared<ROSBridgeCallServiceMsg>();
+			if (!m->FromBSON(*request_bson)) {
+				bson_destroy(request_bson);
+				ROS_LOG_ERROR("[ROSBridge] Failed to parse call_service message into class. Skipping message.");
+				return;
+			}
+			DispatchServiceRequest(m); // m owns request_bson now
+			return;
+		}
+
+		// Parts of a message that rosbridge split up, see ROSTopic::SetFragmentSize
+		if (Helper::get_utf8_by_key("op", bson, key_found) == "fragment") {
+			bson_iter_t iter;
+			const uint8_t *data = nullptr;
+			uint32_t length = 0;
+			if (bson_iter_init_find(&iter, &bson, "data")) {
+				if (BSON_ITER_HOLDS_UTF8(&iter)) {
+					data = reinterpret_cast<const uint8_t*>(bson_iter_utf8(&iter, &length));
+				}
+				else if (BSON_ITER_HOLDS_BINARY(&iter)) {
+					bson_iter_binary(&iter, nullptr, &length, &data);
+				}
+			}
+			if (!data) {
+				ROS_LOG_ERROR("[ROSBridge] Received 'fragment' message without 'data' field. Skipping message.");
+				return;
+			}
+			HandleIncomingFragment(Helper::get_utf8_by_key("id", bson, key_found),
+				Helper::get_int32_by_key("num", bson, key_found), Helper::get_int32_by_key("total", bson, key_found), data, length);
+			return;
+		}
+
+		// Shared memory payload ring, see SetSharedMemoryPayloads
+		if (shared_memory_slots_ > 0) {
+			const std::string op = Helper::get_utf8_by_key("op", bson, key_found);
+			if (op == "shm_ack" || op == "shm_ready") {
+				HandleIncomingSharedMemoryMessage(op, bson);
+			}
 		}
 	}
 
 	void ROSBridge::IncomingMessageCallback(json &data)
 	{
+		ROS_PROFILER_SCOPE("ROS::IncomingMessage");
 		std::string str_repr = Helper::get_string_from_rapidjson(data);
 
+		ConnectionMetrics& connection_metrics = metrics_.GetConnectionMetrics();
+		connection_metrics.messages_received_.Add();
+		connection_metrics.bytes_received_.Add(str_repr.size());
+
+		DispatchIncomingMessage(data, str_repr.size());
+	}
+
+	void ROSBridge::DispatchIncomingMessage(json &data, size_t size)
+	{
 		// Check the message type and dispatch the message properly
 		//
 		// Incoming Topic messages
 		if (std::string(data["op"].GetString(), data["op"].GetStringLength()) == "publish") {
 			ROSBridgePublishMsg m;
 			if (m.FromJSON(data)) {
+				ROS_PROFILER_MESSAGE("in", m.topic_.c_str(), size);
+				m.size_ = size; // counted in the metrics of the topic by HandleIncomingPublishMessage
+				if (latency_tracer_.IsEnabled()) {
+					m.trace_.received_ns_ = LatencyTracer::Now();
+					m.trace_.topic_latency_ = latency_tracer_.GetTopicLatency(m.topic_);
+				}
 				HandleIncomingPublishMessage(m);
 				return;
 			}
 
-			std::cerr << "Failed to parse publish message into class. Skipping message." << std::endl;
+			ROS_LOG_ERROR("[ROSBridge] Failed to parse publish message into class. Skipping message.");
 		}
 
 		// Service responses for service we called earlier
@@ -290,7 +647,7 @@ namespace rosbridge2cpp {
 				HandleIncomingServiceResponseMessage(m);
 				return;
 			}
-			std::cerr << "Failed to parse service_response message into class. Skipping message." << std::endl;
+			ROS_LOG_ERROR("[ROSBridge] Failed to parse service_response message into class. Skipping message.");
 		}
 
 		// Service Requests to a service that we advertised in ROSService
@@ -298,6 +655,102 @@ namespace rosbridge2cpp {
 			ROSBridgeCallServiceMsg m;
 			m.FromJSON(data);
 			HandleIncomingServiceRequestMessage(m);
+			return;
+		}
+
+		// Parts of a message that rosbridge split up, see ROSTopic::SetFragmentSize
+		if (std::string(data["op"].GetString(), data["op"].GetStringLength()) == "fragment") {
+			if (!data.HasMember("data") || !data["data"].IsString() || !data.HasMember("id") || !data["id"].IsString()
+				|| !data.HasMember("num") || !data["num"].IsInt() || !data.HasMember("total") || !data["total"].IsInt()) {
+				ROS_LOG_ERROR("[ROSBridge] Received incomplete 'fragment' message. Skipping message.");
+				return;
+			}
+			HandleIncomingFragment(std::string(data["id"].GetString(), data["id"].GetStringLength()), data["num"].GetInt(), data["total"].GetInt(),
+				reinterpret_cast<const uint8_t*>(data["data"].GetString()), data["data"].GetStringLength());
+		}
+	}
+
+	void ROSBridge::HandleIncomingFragment(const std::string& id, int num, int total, const uint8_t *data, size_t length)
+	{
+		if (total <= 0 || num < 0 || num >= total) {
+			ROS_LOG_ERROR("[ROSBridge] Received fragment %d of %d of message %s. Skipping fragment.", num, total, id.c_str());
+			return;
+		}
+
+		auto message = std::find_if(fragmented_messages_.begin(), fragmented_messages_.end(),
+			[&id](const FragmentedMessage& m) { return m.id_ == id; });
+
+		// all fragments but the last one have the fragment size, so the first one tells the size of the whole message
+		if (total > kMaxFragmentsPerMessage || static_cast<size_t>(total - 1) * length > kMaxFragmentedMessageSize ||
+			(message != fragmented_messages_.end() && message->num_bytes_ + length > kMaxFragmentedMessageSize)) {
+			ROS_LOG_ERROR("[ROSBridge] Fragmented message %s is too large (%d fragments of %u bytes). Skipping message.", id.c_str(), total, static_cast<unsigned>(length));
+			if (message != fragmented_messages_.end()) {
+				fragmented_messages_.erase(message);
+			}
+			return;
+		}
+
+		if (message == fragmented_messages_.end() || message->parts_.size() != static_cast<size_t>(total)) {
+			if (message != fragmented_messages_.end()) {
+				fragmented_messages_.erase(message);
+			}
+			if (fragmented_messages_.size() >= kMaxFragmentedMessages) {
+				ROS_LOG_WARNING("[ROSBridge] Dropping incomplete fragmented message %s", fragmented_messages_.front().id_.c_str());
+				fragmented_messages_.erase(fragmented_messages_.begin());
+			}
+			fragmented_messages_.emplace_back();
+			message = std::prev(fragmented_messages_.end());
+			message->id_ = id;
+			message->parts_.resize(total);
+			message->received_.assign(total, false);
+		}
+
+		if (!message->received_[num]) {
+			message->received_[num] = true;
+			message->parts_[num].assign(reinterpret_cast<const char*>(data), length);
+			++message->num_received_;
+			message->num_bytes_ += length;
+		}
+		if (message->num_received_ < message->parts_.size())
+			return;
+
+		std::string assembled;
+		size_t assembled_length = 0;
+		for (const std::string& part : message->parts_) assembled_length += part.size();
+		assembled.reserve(assembled_length);
+		for (const std::string& part : message->parts_) assembled.append(part);
+		fragmented_messages_.erase(message);
+
+		// rosbridge fragments the serialized message, which is JSON text or, in the BSON mode of newer versions, a BSON document
+		const bool is_json = !assembled.empty() && assembled[0] == '{';
+		if (bson_only_mode()) {
+			bson_t b;
+			bson_error_t error;
+			if (is_json) {
+				if (!bson_init_from_json(&b, assembled.data(), static_cast<ssize_t>(assembled.size()), &error)) {
+					ROS_LOG_ERROR("[ROSBridge] Failed to parse fragmented message %s: %s", id.c_str(), error.message);
+					return;
+				}
+			}
+			else if (!bson_init_static(&b, reinterpret_cast<const uint8_t*>(assembled.data()), assembled.size())) {
+				ROS_LOG_ERROR("[ROSBridge] Fragmented message %s is neither JSON nor BSON. Skipping message.", id.c_str());
+				return;
+			}
+
+			// handlers may call bson_destroy() on the document they get, like for the static documents of the transport
+			bson_t view;
+			bson_init_static(&view, bson_get_data(&b), b.len);
+			DispatchIncomingMessage(view);
+			bson_destroy(&b);
+		}
+		else {
+			json document;
+			document.Parse(assembled.data(), assembled.size());
+			if (document.HasParseError() || !document.IsObject() || !document.HasMember("op") || !document["op"].IsString()) {
+				ROS_LOG_ERROR("[ROSBridge] Failed to parse fragmented message %s. Skipping message.", id.c_str());
+				return;
+			}
+			DispatchIncomingMessage(document, assembled.size());
 		}
 	}
 
@@ -315,10 +768,98 @@ namespace rosbridge2cpp {
 			transport_layer_.RegisterIncomingMessageCallback(fun);
 		}
 
+		transport_layer_.RegisterErrorCallback([this](TransportError error) {
+			if (error == TransportError::R2C_SEND_STALLED) {
+				metrics_.GetConnectionMetrics().send_stalls_.Add();
+			}
+		});
+
 		run_publisher_queue_thread_ = true;
 		publisher_queue_thread_ = std::thread(&ROSBridge::RunPublisherQueueThread, this);
 
-		return transport_layer_.Init(ip_addr, port);
+		run_service_call_timer_thread_ = true;
+		service_call_timer_thread_ = std::thread(&ROSBridge::RunServiceCallTimerThread, this);
+
+		if (bson_only_mode()) {
+			// JSON requests reference the document of the receiving thread, so they are always handled inline
+			service_worker_pool_.Start(num_service_worker_threads_);
+		}
+
+		if (subscription_compression_ == "cbor" && !bson_only_mode()) {
+			ROS_LOG_WARNING("[ROSBridge] CBOR subscriptions need the BSON mode, subscribing without compression");
+			subscription_compression_ = "none";
+		}
+
+		if (!transport_layer_.Init(ip_addr, port)) {
+			return false;
+		}
+
+		if (shared_memory_slots_ > 0) {
+			if (!bson_only_mode()) {
+				ROS_LOG_WARNING("[ROSBridge] Shared memory payloads need the BSON mode, sending them inline");
+			}
+			else if (!OfferSharedMemoryRing()) {
+				ROS_LOG_WARNING("[ROSBridge] Couldn't offer a shared memory ring to the server, sending payloads inline");
+			}
+		}
+		return true;
+	}
+
+	void ROSBridge::SetSharedMemoryPayloads(uint32_t num_slots, uint32_t slot_size, uint32_t min_payload_size)
+	{
+		shared_memory_slots_ = num_slots;
+		shared_memory_slot_size_ = slot_size;
+		min_shared_memory_payload_size_ = min_payload_size;
+	}
+
+	bool ROSBridge::OfferSharedMemoryRing()
+	{
+		if (!payload_ring_.Create(shared_memory_slots_, shared_memory_slot_size_)) {
+			return false;
+		}
+		payload_ring_.SetMetrics(&metrics_.GetConnectionMetrics());
+
+		bson_t *message = bson_new();
+		BSON_APPEND_UTF8(message, "op", "shm_open");
+		BSON_APPEND_UTF8(message, "id", ("shm_open:" + std::to_string(++id_counter)).c_str());
+		BSON_APPEND_UTF8(message, "name", payload_ring_.GetName().c_str());
+		BSON_APPEND_INT32(message, "slots", static_cast<int32_t>(payload_ring_.GetNumSlots()));
+		BSON_APPEND_INT64(message, "slot_size", static_cast<int64_t>(payload_ring_.GetSlotSize()));
+
+		bool success;
+		{
+			spinlock::scoped_lock_wait_for_short_task lock(transport_layer_access_mutex_);
+			success = transport_layer_.SendMessage(bson_get_data(message), message->len);
+			CountSentMessage(success, message->len);
+		}
+		bson_destroy(message);
+		return success;
+	}
+
+	void ROSBridge::HandleIncomingSharedMemoryMessage(const std::string& op, bson_t &bson)
+	{
+		if (op == "shm_ack") {
+			SharedMemoryDescriptor descriptor;
+			if (SharedMemoryRing::ReadDescriptor(&bson, descriptor)) {
+				payload_ring_.Acknowledge(descriptor);
+			}
+			return;
+		}
+
+		bool key_found = false;
+		const std::string name = Helper::get_utf8_by_key("name", bson, key_found);
+		if (name != payload_ring_.GetName()) {
+			return; // answer to the ring of an earlier connection
+		}
+		const bool result = Helper::get_bool_by_key("result", bson, key_found);
+		if (key_found && result) {
+			ROS_LOG_INFO("[ROSBridge] The server mapped %s, payloads of at least %u bytes are passed through shared memory",
+				name.c_str(), min_shared_memory_payload_size_);
+			shared_memory_ready_ = true;
+		}
+		else {
+			ROS_LOG_WARNING("[ROSBridge] The server couldn't map %s, sending payloads inline", name.c_str());
+		}
 	}
 
 	bool ROSBridge::IsHealthy() const
@@ -330,22 +871,191 @@ namespace rosbridge2cpp {
 	void ROSBridge::RegisterTopicCallback(std::string topic_name, ROSCallbackHandle<FunVrROSPublishMsg>& callback_handle)
 	{
 		spinlock::scoped_lock_wait_for_short_task lock(change_topics_mutex_);
-		registered_topic_callbacks_[topic_name].push_back(callback_handle);
+		TopicSubscription& subscription = registered_topic_callbacks_[topic_name];
+		if (!subscription.metrics_) {
+			subscription.metrics_ = metrics_.GetTopicMetrics(topic_name); // the receiver thread doesn't look it up per message
+		}
+		subscription.callbacks_.push_back(callback_handle);
+	}
+
+	bool ROSBridge::RegisterServiceCallback(std::string service_call_id, FunVrROSServiceResponseMsg fun, std::chrono::milliseconds timeout, FunVServiceCallError error_fun)
+	{
+		const size_t max_pending_service_calls = max_pending_service_calls_.load(std::memory_order_relaxed);
+		PendingServiceCall pending_service_call;
+		pending_service_call.callback_ = fun;
+		pending_service_call.error_callback_ = error_fun;
+
+		bool inserted;
+		bool first_timeout = false;
+		if (timeout.count() > 0) {
+			// Scheduled before the call is registered, so whoever takes it out of the registry can remove the timeout
+			spinlock::scoped_lock_wait_for_short_task lock(service_call_timeouts_mutex_);
+			pending_service_call.has_timeout_ = true;
+			pending_service_call.timeout_tick_ = service_call_timeouts_.Schedule(service_call_id, std::chrono::steady_clock::now() + timeout);
+			inserted = registered_service_callbacks_.TryInsert(service_call_id, pending_service_call, max_pending_service_calls);
+			if (!inserted) {
+				service_call_timeouts_.Cancel(service_call_id, pending_service_call.timeout_tick_);
+			}
+			first_timeout = inserted && service_call_timeouts_.Size() == 1;
+		}
+		else {
+			inserted = registered_service_callbacks_.TryInsert(service_call_id, pending_service_call, max_pending_service_calls);
+		}
+
+		if (!inserted) {
+			ROS_LOG_WARNING("[ROSBridge] Too many pending service calls (%u). Rejecting call %s", static_cast<unsigned>(max_pending_service_calls), service_call_id.c_str());
+			return false;
+		}
+		if (first_timeout) {
+			// the timer thread sleeps while there are no timeouts
+			{
+				std::lock_guard<std::mutex> lock(service_call_timer_mutex_);
+				service_call_timer_wakeup_ = true;
+			}
+			service_call_timer_cv_.notify_one();
+		}
+		return true;
+	}
+
+	bool ROSBridge::UnregisterServiceCallback(const std::string& service_call_id)
+	{
+		PendingServiceCall pending_service_call;
+		if (!registered_service_callbacks_.Take(service_call_id, pending_service_call)) {
+			return false;
+		}
+		CancelServiceCallTimeout(service_call_id, pending_service_call);
+		return true;
+	}
+
+	bool ROSBridge::CompleteServiceCall(const std::string& service_call_id, ROSBridgeServiceResponseMsg& response)
+	{
+		// Take the callback out of the registry, whoever takes it first calls it
+		PendingServiceCall pending_service_call;
+		if (!registered_service_callbacks_.Take(service_call_id, pending_service_call)) {
+			return false;
+		}
+		CancelServiceCallTimeout(service_call_id, pending_service_call);
+
+		response.id_ = service_call_id;
+		pending_service_call.callback_(response);
+		return true;
+	}
+
+	bool ROSBridge::FailServiceCall(const std::string& service_call_id, ServiceCallError error)
+	{
+		PendingServiceCall pending_service_call;
+		if (!registered_service_callbacks_.Take(service_call_id, pending_service_call)) {
+			return false;
+		}
+		CancelServiceCallTimeout(service_call_id, pending_service_call);
+
+		if (pending_service_call.error_callback_) {
+			pending_service_call.error_callback_(error);
+		}
+		return true;
+	}
+
+	void ROSBridge::PostServiceResponse(const std::string& service_call_id, std::unique_ptr<ROSBridgeServiceResponseMsg> response)
+	{
+		{
+			std::lock_guard<std::mutex> lock(service_call_timer_mutex_);
+			posted_service_responses_.push_back(PostedServiceResponse{ service_call_id, std::move(response) });
+			service_call_timer_wakeup_ = true;
+		}
+		service_call_timer_cv_.notify_one();
 	}
 
-	void ROSBridge::RegisterServiceCallback(std::string service_call_id, FunVrROSServiceResponseMsg fun)
+	void ROSBridge::CancelServiceCallTimeout(const std::string& service_call_id, const PendingServiceCall& pending_service_call)
 	{
-		registered_service_callbacks_[service_call_id] = fun;
+		if (!pending_service_call.has_timeout_) return;
+		spinlock::scoped_lock_wait_for_short_task lock(service_call_timeouts_mutex_);
+		service_call_timeouts_.Cancel(service_call_id, pending_service_call.timeout_tick_);
+	}
+
+	void ROSBridge::SetMaxPendingServiceCalls(size_t max_pending_service_calls)
+	{
+		max_pending_service_calls_ = max_pending_service_calls;
+	}
+
+	size_t ROSBridge::NumPendingServiceCalls()
+	{
+		return registered_service_callbacks_.Size();
+	}
+
+	void ROSBridge::ExpireServiceCalls()
+	{
+		std::vector<std::string> expired_ids;
+		{
+			spinlock::scoped_lock_wait_for_short_task lock(service_call_timeouts_mutex_);
+			service_call_timeouts_.Advance(std::chrono::steady_clock::now(), expired_ids);
+		}
+
+		for (const std::string& service_call_id : expired_ids) {
+			PendingServiceCall pending_service_call;
+			if (!registered_service_callbacks_.Take(service_call_id, pending_service_call)) continue; // already answered or cancelled
+
+			ROS_LOG_WARNING("[ROSBridge] Service call %s timed out", service_call_id.c_str());
+			if (pending_service_call.error_callback_) {
+				pending_service_call.error_callback_(ServiceCallError::TIMEOUT);
+			}
+		}
+	}
+
+	void ROSBridge::RunServiceCallTimerThread()
+	{
+		ROS_PROFILER_THREAD_NAME("ROSBridgeServiceTimer");
+
+		const std::chrono::milliseconds tick(10); // of service_call_timeouts_
+		std::unique_lock<std::mutex> lock(service_call_timer_mutex_);
+		while (run_service_call_timer_thread_) {
+			bool idle;
+			{
+				spinlock::scoped_lock_wait_for_short_task timeouts_lock(service_call_timeouts_mutex_);
+				idle = service_call_timeouts_.Size() == 0;
+			}
+			if (idle) {
+				service_call_timer_cv_.wait(lock, [this]() { return service_call_timer_wakeup_ || !run_service_call_timer_thread_; });
+			}
+			else {
+				service_call_timer_cv_.wait_for(lock, tick, [this]() { return service_call_timer_wakeup_ || !run_service_call_timer_thread_; });
+			}
+			service_call_timer_wakeup_ = false;
+
+			std::vector<PostedServiceResponse> posted_service_responses;
+			posted_service_responses.swap(posted_service_responses_);
+
+			lock.unlock();
+			for (PostedServiceResponse& posted : posted_service_responses) {
+				CompleteServiceCall(posted.service_call_id_, *posted.response_); // might have been cancelled in the meantime
+			}
+			ExpireServiceCalls();
+			lock.lock();
+		}
 	}
 
 	void ROSBridge::RegisterServiceRequestCallback(std::string service_name, FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator fun)
 	{
-		registered_service_request_callbacks_[service_name] = fun;
+		registered_service_request_callbacks_.Set(service_name, fun);
 	}
 
 	void ROSBridge::RegisterServiceRequestCallback(std::string service_name, FunVrROSCallServiceMsgrROSServiceResponseMsg fun)
 	{
-		registered_service_request_callbacks_bson_[service_name] = fun;
+		std::shared_ptr<ServiceRequestDispatcher> dispatcher = std::make_shared<ServiceRequestDispatcher>();
+		dispatcher->callback_ = fun;
+		max_concurrent_service_requests_.Get(service_name, dispatcher->max_concurrent_requests_);
+		registered_service_request_callbacks_bson_.Set(service_name, dispatcher);
+	}
+
+	void ROSBridge::SetMaxConcurrentServiceRequests(const std::string& service_name, size_t max_concurrent_requests)
+	{
+		if (max_concurrent_requests == 0) max_concurrent_requests = 1;
+		max_concurrent_service_requests_.Set(service_name, max_concurrent_requests);
+
+		std::shared_ptr<ServiceRequestDispatcher> dispatcher;
+		if (registered_service_request_callbacks_bson_.Get(service_name, dispatcher)) {
+			spinlock::scoped_lock_wait_for_short_task lock(dispatcher->mutex_);
+			dispatcher->max_concurrent_requests_ = max_concurrent_requests;
+		}
 	}
 
 	bool ROSBridge::UnregisterTopicCallback(std::string topic_name, const ROSCallbackHandle<FunVrROSPublishMsg>& callback_handle)
@@ -353,18 +1063,18 @@ namespace rosbridge2cpp {
 		spinlock::scoped_lock_wait_for_short_task lock(change_topics_mutex_);
 
 		if (registered_topic_callbacks_.find(topic_name) == registered_topic_callbacks_.end()) {
-			std::cerr << "[ROSBridge] UnregisterTopicCallback called but given topic name '" << topic_name << "' not in map." << std::endl;
+			ROS_LOG_WARNING("[ROSBridge] UnregisterTopicCallback called but given topic name '%s' not in map.", topic_name.c_str());
 			return false;
 		}
 
-		std::list<ROSCallbackHandle<FunVrROSPublishMsg>> &r_list_of_callbacks = registered_topic_callbacks_.find(topic_name)->second;
+		std::list<ROSCallbackHandle<FunVrROSPublishMsg>> &r_list_of_callbacks = registered_topic_callbacks_.find(topic_name)->second.callbacks_;
 
 		for (std::list<ROSCallbackHandle<FunVrROSPublishMsg>>::iterator topic_callback_it = r_list_of_callbacks.begin();
 			topic_callback_it != r_list_of_callbacks.end();
 			++topic_callback_it) {
 
 			if (*topic_callback_it == callback_handle) {
-				std::cout << "[ROSBridge] Found CB in UnregisterTopicCallback. Deleting it ... " << std::endl;
+				ROS_LOG_VERBOSE("[ROSBridge] Found CB in UnregisterTopicCallback. Deleting it ...");
 				r_list_of_callbacks.erase(topic_callback_it);
 				return true;
 			}
@@ -374,6 +1084,8 @@ namespace rosbridge2cpp {
 
 	int ROSBridge::RunPublisherQueueThread()
 	{
+		ROS_PROFILER_THREAD_NAME("ROSBridgePublisher");
+
 		int return_value = 0;
 		int num_retries_left = 10;
 		float sleep_duration = 0.2f;
@@ -388,8 +1100,12 @@ namespace rosbridge2cpp {
 				sleep_duration = 0.0f;
 			}
 
-			bson_t* msg;
+			// Written before the queued messages, so publishing on a topic doesn't overtake its advertise
+			FlushControlMessages();
+
+			QueuedMessage msg;
 			{
+				ROS_PROFILER_SCOPE("ROS::Dequeue");
 				spinlock::scoped_lock_wait_for_short_task lock(change_publisher_queues_mutex_);
 				current_publisher_queue_++;
 				if (current_publisher_queue_ >= publisher_queues_.size())
@@ -410,6 +1126,7 @@ namespace rosbridge2cpp {
 				{
 					msg = queue.front();
 					queue.pop();
+					msg.metrics_->queue_depth_.Set(queue.size());
 				}
 				else
 				{
@@ -417,20 +1134,35 @@ namespace rosbridge2cpp {
 				}
 			}
 
-			const uint8_t* bson_data = bson_get_data(msg);
-			uint32_t bson_size = msg->len;
+			const int64_t dequeued_ns = LatencyTracer::Now();
+			const uint8_t* bson_data = bson_get_data(msg.bson_);
+			uint32_t bson_size = msg.bson_->len;
 			{
+				ROS_PROFILER_SCOPE("ROS::SocketSend");
 				spinlock::scoped_lock_wait_for_long_task lock(transport_layer_access_mutex_);
 				const bool success = transport_layer_.SendMessage(bson_data, bson_size);
-				bson_destroy(msg);
+				bson_destroy(msg.bson_);
+				const int64_t sent_ns = LatencyTracer::Now();
+				CountSentMessage(success, bson_size, msg.metrics_, sent_ns - dequeued_ns);
+				if (success && msg.trace_.topic_latency_)
+				{
+					TopicLatency* topic_latency = msg.trace_.topic_latency_;
+					topic_latency->Record(LatencySegment::QUEUE_WAIT, dequeued_ns - msg.trace_.queued_ns_);
+					topic_latency->Record(LatencySegment::SOCKET_WRITE, sent_ns - dequeued_ns);
+					if (msg.trace_.publish_ns_)
+					{
+						topic_latency->Record(LatencySegment::PUBLISH_TO_SENT, sent_ns - msg.trace_.publish_ns_);
+					}
+				}
 				if (!success)
 				{
+					ReleasePayloadSlots(msg.payload_slots_);
 					num_retries_left--;
 					sleep_duration = 0.2f;
 					if (num_retries_left <= 0) {
 						run_publisher_queue_thread_ = false;
 						return_value = 2;
-						std::cout << "[ROSBridge] Lost connection to ROSBridge!" << std::endl;
+						ROS_LOG_ERROR("[ROSBridge] Lost connection to ROSBridge!");
 					}
 				}
 				else
@@ -8,11 +8,22 @@
 #include <list>
 #include <queue>
 #include <chrono>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 
 #include <stdio.h>
 #include "types.h"
 #include "helper.h"
 #include "spinlock.h"
+#include "ros_latency_tracer.h"
+#include "ros_metrics.h"
+#include "timer_wheel.h"
+#include "sharded_registry.h"
+#include "worker_pool.h"
+#include "shared_memory_ring.h"
 
 #include "itransport_layer.h"
 
@@ -67,6 +78,26 @@ namespace rosbridge2cpp {
 
 		bool QueueMessage(const std::string& topic_name, int queue_size, ROSBridgePublishMsg& msg);
 
+		// Sends a control message (advertise, subscribe, advertise_service, ...). While batching is enabled, the message
+		// is only serialized here and written together with the other control messages of the batch.
+		// If given, on_result is called with the result of the write. For a batched message, that happens later on the
+		// thread that flushes the batch.
+		//
+		// @return false if the message couldn't be sent, true if it has been sent or batched
+		bool SendControlMessage(ROSBridgeMsg &msg, FunVBool on_result = nullptr);
+
+		// Collect control messages in a batch instead of writing each of them on its own, e.g. while hundreds of
+		// topics are advertised and subscribed at startup. Disabled by default.
+		void SetBatchControlMessages(bool enabled) { batch_control_messages_ = enabled; }
+		bool IsBatchingControlMessages() const { return batch_control_messages_; }
+
+		// Writes the batched control messages, with a single write if the transport supports coalesced writes.
+		// The publisher queue thread flushes every round (~10ms) and every other send flushes first, so no message
+		// overtakes the control messages that were sent before it.
+		//
+		// @return the number of control messages that have been written
+		size_t FlushControlMessages();
+
 
 		// Registration function for topic callbacks.
 		// This method should ONLY be called by ROSTopic instances.
@@ -84,9 +115,44 @@ namespace rosbridge2cpp {
 		// @return true, if the passed callback has been found and removed. false otherwise.
 		bool UnregisterTopicCallback(std::string topic_name, const ROSCallbackHandle<FunVrROSPublishMsg>& callback_handle);
 
+		// Only for topic callbacks, which run on the receiver thread while the bridge holds its topic lock: wait is called
+		// on the same thread once the message has been handed to all callbacks and the lock is released. Blocking there
+		// stops reading the socket, without holding up Subscribe()/Unsubscribe() of other topics.
+		void BlockReceiverAfterDispatch(std::function<void()> wait) { receiver_waits_.push_back(std::move(wait)); }
+
 		// Register the callback for a service call.
 		// This callback will be executed when we receive the response for a particular Service Request
-		void RegisterServiceCallback(std::string service_call_id, FunVrROSServiceResponseMsg fun);
+		//
+		// If a timeout is given and no response has been received in time, error_fun will be called
+		// with ServiceCallError::TIMEOUT instead and a late response will be dropped.
+		// Timeouts are checked on a timer thread of their own, error_fun is called from there up to 10ms after the
+		// deadline, even while a write to a stalled connection blocks the publisher queue thread.
+		//
+		// @return false if the maximum number of pending service calls has been reached. fun will not be called in that case.
+		bool RegisterServiceCallback(std::string service_call_id, FunVrROSServiceResponseMsg fun,
+			std::chrono::milliseconds timeout = std::chrono::milliseconds(0), FunVServiceCallError error_fun = nullptr);
+
+		// Drops the callback of a pending service call. Neither fun nor error_fun will be called afterwards.
+		//
+		// @return true, if the service call was still pending.
+		bool UnregisterServiceCallback(const std::string& service_call_id);
+
+		// Completes a pending service call like a received response: its callback is called on the calling thread
+		// with response.id_ set to service_call_id.
+		//
+		// @return false if the call wasn't pending anymore, because it has been answered, cancelled or has timed out.
+		bool CompleteServiceCall(const std::string& service_call_id, ROSBridgeServiceResponseMsg& response);
+		// Same for the error callback
+		bool FailServiceCall(const std::string& service_call_id, ServiceCallError error);
+
+		// Completes a pending service call with a response that didn't come from the connection, e.g. one of a
+		// ServiceResponseCache. The call is completed on the timer thread that checks the timeouts, never on the
+		// calling thread, so the callback of a call can't run before it has returned.
+		void PostServiceResponse(const std::string& service_call_id, std::unique_ptr<ROSBridgeServiceResponseMsg> response);
+
+		// Limits the number of service calls that wait for a response. Defaults to 1024.
+		void SetMaxPendingServiceCalls(size_t max_pending_service_calls);
+		size_t NumPendingServiceCalls();
 
 		// Register the callback that shall be executed,
 		// whenever we receive a request for a service that
@@ -94,9 +160,22 @@ namespace rosbridge2cpp {
 		void RegisterServiceRequestCallback(std::string service_name, FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator fun);
 		void RegisterServiceRequestCallback(std::string service_name, FunVrROSCallServiceMsgrROSServiceResponseMsg fun);
 
+		// Number of threads that handle requests for advertised services in BSON mode.
+		// With 0 threads, requests are handled on the receiving thread and block all other incoming traffic
+		// while the callback runs. Must be called before Init().
+		void SetServiceWorkerThreads(size_t num_threads) { num_service_worker_threads_ = num_threads; }
+
+		// Limits how many requests of the given advertised service are handled at the same time. Defaults to 1,
+		// so the callback of a service never runs concurrently with itself. Further requests wait in a backlog
+		// and are answered with a failure if the backlog is full.
+		void SetMaxConcurrentServiceRequests(const std::string& service_name, size_t max_concurrent_requests);
+
 		// An ID Counter that will be used to generate increasing
 		// IDs for service/topic etc. messages
-		long id_counter = 0;
+		std::atomic<long> id_counter{ 0 };
+
+		// Unique for the lifetime of the process, unlike the address of a bridge that has been destroyed
+		uint64_t GetConnectionId() const { return connection_id_; }
 
 		// Returns true if the bson only mode is activated
 		bool bson_only_mode() {
@@ -108,6 +187,32 @@ namespace rosbridge2cpp {
 		// will be in BSON, instead of JSON
 		void enable_bson_mode() { bson_only_mode_ = true; }
 
+		// Per topic latency histograms of the publish and receive pipeline.
+		// Tracing is disabled by default, see LatencyTracer::SetEnabled.
+		LatencyTracer& GetLatencyTracer() { return latency_tracer_; }
+
+		// Per topic and connection counters (published, sent, dropped, received, bytes, queue depth, ...)
+		MetricsRegistry& GetMetrics() { return metrics_; }
+
+		// Passes large binary fields of outgoing messages (see AppendBinaryPayload) through a SharedMemoryRing instead
+		// of the socket. After connecting, the ring is offered to the server with a 'shm_open' message and used once
+		// the server answers with 'shm_ready', which only a server on the same host can do. Payloads smaller than
+		// min_payload_size are sent inline. BSON mode only, must be called before Init().
+		void SetSharedMemoryPayloads(uint32_t num_slots, uint32_t slot_size, uint32_t min_payload_size);
+
+		// The ring to write payloads into, nullptr until the server accepted it
+		SharedMemoryRing* GetPayloadRing() { return shared_memory_ready_ ? &payload_ring_ : nullptr; }
+		uint32_t GetMinSharedMemoryPayloadSize() const { return min_shared_memory_payload_size_; }
+
+		// Frees the ring slots of a message that isn't going to be sent
+		void ReleasePayloadSlots(uint64_t slots) { payload_ring_.Release(slots); }
+
+		// The 'compression' that topics request when they subscribe: "none" or "cbor". With "cbor", rosbridge sends
+		// the messages of the subscriptions CBOR encoded, with numeric arrays as typed arrays (see CBORCodec), which
+		// the transports convert to BSON on arrival. BSON mode only, must be called before Init().
+		void SetSubscriptionCompression(const std::string& compression) { subscription_compression_ = compression; }
+		const std::string& GetSubscriptionCompression() const { return subscription_compression_; }
+
 	private:
 		// Callback function for the used ITransportLayer.
 		// It receives the received json that was contained
@@ -118,8 +223,17 @@ namespace rosbridge2cpp {
 
 		void IncomingMessageCallback(bson_t &bson);
 
+		// Handles a received or reassembled message, after it has been counted in the connection metrics
+		void DispatchIncomingMessage(json &data, size_t size);
+		void DispatchIncomingMessage(bson_t &bson);
+
+		// Collects the 'fragment' messages of a message that rosbridge split up (see ROSTopic::SetFragmentSize)
+		// and dispatches the message once all of them arrived. Only called by the receiving thread.
+		void HandleIncomingFragment(const std::string& id, int num, int total, const uint8_t *data, size_t length);
+
 		// Handler Method for reply packet
 		void HandleIncomingPublishMessage(ROSBridgePublishMsg &data);
+		void DispatchToTopicCallbacks(ROSBridgePublishMsg &data);
 
 		// Handler Method for reply packet
 		void HandleIncomingServiceResponseMessage(ROSBridgeServiceResponseMsg &data);
@@ -127,25 +241,139 @@ namespace rosbridge2cpp {
 		// Handler Method for reply packet
 		void HandleIncomingServiceRequestMessage(ROSBridgeCallServiceMsg &data);
 
+		// Runs the requests of one advertised service on the worker pool, see SetMaxConcurrentServiceRequests
+		struct ServiceRequestDispatcher {
+			FunVrROSCallServiceMsgrROSServiceResponseMsg callback_;
+			spinlock mutex_;
+			size_t max_concurrent_requests_ = 1;
+			size_t in_flight_ = 0;
+			std::queue<std::shared_ptr<ROSBridgeCallServiceMsg>> backlog_;
+		};
+
+		// Handler for BSON service requests that own their data and can be processed on the worker pool
+		void DispatchServiceRequest(std::shared_ptr<ROSBridgeCallServiceMsg> request);
+		void RunServiceRequest(std::shared_ptr<ServiceRequestDispatcher> dispatcher, std::shared_ptr<ROSBridgeCallServiceMsg> request);
+
+		// Answers a service request that couldn't be handled
+		void RejectServiceRequest(const ROSBridgeCallServiceMsg &request);
+
 		int RunPublisherQueueThread();
 
+		// Updates the connection counters and, if given, the counters of the topic after a write to the transport
+		void CountSentMessage(bool success, size_t num_bytes, TopicMetrics* topic_metrics = nullptr, int64_t send_time_ns = 0);
+
+		// Calls the error callback of all service calls whose timeout has expired
+		void ExpireServiceCalls();
+
+		// Expires the service calls and completes the posted responses on its own thread, a stalled write of the
+		// publisher queue thread doesn't delay it
+		void RunServiceCallTimerThread();
+
+		// Sends 'shm_open' with the name and layout of the payload ring, see SetSharedMemoryPayloads
+		bool OfferSharedMemoryRing();
+
+		// 'shm_ready' (the server mapped the ring) and 'shm_ack' (the server is done with a payload)
+		void HandleIncomingSharedMemoryMessage(const std::string& op, bson_t &bson);
+
 		ITransportLayer &transport_layer_;
-		std::unordered_map<std::string, std::list<ROSCallbackHandle<FunVrROSPublishMsg>>> registered_topic_callbacks_;
-		std::unordered_map<std::string, FunVrROSServiceResponseMsg> registered_service_callbacks_;
-		std::unordered_map<std::string, FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator> registered_service_request_callbacks_;
-		std::unordered_map<std::string, FunVrROSCallServiceMsgrROSServiceResponseMsg> registered_service_request_callbacks_bson_;
+		static std::atomic<uint64_t> connection_id_counter_;
+		const uint64_t connection_id_ = ++connection_id_counter_;
+
+		// The callbacks of a subscribed topic, and its metrics, looked up once when the first callback is registered
+		struct TopicSubscription {
+			std::list<ROSCallbackHandle<FunVrROSPublishMsg>> callbacks_;
+			TopicMetrics* metrics_ = nullptr;
+		};
+		std::unordered_map<std::string, TopicSubscription> registered_topic_callbacks_;
+		ShardedRegistry<FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator> registered_service_request_callbacks_;
+		ShardedRegistry<std::shared_ptr<ServiceRequestDispatcher>> registered_service_request_callbacks_bson_;
+		ShardedRegistry<size_t> max_concurrent_service_requests_;
+		WorkerPool service_worker_pool_;
+		size_t num_service_worker_threads_ = 0;
 		bool bson_only_mode_ = false;
 
 		spinlock transport_layer_access_mutex_;
 
+		// Serialized control messages (JSON string or BSON bytes), see SendControlMessage
+		struct BatchedControlMessage {
+			std::string data_;
+			FunVBool on_result_;
+		};
+
+		std::atomic<bool> batch_control_messages_{ false };
+		spinlock control_batch_mutex_; // always taken after transport_layer_access_mutex_
+		std::vector<BatchedControlMessage> control_batch_;
+		std::atomic<size_t> control_batch_size_{ 0 }; // lets senders skip the flush without taking a lock
+
 		spinlock change_topics_mutex_;
+		std::vector<std::function<void()>> receiver_waits_; // receiver thread only, see BlockReceiverAfterDispatch
+
+		struct PendingServiceCall {
+			FunVrROSServiceResponseMsg callback_;
+			FunVServiceCallError error_callback_;
+			bool has_timeout_ = false;
+			uint64_t timeout_tick_ = 0; // of its entry in service_call_timeouts_
+		};
+
+		// Removes the timeout of a call that was taken out of registered_service_callbacks_ before it expired
+		void CancelServiceCallTimeout(const std::string& service_call_id, const PendingServiceCall& pending_service_call);
+
+		ShardedRegistry<PendingServiceCall> registered_service_callbacks_;
+		spinlock service_call_timeouts_mutex_;
+		TimerWheel<std::string> service_call_timeouts_;
+		std::atomic<size_t> max_pending_service_calls_{ 1024 };
+
+		std::thread service_call_timer_thread_;
+		std::mutex service_call_timer_mutex_;
+		std::condition_variable service_call_timer_cv_;
+		bool run_service_call_timer_thread_ = false; // guarded by service_call_timer_mutex_
+		bool service_call_timer_wakeup_ = false; // the first timeout was scheduled or a response posted, guarded by service_call_timer_mutex_
+
+		struct PostedServiceResponse {
+			std::string service_call_id_;
+			std::unique_ptr<ROSBridgeServiceResponseMsg> response_;
+		};
+		std::vector<PostedServiceResponse> posted_service_responses_; // guarded by service_call_timer_mutex_
+
+		struct QueuedMessage {
+			bson_t* bson_;
+			MessageTrace trace_;
+			TopicMetrics* metrics_;
+			uint64_t payload_slots_;
+		};
 
 		std::thread publisher_queue_thread_;
 		spinlock change_publisher_queues_mutex_;
 		std::unordered_map<std::string, int> publisher_topics_; // points to index in publisher_queues_
-		std::vector<std::queue<bson_t*>> publisher_queues_;	 // data to publish on the queue thread
+		std::vector<std::queue<QueuedMessage>> publisher_queues_;	 // data to publish on the queue thread
+		std::vector<TopicMetrics*> publisher_queue_metrics_;	 // same index as publisher_queues_
 		int current_publisher_queue_ = 0;
 		bool run_publisher_queue_thread_ = true;
-		std::chrono::system_clock::time_point LastDataSendTime; // watchdog for send thread. Socket sometimes blocks infinitely.
+		std::chrono::system_clock::time_point LastDataSendTime; // watchdog for send thread, in case the transport blocks without a send timeout
+
+		LatencyTracer latency_tracer_;
+		MetricsRegistry metrics_;
+
+		SharedMemoryRing payload_ring_;
+		uint32_t shared_memory_slots_ = 0; // 0 disables the ring
+		uint32_t shared_memory_slot_size_ = 0;
+		uint32_t min_shared_memory_payload_size_ = 0;
+		std::atomic<bool> shared_memory_ready_{ false };
+
+		std::string subscription_compression_ = "none";
+
+		// Messages whose fragments are still arriving, oldest first
+		struct FragmentedMessage {
+			std::string id_;
+			std::vector<std::string> parts_;
+			std::vector<bool> received_;
+			size_t num_received_ = 0;
+			size_t num_bytes_ = 0;
+		};
+		static const size_t kMaxFragmentedMessages = 8;
+		// Limits of a single message, so a bogus 'total' or a flood of fragments can't make the receiver allocate without bound
+		static const int kMaxFragmentsPerMessage = 65536;
+		static const size_t kMaxFragmentedMessageSize = 512 * 1024 * 1024;
+		std::vector<FragmentedMessage> fragmented_messages_;
 	};
 }
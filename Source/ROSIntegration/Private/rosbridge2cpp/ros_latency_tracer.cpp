@@ -0,0 +1,195 @@
+#include "ros_latency_tracer.h"
+#include "ros_time.h"
+
+namespace rosbridge2cpp {
+
+	static const char* LatencySegmentNames[] = {
+		"stamp_to_publish",
+		"convert_outgoing",
+		"enqueue",
+		"queue_wait",
+		"socket_write",
+		"publish_to_sent",
+		"stamp_to_receive",
+		"receive_to_dispatch",
+		"convert_incoming",
+		"callback",
+		"receive_to_delivered"
+	};
+	static_assert(sizeof(LatencySegmentNames) / sizeof(LatencySegmentNames[0]) == static_cast<int>(LatencySegment::NUM_SEGMENTS), "Missing name for LatencySegment");
+
+	const char* LatencySegmentName(LatencySegment segment)
+	{
+		return LatencySegmentNames[static_cast<int>(segment)];
+	}
+
+	int LatencyHistogram::BucketIndex(uint64_t value)
+	{
+		const uint64_t max_value = (1ull << kMaxValueBits) - 1;
+		if (value > max_value) {
+			value = max_value;
+		}
+		if (value < 2 * kSubBucketCount) {
+			return static_cast<int>(value);
+		}
+
+		int msb = 0;
+		for (uint64_t v = value; v >>= 1;) {
+			++msb;
+		}
+		const int shift = msb - kSubBucketBits;
+		return (shift + 1) * kSubBucketCount + static_cast<int>((value >> shift) - kSubBucketCount);
+	}
+
+	uint64_t LatencyHistogram::BucketUpperBound(int index)
+	{
+		if (index < 2 * kSubBucketCount) {
+			return static_cast<uint64_t>(index);
+		}
+		const int shift = index / kSubBucketCount - 1;
+		const uint64_t mantissa = index % kSubBucketCount + kSubBucketCount;
+		return ((mantissa + 1) << shift) - 1;
+	}
+
+	void LatencyHistogram::Record(int64_t value_ns)
+	{
+		const uint64_t value = value_ns > 0 ? static_cast<uint64_t>(value_ns) : 0;
+		buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		sum_.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t current_max = max_.load(std::memory_order_relaxed);
+		while (value > current_max && !max_.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+		}
+	}
+
+	uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const
+	{
+		const uint64_t count = Count();
+		if (count == 0) {
+			return 0;
+		}
+
+		uint64_t target = static_cast<uint64_t>(percentile * count + 0.5);
+		if (target < 1) target = 1;
+		if (target > count) target = count;
+
+		uint64_t cumulative = 0;
+		for (int i = 0; i < kBucketCount; ++i) {
+			cumulative += buckets_[i].load(std::memory_order_relaxed);
+			if (cumulative >= target) {
+				// never report more than the exact maximum
+				const uint64_t upper_bound = BucketUpperBound(i);
+				const uint64_t max = Max();
+				return upper_bound < max ? upper_bound : max;
+			}
+		}
+		return Max();
+	}
+
+	double LatencyHistogram::Mean() const
+	{
+		const uint64_t count = Count();
+		return count > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / count : 0.0;
+	}
+
+	void LatencyHistogram::Reset()
+	{
+		for (auto& bucket : buckets_) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		count_.store(0, std::memory_order_relaxed);
+		sum_.store(0, std::memory_order_relaxed);
+		max_.store(0, std::memory_order_relaxed);
+	}
+
+	TopicLatency* LatencyTracer::GetTopicLatency(const std::string& topic_name)
+	{
+		spinlock::scoped_lock_wait_for_short_task lock(topics_mutex_);
+		std::unique_ptr<TopicLatency>& topic_latency = topics_[topic_name];
+		if (!topic_latency) {
+			topic_latency.reset(new TopicLatency());
+		}
+		return topic_latency.get();
+	}
+
+	std::vector<LatencySummary> LatencyTracer::GetSummaries()
+	{
+		std::vector<LatencySummary> summaries;
+
+		spinlock::scoped_lock_wait_for_short_task lock(topics_mutex_);
+		for (const auto& topic : topics_) {
+			for (int i = 0; i < static_cast<int>(LatencySegment::NUM_SEGMENTS); ++i) {
+				const LatencyHistogram& histogram = topic.second->segments_[i];
+				if (histogram.Count() == 0) {
+					continue;
+				}
+
+				LatencySummary summary;
+				summary.topic_ = topic.first;
+				summary.segment_ = static_cast<LatencySegment>(i);
+				summary.count_ = histogram.Count();
+				summary.mean_ms_ = histogram.Mean() / 1e6;
+				summary.p50_ms_ = histogram.ValueAtPercentile(0.5) / 1e6;
+				summary.p90_ms_ = histogram.ValueAtPercentile(0.9) / 1e6;
+				summary.p99_ms_ = histogram.ValueAtPercentile(0.99) / 1e6;
+				summary.max_ms_ = histogram.Max() / 1e6;
+				summaries.push_back(summary);
+			}
+		}
+		return summaries;
+	}
+
+	void LatencyTracer::WriteCSV(std::ostream& out)
+	{
+		WriteCSVHeader(out);
+		WriteCSVRows(out);
+	}
+
+	void LatencyTracer::WriteCSVHeader(std::ostream& out)
+	{
+		out << "topic,segment,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+	}
+
+	void LatencyTracer::WriteCSVRows(std::ostream& out)
+	{
+		for (const LatencySummary& summary : GetSummaries()) {
+			out << summary.topic_ << ',' << LatencySegmentName(summary.segment_) << ',' << summary.count_ << ','
+				<< summary.mean_ms_ << ',' << summary.p50_ms_ << ',' << summary.p90_ms_ << ','
+				<< summary.p99_ms_ << ',' << summary.max_ms_ << '\n';
+		}
+	}
+
+	void LatencyTracer::Reset()
+	{
+		spinlock::scoped_lock_wait_for_short_task lock(topics_mutex_);
+		for (auto& topic : topics_) {
+			for (LatencyHistogram& histogram : topic.second->segments_) {
+				histogram.Reset();
+			}
+		}
+	}
+
+	bool LatencyTracer::GetStampAge(const bson_t& bson, const char* stamp_key, int64_t& age_ns)
+	{
+		const std::string secs_key = std::string(stamp_key) + ".secs";
+		const std::string nsecs_key = std::string(stamp_key) + ".nsecs";
+
+		bson_iter_t iter;
+		bson_iter_t secs;
+		bson_iter_t nsecs;
+		if (!bson_iter_init(&iter, &bson) || !bson_iter_find_descendant(&iter, secs_key.c_str(), &secs)) {
+			return false;
+		}
+		if (!bson_iter_init(&iter, &bson) || !bson_iter_find_descendant(&iter, nsecs_key.c_str(), &nsecs)) {
+			return false;
+		}
+
+		const int64_t stamp_ns = bson_iter_as_int64(&secs) * 1000000000ll + bson_iter_as_int64(&nsecs);
+		if (stamp_ns <= 0) {
+			return false;
+		}
+		age_ns = static_cast<int64_t>(ROSTime::now_ns()) - stamp_ns;
+		return true;
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <bson.h>
+
+#include "spinlock.h"
+
+namespace rosbridge2cpp {
+
+	/**
+	 * A lock-free latency histogram with HDR-style log-linear buckets.
+	 *
+	 * Values below 32ns are stored exactly, larger values are stored in buckets
+	 * with 16 sub-buckets per power of two (less than 6.25% relative error).
+	 * Values above ~18 minutes are clamped into the last bucket.
+	 */
+	class LatencyHistogram {
+	public:
+		static const int kSubBucketBits = 4;
+		static const int kSubBucketCount = 1 << kSubBucketBits;
+		static const int kMaxValueBits = 40;
+		static const int kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+		LatencyHistogram() { Reset(); }
+
+		void Record(int64_t value_ns);
+
+		// Returns the upper bound of the bucket that contains the given percentile (0.0 - 1.0)
+		uint64_t ValueAtPercentile(double percentile) const;
+
+		uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+		uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+		double Mean() const;
+
+		void Reset();
+
+		static int BucketIndex(uint64_t value);
+		static uint64_t BucketUpperBound(int index);
+
+	private:
+		std::atomic<uint32_t> buckets_[kBucketCount];
+		std::atomic<uint64_t> count_;
+		std::atomic<uint64_t> sum_;
+		std::atomic<uint64_t> max_;
+	};
+
+	/**
+	 * The pipeline segments that are measured per topic.
+	 * Outgoing: header.stamp -> UTopic::Publish -> converter -> publisher queue -> socket write
+	 * Incoming: receive -> dispatch -> converter -> callback
+	 */
+	enum class LatencySegment {
+		STAMP_TO_PUBLISH,		// age of header.stamp when UTopic::Publish is called
+		CONVERT_OUTGOING,		// converter encode time
+		ENQUEUE,				// converted -> in publisher queue (envelope creation, locking)
+		QUEUE_WAIT,				// time spent in the publisher queue
+		SOCKET_WRITE,			// transport write
+		PUBLISH_TO_SENT,		// UTopic::Publish -> written to the socket
+		STAMP_TO_RECEIVE,		// age of header.stamp when the message was received
+		RECEIVE_TO_DISPATCH,	// received -> topic callback invoked (envelope parsing, locking)
+		CONVERT_INCOMING,		// converter decode time
+		CALLBACK,				// user callback
+		RECEIVE_TO_DELIVERED,	// received -> user callback returned
+		NUM_SEGMENTS
+	};
+
+	const char* LatencySegmentName(LatencySegment segment);
+
+	// All histograms of a single topic
+	struct TopicLatency {
+		LatencyHistogram segments_[static_cast<int>(LatencySegment::NUM_SEGMENTS)];
+
+		void Record(LatencySegment segment, int64_t value_ns)
+		{
+			segments_[static_cast<int>(segment)].Record(value_ns);
+		}
+	};
+
+	// Timestamps that travel with a single message through the pipeline.
+	// All values are LatencyTracer::Now() timestamps, 0 means 'not taken'.
+	struct MessageTrace {
+		TopicLatency* topic_latency_ = nullptr;
+		int64_t publish_ns_ = 0;
+		int64_t converted_ns_ = 0;
+		int64_t queued_ns_ = 0;
+		int64_t received_ns_ = 0;
+	};
+
+	struct LatencySummary {
+		std::string topic_;
+		LatencySegment segment_;
+		uint64_t count_ = 0;
+		double mean_ms_ = 0.0;
+		double p50_ms_ = 0.0;
+		double p90_ms_ = 0.0;
+		double p99_ms_ = 0.0;
+		double max_ms_ = 0.0;
+	};
+
+	/**
+	 * Collects per topic latency histograms for every pipeline segment.
+	 * Tracing is disabled by default and costs a single relaxed load per message in that case.
+	 */
+	class LatencyTracer {
+	public:
+		LatencyTracer() = default;
+
+		void SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+		bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+		// Returns the histograms for the given topic. The returned pointer stays valid as long as this tracer lives.
+		TopicLatency* GetTopicLatency(const std::string& topic_name);
+
+		std::vector<LatencySummary> GetSummaries();
+
+		// Writes all summaries as CSV with the header
+		// topic,segment,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms
+		void WriteCSV(std::ostream& out);
+
+		// The two parts of WriteCSV, to write the rows of several tracers below a single header
+		static void WriteCSVHeader(std::ostream& out);
+		void WriteCSVRows(std::ostream& out);
+
+		void Reset();
+
+		// Monotonic timestamp in nanoseconds used for all pipeline stages
+		static int64_t Now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// Reads '<key>.secs' and '<key>.nsecs' from the given bson and returns the age of that stamp
+		// relative to ROSTime::now(). Returns false if the stamp is missing.
+		static bool GetStampAge(const bson_t& bson, const char* stamp_key, int64_t& age_ns);
+
+	private:
+		std::atomic<bool> enabled_{ false };
+		spinlock topics_mutex_;
+		std::unordered_map<std::string, std::unique_ptr<TopicLatency>> topics_;
+	};
+}
@@ -0,0 +1,169 @@
+#include "ros_log.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace rosbridge2cpp {
+
+	static const char* LogSeverityNames[] = {
+		"Verbose",
+		"Info",
+		"Warning",
+		"Error"
+	};
+
+	const char* LogSeverityName(LogSeverity severity)
+	{
+		return LogSeverityNames[static_cast<int>(severity)];
+	}
+
+	static_assert((AsyncLogger::kCapacity & (AsyncLogger::kCapacity - 1)) == 0, "AsyncLogger::kCapacity must be a power of two");
+
+	AsyncLogger& AsyncLogger::Get()
+	{
+		static AsyncLogger logger;
+		return logger;
+	}
+
+	AsyncLogger::AsyncLogger()
+	{
+		for (size_t i = 0; i < kCapacity; ++i) {
+			entries_[i].sequence_.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	AsyncLogger::~AsyncLogger()
+	{
+		Stop();
+	}
+
+	void AsyncLogger::SetSink(Sink sink)
+	{
+		std::lock_guard<std::mutex> lock(sink_mutex_);
+		sink_ = std::move(sink);
+	}
+
+	void AsyncLogger::Log(LogSeverity severity, uint32_t suppressed, const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		LogV(severity, suppressed, format, args);
+		va_end(args);
+	}
+
+	void AsyncLogger::LogV(LogSeverity severity, uint32_t suppressed, const char* format, va_list args)
+	{
+		const int state = state_.load(std::memory_order_acquire);
+		if (state == NOT_STARTED) {
+			Start();
+		}
+		else if (state == STOPPED) {
+			char message[kMaxMessageLength];
+			vsnprintf(message, sizeof(message), format, args);
+			Write(severity, message);
+			return;
+		}
+
+		// Bounded MPMC queue by Dmitry Vyukov, with a single consumer
+		size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+		Entry* entry;
+		while (true) {
+			entry = &entries_[pos & (kCapacity - 1)];
+			const size_t sequence = entry->sequence_.load(std::memory_order_acquire);
+			const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+			if (diff == 0) {
+				if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			else {
+				pos = enqueue_pos_.load(std::memory_order_relaxed);
+			}
+		}
+
+		entry->severity_ = severity;
+		int length = vsnprintf(entry->message_, kMaxMessageLength, format, args);
+		if (suppressed > 0 && length >= 0 && static_cast<size_t>(length) < kMaxMessageLength) {
+			snprintf(entry->message_ + length, kMaxMessageLength - length, " (%u similar messages suppressed)", suppressed);
+		}
+		entry->sequence_.store(pos + 1, std::memory_order_release);
+	}
+
+	void AsyncLogger::Start()
+	{
+		std::lock_guard<std::mutex> lock(state_mutex_);
+		if (state_.load(std::memory_order_relaxed) == RUNNING) {
+			return;
+		}
+		state_.store(RUNNING, std::memory_order_release);
+		flush_thread_ = std::thread(&AsyncLogger::RunFlushThread, this);
+	}
+
+	void AsyncLogger::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(state_mutex_);
+			if (state_.load(std::memory_order_relaxed) != RUNNING) {
+				state_.store(STOPPED, std::memory_order_release);
+				return;
+			}
+			state_.store(STOPPED, std::memory_order_release);
+		}
+		stop_requested_.notify_all();
+		if (flush_thread_.joinable()) {
+			flush_thread_.join();
+		}
+		// messages that were queued while stopping
+		Drain();
+	}
+
+	void AsyncLogger::RunFlushThread()
+	{
+		std::unique_lock<std::mutex> lock(state_mutex_);
+		while (state_.load(std::memory_order_relaxed) == RUNNING) {
+			lock.unlock();
+			Drain();
+			lock.lock();
+			stop_requested_.wait_for(lock, std::chrono::milliseconds(10));
+		}
+	}
+
+	size_t AsyncLogger::Drain()
+	{
+		size_t num_written = 0;
+		while (true) {
+			Entry& entry = entries_[dequeue_pos_ & (kCapacity - 1)];
+			if (entry.sequence_.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+				break;
+			}
+			Write(entry.severity_, entry.message_);
+			entry.sequence_.store(dequeue_pos_ + kCapacity, std::memory_order_release);
+			++dequeue_pos_;
+			++num_written;
+		}
+
+		const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+		if (dropped != reported_dropped_) {
+			char message[kMaxMessageLength];
+			snprintf(message, sizeof(message), "[AsyncLogger] Log buffer full, dropped %llu messages", static_cast<unsigned long long>(dropped - reported_dropped_));
+			reported_dropped_ = dropped;
+			Write(LogSeverity::SEVERITY_WARNING, message);
+		}
+		return num_written;
+	}
+
+	void AsyncLogger::Write(LogSeverity severity, const char* message)
+	{
+		std::lock_guard<std::mutex> lock(sink_mutex_);
+		if (sink_) {
+			sink_(severity, message);
+		}
+		else {
+			fprintf(stderr, "[%s] %s\n", LogSeverityName(severity), message);
+		}
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace rosbridge2cpp {
+
+	// Prefixed to avoid clashes with the ERROR and LOG_* macros of windows.h and syslog.h
+	enum class LogSeverity : int {
+		SEVERITY_VERBOSE = 0,
+		SEVERITY_INFO,
+		SEVERITY_WARNING,
+		SEVERITY_ERROR
+	};
+
+	const char* LogSeverityName(LogSeverity severity);
+
+	/**
+	 * Limits a single log call site to a number of messages per second.
+	 * Suppressed messages are counted and reported with the next message that passes.
+	 */
+	class LogRateLimiter {
+	public:
+		explicit LogRateLimiter(uint32_t max_per_second) : max_per_second_(max_per_second) {}
+
+		// Returns true if the message may be logged. suppressed is set to the number of messages
+		// of this call site that were dropped since the last one that was logged.
+		bool Allow(uint32_t& suppressed)
+		{
+			const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			int64_t window_start_ns = window_start_ns_.load(std::memory_order_relaxed);
+			if (now_ns - window_start_ns >= 1000000000ll &&
+				window_start_ns_.compare_exchange_strong(window_start_ns, now_ns, std::memory_order_relaxed)) {
+				count_.store(0, std::memory_order_relaxed);
+			}
+
+			if (count_.fetch_add(1, std::memory_order_relaxed) >= max_per_second_) {
+				suppressed_.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+			return true;
+		}
+
+	private:
+		const uint32_t max_per_second_;
+		std::atomic<int64_t> window_start_ns_{ 0 };
+		std::atomic<uint32_t> count_{ 0 };
+		std::atomic<uint32_t> suppressed_{ 0 };
+	};
+
+	/**
+	 * Asynchronous log sink for rosbridge2cpp.
+	 *
+	 * Log() formats the message into a slot of a lock-free ring buffer and returns, a background
+	 * thread hands the messages to the sink (stderr by default, LogROS inside the engine).
+	 * If the ring buffer is full the message is dropped and counted instead of blocking the caller.
+	 * Use the ROS_LOG_* macros, they check the severity and the rate limit of the call site first.
+	 */
+	class AsyncLogger {
+	public:
+		typedef std::function<void(LogSeverity, const char*)> Sink;
+
+		static const size_t kCapacity = 1024; // must be a power of two
+		static const size_t kMaxMessageLength = 256;
+
+		static AsyncLogger& Get();
+
+		~AsyncLogger();
+
+		void SetMinSeverity(LogSeverity severity) { min_severity_.store(static_cast<int>(severity), std::memory_order_relaxed); }
+		LogSeverity GetMinSeverity() const { return static_cast<LogSeverity>(min_severity_.load(std::memory_order_relaxed)); }
+		bool IsEnabled(LogSeverity severity) const { return static_cast<int>(severity) >= min_severity_.load(std::memory_order_relaxed); }
+
+		// The sink is only called from the flush thread. An empty sink writes to stderr.
+		void SetSink(Sink sink);
+
+		// printf style, suppressed is the number of messages the rate limiter of the call site dropped
+		void Log(LogSeverity severity, uint32_t suppressed, const char* format, ...);
+		void LogV(LogSeverity severity, uint32_t suppressed, const char* format, va_list args);
+
+		// Starts the flush thread. Log() starts it on first use as well.
+		void Start();
+
+		// Writes all pending messages and stops the flush thread. Messages logged afterwards are written synchronously.
+		void Stop();
+
+		uint64_t GetDroppedMessages() const { return dropped_.load(std::memory_order_relaxed); }
+
+	private:
+		AsyncLogger();
+
+		struct Entry {
+			std::atomic<size_t> sequence_;
+			LogSeverity severity_;
+			char message_[kMaxMessageLength];
+		};
+
+		void RunFlushThread();
+		size_t Drain();
+		void Write(LogSeverity severity, const char* message);
+
+		std::atomic<int> min_severity_{ static_cast<int>(LogSeverity::SEVERITY_INFO) };
+
+		Entry entries_[kCapacity];
+		std::atomic<size_t> enqueue_pos_{ 0 };
+		size_t dequeue_pos_ = 0; // flush thread only
+
+		std::atomic<uint64_t> dropped_{ 0 };
+		uint64_t reported_dropped_ = 0;
+
+		std::mutex sink_mutex_;
+		Sink sink_;
+
+		enum State { NOT_STARTED, RUNNING, STOPPED };
+		std::atomic<int> state_{ NOT_STARTED };
+		std::mutex state_mutex_;
+		std::condition_variable stop_requested_;
+		std::thread flush_thread_;
+	};
+}
+
+// Logs a printf style message if the severity is enabled and the call site stayed below MaxPerSecond messages.
+// A suppressed call costs a relaxed load (severity) or a clock read and two relaxed atomics (rate limit).
+#define ROS_LOG(Severity, MaxPerSecond, ...) \
+	do { \
+		if (::rosbridge2cpp::AsyncLogger::Get().IsEnabled(Severity)) { \
+			static ::rosbridge2cpp::LogRateLimiter ros_log_rate_limiter(MaxPerSecond); \
+			uint32_t ros_log_suppressed = 0; \
+			if (ros_log_rate_limiter.Allow(ros_log_suppressed)) { \
+				::rosbridge2cpp::AsyncLogger::Get().Log(Severity, ros_log_suppressed, __VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+#define ROS_LOG_VERBOSE(...) ROS_LOG(::rosbridge2cpp::LogSeverity::SEVERITY_VERBOSE, 10, __VA_ARGS__)
+#define ROS_LOG_INFO(...) ROS_LOG(::rosbridge2cpp::LogSeverity::SEVERITY_INFO, 10, __VA_ARGS__)
+#define ROS_LOG_WARNING(...) ROS_LOG(::rosbridge2cpp::LogSeverity::SEVERITY_WARNING, 10, __VA_ARGS__)
+#define ROS_LOG_ERROR(...) ROS_LOG(::rosbridge2cpp::LogSeverity::SEVERITY_ERROR, 10, __VA_ARGS__)
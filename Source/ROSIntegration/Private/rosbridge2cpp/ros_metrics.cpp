@@ -0,0 +1,78 @@
+#include "ros_metrics.h"
+
+namespace rosbridge2cpp {
+
+	TopicMetrics* MetricsRegistry::GetTopicMetrics(const std::string& topic_name)
+	{
+		spinlock::scoped_lock_wait_for_short_task lock(topics_mutex_);
+		std::unique_ptr<TopicMetrics>& topic_metrics = topics_[topic_name];
+		if (!topic_metrics) {
+			topic_metrics.reset(new TopicMetrics());
+		}
+		return topic_metrics.get();
+	}
+
+	std::vector<TopicMetricsSnapshot> MetricsRegistry::GetTopicSnapshots()
+	{
+		std::vector<TopicMetricsSnapshot> snapshots;
+
+		spinlock::scoped_lock_wait_for_short_task lock(topics_mutex_);
+		snapshots.reserve(topics_.size());
+		for (const auto& topic : topics_) {
+			const TopicMetrics& metrics = *topic.second;
+
+			TopicMetricsSnapshot snapshot;
+			snapshot.topic_ = topic.first;
+			snapshot.published_ = metrics.published_.Get();
+			snapshot.sent_ = metrics.sent_.Get();
+			snapshot.dropped_ = metrics.dropped_.Get();
+			snapshot.bytes_out_ = metrics.bytes_out_.Get();
+			snapshot.send_time_ns_ = metrics.send_time_ns_.Get();
+			snapshot.queue_depth_ = metrics.queue_depth_.Get();
+			snapshot.received_ = metrics.received_.Get();
+			snapshot.decoded_ = metrics.decoded_.Get();
+			snapshot.decode_failures_ = metrics.decode_failures_.Get();
+			snapshot.bytes_in_ = metrics.bytes_in_.Get();
+			snapshot.decode_time_ns_ = metrics.decode_time_ns_.Get();
+			snapshot.conflated_ = metrics.conflated_.Get();
+			snapshot.local_dropped_ = metrics.local_dropped_.Get();
+			snapshot.receiver_blocked_ = metrics.receiver_blocked_.Get();
+			snapshot.delivered_locally_ = metrics.delivered_locally_.Get();
+			snapshots.push_back(snapshot);
+		}
+		return snapshots;
+	}
+
+	ConnectionMetricsSnapshot MetricsRegistry::GetConnectionSnapshot() const
+	{
+		ConnectionMetricsSnapshot snapshot;
+		snapshot.messages_sent_ = connection_.messages_sent_.Get();
+		snapshot.bytes_sent_ = connection_.bytes_sent_.Get();
+		snapshot.send_errors_ = connection_.send_errors_.Get();
+		snapshot.send_stalls_ = connection_.send_stalls_.Get();
+		snapshot.shared_memory_payloads_ = connection_.shared_memory_payloads_.Get();
+		snapshot.shared_memory_bytes_ = connection_.shared_memory_bytes_.Get();
+		snapshot.messages_received_ = connection_.messages_received_.Get();
+		snapshot.bytes_received_ = connection_.bytes_received_.Get();
+		return snapshot;
+	}
+
+	void MetricsRegistry::Reset()
+	{
+		spinlock::scoped_lock_wait_for_short_task lock(topics_mutex_);
+		for (auto& topic : topics_) {
+			TopicMetrics& metrics = *topic.second;
+			for (MetricsCounter* counter : { &metrics.published_, &metrics.sent_, &metrics.dropped_, &metrics.bytes_out_,
+				&metrics.send_time_ns_, &metrics.received_, &metrics.decoded_, &metrics.decode_failures_,
+				&metrics.bytes_in_, &metrics.decode_time_ns_, &metrics.conflated_, &metrics.local_dropped_,
+				&metrics.receiver_blocked_, &metrics.delivered_locally_ }) {
+				counter->Set(0);
+			}
+		}
+		for (MetricsCounter* counter : { &connection_.messages_sent_, &connection_.bytes_sent_, &connection_.send_errors_,
+			&connection_.send_stalls_, &connection_.shared_memory_payloads_, &connection_.shared_memory_bytes_,
+			&connection_.messages_received_, &connection_.bytes_received_ }) {
+			counter->Set(0);
+		}
+	}
+}
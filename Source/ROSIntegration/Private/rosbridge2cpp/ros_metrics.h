@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "spinlock.h"
+
+namespace rosbridge2cpp {
+
+	// A relaxed atomic counter. Counters are only read for statistics, so no ordering is required.
+	class MetricsCounter {
+	public:
+		void Add(uint64_t value = 1) { value_.fetch_add(value, std::memory_order_relaxed); }
+		void Set(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+		uint64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<uint64_t> value_{ 0 };
+	};
+
+	// Runtime counters of a single topic
+	struct TopicMetrics {
+		// outgoing
+		MetricsCounter published_;		// messages handed to the publisher queue
+		MetricsCounter sent_;			// messages written to the transport
+		MetricsCounter dropped_;		// messages lost to a full publisher queue or a failed write
+		MetricsCounter bytes_out_;
+		MetricsCounter send_time_ns_;	// accumulated transport write time
+		MetricsCounter queue_depth_;	// current number of messages in the publisher queue
+
+		// incoming
+		MetricsCounter received_;		// publish messages received for this topic
+		MetricsCounter decoded_;		// messages successfully converted for a subscriber
+		MetricsCounter decode_failures_;
+		MetricsCounter bytes_in_;
+		MetricsCounter decode_time_ns_;	// accumulated converter time
+		MetricsCounter conflated_;		// decoded messages a conflating subscriber replaced by a newer one before delivery
+		MetricsCounter local_dropped_;	// decoded messages lost to a full local subscriber queue
+		MetricsCounter receiver_blocked_; // times a full local subscriber queue stopped the receiver thread
+
+		// intra-process
+		MetricsCounter delivered_locally_; // published messages handed to subscribers in the same process
+	};
+
+	// Runtime counters of the connection to the rosbridge server, including all non-topic traffic
+	struct ConnectionMetrics {
+		MetricsCounter messages_sent_;
+		MetricsCounter bytes_sent_;
+		MetricsCounter send_errors_;
+		MetricsCounter send_stalls_; // writes the transport gave up because the server didn't read
+		MetricsCounter shared_memory_payloads_; // binary fields passed through the SharedMemoryRing instead of the socket
+		MetricsCounter shared_memory_bytes_;
+		MetricsCounter messages_received_;
+		MetricsCounter bytes_received_;
+	};
+
+	// Plain copy of the counters of a topic at the time of the snapshot
+	struct TopicMetricsSnapshot {
+		std::string topic_;
+		uint64_t published_ = 0;
+		uint64_t sent_ = 0;
+		uint64_t dropped_ = 0;
+		uint64_t bytes_out_ = 0;
+		uint64_t send_time_ns_ = 0;
+		uint64_t queue_depth_ = 0;
+		uint64_t received_ = 0;
+		uint64_t decoded_ = 0;
+		uint64_t decode_failures_ = 0;
+		uint64_t bytes_in_ = 0;
+		uint64_t decode_time_ns_ = 0;
+		uint64_t conflated_ = 0;
+		uint64_t local_dropped_ = 0;
+		uint64_t receiver_blocked_ = 0;
+		uint64_t delivered_locally_ = 0;
+	};
+
+	struct ConnectionMetricsSnapshot {
+		uint64_t messages_sent_ = 0;
+		uint64_t bytes_sent_ = 0;
+		uint64_t send_errors_ = 0;
+		uint64_t send_stalls_ = 0;
+		uint64_t shared_memory_payloads_ = 0;
+		uint64_t shared_memory_bytes_ = 0;
+		uint64_t messages_received_ = 0;
+		uint64_t bytes_received_ = 0;
+	};
+
+	/**
+	 * Owns the metrics of all topics of a ROSBridge.
+	 *
+	 * The counters are always enabled. Hot paths should look up the TopicMetrics of a topic once
+	 * and keep the pointer, which stays valid as long as the registry lives.
+	 */
+	class MetricsRegistry {
+	public:
+		TopicMetrics* GetTopicMetrics(const std::string& topic_name);
+		ConnectionMetrics& GetConnectionMetrics() { return connection_; }
+
+		std::vector<TopicMetricsSnapshot> GetTopicSnapshots();
+		ConnectionMetricsSnapshot GetConnectionSnapshot() const;
+
+		// Clears all counters except the current queue depths
+		void Reset();
+
+	private:
+		spinlock topics_mutex_;
+		std::unordered_map<std::string, std::unique_ptr<TopicMetrics>> topics_;
+		ConnectionMetrics connection_;
+	};
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+/**
+ * Profiler instrumentation for the bridge.
+ *
+ * Inside the engine the scopes show up in Unreal Insights as CPU events on the 'ROS' trace
+ * channel (e.g. -trace=cpu,ros), next to the game and render thread. The standalone build
+ * of rosbridge2cpp (Tools/RosbridgeBench) compiles all of them to nothing.
+ *
+ *   ROS_PROFILER_SCOPE("ROS::Receive");                     // CPU scope until the end of the block
+ *   ROS_PROFILER_THREAD_NAME("ROSBridgeReceiver");          // names the calling std::thread
+ *   ROS_PROFILER_MESSAGE("in", topic.c_str(), bson.len);    // bookmark with topic and size
+ *
+ * The message bookmarks are only emitted while the ROS channel is enabled.
+ */
+
+#if defined(WITH_ENGINE)
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTLS.h"
+
+#if ENGINE_MINOR_VERSION > 25 || ENGINE_MAJOR_VERSION > 4
+#define ROS_WITH_TRACE 1
+#else
+#define ROS_WITH_TRACE 0
+#endif
+
+#if ROS_WITH_TRACE
+
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/MiscTrace.h"
+
+UE_TRACE_CHANNEL_EXTERN(ROSChannel, ROSINTEGRATION_API);
+
+#if ENGINE_MAJOR_VERSION > 4
+#define ROS_TRACE_NAMESPACE UE::Trace
+#else
+#define ROS_TRACE_NAMESPACE Trace
+#endif
+
+#define ROS_PROFILER_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR(Name, ROSChannel)
+
+#define ROS_PROFILER_THREAD_NAME(Name) \
+	do { \
+		FPlatformProcess::SetThreadName(TEXT(Name)); \
+		ROS_TRACE_NAMESPACE::ThreadRegister(TEXT(Name), FPlatformTLS::GetCurrentThreadId(), 0); \
+	} while (0)
+
+#define ROS_PROFILER_MESSAGE(Direction, Topic, NumBytes) \
+	do { \
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(ROSChannel)) { \
+			TRACE_BOOKMARK(TEXT("ROS %s %s (%u bytes)"), TEXT(Direction), UTF8_TO_TCHAR(Topic), static_cast<uint32>(NumBytes)); \
+		} \
+	} while (0)
+
+#else // ROS_WITH_TRACE
+
+#define ROS_PROFILER_SCOPE(Name)
+#define ROS_PROFILER_THREAD_NAME(Name) FPlatformProcess::SetThreadName(TEXT(Name))
+#define ROS_PROFILER_MESSAGE(Direction, Topic, NumBytes)
+
+#endif // ROS_WITH_TRACE
+
+#else // WITH_ENGINE
+
+#define ROS_PROFILER_SCOPE(Name)
+#define ROS_PROFILER_THREAD_NAME(Name)
+#define ROS_PROFILER_MESSAGE(Direction, Topic, NumBytes)
+
+#endif // WITH_ENGINE
@@ -18,36 +18,107 @@ namespace rosbridge2cpp{
 		std::string service_call_id = GenerateServiceCallID();
 
 		// Register the callback with the given call id in the ROSBridge
-		ros_.RegisterServiceCallback(service_call_id, callback);
+		if (!ros_.RegisterServiceCallback(service_call_id, callback))
+			return false;
 
 		ROSBridgeCallServiceMsg cmd(true);
 		cmd.id_ = service_call_id;
 		cmd.service_ = service_name_;
 		cmd.args_json_ = request;
 
-		return ros_.SendMessage(cmd);
+		if (!ros_.SendMessage(cmd)) {
+			ros_.UnregisterServiceCallback(service_call_id);
+			return false;
+		}
+		return true;
 	}
 
 	bool ROSService::CallService(bson_t *request, FunVrROSServiceResponseMsg callback) {
-		if (is_advertised_)	// You can't use an advertised ROSService instance to call services.
-			return false;	// Use a separate instance
+		std::string service_call_id;
+		return CallService(request, callback, std::chrono::milliseconds(0), nullptr, service_call_id);
+	}
 
+	bool ROSService::CallService(bson_t *request, FunVrROSServiceResponseMsg callback, std::chrono::milliseconds timeout,
+		FunVServiceCallError error_callback, std::string &service_call_id) {
 		assert(request);
 
-		std::string service_call_id = GenerateServiceCallID();
+		if (is_advertised_) {	// You can't use an advertised ROSService instance to call services.
+			bson_destroy(request);	// Use a separate instance
+			if (error_callback) error_callback(ServiceCallError::SEND_FAILED);
+			return false;
+		}
+
+		service_call_id = GenerateServiceCallID();
 
 		// Register the callback with the given call id in the ROSBridge
-		ros_.RegisterServiceCallback(service_call_id, callback);
+		if (!ros_.RegisterServiceCallback(service_call_id, callback, timeout, error_callback)) {
+			bson_destroy(request);
+			if (error_callback) error_callback(ServiceCallError::REJECTED);
+			return false;
+		}
+
+		std::string request_id = service_call_id; // of the call_service message that is sent
+		std::shared_ptr<bson_t> request_key;
+		if (response_cache_ && ros_.bson_only_mode()) {
+			// The cache completes this call through the ROSBridge, like a received response. It can be cancelled
+			// and times out on its own, without affecting others that wait for the same response.
+			ROSBridge &ros = ros_;
+			const std::string id = service_call_id;
+			std::unique_ptr<ROSBridgeServiceResponseMsg> cached_response;
+			const ServiceResponseCache::LookupResult result = response_cache_->Lookup(*request,
+				[&ros, id](ROSBridgeServiceResponseMsg &response) { ros.CompleteServiceCall(id, response); },
+				[&ros, id](ServiceCallError error) { ros.FailServiceCall(id, error); },
+				timeout, cached_response);
+
+			if (result == ServiceResponseCache::LookupResult::HIT) {
+				bson_destroy(request);
+				ros_.PostServiceResponse(service_call_id, std::move(cached_response));
+				return true;
+			}
+			if (result == ServiceResponseCache::LookupResult::JOINED) {
+				bson_destroy(request); // collapsed into an identical call in flight
+				return true;
+			}
+			if (result == ServiceResponseCache::LookupResult::MISS) {
+				// the request is sent under an id of its own, its response serves the caller and everyone who joined in the meantime
+				request_key = std::shared_ptr<bson_t>(bson_copy(request), bson_destroy);
+				std::shared_ptr<ServiceResponseCache> response_cache = response_cache_;
+				request_id = GenerateServiceCallID();
+				if (!ros_.RegisterServiceCallback(request_id,
+					[response_cache, request_key](ROSBridgeServiceResponseMsg &response) { response_cache->Complete(*request_key, response); },
+					timeout,
+					[response_cache, request_key](ServiceCallError error) { response_cache->Fail(*request_key, error); })) {
+					bson_destroy(request);
+					response_cache_->Fail(*request_key, ServiceCallError::REJECTED);
+					return false;
+				}
+			}
+		}
 
 		ROSBridgeCallServiceMsg cmd(true);
-		cmd.id_ = service_call_id;
+		cmd.id_ = request_id;
 		cmd.service_ = service_name_;
 		cmd.args_bson_ = request;
 
-		return ros_.SendMessage(cmd);
+		if (!ros_.SendMessage(cmd)) {
+			// nobody will ever answer this call
+			if (request_key) {
+				if (ros_.UnregisterServiceCallback(request_id))
+					response_cache_->Fail(*request_key, ServiceCallError::SEND_FAILED);
+			}
+			else {
+				ros_.FailServiceCall(service_call_id, ServiceCallError::SEND_FAILED);
+			}
+			return false;
+		}
+		return true;
+	}
+
+	bool ROSService::CancelServiceCall(const std::string &service_call_id) {
+		return ros_.UnregisterServiceCallback(service_call_id);
 	}
 
-	bool ROSService::Advertise(FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator callback) {
+	bool ROSService::Advertise(FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator callback, FunVBool on_result) {
 		if (is_advertised_)
 			return true;
 
@@ -58,11 +129,11 @@ namespace rosbridge2cpp{
 		cmd.service_ = service_name_;
 		cmd.type_ = service_type_;
 
-		is_advertised_ = ros_.SendMessage(cmd);
+		is_advertised_ = ros_.SendControlMessage(cmd, on_result);
 		return is_advertised_;
 	}
 
-	bool ROSService::Advertise(FunVrROSCallServiceMsgrROSServiceResponseMsg callback) {
+	bool ROSService::Advertise(FunVrROSCallServiceMsgrROSServiceResponseMsg callback, FunVBool on_result) {
 		if (is_advertised_)
 			return true;
 
@@ -73,7 +144,7 @@ namespace rosbridge2cpp{
 		cmd.service_ = service_name_;
 		cmd.type_ = service_type_;
 
-		is_advertised_ = ros_.SendMessage(cmd);
+		is_advertised_ = ros_.SendControlMessage(cmd, on_result);
 		return is_advertised_;
 	}
 
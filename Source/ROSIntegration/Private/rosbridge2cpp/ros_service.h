@@ -1,11 +1,13 @@
 #pragma once
 
 #include <list>
+#include <memory>
 
 #include "rapidjson/document.h"
 
 #include "ros_bridge.h"
 #include "types.h"
+#include "service_response_cache.h"
 #include "messages/rosbridge_advertise_service_msg.h"
 #include "messages/rosbridge_call_service_msg.h"
 #include "messages/rosbridge_unadvertise_service_msg.h"
@@ -28,8 +30,11 @@ namespace rosbridge2cpp {
 		//
 		// This method will only be used when using rapidjson, since we need to use
 		// the allocator of rapidjson to avoid copy operations.
-		bool Advertise(FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator callback);
-		bool Advertise(FunVrROSCallServiceMsgrROSServiceResponseMsg callback);
+		//
+		// on_result receives the result of sending 'advertise_service', asynchronously if
+		// the ROSBridge batches control messages (see ROSBridge::SendControlMessage).
+		bool Advertise(FunVrROSCallServiceMsgrROSServiceResponseMsgrAllocator callback, FunVBool on_result = nullptr);
+		bool Advertise(FunVrROSCallServiceMsgrROSServiceResponseMsg callback, FunVBool on_result = nullptr);
 
 		// Unadvertise an advertised service
 		// Will do nothing if no service has been advertised before in this instance
@@ -44,6 +49,26 @@ namespace rosbridge2cpp {
 		bool CallService(rapidjson::Value &request, FunVrROSServiceResponseMsg callback);
 		bool CallService(bson_t *request, FunVrROSServiceResponseMsg callback);
 
+		// Call a ROS-Service with a timeout.
+		// Either callback or error_callback will be called exactly once, unless the call
+		// is cancelled with CancelServiceCall(). service_call_id receives the id of this call.
+		//
+		// Returns false if too many calls are pending (see ROSBridge::SetMaxPendingServiceCalls)
+		// or the request couldn't be sent. error_callback has been called with REJECTED or SEND_FAILED in that case.
+		bool CallService(bson_t *request, FunVrROSServiceResponseMsg callback, std::chrono::milliseconds timeout,
+			FunVServiceCallError error_callback, std::string &service_call_id);
+
+		// Drops the callbacks of a pending service call. A late response will be ignored.
+		bool CancelServiceCall(const std::string &service_call_id);
+
+		// Serve identical requests from the given cache instead of calling the service again (BSON mode only).
+		// Pass nullptr to disable the cache. Calls that go through the cache complete asynchronously like any other
+		// call: a cached response is delivered on the timer thread of the ROSBridge (see ROSBridge::PostServiceResponse).
+		// They can be cancelled with their service_call_id, which doesn't affect other callers that wait for the same response.
+		void SetResponseCache(std::shared_ptr<ServiceResponseCache> response_cache) {
+			response_cache_ = response_cache;
+		}
+
 		std::string GenerateServiceCallID();
 
 		std::string ServiceName() {
@@ -55,5 +80,6 @@ namespace rosbridge2cpp {
 		std::string service_name_;
 		std::string service_type_;
 		bool is_advertised_ = false;
+		std::shared_ptr<ServiceResponseCache> response_cache_;
 	};
 }
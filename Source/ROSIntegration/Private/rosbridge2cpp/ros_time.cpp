@@ -2,27 +2,62 @@
 
 namespace rosbridge2cpp {
 
-	bool ROSTime::use_sim_time = false;
-	ROSTime ROSTime::sim_time(0, 0);
+	static const uint64_t SimTimeEnabledBit = 1ull << 63;
+	static const uint64_t SimTimeValueMask = ~SimTimeEnabledBit;
 
-	static std::chrono::high_resolution_clock::duration ComputeHRC1970EpocDelta()
+	std::atomic<uint64_t> ROSTime::sim_clock_(0);
+
+	static std::chrono::nanoseconds ComputeSteadyClock1970EpocDelta()
+	{
+		const std::chrono::steady_clock::time_point steady_time = std::chrono::steady_clock::now();
+		const std::chrono::system_clock::time_point system_time = std::chrono::system_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(system_time.time_since_epoch())
+			- std::chrono::duration_cast<std::chrono::nanoseconds>(steady_time.time_since_epoch());
+	}
+
+	const std::chrono::nanoseconds ROSTime::SteadyClockEpochOffset = ComputeSteadyClock1970EpocDelta();
+
+	uint64_t ROSTime::now_ns()
 	{
-		const std::chrono::high_resolution_clock::time_point hr_time_since_epoch = std::chrono::high_resolution_clock::now();
-		const std::chrono::system_clock::time_point time_since_epoch = std::chrono::system_clock::now();
-		return time_since_epoch.time_since_epoch() - hr_time_since_epoch.time_since_epoch();
+		const uint64_t sim_clock = sim_clock_.load(std::memory_order_acquire);
+		if (sim_clock & SimTimeEnabledBit) {
+			return sim_clock & SimTimeValueMask;
+		}
+
+		const std::chrono::nanoseconds time_since_epoch = SteadyClockEpochOffset + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+		return static_cast<uint64_t>(time_since_epoch.count());
 	}
 
-	const std::chrono::high_resolution_clock::duration ROSTime::HRCEpocOffset = ComputeHRC1970EpocDelta();
+	ROSTime ROSTime::now()
+	{
+		return FromNSec(now_ns());
+	}
 
-	ROSTime ROSTime::now() {
+	void ROSTime::SetUseSimTime(bool use_sim_time)
+	{
 		if (use_sim_time) {
-			return sim_time;
+			sim_clock_.fetch_or(SimTimeEnabledBit, std::memory_order_acq_rel);
 		}
+		else {
+			sim_clock_.fetch_and(SimTimeValueMask, std::memory_order_acq_rel);
+		}
+	}
+
+	bool ROSTime::UseSimTime()
+	{
+		return (sim_clock_.load(std::memory_order_acquire) & SimTimeEnabledBit) != 0;
+	}
 
-		const std::chrono::high_resolution_clock::duration time_since_epoch = HRCEpocOffset + std::chrono::high_resolution_clock::now().time_since_epoch();
-		unsigned long seconds_since_epoch = std::chrono::duration_cast<std::chrono::seconds>(time_since_epoch).count();
-		unsigned long long nanoseconds_since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time_since_epoch).count();
-		unsigned long nanosecond_difference = nanoseconds_since_epoch - (seconds_since_epoch * 1000000000ul);
-		return ROSTime(seconds_since_epoch, nanosecond_difference);
+	void ROSTime::SetSimTime(const ROSTime& time)
+	{
+		const uint64_t value = time.ToNSec() & SimTimeValueMask;
+		uint64_t expected = sim_clock_.load(std::memory_order_relaxed);
+		while (!sim_clock_.compare_exchange_weak(expected, (expected & SimTimeEnabledBit) | value, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+		}
+	}
+
+	ROSTime ROSTime::SimTime()
+	{
+		return FromNSec(sim_clock_.load(std::memory_order_acquire) & SimTimeValueMask);
 	}
 }
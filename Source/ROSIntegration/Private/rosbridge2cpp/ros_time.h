@@ -1,5 +1,7 @@
 #pragma once
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 
 namespace rosbridge2cpp {
 	/**
@@ -7,20 +9,49 @@ namespace rosbridge2cpp {
 	 *
 	 * sec_ contains the seconds sind 1.1.1970.
 	 * nsec_ contains the rest nanoseconds from sec_ up to the given time
+	 *
+	 * The simulated clock is shared between the game thread (writer) and any number of
+	 * converter, sensor or network threads (readers). It is packed into a single 64 bit atomic word,
+	 * so readers can never observe a torn sec_/nsec_ pair and don't need any additional locking:
+	 * the lower 63 bits hold the simulated nanoseconds since 1.1.1970, the upper bit tells if simulated time is in use.
 	 */
 	class ROSTime {
 	public:
 		ROSTime() = default;
 		ROSTime(unsigned long sec, unsigned long nsec) : sec_(sec), nsec_(nsec) {}
 
+		// Returns the simulated time if SetUseSimTime(true) has been called, the wall clock time otherwise.
+		// The wall clock is derived from a monotonic clock, so it never jumps backwards.
+		// When simulated time is in use, this costs exactly one atomic load.
 		static ROSTime now();
 
-		unsigned long sec_;
-		unsigned long nsec_;
+		// Same as now(), but as nanoseconds since 1.1.1970
+		static uint64_t now_ns();
+
+		static void SetUseSimTime(bool use_sim_time);
+		static bool UseSimTime();
+
+		// Sets the simulated time. Readers see either the old or the new time, never a mix of both.
+		static void SetSimTime(const ROSTime& time);
+		static ROSTime SimTime();
+
+		uint64_t ToNSec() const
+		{
+			return static_cast<uint64_t>(sec_) * 1000000000ull + nsec_;
+		}
+
+		static ROSTime FromNSec(uint64_t nsec)
+		{
+			return ROSTime(static_cast<unsigned long>(nsec / 1000000000ull), static_cast<unsigned long>(nsec % 1000000000ull));
+		}
+
+		unsigned long sec_ = 0;
+		unsigned long nsec_ = 0;
 
-		static bool use_sim_time;
-		static ROSTime sim_time;
+		// Offset between the monotonic steady_clock and the unix epoch, sampled once at startup
+		static const std::chrono::nanoseconds SteadyClockEpochOffset;
 
-		static const std::chrono::high_resolution_clock::duration HRCEpocOffset;
+	private:
+		static std::atomic<uint64_t> sim_clock_;
 	};
 }
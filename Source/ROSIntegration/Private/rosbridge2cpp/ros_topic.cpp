@@ -1,8 +1,9 @@
 #include "ros_topic.h"
+#include "ros_log.h"
 
 namespace rosbridge2cpp {
 
-	ROSCallbackHandle<FunVrROSPublishMsg> ROSTopic::Subscribe(FunVrROSPublishMsg callback)
+	ROSCallbackHandle<FunVrROSPublishMsg> ROSTopic::Subscribe(FunVrROSPublishMsg callback, FunVBool on_result)
 	{
 		++subscription_counter_;
 
@@ -17,11 +18,16 @@ namespace rosbridge2cpp {
 			cmd.id_ = subscribe_id_;
 			cmd.topic_ = topic_name_;
 			cmd.type_ = message_type_;
-			cmd.compression_ = compression_;
+			if (compression_ != "none" && !ros_.bson_only_mode()) {
+				ROS_LOG_WARNING("[ROSTopic] Compression %s needs the BSON mode, subscribing to %s without compression", compression_.c_str(), topic_name_.c_str());
+				compression_ = "none";
+			}
+			cmd.compression_ = compression_ != "none" ? compression_ : ros_.GetSubscriptionCompression();
 			cmd.throttle_rate_ = throttle_rate_;
-			cmd.queue_length_ = queue_size_;
+			cmd.queue_length_ = queue_length_ >= 0 ? queue_length_ : queue_size_;
+			cmd.fragment_size_ = fragment_size_;
 
-			if (!ros_.SendMessage(cmd))
+			if (!ros_.SendControlMessage(cmd, on_result))
 			{
 				subscribe_id_ = "";
 			}
@@ -47,7 +53,7 @@ namespace rosbridge2cpp {
 
 		if (!ros_.UnregisterTopicCallback(topic_name_, callback_handle)) { // Unregister callback in ROSBridge
 			// failed to unregister callback - maybe the method is different from already registered callbacks
-			std::cerr << "[ROSTopic] Passed unknown callback to ROSTopic::unsubscribe. This callback is not registered in the ROSBridge instance. Aborting..." << std::endl;
+			ROS_LOG_WARNING("[ROSTopic] Passed unknown callback to ROSTopic::unsubscribe. This callback is not registered in the ROSBridge instance. Aborting...");
 			return false;
 		}
 
@@ -56,7 +62,7 @@ namespace rosbridge2cpp {
 		if (subscription_counter_ > 0)
 			return true;
 
-		std::cout << "[ROSTopic] No callbacks registered anymore - unsubscribe from topic" << std::endl;
+		ROS_LOG_VERBOSE("[ROSTopic] No callbacks registered anymore - unsubscribe from topic");
 		// Handle unsubscription when no callback is registered anymore
 		//rapidjson::Document cmd;
 		//cmd.SetObject();
@@ -73,7 +79,7 @@ namespace rosbridge2cpp {
 		return false;
 	}
 
-	bool ROSTopic::Advertise()
+	bool ROSTopic::Advertise(FunVBool on_result)
 	{
 		if (is_advertised_)
 			return true;
@@ -91,7 +97,7 @@ namespace rosbridge2cpp {
 		cmd.latch_ = latch_;
 		cmd.queue_size_ = queue_size_;
 
-		if (ros_.SendMessage(cmd)) {
+		if (ros_.SendControlMessage(cmd, on_result)) {
 			is_advertised_ = true;
 		}
 		return is_advertised_;
@@ -154,10 +160,11 @@ namespace rosbridge2cpp {
 		return ros_.QueueMessage(topic_name_, queue_size_, cmd);
 	}
 
-	bool ROSTopic::Publish(bson_t *message)
+	bool ROSTopic::Publish(bson_t *message, const MessageTrace& trace, uint64_t payload_slots)
 	{
 		if (!is_advertised_) {
 			if (!Advertise()) {
+				ros_.ReleasePayloadSlots(payload_slots);
 				return false;
 			}
 		}
@@ -171,6 +178,8 @@ namespace rosbridge2cpp {
 		cmd.topic_ = topic_name_;
 		cmd.msg_bson_ = message;
 		cmd.latch_ = latch_;
+		cmd.trace_ = trace;
+		cmd.payload_slots_ = payload_slots;
 
 		return ros_.QueueMessage(topic_name_, queue_size_, cmd);
 	}
@@ -45,7 +45,11 @@ namespace rosbridge2cpp{
 	// the json result to the local variable
 	// When this happens, other callbacks that receive the same message
 	// will read 'Null' on msg_json_
-	ROSCallbackHandle<FunVrROSPublishMsg> Subscribe(FunVrROSPublishMsg callback);
+	//
+	// on_result receives the result of sending 'subscribe' to the server, asynchronously if
+	// the ROSBridge batches control messages (see ROSBridge::SendControlMessage).
+	// It isn't called if this instance already subscribed before.
+	ROSCallbackHandle<FunVrROSPublishMsg> Subscribe(FunVrROSPublishMsg callback, FunVBool on_result = nullptr);
 
 	// Unsubscribe from a given topic
 	// If multiple callbacks for this topic have been registered,
@@ -57,7 +61,8 @@ namespace rosbridge2cpp{
 	bool Unsubscribe(const ROSCallbackHandle<FunVrROSPublishMsg>& callback_handle);
 
 	// Advertise as a publisher for this topic
-	bool Advertise();
+	// on_result receives the result of sending 'advertise', like in Subscribe()
+	bool Advertise(FunVBool on_result = nullptr);
 
 	// Unadvertise as a publisher for this topic
 	bool Unadvertise();
@@ -75,10 +80,42 @@ namespace rosbridge2cpp{
 	// Please make sure that the message matches the type of the topic,
 	// since this will NOT be valided before sending it to the rosbridge.
 	bool Publish(rapidjson::Value &message);
-	bool Publish(bson_t *message);
+	// The optional trace carries the timestamps of the earlier pipeline stages for latency tracing.
+	// payload_slots are the slots of the ROSBridge's SharedMemoryRing that hold payloads of the message
+	// (see ScopedPayloadRing::TakeSlots), they are freed if the message can't be sent.
+	bool Publish(bson_t *message, const MessageTrace& trace = MessageTrace(), uint64_t payload_slots = 0);
 
 	std::string GeneratePublishID();
 
+	// The 'compression' to request when subscribing, has to be set before Subscribe(). "none" uses the compression of the
+	// ROSBridge (see ROSBridge::SetSubscriptionCompression). With "cbor-raw", rosbridge doesn't convert the messages at all,
+	// but sends them ROS1 serialized in the "bytes" field of "msg", next to "secs" and "nsecs" of the time they were received.
+	// Like "cbor", this needs the BSON mode.
+	void SetCompression(const std::string& compression) {
+		compression_ = compression;
+	}
+
+	const std::string& GetCompression() const {
+		return compression_;
+	}
+
+	// Minimum time in ms between two messages that rosbridge sends for this subscription, it drops the messages in
+	// between. 0 sends every message. Has to be set before Subscribe(), like the other subscription options.
+	void SetThrottleRate(int throttle_rate) {
+		throttle_rate_ = throttle_rate;
+	}
+
+	// Number of messages rosbridge buffers for this subscription while throttling, -1 uses the queue_size
+	void SetQueueLength(int queue_length) {
+		queue_length_ = queue_length;
+	}
+
+	// rosbridge splits messages larger than this many bytes into 'fragment' messages, which the ROSBridge
+	// reassembles. -1 never splits messages.
+	void SetFragmentSize(int fragment_size) {
+		fragment_size_ = fragment_size;
+	}
+
 	std::string TopicName() {
 		return topic_name_;
 	}
@@ -92,9 +129,13 @@ namespace rosbridge2cpp{
 		bool is_advertised_ = false;
 		std::string compression_ = "none";
 		int throttle_rate_ = 0;
+		int queue_length_ = -1;
+		int fragment_size_ = -1;
 		bool latch_ = false;
 
-		// number of messages queued for remote publisher/subscriber within rosbridge AND local publisher queue (local subscriber queue is not supported at the moment)
+		// number of messages queued for remote publisher/subscriber within rosbridge AND local publisher queue,
+		// a queue_length_ overrides it for the subscription. Subscription callbacks are called on the receiver thread,
+		// a local subscriber queue is up to the callback (UTopic has one, see FROSSubscriptionOptions::LocalQueueLength).
 		int queue_size_ = 10;
 
 		// Householding variables
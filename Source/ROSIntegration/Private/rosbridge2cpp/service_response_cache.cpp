@@ -0,0 +1,182 @@
+#include "service_response_cache.h"
+
+namespace rosbridge2cpp {
+
+	ServiceResponseCache::~ServiceResponseCache()
+	{
+		for (auto& entry : entries_) {
+			if (entry.second.response_) bson_destroy(entry.second.response_);
+		}
+	}
+
+	uint64_t ServiceResponseCache::Hash(const uint8_t *data, size_t length)
+	{
+		// 64 bit FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < length; ++i) {
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::unique_ptr<ROSBridgeServiceResponseMsg> ServiceResponseCache::MakeResponse(bson_t *full_msg)
+	{
+		std::unique_ptr<ROSBridgeServiceResponseMsg> response(new ROSBridgeServiceResponseMsg());
+		response->FromBSON(*full_msg);
+		if (response->full_msg_bson_ != full_msg) {
+			bson_destroy(full_msg); // response without values
+		}
+		return response;
+	}
+
+	ServiceResponseCache::LookupResult ServiceResponseCache::Lookup(const bson_t &request, FunVrROSServiceResponseMsg callback, FunVServiceCallError error_callback,
+		std::chrono::milliseconds timeout, std::unique_ptr<ROSBridgeServiceResponseMsg> &cached_response)
+	{
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		const std::chrono::steady_clock::time_point deadline = timeout.count() > 0 ? now + timeout : std::chrono::steady_clock::time_point::max();
+
+		bson_t *cached_msg = nullptr;
+		{
+			spinlock::scoped_lock_wait_for_short_task lock(mutex_);
+			const std::string key = Key(request);
+			auto it = entries_.find(key);
+			if (it != entries_.end() && it->second.response_ && now >= it->second.expires_) {
+				EraseLocked(it);
+				it = entries_.end();
+			}
+			if (it == entries_.end()) {
+				it = entries_.emplace(key, Entry()).first;
+			}
+
+			Entry &entry = it->second;
+			if (entry.response_) {
+				lru_.splice(lru_.end(), lru_, entry.lru_it_);
+				cached_msg = bson_copy(entry.response_);
+			}
+			else {
+				const bool in_flight = !entry.waiters_.empty();
+				if (in_flight && entry.deadline_ > deadline) {
+					// waiting for that call could exceed our own timeout, or never end
+					misses_++;
+					return LookupResult::BYPASS;
+				}
+				entry.waiters_.push_back(Waiter{ callback, error_callback });
+				if (in_flight) {
+					collapsed_++;
+					return LookupResult::JOINED;
+				}
+				entry.deadline_ = deadline;
+				misses_++;
+				return LookupResult::MISS;
+			}
+		}
+
+		hits_++;
+		cached_response = MakeResponse(cached_msg);
+		return LookupResult::HIT;
+	}
+
+	void ServiceResponseCache::Complete(const bson_t &request, ROSBridgeServiceResponseMsg &response)
+	{
+		// keep a copy of the full message, the received one points into the receive buffer
+		bson_t *full_msg = nullptr;
+		if (response.full_msg_bson_) {
+			full_msg = bson_copy(response.full_msg_bson_);
+		}
+		else {
+			full_msg = bson_new();
+			response.ToBSON(*full_msg);
+		}
+
+		std::vector<Waiter> waiters;
+		{
+			spinlock::scoped_lock_wait_for_short_task lock(mutex_);
+			auto it = entries_.find(Key(request));
+			if (it == entries_.end() || it->second.response_) {
+				bson_destroy(full_msg); // cleared in the meantime
+				return;
+			}
+
+			waiters.swap(it->second.waiters_);
+			if (response.result_) {
+				it->second.response_ = bson_copy(full_msg);
+				it->second.expires_ = std::chrono::steady_clock::now() + ttl_;
+				it->second.lru_it_ = lru_.insert(lru_.end(), it->first);
+
+				while (lru_.size() > max_entries_) {
+					EraseLocked(entries_.find(lru_.front()));
+					evictions_++;
+				}
+			}
+			else {
+				EraseLocked(it);
+			}
+		}
+
+		// the first waiter gets the received message, all others a copy
+		for (size_t i = 0; i < waiters.size(); ++i) {
+			if (i == 0) {
+				waiters[i].callback_(response);
+			}
+			else {
+				std::unique_ptr<ROSBridgeServiceResponseMsg> copy = MakeResponse(bson_copy(full_msg));
+				waiters[i].callback_(*copy);
+			}
+		}
+		bson_destroy(full_msg);
+	}
+
+	void ServiceResponseCache::Fail(const bson_t &request, ServiceCallError error)
+	{
+		std::vector<Waiter> waiters;
+		{
+			spinlock::scoped_lock_wait_for_short_task lock(mutex_);
+			auto it = entries_.find(Key(request));
+			if (it == entries_.end() || it->second.response_) return;
+
+			waiters.swap(it->second.waiters_);
+			EraseLocked(it);
+		}
+
+		for (Waiter &waiter : waiters) {
+			if (waiter.error_callback_) waiter.error_callback_(error);
+		}
+	}
+
+	void ServiceResponseCache::Clear()
+	{
+		spinlock::scoped_lock_wait_for_short_task lock(mutex_);
+		for (auto it = entries_.begin(); it != entries_.end();) {
+			if (it->second.response_) {
+				auto erase_it = it++;
+				EraseLocked(erase_it);
+			}
+			else {
+				++it; // calls in flight still have to serve their waiters
+			}
+		}
+	}
+
+	ServiceResponseCache::Stats ServiceResponseCache::GetStats()
+	{
+		Stats stats;
+		stats.hits_ = hits_.load();
+		stats.misses_ = misses_.load();
+		stats.collapsed_ = collapsed_.load();
+		stats.evictions_ = evictions_.load();
+
+		spinlock::scoped_lock_wait_for_short_task lock(mutex_);
+		stats.entries_ = lru_.size();
+		return stats;
+	}
+
+	void ServiceResponseCache::EraseLocked(std::unordered_map<std::string, Entry, RequestHash>::iterator it)
+	{
+		if (it->second.response_) {
+			bson_destroy(it->second.response_);
+			lru_.erase(it->second.lru_it_);
+		}
+		entries_.erase(it);
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <bson.h>
+
+#include "spinlock.h"
+#include "types.h"
+
+namespace rosbridge2cpp {
+
+	/**
+	 * Memoizes the responses of a service whose response only depends on the request.
+	 *
+	 * Entries are keyed by the encoded request BSON, hashed with FNV-1a and compared bytewise,
+	 * so different requests never share a response. Only successful responses are cached.
+	 * Identical requests that are issued while the first one is still waiting for its
+	 * response are collapsed into that call (single flight), unless that call might
+	 * outlive their own timeout.
+	 */
+	class ServiceResponseCache {
+	public:
+		struct Stats {
+			uint64_t hits_ = 0;			// served from the cache
+			uint64_t misses_ = 0;		// sent to the service, including BYPASS
+			uint64_t collapsed_ = 0;	// joined an identical call that was already in flight
+			uint64_t evictions_ = 0;	// removed because max_entries was reached
+			size_t entries_ = 0;
+		};
+
+		enum class LookupResult {
+			HIT,		// cached_response receives a copy of the cached response, the callbacks aren't called
+			JOINED,		// callbacks will be called when the identical call in flight finishes
+			MISS,		// the caller has to send the request and report the outcome via Complete() or Fail()
+			BYPASS		// the identical call in flight has a later deadline, the caller has to send the request
+						// with its own callbacks, its response isn't cached
+		};
+
+		ServiceResponseCache(std::chrono::milliseconds ttl, size_t max_entries) : ttl_(ttl), max_entries_(max_entries) {}
+		~ServiceResponseCache();
+
+		// On MISS, the callbacks are stored as the first waiter of the new call in flight.
+		// A timeout of 0 waits forever. A joined call fails when the call in flight times out, which is never later than
+		// its own deadline.
+		LookupResult Lookup(const bson_t &request, FunVrROSServiceResponseMsg callback, FunVServiceCallError error_callback,
+			std::chrono::milliseconds timeout, std::unique_ptr<ROSBridgeServiceResponseMsg> &cached_response);
+
+		// Serves all waiters of the given request and caches the response if it was successful
+		void Complete(const bson_t &request, ROSBridgeServiceResponseMsg &response);
+		void Fail(const bson_t &request, ServiceCallError error);
+
+		void Clear();
+		Stats GetStats();
+
+		static uint64_t Hash(const uint8_t *data, size_t length);
+
+	private:
+		struct RequestHash {
+			size_t operator()(const std::string &request) const
+			{
+				return static_cast<size_t>(Hash(reinterpret_cast<const uint8_t*>(request.data()), request.size()));
+			}
+		};
+
+		struct Waiter {
+			FunVrROSServiceResponseMsg callback_;
+			FunVServiceCallError error_callback_;
+		};
+
+		struct Entry {
+			bson_t *response_ = nullptr;	// full service_response message, nullptr while in flight
+			std::chrono::steady_clock::time_point expires_;
+			std::chrono::steady_clock::time_point deadline_;	// of the call in flight, max() without a timeout
+			std::vector<Waiter> waiters_;
+			std::list<std::string>::iterator lru_it_;
+		};
+
+		static std::string Key(const bson_t &request)
+		{
+			return std::string(reinterpret_cast<const char*>(bson_get_data(&request)), request.len);
+		}
+
+		// Creates a response message that takes ownership of the given full message
+		static std::unique_ptr<ROSBridgeServiceResponseMsg> MakeResponse(bson_t *full_msg);
+
+		void EraseLocked(std::unordered_map<std::string, Entry, RequestHash>::iterator it);
+
+		const std::chrono::milliseconds ttl_;
+		const size_t max_entries_;
+
+		spinlock mutex_;
+		std::unordered_map<std::string, Entry, RequestHash> entries_;
+		std::list<std::string> lru_; // cached responses, least recently used first
+
+		std::atomic<uint64_t> hits_{ 0 };
+		std::atomic<uint64_t> misses_{ 0 };
+		std::atomic<uint64_t> collapsed_{ 0 };
+		std::atomic<uint64_t> evictions_{ 0 };
+	};
+}
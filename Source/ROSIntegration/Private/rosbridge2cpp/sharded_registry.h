@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "spinlock.h"
+
+namespace rosbridge2cpp {
+
+	/**
+	 * A thread safe map from names or ids to values.
+	 *
+	 * The entries are split into shards with their own lock, so threads that access
+	 * different keys (e.g. the game thread registering a service while the receiver
+	 * thread looks up another one) rarely contend. Values are always copied out,
+	 * so callbacks stored in here are never invoked while a shard is locked.
+	 */
+	template<typename ValueType, size_t NumShards = 16>
+	class ShardedRegistry {
+	public:
+		// Inserts or replaces the value for the given key
+		void Set(const std::string& key, ValueType value)
+		{
+			Shard& shard = ShardOf(key);
+			spinlock::scoped_lock_wait_for_short_task lock(shard.mutex_);
+			if (InsertOrAssign(shard, key, std::move(value))) {
+				size_.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		// Inserts the value only if less than max_size entries are stored.
+		// @return false if the registry is full
+		bool TryInsert(const std::string& key, ValueType value, size_t max_size)
+		{
+			if (size_.fetch_add(1, std::memory_order_relaxed) >= max_size) {
+				size_.fetch_sub(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			Shard& shard = ShardOf(key);
+			spinlock::scoped_lock_wait_for_short_task lock(shard.mutex_);
+			if (!InsertOrAssign(shard, key, std::move(value))) {
+				size_.fetch_sub(1, std::memory_order_relaxed); // replaced an existing entry
+			}
+			return true;
+		}
+
+		bool Get(const std::string& key, ValueType& value) const
+		{
+			const Shard& shard = ShardOf(key);
+			spinlock::scoped_lock_wait_for_short_task lock(shard.mutex_);
+			auto it = shard.entries_.find(key);
+			if (it == shard.entries_.end()) return false;
+			value = it->second;
+			return true;
+		}
+
+		// Removes the entry and moves its value out
+		bool Take(const std::string& key, ValueType& value)
+		{
+			Shard& shard = ShardOf(key);
+			spinlock::scoped_lock_wait_for_short_task lock(shard.mutex_);
+			auto it = shard.entries_.find(key);
+			if (it == shard.entries_.end()) return false;
+			value = std::move(it->second);
+			shard.entries_.erase(it);
+			size_.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		bool Erase(const std::string& key)
+		{
+			Shard& shard = ShardOf(key);
+			spinlock::scoped_lock_wait_for_short_task lock(shard.mutex_);
+			if (shard.entries_.erase(key) == 0) return false;
+			size_.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// Removes all entries and returns them
+		std::vector<std::pair<std::string, ValueType>> TakeAll()
+		{
+			std::vector<std::pair<std::string, ValueType>> entries;
+			for (Shard& shard : shards_) {
+				spinlock::scoped_lock_wait_for_short_task lock(shard.mutex_);
+				for (auto& entry : shard.entries_) {
+					entries.emplace_back(entry.first, std::move(entry.second));
+				}
+				size_.fetch_sub(shard.entries_.size(), std::memory_order_relaxed);
+				shard.entries_.clear();
+			}
+			return entries;
+		}
+
+		size_t Size() const { return size_.load(std::memory_order_relaxed); }
+
+	private:
+		struct Shard {
+			mutable spinlock mutex_;
+			std::unordered_map<std::string, ValueType> entries_;
+		};
+
+		// @return true if a new entry has been inserted
+		static bool InsertOrAssign(Shard& shard, const std::string& key, ValueType&& value)
+		{
+			auto it = shard.entries_.find(key);
+			if (it != shard.entries_.end()) {
+				it->second = std::move(value);
+				return false;
+			}
+			shard.entries_.emplace(key, std::move(value));
+			return true;
+		}
+
+		Shard& ShardOf(const std::string& key) { return shards_[std::hash<std::string>()(key) % NumShards]; }
+		const Shard& ShardOf(const std::string& key) const { return shards_[std::hash<std::string>()(key) % NumShards]; }
+
+		Shard shards_[NumShards];
+		std::atomic<size_t> size_{ 0 };
+	};
+}
@@ -0,0 +1,347 @@
+#include "shared_memory_ring.h"
+
+#include "ros_log.h"
+#include "ros_profiling.h"
+
+#include <cstring>
+#include <new>
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rosbridge2cpp {
+
+	static const uint32_t SharedMemoryMagic = 0x52494d53; // "SMIR"
+	static const uint32_t SharedMemoryVersion = 1;
+	static const size_t SharedMemoryDataOffset = 4096; // slots start on their own page
+
+	static_assert(ATOMIC_INT_LOCK_FREE == 2, "SharedMemoryRing needs lock free atomics to share them between processes");
+
+	// At the start of the segment. The magic is written last, a consumer only trusts a header that has it.
+	struct SharedMemoryRing::Header {
+		std::atomic<uint32_t> magic_;
+		uint32_t version_;
+		uint32_t num_slots_;
+		uint32_t slot_size_;
+		std::atomic<uint32_t> generations_[kMaxSlots];
+	};
+
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "The header layout must not depend on the compiler");
+
+	static thread_local ScopedPayloadRing *CurrentPayloadRing = nullptr;
+
+	SharedMemoryRing::~SharedMemoryRing()
+	{
+		Close();
+	}
+
+	bool SharedMemoryRing::Create(uint32_t num_slots, uint32_t slot_size)
+	{
+#if defined(_WIN32)
+		ROS_LOG_ERROR("[SharedMemoryRing] Shared memory payloads aren't supported on this platform");
+		return false;
+#else
+		if (num_slots == 0 || num_slots > kMaxSlots || slot_size == 0) {
+			ROS_LOG_ERROR("[SharedMemoryRing] Invalid ring of %u slots with %u bytes, at most %u slots are supported", num_slots, slot_size, kMaxSlots);
+			return false;
+		}
+		Close();
+
+		static std::atomic<uint32_t> ring_counter{ 0 };
+		const std::string name = "/rosintegration_" + std::to_string(getpid()) + "_" + std::to_string(ring_counter++);
+		const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) {
+			ROS_LOG_ERROR("[SharedMemoryRing] Couldn't create %s: %s", name.c_str(), strerror(errno));
+			return false;
+		}
+
+		// the pages are only backed by memory once a payload is written into them
+		const size_t size = SharedMemoryDataOffset + static_cast<size_t>(num_slots) * slot_size;
+		void *mapping = MAP_FAILED;
+		if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+			mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			ROS_LOG_ERROR("[SharedMemoryRing] Couldn't map %zu bytes of %s: %s", size, name.c_str(), strerror(errno));
+			shm_unlink(name.c_str());
+			return false;
+		}
+
+		base_ = static_cast<uint8_t*>(mapping);
+		mapped_size_ = size;
+		name_ = name;
+		owner_ = true;
+		num_slots_ = num_slots;
+		slot_size_ = slot_size;
+
+		header_ = new (base_) Header();
+		header_->version_ = SharedMemoryVersion;
+		header_->num_slots_ = num_slots;
+		header_->slot_size_ = slot_size;
+		for (uint32_t i = 0; i < kMaxSlots; ++i) {
+			header_->generations_[i].store(0, std::memory_order_relaxed);
+		}
+		header_->magic_.store(SharedMemoryMagic, std::memory_order_release);
+
+		slots_in_use_ = 0;
+		next_slot_ = 0;
+		written_at_.assign(num_slots, std::chrono::steady_clock::time_point());
+		return true;
+#endif
+	}
+
+	bool SharedMemoryRing::Open(const std::string& name)
+	{
+#if defined(_WIN32)
+		ROS_LOG_ERROR("[SharedMemoryRing] Shared memory payloads aren't supported on this platform");
+		return false;
+#else
+		Close();
+
+		const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0) {
+			ROS_LOG_WARNING("[SharedMemoryRing] Couldn't open %s: %s", name.c_str(), strerror(errno));
+			return false;
+		}
+		struct stat info;
+		void *mapping = MAP_FAILED;
+		if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= SharedMemoryDataOffset) {
+			mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		}
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			ROS_LOG_WARNING("[SharedMemoryRing] Couldn't map %s", name.c_str());
+			return false;
+		}
+
+		base_ = static_cast<uint8_t*>(mapping);
+		mapped_size_ = static_cast<size_t>(info.st_size);
+		name_ = name;
+		header_ = reinterpret_cast<Header*>(base_);
+
+		const bool valid = header_->magic_.load(std::memory_order_acquire) == SharedMemoryMagic &&
+			header_->version_ == SharedMemoryVersion && header_->num_slots_ > 0 && header_->num_slots_ <= kMaxSlots &&
+			SharedMemoryDataOffset + static_cast<size_t>(header_->num_slots_) * header_->slot_size_ <= mapped_size_;
+		if (!valid) {
+			ROS_LOG_WARNING("[SharedMemoryRing] %s isn't a ring of a compatible version", name.c_str());
+			Close();
+			return false;
+		}
+		num_slots_ = header_->num_slots_;
+		slot_size_ = header_->slot_size_;
+		return true;
+#endif
+	}
+
+	void SharedMemoryRing::Close()
+	{
+#if !defined(_WIN32)
+		if (base_) {
+			munmap(base_, mapped_size_);
+		}
+		if (owner_) {
+			shm_unlink(name_.c_str());
+		}
+#endif
+		header_ = nullptr;
+		base_ = nullptr;
+		mapped_size_ = 0;
+		owner_ = false;
+		num_slots_ = 0;
+		slot_size_ = 0;
+	}
+
+	bool SharedMemoryRing::Write(const uint8_t *data, uint32_t length, SharedMemoryDescriptor& descriptor, uint32_t& slot)
+	{
+		if (!owner_ || !header_ || length > slot_size_) {
+			return false;
+		}
+
+		{
+			spinlock::scoped_lock_wait_for_short_task lock(slots_mutex_);
+			const auto now = std::chrono::steady_clock::now();
+			uint32_t free_slot = num_slots_;
+			uint32_t oldest_slot = num_slots_;
+			for (uint32_t i = 0; i < num_slots_; ++i) {
+				const uint32_t candidate = (next_slot_ + i) % num_slots_;
+				if (!(slots_in_use_ & (1ull << candidate))) {
+					free_slot = candidate;
+					break;
+				}
+				if (oldest_slot == num_slots_ || written_at_[candidate] < written_at_[oldest_slot]) {
+					oldest_slot = candidate;
+				}
+			}
+			if (free_slot == num_slots_) {
+				if (now - written_at_[oldest_slot] < reclaim_timeout_) {
+					return false;
+				}
+				ROS_LOG_WARNING("[SharedMemoryRing] Slot %u of %s hasn't been acknowledged for %lld ms, reusing it", oldest_slot, name_.c_str(),
+					static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(now - written_at_[oldest_slot]).count()));
+				free_slot = oldest_slot;
+			}
+			slot = free_slot;
+			slots_in_use_ |= 1ull << slot;
+			written_at_[slot] = now;
+			next_slot_ = (slot + 1) % num_slots_;
+		}
+
+		// Seqlock: a consumer that still reads the previous payload of the slot sees the new generation afterwards
+		uint32_t generation = header_->generations_[slot].load(std::memory_order_relaxed) + 1;
+		if (generation == 0) generation = 1; // 0 is never written
+		header_->generations_[slot].store(generation, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		const uint64_t offset = SharedMemoryDataOffset + static_cast<uint64_t>(slot) * slot_size_;
+		{
+			ROS_PROFILER_SCOPE("ROS::SharedMemoryWrite");
+			memcpy(base_ + offset, data, length);
+		}
+
+		descriptor.offset_ = offset;
+		descriptor.length_ = length;
+		descriptor.generation_ = generation;
+
+		if (metrics_) {
+			metrics_->shared_memory_payloads_.Add();
+			metrics_->shared_memory_bytes_.Add(length);
+		}
+		return true;
+	}
+
+	void SharedMemoryRing::Acknowledge(const SharedMemoryDescriptor& descriptor)
+	{
+		const uint32_t slot = SlotOf(descriptor);
+		if (!owner_ || slot >= num_slots_) {
+			return;
+		}
+		spinlock::scoped_lock_wait_for_short_task lock(slots_mutex_);
+		if (header_->generations_[slot].load(std::memory_order_relaxed) == descriptor.generation_) {
+			slots_in_use_ &= ~(1ull << slot);
+		}
+	}
+
+	void SharedMemoryRing::Release(uint64_t slot_mask)
+	{
+		if (!owner_ || !slot_mask) {
+			return;
+		}
+		spinlock::scoped_lock_wait_for_short_task lock(slots_mutex_);
+		slots_in_use_ &= ~slot_mask;
+	}
+
+	uint32_t SharedMemoryRing::NumSlotsInUse()
+	{
+		spinlock::scoped_lock_wait_for_short_task lock(slots_mutex_);
+		uint32_t num_slots = 0;
+		for (uint64_t slots = slots_in_use_; slots; slots &= slots - 1) {
+			++num_slots;
+		}
+		return num_slots;
+	}
+
+	uint32_t SharedMemoryRing::SlotOf(const SharedMemoryDescriptor& descriptor) const
+	{
+		if (!header_ || descriptor.offset_ < SharedMemoryDataOffset) {
+			return num_slots_;
+		}
+		const uint64_t relative_offset = descriptor.offset_ - SharedMemoryDataOffset;
+		if (relative_offset % slot_size_ != 0 || descriptor.length_ > slot_size_) {
+			return num_slots_;
+		}
+		const uint64_t slot = relative_offset / slot_size_;
+		return slot < num_slots_ ? static_cast<uint32_t>(slot) : num_slots_;
+	}
+
+	const uint8_t* SharedMemoryRing::Resolve(const SharedMemoryDescriptor& descriptor) const
+	{
+		const uint32_t slot = SlotOf(descriptor);
+		if (slot >= num_slots_ || header_->generations_[slot].load(std::memory_order_acquire) != descriptor.generation_) {
+			return nullptr;
+		}
+		return base_ + descriptor.offset_;
+	}
+
+	bool SharedMemoryRing::IsCurrent(const SharedMemoryDescriptor& descriptor) const
+	{
+		const uint32_t slot = SlotOf(descriptor);
+		if (slot >= num_slots_) {
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return header_->generations_[slot].load(std::memory_order_relaxed) == descriptor.generation_;
+	}
+
+	void SharedMemoryRing::AppendDescriptor(bson_t *b, const char *key, const SharedMemoryDescriptor& descriptor)
+	{
+		bson_t child;
+		BSON_APPEND_DOCUMENT_BEGIN(b, key, &child);
+		BSON_APPEND_INT64(&child, "shm_offset", static_cast<int64_t>(descriptor.offset_));
+		BSON_APPEND_INT32(&child, "shm_length", static_cast<int32_t>(descriptor.length_));
+		BSON_APPEND_INT32(&child, "shm_generation", static_cast<int32_t>(descriptor.generation_));
+		bson_append_document_end(b, &child);
+	}
+
+	bool SharedMemoryRing::ReadDescriptor(const bson_t *document, SharedMemoryDescriptor& descriptor)
+	{
+		bson_iter_t iter;
+		if (!bson_iter_init_find(&iter, document, "shm_offset") || !BSON_ITER_HOLDS_INT64(&iter)) {
+			return false;
+		}
+		descriptor.offset_ = static_cast<uint64_t>(bson_iter_int64(&iter));
+		if (!bson_iter_init_find(&iter, document, "shm_length") || !BSON_ITER_HOLDS_INT32(&iter)) {
+			return false;
+		}
+		descriptor.length_ = static_cast<uint32_t>(bson_iter_int32(&iter));
+		if (!bson_iter_init_find(&iter, document, "shm_generation") || !BSON_ITER_HOLDS_INT32(&iter)) {
+			return false;
+		}
+		descriptor.generation_ = static_cast<uint32_t>(bson_iter_int32(&iter));
+		return true;
+	}
+
+	ScopedPayloadRing::ScopedPayloadRing(SharedMemoryRing *ring, uint32_t min_payload_size)
+		: ring_(ring)
+		, min_payload_size_(min_payload_size)
+		, previous_(CurrentPayloadRing)
+	{
+		CurrentPayloadRing = this;
+	}
+
+	ScopedPayloadRing::~ScopedPayloadRing()
+	{
+		if (ring_ && slots_) {
+			ring_->Release(slots_);
+		}
+		CurrentPayloadRing = previous_;
+	}
+
+	uint64_t ScopedPayloadRing::TakeSlots()
+	{
+		const uint64_t slots = slots_;
+		slots_ = 0;
+		return slots;
+	}
+
+	void AppendBinaryPayload(bson_t *b, const char *key, const uint8_t *data, uint32_t length)
+	{
+		ScopedPayloadRing *scope = CurrentPayloadRing;
+		if (scope && scope->ring_ && length >= scope->min_payload_size_) {
+			SharedMemoryDescriptor descriptor;
+			uint32_t slot;
+			if (scope->ring_->Write(data, length, descriptor, slot)) {
+				scope->slots_ |= 1ull << slot;
+				SharedMemoryRing::AppendDescriptor(b, key, descriptor);
+				return;
+			}
+		}
+		// no ring, too small, or all slots wait for the consumer
+		BSON_APPEND_BINARY(b, key, BSON_SUBTYPE_BINARY, data, length);
+	}
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <bson.h>
+
+#include "ros_metrics.h"
+#include "spinlock.h"
+
+namespace rosbridge2cpp {
+
+	// Location of a payload in a SharedMemoryRing, sent over the socket instead of the payload itself
+	struct SharedMemoryDescriptor {
+		uint64_t offset_ = 0; // from the start of the segment
+		uint32_t length_ = 0;
+		uint32_t generation_ = 0; // of the slot at the time the payload was written
+	};
+
+	/**
+	 * Ring of fixed size slots in a POSIX shared memory segment, to hand large binary fields (Image.data,
+	 * PointCloud2.data, CompressedImage.data) to a consumer on the same host without pushing them through a socket.
+	 *
+	 * The producer copies a payload into a free slot and sends a small SharedMemoryDescriptor in its place.
+	 * The consumer maps the same segment, reads the payload in place and acknowledges the descriptor, which frees
+	 * the slot again. Every write bumps the generation of its slot, so the consumer can tell if a slot has been
+	 * reused in the meantime (e.g. after the producer reclaimed it because the acknowledgement got lost).
+	 *
+	 * Not available on Windows, Create() and Open() fail there.
+	 */
+	class SharedMemoryRing {
+	public:
+		static const uint32_t kMaxSlots = 64; // the slots of a message are passed around as a 64 bit mask
+
+		SharedMemoryRing() {}
+		~SharedMemoryRing();
+
+		SharedMemoryRing(const SharedMemoryRing&) = delete;
+		SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+		// Producer: creates a segment with a unique name, which is removed again on destruction
+		bool Create(uint32_t num_slots, uint32_t slot_size);
+
+		// Consumer: maps the segment of a producer read-only
+		bool Open(const std::string& name);
+
+		bool IsMapped() const { return header_ != nullptr; }
+		const std::string& GetName() const { return name_; }
+		uint32_t GetNumSlots() const { return num_slots_; }
+		uint32_t GetSlotSize() const { return slot_size_; }
+
+		// Producer: copies the payload into a free slot. If no slot is free, the oldest slot that hasn't been
+		// acknowledged within the reclaim timeout is reused.
+		//
+		// @return false if the payload doesn't fit into a slot or all slots wait for an acknowledgement
+		bool Write(const uint8_t *data, uint32_t length, SharedMemoryDescriptor& descriptor, uint32_t& slot);
+
+		// Producer: the consumer is done with the payload. Ignored if the slot has been reused since.
+		void Acknowledge(const SharedMemoryDescriptor& descriptor);
+
+		// Producer: frees slots whose descriptors never reached the consumer, e.g. of a message that was dropped
+		// from the publisher queue
+		void Release(uint64_t slot_mask);
+
+		uint32_t NumSlotsInUse();
+
+		// Defaults to 2 seconds
+		void SetReclaimTimeout(std::chrono::milliseconds timeout) { reclaim_timeout_ = timeout; }
+
+		// Producer: counts the written payloads in shared_memory_payloads_ and shared_memory_bytes_
+		void SetMetrics(ConnectionMetrics* metrics) { metrics_ = metrics; }
+
+		// Consumer: the payload inside the mapping, nullptr if the descriptor doesn't point into a slot or the
+		// slot has been reused. The producer may still reuse the slot while the payload is read, so check
+		// IsCurrent() afterwards.
+		const uint8_t* Resolve(const SharedMemoryDescriptor& descriptor) const;
+		bool IsCurrent(const SharedMemoryDescriptor& descriptor) const;
+
+		// BSON form of a descriptor: { shm_offset: int64, shm_length: int32, shm_generation: int32 }
+		static void AppendDescriptor(bson_t *b, const char *key, const SharedMemoryDescriptor& descriptor);
+		static bool ReadDescriptor(const bson_t *document, SharedMemoryDescriptor& descriptor);
+
+	private:
+		struct Header;
+
+		void Close();
+		uint32_t SlotOf(const SharedMemoryDescriptor& descriptor) const;
+
+		Header *header_ = nullptr;
+		uint8_t *base_ = nullptr;
+		size_t mapped_size_ = 0;
+		std::string name_;
+		bool owner_ = false;
+		uint32_t num_slots_ = 0;
+		uint32_t slot_size_ = 0;
+
+		// producer side bookkeeping
+		spinlock slots_mutex_;
+		uint64_t slots_in_use_ = 0;
+		uint32_t next_slot_ = 0;
+		std::vector<std::chrono::steady_clock::time_point> written_at_;
+		std::chrono::milliseconds reclaim_timeout_{ 2000 };
+		ConnectionMetrics *metrics_ = nullptr;
+	};
+
+	// Lets AppendBinaryPayload() on this thread put large payloads into the given ring until the scope ends.
+	// Used around the converter of an outgoing message. Slots that haven't been handed over with TakeSlots()
+	// are released again, e.g. if the conversion failed.
+	class ScopedPayloadRing {
+	public:
+		ScopedPayloadRing(SharedMemoryRing *ring, uint32_t min_payload_size);
+		~ScopedPayloadRing();
+
+		ScopedPayloadRing(const ScopedPayloadRing&) = delete;
+		ScopedPayloadRing& operator=(const ScopedPayloadRing&) = delete;
+
+		// The slots written in this scope, the caller is responsible for them afterwards
+		uint64_t TakeSlots();
+
+	private:
+		friend void AppendBinaryPayload(bson_t *b, const char *key, const uint8_t *data, uint32_t length);
+
+		SharedMemoryRing *ring_;
+		uint32_t min_payload_size_;
+		uint64_t slots_ = 0;
+		ScopedPayloadRing *previous_;
+	};
+
+	// Appends a binary field. Inside a ScopedPayloadRing, a payload of at least its minimum size is copied into the
+	// ring and its descriptor is appended instead, unless all slots are in use.
+	void AppendBinaryPayload(bson_t *b, const char *key, const uint8_t *data, uint32_t length);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace rosbridge2cpp {
+
+	/**
+	 * A single level hashed timer wheel.
+	 *
+	 * Schedule() and the expiry of a timer are O(1). Deadlines that are more than one
+	 * revolution away simply stay in their slot until their tick has come.
+	 * Cancel() removes a timer with the tick Schedule() returned for it, searching only its slot.
+	 *
+	 * This class is not thread safe.
+	 */
+	template<typename KeyType>
+	class TimerWheel {
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		TimerWheel(Clock::duration tick_duration = std::chrono::milliseconds(10), size_t num_slots = 512)
+			: slots_(num_slots), tick_duration_(tick_duration), start_(Clock::now()) {}
+
+		// Returns the tick of the timer, which Cancel() needs
+		uint64_t Schedule(const KeyType& key, Clock::time_point deadline)
+		{
+			uint64_t tick = TickOf(deadline);
+			if (tick < current_tick_) tick = current_tick_; // already due, expire on the next Advance()
+
+			slots_[tick % slots_.size()].push_back(Entry{ key, tick });
+			size_++;
+			return tick;
+		}
+
+		// Returns false if the timer already expired or was cancelled
+		bool Cancel(const KeyType& key, uint64_t tick)
+		{
+			std::vector<Entry>& slot = slots_[tick % slots_.size()];
+			for (size_t j = 0; j < slot.size(); ++j) {
+				if (slot[j].tick_ == tick && slot[j].key_ == key) {
+					slot[j] = slot.back();
+					slot.pop_back();
+					size_--;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Appends the keys of all timers that are due at 'now' to 'expired'
+		void Advance(Clock::time_point now, std::vector<KeyType>& expired)
+		{
+			const uint64_t now_tick = now > start_ ? static_cast<uint64_t>((now - start_) / tick_duration_) : 0;
+			if (now_tick < current_tick_) return;
+			if (size_ == 0) {
+				current_tick_ = now_tick + 1;
+				return;
+			}
+
+			// visit every slot at most once, even if we have been called late
+			const uint64_t num_ticks = now_tick - current_tick_ + 1;
+			const uint64_t num_slots_to_visit = num_ticks < slots_.size() ? num_ticks : slots_.size();
+			for (uint64_t i = 0; i < num_slots_to_visit; ++i) {
+				std::vector<Entry>& slot = slots_[(current_tick_ + i) % slots_.size()];
+				for (size_t j = 0; j < slot.size();) {
+					if (slot[j].tick_ <= now_tick) {
+						expired.push_back(slot[j].key_);
+						slot[j] = slot.back();
+						slot.pop_back();
+						size_--;
+					}
+					else {
+						++j;
+					}
+				}
+			}
+			current_tick_ = now_tick + 1;
+		}
+
+		size_t Size() const { return size_; }
+
+	private:
+		struct Entry {
+			KeyType key_;
+			uint64_t tick_;
+		};
+
+		// Rounds up, so a timer never fires before its deadline
+		uint64_t TickOf(Clock::time_point time) const
+		{
+			if (time <= start_) return 0;
+			return static_cast<uint64_t>((time - start_ + tick_duration_ - Clock::duration(1)) / tick_duration_);
+		}
+
+		std::vector<std::vector<Entry>> slots_;
+		Clock::duration tick_duration_;
+		Clock::time_point start_;
+		uint64_t current_tick_ = 0;
+		size_t size_ = 0;
+	};
+}
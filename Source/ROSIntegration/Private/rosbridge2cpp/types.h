@@ -18,7 +18,13 @@ namespace rosbridge2cpp {
 	typedef std::function<void(ROSBridgeCallServiceMsg&)> FunVrROSCallServiceMsgrROSServiceResponseMsg;
 	// typedef std::function<json(json&)> FunJSONcrJSON;
 
-	enum class TransportError { R2C_SOCKET_ERROR, R2C_CONNECTION_CLOSED };
+	// R2C_SEND_STALLED: the server didn't read fast enough and a write timed out, the message was dropped
+	enum class TransportError { R2C_SOCKET_ERROR, R2C_CONNECTION_CLOSED, R2C_SEND_STALLED };
+
+	// Reasons why a service call didn't receive a response
+	enum class ServiceCallError { TIMEOUT, CONNECTION_CLOSED, REJECTED, SEND_FAILED };
+	typedef std::function<void(ServiceCallError)> FunVServiceCallError;
+	typedef std::function<void(bool)> FunVBool;
 	extern unsigned long ROSCallbackHandle_id_counter;
 
 	template<typename FunctionType>
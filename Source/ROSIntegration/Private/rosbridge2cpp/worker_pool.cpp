@@ -0,0 +1,76 @@
+#include "worker_pool.h"
+#include "ros_profiling.h"
+
+namespace rosbridge2cpp {
+
+	void WorkerPool::Start(size_t num_threads)
+	{
+		Stop();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = true;
+		stopped_ = false;
+		for (size_t i = 0; i < num_threads; ++i) {
+			threads_.emplace_back(&WorkerPool::Run, this);
+		}
+	}
+
+	void WorkerPool::Stop()
+	{
+		std::vector<std::thread> threads;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			running_ = false;
+			stopped_ = true;
+			tasks_.clear();
+			threads.swap(threads_);
+		}
+		task_available_.notify_all();
+
+		for (std::thread& thread : threads) {
+			if (thread.joinable()) thread.join();
+		}
+	}
+
+	void WorkerPool::Submit(std::function<void()> task)
+	{
+		bool run_inline;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (stopped_) return;
+			run_inline = threads_.empty();
+			if (!run_inline) tasks_.push_back(std::move(task));
+		}
+
+		if (run_inline) {
+			task();
+			return;
+		}
+		task_available_.notify_one();
+	}
+
+	size_t WorkerPool::NumThreads() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return threads_.size();
+	}
+
+	void WorkerPool::Run()
+	{
+		ROS_PROFILER_THREAD_NAME("ROSServiceWorker");
+
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				task_available_.wait(lock, [this]() { return !running_ || !tasks_.empty(); });
+				if (!running_) return;
+
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+			ROS_PROFILER_SCOPE("ROS::ServiceWorkerTask");
+			task();
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rosbridge2cpp {
+
+	/**
+	 * A fixed size pool of threads that run submitted tasks in FIFO order.
+	 * A pool with 0 threads runs every task inline in Submit(), a stopped pool drops them.
+	 * Submit() is thread safe, Start() and Stop() must not be called concurrently with each other.
+	 */
+	class WorkerPool {
+	public:
+		WorkerPool() = default;
+		~WorkerPool() { Stop(); }
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		void Start(size_t num_threads);
+
+		// Waits for the running tasks to finish. Tasks that haven't been started yet and the ones submitted
+		// afterwards are dropped.
+		void Stop();
+
+		void Submit(std::function<void()> task);
+
+		size_t NumThreads() const;
+
+	private:
+		void Run();
+
+		mutable std::mutex mutex_;
+		std::condition_variable task_available_;
+		std::deque<std::function<void()>> tasks_;
+		std::vector<std::thread> threads_;
+		bool running_ = false;
+		bool stopped_ = false;
+	};
+}
@@ -9,6 +9,8 @@ public:
 
 	static FROSTime Now();
 
+	// Simulated time can be set from the game thread while other threads call Now();
+	// readers always get a consistent timestamp without any additional locking.
 	static void SetUseSimTime(bool bUseSimTime);
 	static void SetSimTime(const FROSTime& time);
 
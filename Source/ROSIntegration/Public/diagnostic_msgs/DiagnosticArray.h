@@ -0,0 +1,21 @@
+#pragma once
+
+#include "ROSBaseMsg.h"
+#include "DiagnosticStatus.h"
+#include "std_msgs/Header.h"
+
+namespace ROSMessages {
+	namespace diagnostic_msgs {
+		class DiagnosticArray : public FROSBaseMsg {
+		public:
+			DiagnosticArray() {
+				_MessageType = "diagnostic_msgs/DiagnosticArray";
+			}
+
+			// # This message is used to send diagnostic information about the state of the robot
+			std_msgs::Header header;
+			// DiagnosticStatus[] status # an array of components being reported on
+			TArray<DiagnosticStatus> status;
+		};
+	}
+}
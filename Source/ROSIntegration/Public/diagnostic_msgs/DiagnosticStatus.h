@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ROSBaseMsg.h"
+#include "KeyValue.h"
+
+namespace ROSMessages {
+	namespace diagnostic_msgs {
+		class DiagnosticStatus : public FROSBaseMsg {
+		public:
+			DiagnosticStatus() {
+				_MessageType = "diagnostic_msgs/DiagnosticStatus";
+			}
+
+			// # Possible levels of operations
+			// byte OK=0
+			// byte WARN=1
+			// byte ERROR=2
+			// byte STALE=3
+			// prefixed, because ERROR is a macro on Windows
+			enum Level : uint8 { LEVEL_OK = 0, LEVEL_WARN, LEVEL_ERROR, LEVEL_STALE };
+
+			// byte level # level of operation enumerated above
+			Level level = LEVEL_OK;
+			// string name # a description of the test/component reporting
+			FString name;
+			// string message # a description of the status
+			FString message;
+			// string hardware_id # a hardware unique string
+			FString hardware_id;
+			// KeyValue[] values # an array of values associated with the status
+			TArray<KeyValue> values;
+		};
+	}
+}
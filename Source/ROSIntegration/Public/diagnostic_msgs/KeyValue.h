@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ROSBaseMsg.h"
+
+namespace ROSMessages {
+	namespace diagnostic_msgs {
+		class KeyValue : public FROSBaseMsg {
+		public:
+			KeyValue() {
+				_MessageType = "diagnostic_msgs/KeyValue";
+			}
+
+			KeyValue(const FString& key, const FString& value) : key(key), value(value) {
+				_MessageType = "diagnostic_msgs/KeyValue";
+			}
+
+			// string key # what to label this value when viewing
+			FString key;
+			// string value # a value to track over time
+			FString value;
+		};
+	}
+}
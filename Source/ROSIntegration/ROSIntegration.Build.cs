@@ -57,7 +57,8 @@ public class ROSIntegration : ModuleRules
 				"Engine",
 				"Sockets",
 				"Networking",
-				"WebSockets"
+				"WebSockets",
+				"Projects"
 				// ... add private dependencies that you statically link with here ...
 			}
 		);
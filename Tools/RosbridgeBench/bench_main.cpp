@@ -0,0 +1,486 @@
+// rosbridge_bench: throughput and latency of the rosbridge2cpp client against a local or remote rosbridge
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ros_bridge.h"
+#include "ros_latency_tracer.h"
+#include "ros_service.h"
+#include "ros_topic.h"
+#include "UnixSocketConnection.h"
+
+#include "posix_connection.h"
+#include "standin_server.h"
+
+using namespace rosbridge2cpp;
+using namespace rosbridge_bench;
+
+namespace {
+
+	struct BenchOptions {
+		Transport transport_ = Transport::TCP;
+		Encoding encoding_ = Encoding::BSON;
+		std::string host_ = "127.0.0.1";
+		int port_ = 0; // 0 starts an embedded stand-in server
+		std::vector<size_t> sizes_ = { 64, 1024, 65536, 1048576 };
+		std::vector<size_t> topic_counts_ = { 1, 4, 16 };
+		double duration_ = 3.0;
+		size_t window_ = 8; // unanswered messages per topic
+		size_t service_calls_ = 1000;
+		size_t service_window_ = 32;
+		bool batch_registrations_ = false;
+		bool shared_memory_ = false;
+		std::string compression_ = "none"; // of the subscriptions
+		bool float_payload_ = false; // float32[] like LaserScan.ranges instead of uint8[]
+		int fragment_size_ = -1; // of the subscriptions, see ROSTopic::SetFragmentSize
+		std::string csv_file_;
+	};
+
+	struct BenchResult {
+		std::string name_;
+		size_t size_ = 0;
+		size_t topics_ = 0;
+		uint64_t sent_ = 0;
+		uint64_t received_ = 0;
+		uint64_t bytes_received_ = 0; // by the client, 0 if the transport doesn't count them
+		double seconds_ = 0;
+		LatencyHistogram latency_;
+	};
+
+	int64_t Now()
+	{
+		return LatencyTracer::Now();
+	}
+
+	std::vector<size_t> ParseList(const std::string& value)
+	{
+		std::vector<size_t> list;
+		std::stringstream stream(value);
+		std::string item;
+		while (std::getline(stream, item, ',')) {
+			if (!item.empty()) list.push_back(static_cast<size_t>(std::atoll(item.c_str())));
+		}
+		return list;
+	}
+
+	// One connection with its own bridge, so every case starts with empty queues.
+	// Unix domain sockets use the engine free transport of the plugin itself.
+	struct Session {
+		explicit Session(const BenchOptions& options)
+			: connection_(CreateConnection(options)), bridge_(*connection_, options.encoding_ == Encoding::BSON)
+		{
+			bridge_.SetBatchControlMessages(options.batch_registrations_);
+			bridge_.SetSubscriptionCompression(options.compression_);
+			if (options.shared_memory_) {
+				const size_t max_size = *std::max_element(options.sizes_.begin(), options.sizes_.end());
+				bridge_.SetSharedMemoryPayloads(16, static_cast<uint32_t>(std::max<size_t>(max_size, 1)), SharedMemoryMinPayloadSize);
+			}
+		}
+
+		// Payloads of at least this size go through shared memory, like the default of the plugin
+		static const uint32_t SharedMemoryMinPayloadSize = 64 * 1024;
+
+		// The server answers shm_open asynchronously
+		bool WaitForPayloadRing()
+		{
+			const int64_t deadline_ns = LatencyTracer::Now() + 1000000000ll;
+			while (!bridge_.GetPayloadRing()) {
+				if (LatencyTracer::Now() > deadline_ns) return false;
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			return true;
+		}
+
+		static ITransportLayer* CreateConnection(const BenchOptions& options)
+		{
+			if (options.transport_ == Transport::UNIX) return new UnixSocketConnection();
+			return new PosixConnection(options.transport_);
+		}
+
+		std::unique_ptr<ITransportLayer> connection_;
+		ROSBridge bridge_;
+	};
+
+	// Tracks the messages in flight of all topics of a case
+	struct FlowControl {
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::vector<uint64_t> sent_;
+		std::vector<uint64_t> received_;
+		uint64_t total_received_ = 0;
+	};
+
+	// size / 4 floats as BSON array, where every element is a double with its own key, like the converters write float32[]
+	std::shared_ptr<bson_t> FloatArrayPayload(size_t size)
+	{
+		std::shared_ptr<bson_t> array(bson_new(), bson_destroy);
+		char key_buffer[16];
+		for (uint32_t i = 0; i < size / 4; ++i) {
+			const char *key;
+			const size_t key_length = bson_uint32_to_string(i, &key, key_buffer, sizeof(key_buffer));
+			bson_append_double(array.get(), key, static_cast<int>(key_length), 0.25 * (i % 4096));
+		}
+		return array;
+	}
+
+	bool PublishBSON(ROSBridge& bridge, ROSTopic& topic, const std::vector<uint8_t>& payload, const bson_t *float_payload, uint64_t seq)
+	{
+		// like the converters of the plugin, see UTopic::Publish()
+		ScopedPayloadRing payload_ring(bridge.GetPayloadRing(), bridge.GetMinSharedMemoryPayloadSize());
+		bson_t *message = bson_new();
+		if (float_payload) {
+			BSON_APPEND_ARRAY(message, "data", float_payload);
+		}
+		else {
+			AppendBinaryPayload(message, "data", payload.data(), static_cast<uint32_t>(payload.size()));
+		}
+		BSON_APPEND_INT64(message, "seq", static_cast<int64_t>(seq));
+		BSON_APPEND_INT64(message, "sent_ns", Now());
+		return topic.Publish(message, MessageTrace(), payload_ring.TakeSlots()); // takes ownership of message
+	}
+
+	bool PublishJSON(ROSBridge& bridge, const std::string& topic_name, const std::string& payload, uint64_t seq)
+	{
+		// ROSTopic::Publish(rapidjson::Value&) goes through the BSON-only publisher queue,
+		// so JSON messages are sent directly like the other JSON operations of rosbridge2cpp
+		rapidjson::Document document;
+		auto& alloc = document.GetAllocator();
+		rapidjson::Value msg(rapidjson::kObjectType);
+		msg.AddMember("data", rapidjson::Value(payload.c_str(), static_cast<rapidjson::SizeType>(payload.size()), alloc), alloc);
+		msg.AddMember("seq", static_cast<int64_t>(seq), alloc);
+		msg.AddMember("sent_ns", Now(), alloc);
+
+		ROSBridgePublishMsg cmd(true);
+		cmd.topic_ = topic_name;
+		cmd.msg_json_ = msg;
+		return bridge.SendMessage(cmd);
+	}
+
+	bool RunTopicCase(const BenchOptions& options, size_t size, size_t num_topics, BenchResult& result)
+	{
+		Session session(options);
+		if (!session.bridge_.Init(options.host_, options.port_)) return false;
+		if (options.shared_memory_ && options.encoding_ == Encoding::BSON && !session.WaitForPayloadRing()) {
+			std::cerr << "The server didn't map the shared memory ring" << std::endl;
+			return false;
+		}
+
+		result.size_ = size;
+		result.topics_ = num_topics;
+		const bool bson = options.encoding_ == Encoding::BSON;
+
+		FlowControl flow;
+		flow.sent_.assign(num_topics, 0);
+		flow.received_.assign(num_topics, 0);
+
+		std::vector<std::unique_ptr<ROSTopic>> topics;
+		std::vector<ROSCallbackHandle<FunVrROSPublishMsg>> handles;
+		for (size_t i = 0; i < num_topics; ++i) {
+			const std::string topic_name = "/bench/topic_" + std::to_string(i);
+			topics.emplace_back(new ROSTopic(session.bridge_, topic_name, "std_msgs/UInt8MultiArray", static_cast<int>(options.window_)));
+			topics.back()->SetFragmentSize(options.fragment_size_);
+
+			handles.push_back(topics.back()->Subscribe([&flow, &result, bson, i](const ROSBridgePublishMsg& msg) {
+				const int64_t received_ns = Now();
+				int64_t sent_ns = 0;
+				if (bson) {
+					bool key_found = false;
+					sent_ns = Helper::get_int64_by_key("msg.sent_ns", *msg.full_msg_bson_, key_found);
+				}
+				else if (msg.msg_json_.IsObject() && msg.msg_json_.HasMember("sent_ns")) {
+					sent_ns = msg.msg_json_["sent_ns"].GetInt64();
+				}
+				if (sent_ns) result.latency_.Record(received_ns - sent_ns);
+
+				std::lock_guard<std::mutex> lock(flow.mutex_);
+				flow.received_[i]++;
+				flow.total_received_++;
+				flow.cv_.notify_one();
+			}));
+			if (!topics.back()->Advertise()) return false;
+		}
+
+		const std::vector<uint8_t> bson_payload(bson && !options.float_payload_ ? size : 0, 0xAB);
+		const std::shared_ptr<bson_t> float_payload = bson && options.float_payload_ ? FloatArrayPayload(size) : nullptr;
+		const std::string json_payload(bson ? 0 : size, 'x');
+
+		const int64_t start_ns = Now();
+		const int64_t end_ns = start_ns + static_cast<int64_t>(options.duration_ * 1e9);
+		while (Now() < end_ns) {
+			bool published = false;
+			for (size_t i = 0; i < num_topics; ++i) {
+				uint64_t seq;
+				{
+					std::lock_guard<std::mutex> lock(flow.mutex_);
+					if (flow.sent_[i] - flow.received_[i] >= options.window_) continue;
+					seq = flow.sent_[i]++;
+				}
+				const bool success = bson ? PublishBSON(session.bridge_, *topics[i], bson_payload, float_payload.get(), seq)
+					: PublishJSON(session.bridge_, topics[i]->TopicName(), json_payload, seq);
+				if (!success) {
+					std::cerr << "Publishing failed, aborting case" << std::endl;
+					return false;
+				}
+				published = true;
+			}
+			if (!published) {
+				std::unique_lock<std::mutex> lock(flow.mutex_);
+				flow.cv_.wait_for(lock, std::chrono::milliseconds(1));
+			}
+		}
+
+		// wait for the messages still in flight, whatever doesn't arrive in time counts as dropped
+		{
+			std::unique_lock<std::mutex> lock(flow.mutex_);
+			uint64_t total_sent = 0;
+			for (uint64_t sent : flow.sent_) total_sent += sent;
+			flow.cv_.wait_for(lock, std::chrono::seconds(2), [&]() { return flow.total_received_ >= total_sent; });
+			result.sent_ = total_sent;
+			result.received_ = flow.total_received_;
+		}
+		result.seconds_ = (Now() - start_ns) / 1e9;
+		if (const PosixConnection *connection = dynamic_cast<const PosixConnection*>(session.connection_.get())) {
+			result.bytes_received_ = connection->BytesReceived();
+		}
+
+		for (size_t i = 0; i < num_topics; ++i) {
+			topics[i]->Unsubscribe(handles[i]);
+			topics[i]->Unadvertise();
+		}
+		return true;
+	}
+
+	bool RunServiceCase(const BenchOptions& options, size_t window, BenchResult& result)
+	{
+		Session session(options);
+		if (!session.bridge_.Init(options.host_, options.port_)) return false;
+
+		result.size_ = 0;
+		result.topics_ = window;
+		const bool bson = options.encoding_ == Encoding::BSON;
+		ROSService service(session.bridge_, "/bench/echo", "rospy_tutorials/AddTwoInts");
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		uint64_t in_flight = 0;
+
+		const int64_t start_ns = Now();
+		for (size_t i = 0; i < options.service_calls_; ++i) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (!cv.wait_for(lock, std::chrono::seconds(2), [&]() { return in_flight < window; })) break;
+				in_flight++;
+			}
+
+			const int64_t call_ns = Now();
+			auto callback = [&, call_ns](ROSBridgeServiceResponseMsg& response) {
+				result.latency_.Record(Now() - call_ns);
+				std::lock_guard<std::mutex> lock(mutex);
+				in_flight--;
+				if (response.result_) result.received_++;
+				cv.notify_one();
+			};
+
+			bool success;
+			if (bson) {
+				bson_t *request = bson_new();
+				BSON_APPEND_INT64(request, "a", static_cast<int64_t>(i));
+				BSON_APPEND_INT64(request, "b", 1);
+				success = service.CallService(request, callback);
+			}
+			else {
+				rapidjson::Document document;
+				rapidjson::Value request(rapidjson::kObjectType);
+				request.AddMember("a", static_cast<int64_t>(i), document.GetAllocator());
+				request.AddMember("b", 1, document.GetAllocator());
+				success = service.CallService(request, callback);
+			}
+
+			if (!success) {
+				std::lock_guard<std::mutex> lock(mutex);
+				in_flight--;
+				break;
+			}
+			result.sent_++;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait_for(lock, std::chrono::seconds(2), [&]() { return in_flight == 0; });
+		}
+		result.seconds_ = (Now() - start_ns) / 1e9;
+
+		// late responses must not touch the locals of this function anymore
+		std::lock_guard<std::mutex> lock(mutex);
+		if (in_flight) {
+			std::cerr << in_flight << " service calls unanswered" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void PrintHeader(std::ostream& out)
+	{
+		out << std::left << std::setw(10) << "case" << std::right
+			<< std::setw(10) << "size" << std::setw(8) << "topics"
+			<< std::setw(12) << "msgs/s" << std::setw(10) << "MB/s"
+			<< std::setw(10) << "p50 us" << std::setw(10) << "p90 us" << std::setw(10) << "p99 us" << std::setw(10) << "max us"
+			<< std::setw(9) << "dropped" << std::setw(10) << "rx B/msg" << std::endl;
+	}
+
+	void PrintResult(std::ostream& out, const BenchResult& result)
+	{
+		const double rate = result.seconds_ > 0 ? result.received_ / result.seconds_ : 0;
+		out << std::left << std::setw(10) << result.name_ << std::right
+			<< std::setw(10) << result.size_ << std::setw(8) << result.topics_
+			<< std::fixed << std::setprecision(0) << std::setw(12) << rate
+			<< std::setprecision(2) << std::setw(10) << rate * result.size_ / 1e6
+			<< std::setprecision(0)
+			<< std::setw(10) << result.latency_.ValueAtPercentile(0.5) / 1e3
+			<< std::setw(10) << result.latency_.ValueAtPercentile(0.9) / 1e3
+			<< std::setw(10) << result.latency_.ValueAtPercentile(0.99) / 1e3
+			<< std::setw(10) << result.latency_.Max() / 1e3
+			<< std::setw(9) << (result.sent_ - result.received_);
+		if (result.bytes_received_ > 0 && result.received_ > 0) out << std::setw(10) << result.bytes_received_ / result.received_;
+		else out << std::setw(10) << "-";
+		out << std::endl;
+	}
+
+	void WriteCSVRow(std::ostream& out, const BenchOptions& options, const BenchResult& result)
+	{
+		const double rate = result.seconds_ > 0 ? result.received_ / result.seconds_ : 0;
+		out << TransportName(options.transport_) << ","
+			<< (options.encoding_ == Encoding::BSON ? "bson" : "json") << ","
+			<< result.name_ << "," << result.size_ << "," << result.topics_ << ","
+			<< result.sent_ << "," << result.received_ << "," << rate << "," << rate * result.size_ / 1e6 << ","
+			<< result.latency_.ValueAtPercentile(0.5) << "," << result.latency_.ValueAtPercentile(0.9) << ","
+			<< result.latency_.ValueAtPercentile(0.99) << "," << result.latency_.Max() << std::endl;
+	}
+
+	void PrintUsage()
+	{
+		std::cout <<
+			"Usage: rosbridge_bench [options]\n"
+			"  --transport tcp|ws|unix  default: tcp, unix uses the UnixSocketConnection of the plugin\n"
+			"  --encoding bson|json     default: bson\n"
+			"  --host <ip>              default: 127.0.0.1, the socket path for unix\n"
+			"  --port <port>            rosbridge to connect to, default: start an embedded stand-in in echo mode\n"
+			"  --sizes <list>           payload sizes in bytes, default: 64,1024,65536,1048576\n"
+			"  --topics <list>          number of topics published in parallel, default: 1,4,16\n"
+			"  --duration <s>           duration of every topic case, default: 3\n"
+			"  --window <n>             unanswered messages per topic, default: 8\n"
+			"  --service-calls <n>      calls per service case, 0 disables them, default: 1000\n"
+			"  --service-window <n>     concurrent calls of the pipelined service case, default: 32\n"
+			"  --batch-registrations    batch the advertise/subscribe messages, see ROSBridge::SetBatchControlMessages\n"
+			"  --shared-memory          pass payloads of 64 KiB and more through shared memory, see ROSBridge::SetSharedMemoryPayloads\n"
+			"  --compression none|cbor  compression of the subscriptions, see ROSBridge::SetSubscriptionCompression, default: none\n"
+			"  --payload bytes|floats   uint8[] or float32[] (size / 4 elements) payloads, default: bytes\n"
+			"  --fragment-size <bytes>  let the server split larger messages into fragments, see ROSTopic::SetFragmentSize\n"
+			"  --csv <file>             additionally write the results (latencies in ns) as CSV\n";
+	}
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (arg == "--transport" && has_value) {
+			if (!ParseTransport(argv[++i], options.transport_)) { PrintUsage(); return 1; }
+		}
+		else if (arg == "--encoding" && has_value) {
+			if (!ParseEncoding(argv[++i], options.encoding_)) { PrintUsage(); return 1; }
+		}
+		else if (arg == "--host" && has_value) options.host_ = argv[++i];
+		else if (arg == "--port" && has_value) options.port_ = std::atoi(argv[++i]);
+		else if (arg == "--sizes" && has_value) options.sizes_ = ParseList(argv[++i]);
+		else if (arg == "--topics" && has_value) options.topic_counts_ = ParseList(argv[++i]);
+		else if (arg == "--duration" && has_value) options.duration_ = std::atof(argv[++i]);
+		else if (arg == "--window" && has_value) options.window_ = std::max<size_t>(1, static_cast<size_t>(std::atoll(argv[++i])));
+		else if (arg == "--service-calls" && has_value) options.service_calls_ = static_cast<size_t>(std::atoll(argv[++i]));
+		else if (arg == "--service-window" && has_value) options.service_window_ = std::max<size_t>(1, static_cast<size_t>(std::atoll(argv[++i])));
+		else if (arg == "--batch-registrations") options.batch_registrations_ = true;
+		else if (arg == "--shared-memory") options.shared_memory_ = true;
+		else if (arg == "--compression" && has_value) options.compression_ = argv[++i];
+		else if (arg == "--payload" && has_value) {
+			const std::string payload = argv[++i];
+			if (payload != "bytes" && payload != "floats") { PrintUsage(); return 1; }
+			options.float_payload_ = payload == "floats";
+		}
+		else if (arg == "--fragment-size" && has_value) options.fragment_size_ = std::atoi(argv[++i]);
+		else if (arg == "--csv" && has_value) options.csv_file_ = argv[++i];
+		else { PrintUsage(); return arg == "--help" ? 0 : 1; }
+	}
+
+	if (options.transport_ == Transport::UNIX && options.host_ == BenchOptions().host_) {
+		options.host_ = "/tmp/rosbridge_bench.sock";
+	}
+
+	std::unique_ptr<StandinServer> server;
+	if (options.port_ == 0) {
+		StandinServer::Options server_options;
+		server_options.transport_ = options.transport_;
+		server_options.encoding_ = options.encoding_;
+		server_options.host_ = options.host_;
+		server_options.port_ = 0;
+		server.reset(new StandinServer(server_options));
+		if (!server->Start()) return 1;
+		options.port_ = server->Port();
+	}
+
+	std::ofstream csv;
+	if (!options.csv_file_.empty()) {
+		csv.open(options.csv_file_);
+		csv << "transport,encoding,case,size,topics,sent,received,msgs_per_s,mb_per_s,p50_ns,p90_ns,p99_ns,max_ns" << std::endl;
+	}
+
+	std::cout << "rosbridge_bench " << TransportName(options.transport_) << "/"
+		<< (options.encoding_ == Encoding::BSON ? "bson" : "json") << " against " << options.host_ << ":" << options.port_
+		<< (server ? " (embedded stand-in)" : "")
+		<< (options.compression_ != "none" ? ", subscriptions with compression " + options.compression_ : std::string())
+		<< (options.fragment_size_ > 0 ? ", fragment size " + std::to_string(options.fragment_size_) : std::string()) << std::endl;
+	PrintHeader(std::cout);
+
+	int return_value = 0;
+	for (size_t size : options.sizes_) {
+		for (size_t num_topics : options.topic_counts_) {
+			BenchResult result;
+			result.name_ = "publish";
+			if (!RunTopicCase(options, size, num_topics, result)) {
+				std::cerr << "Case size=" << size << " topics=" << num_topics << " failed" << std::endl;
+				return_value = 1;
+				continue;
+			}
+			PrintResult(std::cout, result);
+			if (csv.is_open()) WriteCSVRow(csv, options, result);
+		}
+	}
+
+	if (options.service_calls_ > 0) {
+		// 'topics' is the number of concurrent calls for the service cases
+		for (size_t window : { static_cast<size_t>(1), options.service_window_ }) {
+			BenchResult result;
+			result.name_ = "service";
+			if (!RunServiceCase(options, window, result)) {
+				std::cerr << "Service case with " << window << " concurrent calls failed" << std::endl;
+				return_value = 1;
+				continue;
+			}
+			PrintResult(std::cout, result);
+			if (csv.is_open()) WriteCSVRow(csv, options, result);
+		}
+	}
+
+	return return_value;
+}
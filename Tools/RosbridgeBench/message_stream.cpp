@@ -0,0 +1,473 @@
+#include "message_stream.h"
+
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cbor_codec.h"
+
+namespace rosbridge_bench {
+
+	static const uint8_t OpcodeContinuation = 0x0;
+	static const uint8_t OpcodeText = 0x1;
+	static const uint8_t OpcodeBinary = 0x2;
+	static const uint8_t OpcodeClose = 0x8;
+	static const uint8_t OpcodePing = 0x9;
+	static const uint8_t OpcodePong = 0xA;
+
+	bool ParseTransport(const std::string& name, Transport& transport)
+	{
+		if (name == "tcp") { transport = Transport::TCP; return true; }
+		if (name == "ws") { transport = Transport::WEBSOCKET; return true; }
+		if (name == "unix") { transport = Transport::UNIX; return true; }
+		return false;
+	}
+
+	const char* TransportName(Transport transport)
+	{
+		switch (transport) {
+		case Transport::WEBSOCKET: return "ws";
+		case Transport::UNIX: return "unix";
+		default: return "tcp";
+		}
+	}
+
+	bool ParseEncoding(const std::string& name, Encoding& encoding)
+	{
+		if (name == "bson") { encoding = Encoding::BSON; return true; }
+		if (name == "json") { encoding = Encoding::JSON; return true; }
+		return false;
+	}
+
+	bool ReadExact(int fd, uint8_t *data, size_t length)
+	{
+		while (length > 0) {
+			const ssize_t bytes_read = recv(fd, data, length, 0);
+			if (bytes_read < 0 && errno == EINTR) continue;
+			if (bytes_read <= 0) return false;
+			data += bytes_read;
+			length -= static_cast<size_t>(bytes_read);
+		}
+		return true;
+	}
+
+	bool WriteAll(int fd, const uint8_t *data, size_t length)
+	{
+		while (length > 0) {
+			const ssize_t bytes_sent = send(fd, data, length, MSG_NOSIGNAL);
+			if (bytes_sent < 0 && errno == EINTR) continue;
+			if (bytes_sent <= 0) return false;
+			data += bytes_sent;
+			length -= static_cast<size_t>(bytes_sent);
+		}
+		return true;
+	}
+
+	static void SetNoDelay(int fd)
+	{
+		int flag = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+	}
+
+	int ConnectTcp(const std::string& host, int port)
+	{
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		addrinfo *addresses = nullptr;
+		if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) return -1;
+
+		int fd = -1;
+		for (addrinfo *address = addresses; address; address = address->ai_next) {
+			fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+			if (fd < 0) continue;
+			if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) break;
+			close(fd);
+			fd = -1;
+		}
+		freeaddrinfo(addresses);
+
+		if (fd >= 0) SetNoDelay(fd);
+		return fd;
+	}
+
+	int ListenTcp(const std::string& host, int port, int& bound_port)
+	{
+		const int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) return -1;
+
+		int reuse = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(static_cast<uint16_t>(port));
+		if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1 ||
+			bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+			listen(fd, 16) != 0) {
+			close(fd);
+			return -1;
+		}
+
+		socklen_t length = sizeof(address);
+		getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+		bound_port = ntohs(address.sin_port);
+		return fd;
+	}
+
+	static bool MakeUnixAddress(const std::string& path, sockaddr_un& address)
+	{
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+		memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+
+	int ConnectUnix(const std::string& path)
+	{
+		sockaddr_un address;
+		if (!MakeUnixAddress(path, address)) return -1;
+
+		const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) return -1;
+		if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	int ListenUnix(const std::string& path)
+	{
+		sockaddr_un address;
+		if (!MakeUnixAddress(path, address)) return -1;
+
+		const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) return -1;
+
+		unlink(path.c_str());
+		if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 16) != 0) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	// Minimal SHA-1 (FIPS 180-1), only used for the websocket handshake
+	static std::string Sha1(const std::string& input)
+	{
+		uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+		std::string data = input;
+		const uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+		data.push_back(static_cast<char>(0x80));
+		while (data.size() % 64 != 56) data.push_back(0);
+		for (int i = 7; i >= 0; --i) data.push_back(static_cast<char>((bit_length >> (i * 8)) & 0xFF));
+
+		auto rotl = [](uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); };
+		for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+			uint32_t w[80];
+			for (int i = 0; i < 16; ++i) {
+				w[i] = (static_cast<uint32_t>(static_cast<uint8_t>(data[chunk + i * 4])) << 24) |
+					(static_cast<uint32_t>(static_cast<uint8_t>(data[chunk + i * 4 + 1])) << 16) |
+					(static_cast<uint32_t>(static_cast<uint8_t>(data[chunk + i * 4 + 2])) << 8) |
+					static_cast<uint32_t>(static_cast<uint8_t>(data[chunk + i * 4 + 3]));
+			}
+			for (int i = 16; i < 80; ++i) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+			uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+			for (int i = 0; i < 80; ++i) {
+				uint32_t f, k;
+				if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+				else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+				else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+				else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+				const uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+				e = d; d = c; c = rotl(b, 30); b = a; a = temp;
+			}
+			h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+		}
+
+		std::string digest;
+		for (uint32_t value : h) {
+			for (int i = 3; i >= 0; --i) digest.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+		}
+		return digest;
+	}
+
+	static std::string Base64(const std::string& input)
+	{
+		static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string output;
+		size_t i = 0;
+		for (; i + 2 < input.size(); i += 3) {
+			const uint32_t n = (static_cast<uint8_t>(input[i]) << 16) | (static_cast<uint8_t>(input[i + 1]) << 8) | static_cast<uint8_t>(input[i + 2]);
+			output += alphabet[(n >> 18) & 63];
+			output += alphabet[(n >> 12) & 63];
+			output += alphabet[(n >> 6) & 63];
+			output += alphabet[n & 63];
+		}
+		if (i + 1 == input.size()) {
+			const uint32_t n = static_cast<uint8_t>(input[i]) << 16;
+			output += alphabet[(n >> 18) & 63];
+			output += alphabet[(n >> 12) & 63];
+			output += "==";
+		}
+		else if (i + 2 == input.size()) {
+			const uint32_t n = (static_cast<uint8_t>(input[i]) << 16) | (static_cast<uint8_t>(input[i + 1]) << 8);
+			output += alphabet[(n >> 18) & 63];
+			output += alphabet[(n >> 12) & 63];
+			output += alphabet[(n >> 6) & 63];
+			output += '=';
+		}
+		return output;
+	}
+
+	std::string WebsocketAcceptKey(const std::string& key)
+	{
+		return Base64(Sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+	}
+
+	// Reads the HTTP header up to the empty line
+	static bool ReadHttpHeader(int fd, std::string& header)
+	{
+		header.clear();
+		uint8_t c;
+		while (header.size() < 8192) {
+			if (!ReadExact(fd, &c, 1)) return false;
+			header.push_back(static_cast<char>(c));
+			if (header.size() >= 4 && header.compare(header.size() - 4, 4, "\r\n\r\n") == 0) return true;
+		}
+		return false;
+	}
+
+	static std::string HeaderValue(const std::string& header, const std::string& name)
+	{
+		std::istringstream lines(header);
+		std::string line;
+		while (std::getline(lines, line)) {
+			const size_t colon = line.find(':');
+			if (colon == std::string::npos || colon != name.size()) continue;
+			if (strncasecmp(line.c_str(), name.c_str(), name.size()) != 0) continue;
+
+			std::string value = line.substr(colon + 1);
+			value.erase(0, value.find_first_not_of(" \t"));
+			value.erase(value.find_last_not_of(" \t\r") + 1);
+			return value;
+		}
+		return "";
+	}
+
+	bool WebsocketClientHandshake(int fd, const std::string& host, int port)
+	{
+		const std::string key = "cm9zYnJpZGdlLWJlbmNoIQ==";
+		std::ostringstream request;
+		request << "GET / HTTP/1.1\r\n"
+			<< "Host: " << host << ":" << port << "\r\n"
+			<< "Upgrade: websocket\r\n"
+			<< "Connection: Upgrade\r\n"
+			<< "Sec-WebSocket-Key: " << key << "\r\n"
+			<< "Sec-WebSocket-Version: 13\r\n\r\n";
+		const std::string data = request.str();
+		if (!WriteAll(fd, reinterpret_cast<const uint8_t*>(data.data()), data.size())) return false;
+
+		std::string response;
+		if (!ReadHttpHeader(fd, response)) return false;
+		return response.compare(0, 12, "HTTP/1.1 101") == 0 && HeaderValue(response, "Sec-WebSocket-Accept") == WebsocketAcceptKey(key);
+	}
+
+	bool WebsocketServerHandshake(int fd)
+	{
+		std::string request;
+		if (!ReadHttpHeader(fd, request)) return false;
+
+		const std::string key = HeaderValue(request, "Sec-WebSocket-Key");
+		if (key.empty()) return false;
+
+		const std::string response =
+			"HTTP/1.1 101 Switching Protocols\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Accept: " + WebsocketAcceptKey(key) + "\r\n\r\n";
+		return WriteAll(fd, reinterpret_cast<const uint8_t*>(response.data()), response.size());
+	}
+
+	bool MessageStream::Read(std::vector<uint8_t>& message)
+	{
+		if (transport_ == Transport::WEBSOCKET) return ReadWebsocketMessage(message);
+		if (encoding_ == Encoding::JSON) return ReadJSONObject(message);
+
+		uint8_t length_bytes[4];
+		if (!ReadExact(fd_, length_bytes, 4)) return false;
+		if (rosbridge2cpp::CBORCodec::IsMessage(length_bytes, 4)) return ReadCBORMessage(length_bytes, message);
+
+		const uint32_t length = static_cast<uint32_t>(length_bytes[0]) | (static_cast<uint32_t>(length_bytes[1]) << 8) |
+			(static_cast<uint32_t>(length_bytes[2]) << 16) | (static_cast<uint32_t>(length_bytes[3]) << 24);
+		if (length < 5) return false;
+
+		message.resize(length);
+		memcpy(message.data(), length_bytes, 4);
+		return ReadExact(fd_, message.data() + 4, length - 4);
+	}
+
+	bool MessageStream::ReadCBORMessage(const uint8_t *first_bytes, std::vector<uint8_t>& message)
+	{
+		message.assign(first_bytes, first_bytes + rosbridge2cpp::CBORCodec::kDetectLength);
+		rosbridge2cpp::CBORCodec::ItemScanner scanner;
+		while (true) {
+			size_t length = 0;
+			const rosbridge2cpp::CBORCodec::ItemStatus status = scanner.Scan(message.data(), message.size(), length);
+			if (status == rosbridge2cpp::CBORCodec::ItemStatus::COMPLETE) return true;
+			if (status == rosbridge2cpp::CBORCodec::ItemStatus::INVALID) return false;
+
+			// never read beyond the lower bound, the next message follows right after this one
+			const size_t num_read = message.size();
+			message.resize(length);
+			if (!ReadExact(fd_, message.data() + num_read, length - num_read)) return false;
+		}
+	}
+
+	bool MessageStream::ReadJSONObject(std::vector<uint8_t>& message)
+	{
+		while (true) {
+			// find the end of the first complete top level object in the buffer
+			int depth = 0;
+			bool in_string = false;
+			bool escaped = false;
+			size_t start = std::string::npos;
+			for (size_t i = 0; i < json_buffer_.size(); ++i) {
+				const char c = static_cast<char>(json_buffer_[i]);
+				if (in_string) {
+					if (escaped) escaped = false;
+					else if (c == '\\') escaped = true;
+					else if (c == '"') in_string = false;
+					continue;
+				}
+				if (c == '"') in_string = true;
+				else if (c == '{') {
+					if (depth++ == 0) start = i;
+				}
+				else if (c == '}' && depth > 0 && --depth == 0) {
+					message.assign(json_buffer_.begin() + start, json_buffer_.begin() + i + 1);
+					json_buffer_.erase(json_buffer_.begin(), json_buffer_.begin() + i + 1);
+					return true;
+				}
+			}
+
+			uint8_t chunk[65536];
+			const ssize_t bytes_read = recv(fd_, chunk, sizeof(chunk), 0);
+			if (bytes_read < 0 && errno == EINTR) continue;
+			if (bytes_read <= 0) return false;
+			json_buffer_.insert(json_buffer_.end(), chunk, chunk + bytes_read);
+		}
+	}
+
+	bool MessageStream::ReadWebsocketMessage(std::vector<uint8_t>& message)
+	{
+		message.clear();
+		while (true) {
+			uint8_t header[2];
+			if (!ReadExact(fd_, header, 2)) return false;
+
+			const bool fin = (header[0] & 0x80) != 0;
+			const uint8_t opcode = header[0] & 0x0F;
+			const bool masked = (header[1] & 0x80) != 0;
+			uint64_t length = header[1] & 0x7F;
+
+			if (length == 126) {
+				uint8_t extended[2];
+				if (!ReadExact(fd_, extended, 2)) return false;
+				length = (static_cast<uint64_t>(extended[0]) << 8) | extended[1];
+			}
+			else if (length == 127) {
+				uint8_t extended[8];
+				if (!ReadExact(fd_, extended, 8)) return false;
+				length = 0;
+				for (int i = 0; i < 8; ++i) length = (length << 8) | extended[i];
+			}
+
+			uint8_t mask[4] = { 0, 0, 0, 0 };
+			if (masked && !ReadExact(fd_, mask, 4)) return false;
+
+			frame_buffer_.resize(static_cast<size_t>(length));
+			if (length > 0 && !ReadExact(fd_, frame_buffer_.data(), frame_buffer_.size())) return false;
+			if (masked) {
+				for (size_t i = 0; i < frame_buffer_.size(); ++i) frame_buffer_[i] ^= mask[i % 4];
+			}
+
+			switch (opcode) {
+			case OpcodeClose:
+				return false;
+			case OpcodePing:
+				if (!WriteWebsocketFrame(OpcodePong, frame_buffer_.data(), frame_buffer_.size())) return false;
+				continue;
+			case OpcodePong:
+				continue;
+			case OpcodeText:
+			case OpcodeBinary:
+			case OpcodeContinuation:
+				message.insert(message.end(), frame_buffer_.begin(), frame_buffer_.end());
+				if (fin) return true;
+				continue;
+			default:
+				return false;
+			}
+		}
+	}
+
+	bool MessageStream::Write(const uint8_t *data, size_t length)
+	{
+		if (transport_ == Transport::WEBSOCKET) {
+			return WriteWebsocketFrame(encoding_ == Encoding::BSON ? OpcodeBinary : OpcodeText, data, length);
+		}
+		return WriteAll(fd_, data, length);
+	}
+
+	bool MessageStream::WriteWebsocketFrame(uint8_t opcode, const uint8_t *data, size_t length)
+	{
+		std::vector<uint8_t> frame;
+		frame.reserve(length + 14);
+		frame.push_back(0x80 | opcode);
+
+		const uint8_t mask_bit = is_client_ ? 0x80 : 0x00;
+		if (length < 126) {
+			frame.push_back(mask_bit | static_cast<uint8_t>(length));
+		}
+		else if (length <= 0xFFFF) {
+			frame.push_back(mask_bit | 126);
+			frame.push_back(static_cast<uint8_t>(length >> 8));
+			frame.push_back(static_cast<uint8_t>(length));
+		}
+		else {
+			frame.push_back(mask_bit | 127);
+			for (int i = 7; i >= 0; --i) frame.push_back(static_cast<uint8_t>(static_cast<uint64_t>(length) >> (i * 8)));
+		}
+
+		if (!is_client_) {
+			frame.insert(frame.end(), data, data + length);
+			return WriteAll(fd_, frame.data(), frame.size());
+		}
+
+		static thread_local std::mt19937 random(std::random_device{}());
+		const uint32_t mask_value = random();
+		const uint8_t mask[4] = { static_cast<uint8_t>(mask_value), static_cast<uint8_t>(mask_value >> 8), static_cast<uint8_t>(mask_value >> 16), static_cast<uint8_t>(mask_value >> 24) };
+		frame.insert(frame.end(), mask, mask + 4);
+		const size_t payload_offset = frame.size();
+		frame.insert(frame.end(), data, data + length);
+		for (size_t i = 0; i < length; ++i) frame[payload_offset + i] ^= mask[i % 4];
+		return WriteAll(fd_, frame.data(), frame.size());
+	}
+}
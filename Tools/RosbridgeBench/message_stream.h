@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rosbridge_bench {
+
+	// UNIX is a Unix domain stream socket with the framing of TCP, its host is the path of the socket
+	enum class Transport { TCP, WEBSOCKET, UNIX };
+	enum class Encoding { BSON, JSON };
+
+	bool ParseTransport(const std::string& name, Transport& transport);
+	const char* TransportName(Transport transport);
+	bool ParseEncoding(const std::string& name, Encoding& encoding);
+
+	// Blocking socket helpers, all return false on error or when the peer closed the connection
+	bool ReadExact(int fd, uint8_t *data, size_t length);
+	bool WriteAll(int fd, const uint8_t *data, size_t length);
+
+	// Returns a connected socket or -1
+	int ConnectTcp(const std::string& host, int port);
+
+	// Returns a listening socket or -1. If port is 0, bound_port receives the port chosen by the system.
+	int ListenTcp(const std::string& host, int port, int& bound_port);
+
+	// Same for Unix domain sockets. ListenUnix replaces an existing socket file at path.
+	int ConnectUnix(const std::string& path);
+	int ListenUnix(const std::string& path);
+
+	// Performs the HTTP upgrade of a websocket connection
+	bool WebsocketClientHandshake(int fd, const std::string& host, int port);
+	bool WebsocketServerHandshake(int fd);
+
+	// Returns the Sec-WebSocket-Accept value for the given Sec-WebSocket-Key (RFC 6455, 4.2.2)
+	std::string WebsocketAcceptKey(const std::string& key);
+
+	/**
+	 * Splits the byte stream of a rosbridge connection into messages and writes messages to it.
+	 *
+	 * TCP + BSON:  every message is a BSON document, framed by its own length prefix (UNIX as well), or a CBOR
+ *              message of a subscription with compression "cbor", which delimits itself
+	 * TCP + JSON:  JSON objects are concatenated without delimiter
+	 * Websocket:   one message per (possibly fragmented) frame, binary for BSON and text for JSON
+	 *
+	 * Reading and writing may happen on different threads, but only one thread may write at a time.
+	 */
+	class MessageStream {
+	public:
+		// Clients have to mask their websocket frames, servers must not
+		MessageStream(int fd, Transport transport, Encoding encoding, bool is_client)
+			: fd_(fd), transport_(transport), encoding_(encoding), is_client_(is_client) {}
+
+		// Blocks until the next complete message has been received
+		bool Read(std::vector<uint8_t>& message);
+
+		bool Write(const uint8_t *data, size_t length);
+		bool Write(const std::string& data) { return Write(reinterpret_cast<const uint8_t*>(data.data()), data.size()); }
+
+		int fd() const { return fd_; }
+
+	private:
+		bool ReadWebsocketMessage(std::vector<uint8_t>& message);
+		bool ReadJSONObject(std::vector<uint8_t>& message);
+		bool ReadCBORMessage(const uint8_t *first_bytes, std::vector<uint8_t>& message);
+		bool WriteWebsocketFrame(uint8_t opcode, const uint8_t *data, size_t length);
+
+		int fd_;
+		Transport transport_;
+		Encoding encoding_;
+		bool is_client_;
+
+		// unparsed bytes of a TCP JSON stream
+		std::vector<uint8_t> json_buffer_;
+		std::vector<uint8_t> frame_buffer_;
+	};
+}
@@ -0,0 +1,141 @@
+#include "posix_connection.h"
+
+#include <iostream>
+
+#include "cbor_codec.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace rosbridge_bench {
+
+	PosixConnection::~PosixConnection()
+	{
+		run_receiver_thread_ = false;
+		if (fd_ >= 0) {
+			shutdown(fd_, SHUT_RDWR); // wakes up the receiver thread
+		}
+		if (receiver_thread_.joinable()) {
+			receiver_thread_.join();
+		}
+		if (fd_ >= 0) {
+			close(fd_);
+		}
+	}
+
+	bool PosixConnection::Init(std::string ip_addr, int port)
+	{
+		fd_ = transport_ == Transport::UNIX ? ConnectUnix(ip_addr) : ConnectTcp(ip_addr, port);
+		if (fd_ < 0) {
+			std::cerr << "[PosixConnection] Couldn't connect to " << ip_addr << ":" << port << std::endl;
+			return false;
+		}
+
+		if (transport_ == Transport::WEBSOCKET && !WebsocketClientHandshake(fd_, ip_addr, port)) {
+			std::cerr << "[PosixConnection] Websocket handshake with " << ip_addr << ":" << port << " failed" << std::endl;
+			close(fd_);
+			fd_ = -1;
+			return false;
+		}
+
+		stream_.reset(new MessageStream(fd_, transport_, encoding_, true));
+		run_receiver_thread_ = true;
+		receiver_thread_ = std::thread(&PosixConnection::ReceiverThreadFunction, this);
+		return true;
+	}
+
+	bool PosixConnection::SendMessage(std::string data)
+	{
+		return SendMessage(reinterpret_cast<const uint8_t*>(data.data()), static_cast<unsigned int>(data.size()));
+	}
+
+	bool PosixConnection::SendMessage(const uint8_t *data, unsigned int length)
+	{
+		if (!stream_) return false;
+
+		std::lock_guard<std::mutex> lock(send_mutex_);
+		if (!stream_->Write(data, length)) {
+			ReportError(rosbridge2cpp::TransportError::R2C_SOCKET_ERROR);
+			return false;
+		}
+		bytes_sent_.fetch_add(length, std::memory_order_relaxed);
+		return true;
+	}
+
+	void PosixConnection::ReceiverThreadFunction()
+	{
+		std::vector<uint8_t> message;
+		while (run_receiver_thread_) {
+			if (!stream_->Read(message)) {
+				if (run_receiver_thread_) {
+					ReportError(rosbridge2cpp::TransportError::R2C_CONNECTION_CLOSED);
+				}
+				break;
+			}
+			bytes_received_.fetch_add(message.size(), std::memory_order_relaxed);
+
+			if (encoding_ == Encoding::BSON && rosbridge2cpp::CBORCodec::IsMessage(message.data(), message.size())) {
+				bson_t b;
+				bson_init(&b);
+				if (!rosbridge2cpp::CBORCodec::ToBSON(message.data(), message.size(), &b)) {
+					std::cerr << "[PosixConnection] Error on CBOR parse - Ignoring message" << std::endl;
+				}
+				else if (incoming_message_callback_bson_) {
+					bson_t view;
+					bson_init_static(&view, bson_get_data(&b), b.len);
+					incoming_message_callback_bson_(view);
+				}
+				bson_destroy(&b);
+			}
+			else if (encoding_ == Encoding::BSON) {
+				bson_t b;
+				if (!bson_init_static(&b, message.data(), message.size())) {
+					std::cerr << "[PosixConnection] Error on BSON parse - Ignoring message" << std::endl;
+					continue;
+				}
+				if (incoming_message_callback_bson_) {
+					incoming_message_callback_bson_(b);
+				}
+			}
+			else {
+				json j;
+				j.Parse(reinterpret_cast<const char*>(message.data()), message.size());
+				if (j.HasParseError() || !j.IsObject()) {
+					std::cerr << "[PosixConnection] Error on JSON parse - Ignoring message" << std::endl;
+					continue;
+				}
+				if (incoming_message_callback_) {
+					incoming_message_callback_(j);
+				}
+			}
+		}
+		run_receiver_thread_ = false;
+	}
+
+	void PosixConnection::RegisterIncomingMessageCallback(std::function<void(json&)> fun)
+	{
+		incoming_message_callback_ = fun;
+	}
+
+	void PosixConnection::RegisterIncomingMessageCallback(std::function<void(bson_t&)> fun)
+	{
+		incoming_message_callback_bson_ = fun;
+	}
+
+	void PosixConnection::RegisterErrorCallback(std::function<void(rosbridge2cpp::TransportError)> fun)
+	{
+		error_callback_ = fun;
+	}
+
+	void PosixConnection::ReportError(rosbridge2cpp::TransportError err)
+	{
+		if (error_callback_) {
+			error_callback_(err);
+		}
+	}
+
+	void PosixConnection::SetTransportMode(rosbridge2cpp::ITransportLayer::TransportMode mode)
+	{
+		encoding_ = mode == rosbridge2cpp::ITransportLayer::BSON ? Encoding::BSON : Encoding::JSON;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "itransport_layer.h"
+#include "message_stream.h"
+
+namespace rosbridge_bench {
+
+	/**
+	 * Engine free rosbridge2cpp transport on top of POSIX sockets.
+	 * Speaks the same framing as TCPConnection (plain TCP) and WebsocketConnection (ws) of the plugin,
+	 * so the ROSBridge code under test is exactly the one that runs in the engine.
+	 */
+	class PosixConnection : public rosbridge2cpp::ITransportLayer {
+	public:
+		explicit PosixConnection(Transport transport) : transport_(transport) {}
+		~PosixConnection();
+
+		bool Init(std::string ip_addr, int port) override;
+		bool SendMessage(std::string data) override;
+		bool SendMessage(const uint8_t *data, unsigned int length) override;
+		bool SupportsCoalescedWrites() const override { return transport_ != Transport::WEBSOCKET; }
+		void RegisterIncomingMessageCallback(std::function<void(json&)> fun) override;
+		void RegisterIncomingMessageCallback(std::function<void(bson_t&)> fun) override;
+		void RegisterErrorCallback(std::function<void(rosbridge2cpp::TransportError)> fun) override;
+		void ReportError(rosbridge2cpp::TransportError err) override;
+		void SetTransportMode(rosbridge2cpp::ITransportLayer::TransportMode mode) override;
+
+		uint64_t BytesSent() const { return bytes_sent_.load(std::memory_order_relaxed); }
+		uint64_t BytesReceived() const { return bytes_received_.load(std::memory_order_relaxed); }
+
+	private:
+		void ReceiverThreadFunction();
+
+		Transport transport_;
+		Encoding encoding_ = Encoding::JSON;
+		int fd_ = -1;
+		std::unique_ptr<MessageStream> stream_;
+		std::mutex send_mutex_;
+
+		std::thread receiver_thread_;
+		std::atomic<bool> run_receiver_thread_{ false };
+
+		std::function<void(json&)> incoming_message_callback_;
+		std::function<void(bson_t&)> incoming_message_callback_bson_;
+		std::function<void(rosbridge2cpp::TransportError)> error_callback_;
+
+		std::atomic<uint64_t> bytes_sent_{ 0 };
+		std::atomic<uint64_t> bytes_received_{ 0 };
+	};
+}
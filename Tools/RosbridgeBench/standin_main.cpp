@@ -0,0 +1,96 @@
+// rosbridge_standin: a rosbridge protocol stand-in for local testing of rosbridge2cpp without ROS
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "standin_server.h"
+
+using namespace rosbridge_bench;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void HandleSignal(int)
+{
+	stop_requested = 1;
+}
+
+static void PrintUsage()
+{
+	std::cout <<
+		"Usage: rosbridge_standin [options]\n"
+		"  --transport tcp|ws|unix   default: tcp\n"
+		"  --encoding bson|json      default: bson\n"
+		"  --mode echo|sink|generate default: echo\n"
+		"  --host <ip>               default: 127.0.0.1, the socket path for unix\n"
+		"  --port <port>             default: 9090, 0 picks a free port\n"
+		"  --size <bytes>            payload of generated messages, default: 1024\n"
+		"  --rate <hz>               generated messages per second and topic, default: 100\n";
+}
+
+int main(int argc, char **argv)
+{
+	StandinServer::Options options;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (arg == "--transport" && has_value) {
+			if (!ParseTransport(argv[++i], options.transport_)) { PrintUsage(); return 1; }
+		}
+		else if (arg == "--encoding" && has_value) {
+			if (!ParseEncoding(argv[++i], options.encoding_)) { PrintUsage(); return 1; }
+		}
+		else if (arg == "--mode" && has_value) {
+			if (!StandinServer::ParseMode(argv[++i], options.mode_)) { PrintUsage(); return 1; }
+		}
+		else if (arg == "--host" && has_value) options.host_ = argv[++i];
+		else if (arg == "--port" && has_value) options.port_ = std::atoi(argv[++i]);
+		else if (arg == "--size" && has_value) options.generate_size_ = static_cast<size_t>(std::atoll(argv[++i]));
+		else if (arg == "--rate" && has_value) options.generate_rate_ = std::atof(argv[++i]);
+		else { PrintUsage(); return arg == "--help" ? 0 : 1; }
+	}
+
+	StandinServer server(options);
+	if (!server.Start()) return 1;
+
+	std::signal(SIGINT, HandleSignal);
+	std::signal(SIGTERM, HandleSignal);
+	if (options.transport_ == Transport::UNIX) {
+		std::cout << "rosbridge stand-in listening on " << options.host_ << std::endl;
+	}
+	else {
+		std::cout << "rosbridge stand-in listening on " << options.host_ << ":" << server.Port() << std::endl;
+	}
+
+	StandinServer::Stats last = server.GetStats();
+	while (!stop_requested) {
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		const StandinServer::Stats stats = server.GetStats();
+		std::cout << "clients " << stats.clients_
+			<< "  in " << (stats.messages_received_ - last.messages_received_) << " msg/s "
+			<< (stats.bytes_received_ - last.bytes_received_) / 1e6 << " MB/s"
+			<< "  out " << (stats.messages_sent_ - last.messages_sent_) << " msg/s "
+			<< (stats.bytes_sent_ - last.bytes_sent_) / 1e6 << " MB/s"
+			<< "  publish " << (stats.publishes_ - last.publishes_) << "/s"
+			<< "  call_service " << (stats.service_calls_ - last.service_calls_) << "/s";
+		if (stats.shm_payloads_ || stats.shm_stale_) {
+			std::cout << "  shm " << (stats.shm_payloads_ - last.shm_payloads_) << "/s"
+				<< " (" << (stats.shm_stale_ - last.shm_stale_) << " stale)";
+		}
+		if (stats.cbor_messages_) {
+			std::cout << "  cbor " << (stats.cbor_messages_ - last.cbor_messages_) << " msg/s";
+		}
+		if (stats.throttled_) {
+			std::cout << "  throttled " << (stats.throttled_ - last.throttled_) << "/s";
+		}
+		if (stats.fragments_) {
+			std::cout << "  fragments " << (stats.fragments_ - last.fragments_) << "/s";
+		}
+		std::cout << std::endl;
+		last = stats;
+	}
+
+	server.Stop();
+	return 0;
+}
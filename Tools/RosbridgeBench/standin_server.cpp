@@ -0,0 +1,654 @@
+#include "standin_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <bson.h>
+
+#include "cbor_codec.h"
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+namespace rosbridge_bench {
+
+	static int64_t SteadyNowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static std::vector<uint8_t> ToBytes(const bson_t *bson)
+	{
+		const uint8_t *data = bson_get_data(bson);
+		return std::vector<uint8_t>(data, data + bson->len);
+	}
+
+	static std::vector<uint8_t> ToBytes(const rapidjson::Document& document)
+	{
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		document.Accept(writer);
+		return std::vector<uint8_t>(buffer.GetString(), buffer.GetString() + buffer.GetSize());
+	}
+
+	static std::string GetUTF8(const bson_t *bson, const char *key)
+	{
+		bson_iter_t iter;
+		if (bson_iter_init_find(&iter, bson, key) && BSON_ITER_HOLDS_UTF8(&iter)) {
+			uint32_t length = 0;
+			const char *value = bson_iter_utf8(&iter, &length);
+			return std::string(value, length);
+		}
+		return "";
+	}
+
+	static int GetInt32(const bson_t *bson, const char *key)
+	{
+		bson_iter_t iter;
+		if (bson_iter_init_find(&iter, bson, key) && BSON_ITER_HOLDS_INT32(&iter)) return bson_iter_int32(&iter);
+		return 0;
+	}
+
+	static int GetInt(const rapidjson::Document& document, const char *key)
+	{
+		auto member = document.FindMember(key);
+		if (member != document.MemberEnd() && member->value.IsInt()) return member->value.GetInt();
+		return 0;
+	}
+
+	static std::string GetString(const rapidjson::Document& document, const char *key)
+	{
+		auto member = document.FindMember(key);
+		if (member != document.MemberEnd() && member->value.IsString()) {
+			return std::string(member->value.GetString(), member->value.GetStringLength());
+		}
+		return "";
+	}
+
+	// Copies document into out, with the descriptors of payloads in the ring replaced by the payloads themselves
+	static void InlinePayloads(const rosbridge2cpp::SharedMemoryRing& ring, const bson_t *document, bson_t *out,
+		std::vector<rosbridge2cpp::SharedMemoryDescriptor>& descriptors)
+	{
+		bson_iter_t iter;
+		if (!bson_iter_init(&iter, document)) return;
+		while (bson_iter_next(&iter)) {
+			const char *key = bson_iter_key(&iter);
+			if (!BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+				bson_append_iter(out, key, -1, &iter);
+				continue;
+			}
+
+			uint32_t length = 0;
+			const uint8_t *data = nullptr;
+			bson_iter_document(&iter, &length, &data);
+			bson_t child;
+			bson_init_static(&child, data, length);
+
+			rosbridge2cpp::SharedMemoryDescriptor descriptor;
+			if (rosbridge2cpp::SharedMemoryRing::ReadDescriptor(&child, descriptor)) {
+				descriptors.push_back(descriptor);
+				const uint8_t *payload = ring.Resolve(descriptor);
+				if (payload) {
+					BSON_APPEND_BINARY(out, key, BSON_SUBTYPE_BINARY, payload, descriptor.length_);
+				}
+				continue;
+			}
+
+			bson_t out_child;
+			BSON_APPEND_DOCUMENT_BEGIN(out, key, &out_child);
+			InlinePayloads(ring, &child, &out_child, descriptors);
+			bson_append_document_end(out, &out_child);
+		}
+	}
+
+	// Collects the descriptors of a document without touching the payloads
+	static void FindDescriptors(const bson_t *document, std::vector<rosbridge2cpp::SharedMemoryDescriptor>& descriptors)
+	{
+		bson_iter_t iter;
+		if (!bson_iter_init(&iter, document)) return;
+		while (bson_iter_next(&iter)) {
+			if (!BSON_ITER_HOLDS_DOCUMENT(&iter)) continue;
+			uint32_t length = 0;
+			const uint8_t *data = nullptr;
+			bson_iter_document(&iter, &length, &data);
+			bson_t child;
+			bson_init_static(&child, data, length);
+
+			rosbridge2cpp::SharedMemoryDescriptor descriptor;
+			if (rosbridge2cpp::SharedMemoryRing::ReadDescriptor(&child, descriptor)) descriptors.push_back(descriptor);
+			else FindDescriptors(&child, descriptors);
+		}
+	}
+
+	StandinServer::~StandinServer()
+	{
+		Stop();
+	}
+
+	bool StandinServer::ParseMode(const std::string& name, Mode& mode)
+	{
+		if (name == "echo") { mode = Mode::ECHO; return true; }
+		if (name == "sink") { mode = Mode::SINK; return true; }
+		if (name == "generate") { mode = Mode::GENERATE; return true; }
+		return false;
+	}
+
+	bool StandinServer::Start()
+	{
+		listen_fd_ = options_.transport_ == Transport::UNIX ? ListenUnix(options_.host_) : ListenTcp(options_.host_, options_.port_, port_);
+		if (listen_fd_ < 0) {
+			std::cerr << "[StandinServer] Couldn't listen on " << options_.host_ << ":" << options_.port_ << std::endl;
+			return false;
+		}
+
+		running_ = true;
+		accept_thread_ = std::thread(&StandinServer::AcceptThreadFunction, this);
+		if (options_.mode_ == Mode::GENERATE) {
+			generator_thread_ = std::thread(&StandinServer::GeneratorThreadFunction, this);
+		}
+		return true;
+	}
+
+	void StandinServer::Stop()
+	{
+		if (!running_.exchange(false)) return;
+
+		shutdown(listen_fd_, SHUT_RDWR);
+		close(listen_fd_);
+		accept_thread_.join();
+		if (options_.transport_ == Transport::UNIX) unlink(options_.host_.c_str());
+
+		{
+			std::lock_guard<std::mutex> lock(generator_mutex_);
+			generator_cv_.notify_all();
+		}
+		if (generator_thread_.joinable()) generator_thread_.join();
+
+		std::list<ClientPtr> clients;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			clients.swap(clients_);
+			subscribers_.clear();
+			service_providers_.clear();
+			pending_service_calls_.clear();
+		}
+		for (auto& client : clients) {
+			shutdown(client->stream_.fd(), SHUT_RDWR);
+		}
+		for (auto& client : clients) {
+			client->thread_.join();
+			close(client->stream_.fd());
+		}
+	}
+
+	StandinServer::Stats StandinServer::GetStats() const
+	{
+		Stats stats;
+		stats.messages_received_ = messages_received_.load(std::memory_order_relaxed);
+		stats.bytes_received_ = bytes_received_.load(std::memory_order_relaxed);
+		stats.messages_sent_ = messages_sent_.load(std::memory_order_relaxed);
+		stats.bytes_sent_ = bytes_sent_.load(std::memory_order_relaxed);
+		stats.publishes_ = publishes_.load(std::memory_order_relaxed);
+		stats.service_calls_ = service_calls_.load(std::memory_order_relaxed);
+		stats.shm_payloads_ = shm_payloads_.load(std::memory_order_relaxed);
+		stats.shm_stale_ = shm_stale_.load(std::memory_order_relaxed);
+		stats.cbor_messages_ = cbor_messages_.load(std::memory_order_relaxed);
+		stats.throttled_ = throttled_.load(std::memory_order_relaxed);
+		stats.fragments_ = fragments_.load(std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (const auto& client : clients_) {
+			if (!client->closed_) stats.clients_++;
+		}
+		return stats;
+	}
+
+	void StandinServer::AcceptThreadFunction()
+	{
+		while (running_) {
+			const int fd = accept(listen_fd_, nullptr, nullptr);
+			if (fd < 0) {
+				if (running_ && errno == EINTR) continue;
+				break;
+			}
+
+			if (options_.transport_ == Transport::WEBSOCKET && !WebsocketServerHandshake(fd)) {
+				std::cerr << "[StandinServer] Websocket handshake failed" << std::endl;
+				close(fd);
+				continue;
+			}
+
+			ClientPtr client = std::make_shared<Client>(fd, options_);
+			std::list<ClientPtr> finished_clients;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (!running_) {
+					close(fd);
+					break;
+				}
+				// reap the connections that have been closed in the meantime
+				for (auto it = clients_.begin(); it != clients_.end();) {
+					if ((*it)->closed_) {
+						finished_clients.push_back(*it);
+						it = clients_.erase(it);
+					}
+					else {
+						++it;
+					}
+				}
+				clients_.push_back(client);
+				client->thread_ = std::thread(&StandinServer::ClientThreadFunction, this, client);
+			}
+			for (auto& finished_client : finished_clients) {
+				finished_client->thread_.join();
+				close(finished_client->stream_.fd());
+			}
+		}
+	}
+
+	void StandinServer::ClientThreadFunction(ClientPtr client)
+	{
+		std::vector<uint8_t> message;
+		while (running_ && client->stream_.Read(message)) {
+			messages_received_.fetch_add(1, std::memory_order_relaxed);
+			bytes_received_.fetch_add(message.size(), std::memory_order_relaxed);
+			HandleMessage(client, message);
+		}
+		RemoveClient(client);
+
+		// after this, the socket may be closed at any time, see AcceptThreadFunction()
+		std::lock_guard<std::mutex> lock(client->write_mutex_);
+		client->closed_ = true;
+	}
+
+	void StandinServer::RemoveClient(const ClientPtr& client)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (auto& topic : subscribers_) {
+			auto& clients = topic.second;
+			clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+		}
+		for (auto it = service_providers_.begin(); it != service_providers_.end();) {
+			if (it->second == client) it = service_providers_.erase(it);
+			else ++it;
+		}
+		for (auto it = pending_service_calls_.begin(); it != pending_service_calls_.end();) {
+			if (it->second == client) it = pending_service_calls_.erase(it);
+			else ++it;
+		}
+	}
+
+	bool StandinServer::Send(const ClientPtr& client, const uint8_t *data, size_t length)
+	{
+		std::lock_guard<std::mutex> lock(client->write_mutex_);
+		if (client->closed_ || !client->stream_.Write(data, length)) return false;
+		messages_sent_.fetch_add(1, std::memory_order_relaxed);
+		bytes_sent_.fetch_add(length, std::memory_order_relaxed);
+		return true;
+	}
+
+	void StandinServer::SendToSubscribers(const std::string& topic, const std::vector<uint8_t>& message)
+	{
+		std::vector<std::pair<ClientPtr, Subscription>> receivers;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto it = subscribers_.find(topic);
+			if (it == subscribers_.end()) return;
+			const auto now = std::chrono::steady_clock::now();
+			for (const auto& client : it->second) {
+				Subscription& subscription = client->subscriptions_[topic];
+				if (subscription.throttle_rate_ > 0 && now - subscription.last_sent_ < std::chrono::milliseconds(subscription.throttle_rate_)) {
+					throttled_.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+				subscription.last_sent_ = now;
+				receivers.emplace_back(client, subscription);
+			}
+		}
+
+		std::vector<uint8_t> cbor_message;
+		for (const auto& receiver : receivers) {
+			if (!receiver.second.cbor_) {
+				const size_t fragment_size = static_cast<size_t>(std::max(receiver.second.fragment_size_, 0));
+				if (fragment_size > 0 && message.size() > fragment_size) SendFragments(receiver.first, message, fragment_size);
+				else Send(receiver.first, message);
+				continue;
+			}
+			if (cbor_message.empty()) {
+				bson_t bson;
+				if (!bson_init_static(&bson, message.data(), message.size())) return;
+				rosbridge2cpp::CBORCodec::FromBSON(&bson, cbor_message);
+			}
+			if (Send(receiver.first, cbor_message)) cbor_messages_.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	bool StandinServer::SendFragments(const ClientPtr& client, const std::vector<uint8_t>& message, size_t fragment_size)
+	{
+		const std::string id = "fragmented:" + std::to_string(fragmented_message_ids_.fetch_add(1, std::memory_order_relaxed));
+		const int total = static_cast<int>((message.size() + fragment_size - 1) / fragment_size);
+		for (int num = 0; num < total; ++num) {
+			const size_t begin = num * fragment_size;
+			const size_t length = std::min(fragment_size, message.size() - begin);
+			std::vector<uint8_t> fragment;
+			if (options_.encoding_ == Encoding::BSON) {
+				bson_t bson;
+				bson_init(&bson);
+				BSON_APPEND_UTF8(&bson, "op", "fragment");
+				BSON_APPEND_UTF8(&bson, "id", id.c_str());
+				BSON_APPEND_BINARY(&bson, "data", BSON_SUBTYPE_BINARY, message.data() + begin, static_cast<uint32_t>(length));
+				BSON_APPEND_INT32(&bson, "num", num);
+				BSON_APPEND_INT32(&bson, "total", total);
+				fragment = ToBytes(&bson);
+				bson_destroy(&bson);
+			}
+			else {
+				rapidjson::Document document(rapidjson::kObjectType);
+				auto& allocator = document.GetAllocator();
+				document.AddMember("op", "fragment", allocator);
+				document.AddMember("id", rapidjson::Value(id.c_str(), allocator), allocator);
+				document.AddMember("data", rapidjson::Value(reinterpret_cast<const char*>(message.data() + begin), static_cast<rapidjson::SizeType>(length), allocator), allocator);
+				document.AddMember("num", num, allocator);
+				document.AddMember("total", total, allocator);
+				fragment = ToBytes(document);
+			}
+			if (!Send(client, fragment)) return false;
+			fragments_.fetch_add(1, std::memory_order_relaxed);
+		}
+		return true;
+	}
+
+	bool StandinServer::ParseEnvelope(const std::vector<uint8_t>& message, Envelope& envelope) const
+	{
+		if (options_.encoding_ == Encoding::BSON) {
+			bson_t bson;
+			if (!bson_init_static(&bson, message.data(), message.size())) return false;
+			envelope.op_ = GetUTF8(&bson, "op");
+			envelope.topic_ = GetUTF8(&bson, "topic");
+			envelope.service_ = GetUTF8(&bson, "service");
+			envelope.id_ = GetUTF8(&bson, "id");
+			envelope.compression_ = GetUTF8(&bson, "compression");
+			envelope.throttle_rate_ = GetInt32(&bson, "throttle_rate");
+			envelope.fragment_size_ = GetInt32(&bson, "fragment_size");
+		}
+		else {
+			rapidjson::Document document;
+			document.Parse(reinterpret_cast<const char*>(message.data()), message.size());
+			if (document.HasParseError() || !document.IsObject()) return false;
+			envelope.op_ = GetString(document, "op");
+			envelope.topic_ = GetString(document, "topic");
+			envelope.service_ = GetString(document, "service");
+			envelope.id_ = GetString(document, "id");
+			envelope.compression_ = GetString(document, "compression");
+			envelope.throttle_rate_ = GetInt(document, "throttle_rate");
+			envelope.fragment_size_ = GetInt(document, "fragment_size");
+		}
+		return !envelope.op_.empty();
+	}
+
+	void StandinServer::HandleMessage(const ClientPtr& client, std::vector<uint8_t>& message)
+	{
+		Envelope envelope;
+		if (!ParseEnvelope(message, envelope)) {
+			std::cerr << "[StandinServer] Ignoring malformed message of " << message.size() << " bytes" << std::endl;
+			return;
+		}
+
+		if (envelope.op_ == "publish") {
+			publishes_.fetch_add(1, std::memory_order_relaxed);
+			if (client->payload_ring_ && !ConsumePayloads(client, message, options_.mode_ == Mode::ECHO)) return;
+			if (options_.mode_ != Mode::ECHO) return;
+
+			SendToSubscribers(envelope.topic_, message);
+		}
+		else if (envelope.op_ == "subscribe") {
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto& clients = subscribers_[envelope.topic_];
+			if (std::find(clients.begin(), clients.end(), client) == clients.end()) clients.push_back(client);
+			Subscription& subscription = client->subscriptions_[envelope.topic_];
+			subscription.cbor_ = envelope.compression_ == "cbor" && options_.encoding_ == Encoding::BSON;
+			subscription.throttle_rate_ = envelope.throttle_rate_;
+			subscription.fragment_size_ = envelope.fragment_size_;
+		}
+		else if (envelope.op_ == "unsubscribe") {
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto& clients = subscribers_[envelope.topic_];
+			clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+			client->subscriptions_.erase(envelope.topic_);
+		}
+		else if (envelope.op_ == "advertise_service") {
+			std::lock_guard<std::mutex> lock(mutex_);
+			service_providers_[envelope.service_] = client;
+		}
+		else if (envelope.op_ == "unadvertise_service") {
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto it = service_providers_.find(envelope.service_);
+			if (it != service_providers_.end() && it->second == client) service_providers_.erase(it);
+		}
+		else if (envelope.op_ == "call_service") {
+			service_calls_.fetch_add(1, std::memory_order_relaxed);
+
+			ClientPtr provider;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				auto it = service_providers_.find(envelope.service_);
+				if (it != service_providers_.end()) {
+					provider = it->second;
+					pending_service_calls_[envelope.id_] = client;
+				}
+			}
+			if (provider) {
+				Send(provider, message);
+			}
+			else {
+				Send(client, EchoServiceResponse(message, envelope));
+			}
+		}
+		else if (envelope.op_ == "service_response") {
+			ClientPtr caller;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				auto it = pending_service_calls_.find(envelope.id_);
+				if (it != pending_service_calls_.end()) {
+					caller = it->second;
+					pending_service_calls_.erase(it);
+				}
+			}
+			if (caller) Send(caller, message);
+		}
+		else if (envelope.op_ == "shm_open" && options_.encoding_ == Encoding::BSON) {
+			OpenPayloadRing(client, message);
+		}
+		// advertise and unadvertise don't need any bookkeeping, publish messages are routed by topic name only
+	}
+
+	void StandinServer::OpenPayloadRing(const ClientPtr& client, const std::vector<uint8_t>& message)
+	{
+		bson_t bson;
+		bson_init_static(&bson, message.data(), message.size());
+		const std::string name = GetUTF8(&bson, "name");
+
+		std::unique_ptr<rosbridge2cpp::SharedMemoryRing> ring(new rosbridge2cpp::SharedMemoryRing());
+		const bool result = !name.empty() && ring->Open(name);
+		if (result) {
+			client->payload_ring_ = std::move(ring);
+		}
+		else {
+			std::cerr << "[StandinServer] Couldn't map the shared memory ring '" << name << "'" << std::endl;
+		}
+
+		bson_t *response = bson_new();
+		BSON_APPEND_UTF8(response, "op", "shm_ready");
+		BSON_APPEND_UTF8(response, "name", name.c_str());
+		BSON_APPEND_BOOL(response, "result", result);
+		Send(client, ToBytes(response));
+		bson_destroy(response);
+	}
+
+	bool StandinServer::ConsumePayloads(const ClientPtr& client, std::vector<uint8_t>& message, bool inline_payloads)
+	{
+		const rosbridge2cpp::SharedMemoryRing& ring = *client->payload_ring_;
+		bson_t bson;
+		if (!bson_init_static(&bson, message.data(), message.size())) return false;
+
+		std::vector<rosbridge2cpp::SharedMemoryDescriptor> descriptors;
+		bson_t *inlined = nullptr;
+		if (inline_payloads) {
+			inlined = bson_new();
+			InlinePayloads(ring, &bson, inlined, descriptors);
+		}
+		else {
+			FindDescriptors(&bson, descriptors);
+		}
+
+		// the payloads have been copied (or weren't needed), so the slots may be reused now
+		bool current = true;
+		for (const auto& descriptor : descriptors) {
+			if (!ring.Resolve(descriptor) || !ring.IsCurrent(descriptor)) current = false;
+
+			bson_t *ack = bson_new();
+			BSON_APPEND_UTF8(ack, "op", "shm_ack");
+			BSON_APPEND_INT64(ack, "shm_offset", static_cast<int64_t>(descriptor.offset_));
+			BSON_APPEND_INT32(ack, "shm_length", static_cast<int32_t>(descriptor.length_));
+			BSON_APPEND_INT32(ack, "shm_generation", static_cast<int32_t>(descriptor.generation_));
+			Send(client, ToBytes(ack));
+			bson_destroy(ack);
+		}
+
+		if (!descriptors.empty()) {
+			if (current) {
+				shm_payloads_.fetch_add(descriptors.size(), std::memory_order_relaxed);
+				if (inlined) message = ToBytes(inlined);
+			}
+			else {
+				shm_stale_.fetch_add(1, std::memory_order_relaxed);
+				std::cerr << "[StandinServer] Dropping a message whose shared memory payload was overwritten" << std::endl;
+			}
+		}
+		if (inlined) bson_destroy(inlined);
+		return current;
+	}
+
+	std::vector<uint8_t> StandinServer::EchoServiceResponse(const std::vector<uint8_t>& request, const Envelope& envelope) const
+	{
+		if (options_.encoding_ == Encoding::BSON) {
+			bson_t request_bson;
+			bson_init_static(&request_bson, request.data(), request.size());
+
+			bson_t *response = bson_new();
+			BSON_APPEND_UTF8(response, "op", "service_response");
+			BSON_APPEND_UTF8(response, "service", envelope.service_.c_str());
+			if (!envelope.id_.empty()) BSON_APPEND_UTF8(response, "id", envelope.id_.c_str());
+
+			bson_iter_t iter;
+			if (bson_iter_init_find(&iter, &request_bson, "args") && BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+				uint32_t length = 0;
+				const uint8_t *data = nullptr;
+				bson_iter_document(&iter, &length, &data);
+				bson_t args;
+				bson_init_static(&args, data, length);
+				BSON_APPEND_DOCUMENT(response, "values", &args);
+			}
+			else {
+				bson_t values;
+				BSON_APPEND_DOCUMENT_BEGIN(response, "values", &values);
+				bson_append_document_end(response, &values);
+			}
+			BSON_APPEND_BOOL(response, "result", true);
+
+			std::vector<uint8_t> bytes = ToBytes(response);
+			bson_destroy(response);
+			return bytes;
+		}
+
+		rapidjson::Document request_document;
+		request_document.Parse(reinterpret_cast<const char*>(request.data()), request.size());
+
+		rapidjson::Document response(rapidjson::kObjectType);
+		auto& alloc = response.GetAllocator();
+		response.AddMember("op", "service_response", alloc);
+		response.AddMember("service", rapidjson::Value(envelope.service_.c_str(), alloc), alloc);
+		if (!envelope.id_.empty()) response.AddMember("id", rapidjson::Value(envelope.id_.c_str(), alloc), alloc);
+
+		auto args = request_document.FindMember("args");
+		if (args != request_document.MemberEnd() && args->value.IsObject()) {
+			response.AddMember("values", rapidjson::Value(args->value, alloc), alloc);
+		}
+		else {
+			response.AddMember("values", rapidjson::Value(rapidjson::kObjectType), alloc);
+		}
+		response.AddMember("result", true, alloc);
+		return ToBytes(response);
+	}
+
+	std::vector<uint8_t> StandinServer::GeneratedMessage(const std::string& topic, uint64_t seq) const
+	{
+		if (options_.encoding_ == Encoding::BSON) {
+			std::vector<uint8_t> data(options_.generate_size_, 0xAB);
+
+			bson_t *message = bson_new();
+			BSON_APPEND_UTF8(message, "op", "publish");
+			BSON_APPEND_UTF8(message, "topic", topic.c_str());
+			bson_t msg;
+			BSON_APPEND_DOCUMENT_BEGIN(message, "msg", &msg);
+			BSON_APPEND_BINARY(&msg, "data", BSON_SUBTYPE_BINARY, data.data(), static_cast<uint32_t>(data.size()));
+			BSON_APPEND_INT64(&msg, "seq", static_cast<int64_t>(seq));
+			BSON_APPEND_INT64(&msg, "sent_ns", SteadyNowNs());
+			bson_append_document_end(message, &msg);
+
+			std::vector<uint8_t> bytes = ToBytes(message);
+			bson_destroy(message);
+			return bytes;
+		}
+
+		const std::string data(options_.generate_size_, 'x');
+
+		rapidjson::Document message(rapidjson::kObjectType);
+		auto& alloc = message.GetAllocator();
+		message.AddMember("op", "publish", alloc);
+		message.AddMember("topic", rapidjson::Value(topic.c_str(), alloc), alloc);
+		rapidjson::Value msg(rapidjson::kObjectType);
+		msg.AddMember("data", rapidjson::Value(data.c_str(), static_cast<rapidjson::SizeType>(data.size()), alloc), alloc);
+		msg.AddMember("seq", static_cast<int64_t>(seq), alloc);
+		msg.AddMember("sent_ns", SteadyNowNs(), alloc);
+		message.AddMember("msg", msg, alloc);
+		return ToBytes(message);
+	}
+
+	void StandinServer::GeneratorThreadFunction()
+	{
+		const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(1.0 / std::max(options_.generate_rate_, 0.001)));
+		auto next = std::chrono::steady_clock::now();
+		uint64_t seq = 0;
+
+		while (running_) {
+			{
+				std::unique_lock<std::mutex> lock(generator_mutex_);
+				generator_cv_.wait_until(lock, next, [this]() { return !running_; });
+			}
+			if (!running_) break;
+			next += interval;
+
+			std::vector<std::string> topics;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (const auto& topic : subscribers_) {
+					if (!topic.second.empty()) topics.push_back(topic.first);
+				}
+			}
+			for (const auto& topic : topics) {
+				SendToSubscribers(topic, GeneratedMessage(topic, seq));
+			}
+			seq++;
+
+			// don't try to catch up after a stall, that would only produce a burst
+			if (std::chrono::steady_clock::now() > next + interval) next = std::chrono::steady_clock::now();
+		}
+	}
+}
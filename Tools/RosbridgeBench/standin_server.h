@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "message_stream.h"
+#include "shared_memory_ring.h"
+
+namespace rosbridge_bench {
+
+	/**
+	 * A small stand-in for rosbridge_server, so the rosbridge2cpp client can be exercised without ROS.
+	 *
+	 * It understands the subset of the rosbridge v2 protocol that ROSIntegration uses:
+	 * advertise, unadvertise, publish, subscribe, unsubscribe, call_service, advertise_service,
+	 * unadvertise_service and service_response. Messages are routed as raw bytes, so the server
+	 * adds as little overhead as possible to the measurements of the client.
+	 *
+	 * In BSON mode it also accepts the shared memory ring of a client on the same host (shm_open, see
+	 * ROSBridge::SetSharedMemoryPayloads). Payloads in the ring are acknowledged (shm_ack) once they have been
+	 * consumed: in ECHO mode they are copied back into the message for the subscribers, in the other modes
+	 * they are dropped after the descriptor has been checked.
+	 *
+	 * Subscriptions with compression "cbor" receive their messages CBOR encoded like from rosbridge (BSON mode only).
+	 * The throttle_rate of a subscription drops the messages that follow a sent one within that many ms, and
+	 * messages larger than its fragment_size are split into 'fragment' messages.
+	 *
+	 * ECHO:     publish messages are forwarded to all subscribers of the topic, including the publisher.
+	 *           call_service is forwarded to the client that advertised the service, or answered with
+	 *           the request arguments as values if nobody did.
+	 * SINK:     publish messages are counted and dropped, services are answered like in ECHO.
+	 * GENERATE: like SINK, but every subscribed topic receives generated messages of the given size and rate.
+	 */
+	class StandinServer {
+	public:
+		enum class Mode { ECHO, SINK, GENERATE };
+
+		struct Options {
+			Transport transport_ = Transport::TCP;
+			Encoding encoding_ = Encoding::BSON;
+			Mode mode_ = Mode::ECHO;
+			std::string host_ = "127.0.0.1"; // path of the socket for Transport::UNIX
+			int port_ = 9090; // 0 picks a free port, see Port()
+			size_t generate_size_ = 1024;
+			double generate_rate_ = 100.0; // messages per second and topic
+		};
+
+		struct Stats {
+			uint64_t messages_received_ = 0;
+			uint64_t bytes_received_ = 0;
+			uint64_t messages_sent_ = 0;
+			uint64_t bytes_sent_ = 0;
+			uint64_t publishes_ = 0;
+			uint64_t service_calls_ = 0;
+			uint64_t shm_payloads_ = 0; // payloads received through shared memory
+			uint64_t shm_stale_ = 0; // payloads whose slot had been reused before they were read
+			uint64_t cbor_messages_ = 0; // messages sent CBOR encoded
+			uint64_t throttled_ = 0; // messages not sent because of the throttle_rate of a subscription
+			uint64_t fragments_ = 0;
+			size_t clients_ = 0;
+		};
+
+		explicit StandinServer(const Options& options) : options_(options) {}
+		~StandinServer();
+
+		bool Start();
+		void Stop();
+
+		int Port() const { return port_; }
+		Stats GetStats() const;
+
+		static bool ParseMode(const std::string& name, Mode& mode);
+
+	private:
+		// The options of a subscription that the server applies
+		struct Subscription {
+			bool cbor_ = false;
+			int throttle_rate_ = 0; // ms
+			int fragment_size_ = 0; // 0 never fragments
+			std::chrono::steady_clock::time_point last_sent_;
+		};
+
+		struct Client {
+			explicit Client(int fd, const Options& options) : stream_(fd, options.transport_, options.encoding_, false) {}
+
+			MessageStream stream_;
+			std::unique_ptr<rosbridge2cpp::SharedMemoryRing> payload_ring_; // only used by the thread of the client
+			std::unordered_map<std::string, Subscription> subscriptions_; // guarded by StandinServer::mutex_
+			std::mutex write_mutex_;
+			std::thread thread_;
+			std::atomic<bool> closed_{ false };
+		};
+		typedef std::shared_ptr<Client> ClientPtr;
+
+		// The fields of an incoming message that are needed for routing
+		struct Envelope {
+			std::string op_;
+			std::string topic_;
+			std::string service_;
+			std::string id_;
+			std::string compression_;
+			int throttle_rate_ = 0;
+			int fragment_size_ = 0;
+		};
+
+		void AcceptThreadFunction();
+		void ClientThreadFunction(ClientPtr client);
+		void GeneratorThreadFunction();
+
+		bool ParseEnvelope(const std::vector<uint8_t>& message, Envelope& envelope) const;
+		void HandleMessage(const ClientPtr& client, std::vector<uint8_t>& message);
+		void RemoveClient(const ClientPtr& client);
+
+		bool Send(const ClientPtr& client, const uint8_t *data, size_t length);
+		bool Send(const ClientPtr& client, const std::vector<uint8_t>& data) { return Send(client, data.data(), data.size()); }
+
+		// Sends a publish message to all subscribers of the topic. It is encoded to CBOR once if any of them asked for it.
+		void SendToSubscribers(const std::string& topic, const std::vector<uint8_t>& message);
+
+		// Splits the serialized message into 'fragment' messages of at most fragment_size bytes of it, like rosbridge
+		bool SendFragments(const ClientPtr& client, const std::vector<uint8_t>& message, size_t fragment_size);
+
+		// Answers a call_service that no client advertised by echoing the arguments
+		std::vector<uint8_t> EchoServiceResponse(const std::vector<uint8_t>& request, const Envelope& envelope) const;
+		std::vector<uint8_t> GeneratedMessage(const std::string& topic, uint64_t seq) const;
+
+		// Maps the ring of a shm_open message and answers with shm_ready
+		void OpenPayloadRing(const ClientPtr& client, const std::vector<uint8_t>& message);
+
+		// Resolves the shared memory descriptors of a publish message and acknowledges them. With inline_payloads,
+		// message is replaced by a copy that contains the payloads as binary fields.
+		// Returns false if a payload had been overwritten before it was read.
+		bool ConsumePayloads(const ClientPtr& client, std::vector<uint8_t>& message, bool inline_payloads);
+
+		Options options_;
+		int listen_fd_ = -1;
+		int port_ = 0;
+		std::atomic<bool> running_{ false };
+		std::thread accept_thread_;
+		std::thread generator_thread_;
+		std::mutex generator_mutex_;
+		std::condition_variable generator_cv_;
+
+		mutable std::mutex mutex_;
+		std::list<ClientPtr> clients_;
+		std::unordered_map<std::string, std::vector<ClientPtr>> subscribers_;
+		std::unordered_map<std::string, ClientPtr> service_providers_;
+		std::unordered_map<std::string, ClientPtr> pending_service_calls_; // call id -> caller
+
+		std::atomic<uint64_t> messages_received_{ 0 };
+		std::atomic<uint64_t> bytes_received_{ 0 };
+		std::atomic<uint64_t> messages_sent_{ 0 };
+		std::atomic<uint64_t> bytes_sent_{ 0 };
+		std::atomic<uint64_t> publishes_{ 0 };
+		std::atomic<uint64_t> service_calls_{ 0 };
+		std::atomic<uint64_t> shm_payloads_{ 0 };
+		std::atomic<uint64_t> shm_stale_{ 0 };
+		std::atomic<uint64_t> cbor_messages_{ 0 };
+		std::atomic<uint64_t> throttled_{ 0 };
+		std::atomic<uint64_t> fragments_{ 0 };
+		std::atomic<uint64_t> fragmented_message_ids_{ 0 };
+	};
+}